@@ -32,10 +32,60 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_BLE_DATA_SPS_MAX_CHANNELS
+/** The number of SPS connections per ble instance for which
+ * uBleDataSendQueued() and uBleDataGetStats() can be used.
+ */
+# define U_BLE_DATA_SPS_MAX_CHANNELS 2
+#endif
+
+#ifndef U_BLE_DATA_SPS_TX_BUDGET_BYTES
+/** The number of bytes that uBleDataSendQueued() will hold for
+ * each SPS connection, i.e. the credits each starts with.
+ */
+# define U_BLE_DATA_SPS_TX_BUDGET_BYTES 1024
+#endif
+
+#ifndef U_BLE_DATA_SPS_TX_TASK_STACK_SIZE_BYTES
+/** The stack size of the task that sends queued SPS data.
+ */
+# define U_BLE_DATA_SPS_TX_TASK_STACK_SIZE_BYTES 1536
+#endif
+
+#ifndef U_BLE_DATA_SPS_TX_TASK_PRIORITY
+/** The priority of the task that sends queued SPS data.
+ */
+# define U_BLE_DATA_SPS_TX_TASK_PRIORITY (U_CFG_OS_PRIORITY_MAX - 5)
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** Statistics for an SPS connection, see uBleDataGetStats().
+ */
+typedef struct {
+    int32_t frameSize;   /**< the frame size of the connection, as
+                              given by the module when it connected. */
+    int32_t txCredits;   /**< the number of bytes uBleDataSendQueued()
+                              would accept right now. */
+    uint32_t txBytes;    /**< the number of bytes sent since the
+                              connection was made. */
+    uint32_t txDiscarded; /**< the number of bytes queued with
+                               uBleDataSendQueued() that were thrown
+                               away because the module could not be
+                               given them. */
+    uint32_t rxBytes;    /**< the number of bytes received since the
+                              connection was made. */
+    uint32_t rxDiscarded; /**< the number of bytes received that were
+                               thrown away because the receive buffer,
+                               see uBleDataSetReceiveBuffer(), was full. */
+    int32_t txBytesPerSecond; /**< the average send rate since the
+                                   connection was made. */
+    int32_t rxBytesPerSecond; /**< the average receive rate since the
+                                   connection was made. */
+} uBleDataSpsStats_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -107,6 +157,102 @@ int32_t uBleDataDisconnect(int32_t bleHandle, int32_t connHandle);
  */
 int32_t uBleDataSend(int32_t bleHandle, int32_t channel, const char *pData, int32_t length);
 
+/** Send data in throughput mode: the data is copied into a queue
+ * for the channel and sent in the background, the queued data
+ * of all channels being written to the module together.  Each
+ * channel has U_BLE_DATA_SPS_TX_BUDGET_BYTES of credit; queuing
+ * uses credit up and sending gives it back, and only as much data
+ * as there is credit for is accepted, so a return value less
+ * than length means the application should wait before sending
+ * the rest; uBleDataGetCredits() tells it when.  A connection
+ * status callback must have been set with
+ * uBleDataSetCallbackConnectionStatus() before the connection was
+ * made, since that is how the channel becomes known; up to
+ * U_BLE_DATA_SPS_MAX_CHANNELS connections are supported.  Data
+ * still queued when the connection is lost is thrown away.
+ *
+ * @param bleHandle   the handle of the ble instance.
+ * @param channel     the channel to send on.
+ * @param pData       pointer to the data, must not be NULL.
+ * @param length      length of data to send, must not be 0.
+ * @return            the number of bytes accepted, which may be
+ *                    zero, else negative error code.
+ */
+int32_t uBleDataSendQueued(int32_t bleHandle, int32_t channel,
+                           const char *pData, int32_t length);
+
+/** Get the number of bytes that uBleDataSendQueued() would
+ * currently accept for a channel.
+ *
+ * @param bleHandle   the handle of the ble instance.
+ * @param channel     the channel.
+ * @return            the number of bytes else negative error code.
+ */
+int32_t uBleDataGetCredits(int32_t bleHandle, int32_t channel);
+
+/** Buffer received data per SPS connection instead of passing
+ * it to the data callback: each connection gets a receive buffer
+ * of bufferSize bytes from which the application reads with
+ * uBleDataReceive() whenever it likes, so that a slow reader
+ * doesn't hold up data for the other connections.  If a buffer
+ * fills up, what doesn't fit is thrown away and counted in the
+ * rxDiscarded field of uBleDataGetStats().  The connections are
+ * known as described for uBleDataSendQueued(); data on a
+ * connection without a receive buffer still goes to the data
+ * callback.  Calling this again throws away anything buffered
+ * and starts again with the new settings.  If there is not
+ * enough memory for all of the buffers then buffering is
+ * switched off.
+ *
+ * @param bleHandle          the handle of the ble instance.
+ * @param bufferSize         the size of the receive buffer of each
+ *                           connection, 0 to switch buffering off.
+ * @param watermark          pCallback is called when the number of
+ *                           bytes in a receive buffer reaches this,
+ *                           having been below it; 1 gives a callback
+ *                           whenever data arrives in an empty buffer,
+ *                           a value close to bufferSize a warning
+ *                           that the buffer is nearly full.  Must be
+ *                           no larger than bufferSize.
+ * @param pCallback          the watermark callback, may be NULL.
+ *                           Parameter order:
+ *                           - channel
+ *                           - the number of bytes in the buffer
+ *                           - pCallbackParameter
+ * @param pCallbackParameter parameter included with the callback.
+ * @return                   zero on success, on failure negative
+ *                           error code.
+ */
+int32_t uBleDataSetReceiveBuffer(int32_t bleHandle, size_t bufferSize,
+                                 size_t watermark,
+                                 void (*pCallback) (int32_t, size_t, void *),
+                                 void *pCallbackParameter);
+
+/** Read data from the receive buffer of an SPS connection, see
+ * uBleDataSetReceiveBuffer(); does not block.
+ *
+ * @param bleHandle   the handle of the ble instance.
+ * @param channel     the channel to read from.
+ * @param pData       a place to put the data, must not be NULL.
+ * @param length      the amount of storage at pData.
+ * @return            the number of bytes read, which may be zero,
+ *                    else negative error code.
+ */
+int32_t uBleDataReceive(int32_t bleHandle, int32_t channel,
+                        char *pData, int32_t length);
+
+/** Get the statistics for an SPS connection.  The connection must
+ * be known as described for uBleDataSendQueued(), though the
+ * statistics include data sent with uBleDataSend() also.
+ *
+ * @param bleHandle   the handle of the ble instance.
+ * @param channel     the channel.
+ * @param pStats      a place to put the statistics, must not be NULL.
+ * @return            zero on success else negative error code.
+ */
+int32_t uBleDataGetStats(int32_t bleHandle, int32_t channel,
+                         uBleDataSpsStats_t *pStats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,17 +29,23 @@
 #endif
 
 #include "stdlib.h"    // malloc() and free()
+#include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
 
 #include "u_error_common.h"
 
+#include "u_port_os.h"
+
 #include "u_at_client.h"
 #include "u_short_range_module_type.h"
 #include "u_short_range.h"
+#include "u_short_range_edm.h"
+#include "u_short_range_private.h"
 
 #include "u_ble_module_type.h"
 #include "u_ble.h"
+#include "u_ble_data_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -109,6 +115,15 @@ int32_t uBleInit()
 // Shut-down the ble driver.
 void uBleDeinit()
 {
+    uShortRangePrivateInstance_t *pInstance;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        for (pInstance = gpUShortRangePrivateInstanceList; pInstance != NULL;
+             pInstance = pInstance->pNext) {
+            uBleDataPrivateRemoveInstance(pInstance);
+        }
+        uShortRangeUnlock();
+    }
     uShortRangeDeinit();
 }
 
@@ -134,6 +149,7 @@ void uBleRemove(int32_t bleHandle)
     errorCode = uShortRangeLock();
 
     if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        uBleDataPrivateRemoveInstance(pUShortRangePrivateGetInstance(bleHandle));
         uShortRangeRemove(bleHandle);
         uShortRangeUnlock();
     }
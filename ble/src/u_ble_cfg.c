@@ -41,6 +41,7 @@
 
 #include "u_short_range_module_type.h"
 #include "u_short_range.h"
+#include "u_short_range_edm.h"
 #include "u_short_range_private.h"
 #include "u_ble_cfg.h"
 
@@ -32,21 +32,25 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
-#include "string.h"    // memset()
+#include "string.h"    // memset(), memcpy()
 
 #include "u_error_common.h"
 
+#include "u_port.h"
 #include "u_port_os.h"
 #include "u_port_debug.h"
+#include "u_port_event_queue.h"
 #include "u_cfg_os_platform_specific.h"
 
 #include "u_at_client.h"
 #include "u_short_range_module_type.h"
 #include "u_short_range.h"
+#include "u_short_range_edm.h"
 #include "u_short_range_private.h"
 #include "u_short_range_edm_stream.h"
 
 #include "u_ble_data.h"
+#include "u_ble_data_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -69,10 +73,330 @@ typedef struct {
     void *pCallbackParameter;
 } uBleDataSpsConnection_t;
 
+/** The state of an SPS connection.
+ */
+typedef struct {
+    int32_t channel; // -1 if this entry is free
+    int32_t frameSize;
+    char txBuffer[U_BLE_DATA_SPS_TX_BUDGET_BYTES]; // Data queued to send
+    size_t txIn;
+    size_t txOut;
+    size_t txCount;
+    uint32_t txBytes;
+    uint32_t txDiscarded;
+    uint32_t rxBytes;
+    char *pRxBuffer; // Data received, if receive buffering is on
+    size_t rxIn;
+    size_t rxOut;
+    size_t rxCount;
+    uint32_t rxDiscarded;
+    int64_t connectedTimeMs;
+} uBleDataSpsChannel_t;
+
+/** The SPS state of a ble instance, hung off the short range
+ * instance; created when a connection status callback is first
+ * set and kept until the instance is removed.
+ */
+typedef struct {
+    uPortMutexHandle_t mutex;
+    int32_t streamHandle;
+    int32_t txEventQueueHandle;
+    bool txPending; // An event is on its way to spsTxEventHandler()
+    char txFrame[U_BLE_DATA_SPS_TX_BUDGET_BYTES]; // Only used by spsTxEventHandler()
+    size_t rxBufferSize; // Zero if receive buffering is off
+    size_t rxWatermark;
+    void (*pRxCallback) (int32_t, size_t, void *);
+    void *pRxCallbackParameter;
+    uBleDataSpsChannel_t channels[U_BLE_DATA_SPS_MAX_CHANNELS];
+} uBleDataSpsContext_t;
+
 /* ----------------------------------------------------------------
  * STATIC VARIABLES
  * -------------------------------------------------------------- */
 
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: SPS CHANNELS
+ * -------------------------------------------------------------- */
+
+// Find the entry for a channel, use -1 to get a free entry.
+// The context mutex must be locked before calling this function.
+static uBleDataSpsChannel_t *pSpsChannelGet(uBleDataSpsContext_t *pContext,
+                                            int32_t channel)
+{
+    uBleDataSpsChannel_t *pChannel = NULL;
+
+    for (size_t x = 0; (x < U_BLE_DATA_SPS_MAX_CHANNELS) && (pChannel == NULL); x++) {
+        if (pContext->channels[x].channel == channel) {
+            pChannel = &(pContext->channels[x]);
+        }
+    }
+
+    return pChannel;
+}
+
+// Average rate in bytes per second since a given time.
+static int32_t bytesPerSecond(uint32_t bytes, int64_t startTimeMs)
+{
+    int64_t durationMs = uPortGetTickTimeMs() - startTimeMs;
+
+    if (durationMs <= 0) {
+        durationMs = 1;
+    }
+
+    return (int32_t) (((int64_t) bytes * 1000) / durationMs);
+}
+
+// Event handler for the SPS transmit event queue: sends the data
+// queued for all channels, a frame's worth of each at a time so
+// that the channels share the link, the frames of one round being
+// written to the module together.  Each frame is copied out under
+// the context mutex and written with the mutex released, since
+// writing to the EDM stream may block on the UART and on the EDM
+// stream's own mutex, and the EDM stream's data task, calling
+// back into here, may be waiting for the context mutex.  If the
+// EDM stream won't take a channel's data, e.g. because the
+// connection has gone, what is queued for that channel is thrown
+// away and counted in its txDiscarded.
+static void spsTxEventHandler(void *pParam, size_t paramLength)
+{
+    uBleDataSpsContext_t *pContext = *((uBleDataSpsContext_t **) pParam);
+    uBleDataSpsChannel_t *pChannel;
+    bool queued;
+    int32_t channel;
+    size_t length;
+    int32_t result;
+
+    (void) paramLength;
+
+    do {
+        queued = false;
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+        // Anything queued from here on is picked up by this
+        // round or, if it comes after, by the next event
+        pContext->txPending = false;
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+        for (size_t x = 0; x < U_BLE_DATA_SPS_MAX_CHANNELS; x++) {
+            pChannel = &(pContext->channels[x]);
+            length = 0;
+
+            U_PORT_MUTEX_LOCK(pContext->mutex);
+
+            channel = pChannel->channel;
+            if ((channel >= 0) && (pChannel->txCount > 0)) {
+                // Contiguous data only, up to a frame
+                length = sizeof(pChannel->txBuffer) - pChannel->txOut;
+                if (length > pChannel->txCount) {
+                    length = pChannel->txCount;
+                }
+                if ((pChannel->frameSize > 0) && (length > (size_t) pChannel->frameSize)) {
+                    length = (size_t) pChannel->frameSize;
+                }
+                memcpy(pContext->txFrame, pChannel->txBuffer + pChannel->txOut, length);
+            }
+
+            U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+            if (length > 0) {
+                result = uShortRangeEdmStreamWriteQueue(pContext->streamHandle,
+                                                        channel, pContext->txFrame,
+                                                        length);
+
+                U_PORT_MUTEX_LOCK(pContext->mutex);
+
+                // Only the data that was copied can have been
+                // consumed, unless the channel has gone meanwhile
+                if ((pChannel->channel == channel) && (pChannel->txCount >= length)) {
+                    if (result == (int32_t) length) {
+                        pChannel->txOut = (pChannel->txOut + length) % sizeof(pChannel->txBuffer);
+                        pChannel->txCount -= length;
+                        pChannel->txBytes += (uint32_t) length;
+                        queued = true;
+                    } else {
+                        // Can't be sent, throw it away
+                        pChannel->txDiscarded += (uint32_t) pChannel->txCount;
+                        pChannel->txIn = 0;
+                        pChannel->txOut = 0;
+                        pChannel->txCount = 0;
+                    }
+                }
+
+                U_PORT_MUTEX_UNLOCK(pContext->mutex);
+            }
+        }
+
+        if (queued) {
+            uShortRangeEdmStreamWriteFlush(pContext->streamHandle);
+        }
+    } while (queued);
+}
+
+// Create the SPS context for an instance if there isn't one.
+// Note: the short range lock should be held when this is called.
+static int32_t spsContextCreate(uShortRangePrivateInstance_t *pInstance)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    uBleDataSpsContext_t *pContext;
+
+    if (pInstance->pSpsContext == NULL) {
+        errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+        pContext = (uBleDataSpsContext_t *) malloc(sizeof(*pContext));
+        if (pContext != NULL) {
+            memset(pContext, 0, sizeof(*pContext));
+            pContext->streamHandle = pInstance->streamHandle;
+            for (size_t x = 0; x < U_BLE_DATA_SPS_MAX_CHANNELS; x++) {
+                pContext->channels[x].channel = -1;
+            }
+            errorCode = uPortMutexCreate(&(pContext->mutex));
+            if (errorCode == 0) {
+                pContext->txEventQueueHandle = uPortEventQueueOpen(spsTxEventHandler,
+                                                                   "bleDataSpsTx",
+                                                                   sizeof(uBleDataSpsContext_t *),
+                                                                   U_BLE_DATA_SPS_TX_TASK_STACK_SIZE_BYTES,
+                                                                   U_BLE_DATA_SPS_TX_TASK_PRIORITY,
+                                                                   U_BLE_DATA_SPS_MAX_CHANNELS);
+                if (pContext->txEventQueueHandle >= 0) {
+                    pInstance->pSpsContext = pContext;
+                } else {
+                    errorCode = pContext->txEventQueueHandle;
+                    uPortMutexDelete(pContext->mutex);
+                }
+            }
+            if (pInstance->pSpsContext == NULL) {
+                free(pContext);
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Note the start or end of an SPS connection.
+static void spsChannelConnection(uShortRangePrivateInstance_t *pInstance,
+                                 bool connected, int32_t channel,
+                                 int32_t frameSize)
+{
+    uBleDataSpsContext_t *pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+    uBleDataSpsChannel_t *pChannel;
+
+    if (pContext != NULL) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        pChannel = pSpsChannelGet(pContext, channel);
+        if (connected && (pChannel == NULL)) {
+            pChannel = pSpsChannelGet(pContext, -1);
+        }
+        if (pChannel != NULL) {
+            // Any data not yet read is lost with the connection
+            free(pChannel->pRxBuffer);
+            pChannel->pRxBuffer = NULL;
+            if (connected && (pContext->rxBufferSize > 0)) {
+                // If this fails received data is passed to the
+                // data callback instead
+                pChannel->pRxBuffer = (char *) malloc(pContext->rxBufferSize);
+            }
+            pChannel->rxIn = 0;
+            pChannel->rxOut = 0;
+            pChannel->rxCount = 0;
+            pChannel->rxDiscarded = 0;
+            pChannel->channel = connected ? channel : -1;
+            pChannel->frameSize = connected ? frameSize : -1;
+            pChannel->txIn = 0;
+            pChannel->txOut = 0;
+            pChannel->txCount = 0;
+            pChannel->txBytes = 0;
+            pChannel->txDiscarded = 0;
+            pChannel->rxBytes = 0;
+            pChannel->connectedTimeMs = uPortGetTickTimeMs();
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+}
+
+// Add to the byte counts of a channel.
+static void spsChannelCount(uShortRangePrivateInstance_t *pInstance,
+                            int32_t channel, uint32_t txBytes,
+                            uint32_t rxBytes)
+{
+    uBleDataSpsContext_t *pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+    uBleDataSpsChannel_t *pChannel;
+
+    if ((pContext != NULL) && (channel >= 0)) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        pChannel = pSpsChannelGet(pContext, channel);
+        if (pChannel != NULL) {
+            pChannel->txBytes += txBytes;
+            pChannel->rxBytes += rxBytes;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+    }
+}
+
+// Put received data into the receive buffer of a channel, returning
+// false if the channel has no receive buffer.  What doesn't fit is
+// thrown away, and counted, rather than holding up the EDM stream.
+static bool spsChannelReceive(uShortRangePrivateInstance_t *pInstance,
+                              int32_t channel, const char *pData,
+                              size_t length)
+{
+    uBleDataSpsContext_t *pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+    uBleDataSpsChannel_t *pChannel;
+    bool buffered = false;
+    bool notify = false;
+    size_t accepted;
+    size_t x = 0;
+
+    if ((pContext != NULL) && (channel >= 0)) {
+
+        U_PORT_MUTEX_LOCK(pContext->mutex);
+
+        pChannel = pSpsChannelGet(pContext, channel);
+        if ((pChannel != NULL) && (pChannel->pRxBuffer != NULL)) {
+            accepted = pContext->rxBufferSize - pChannel->rxCount;
+            if (accepted > length) {
+                accepted = length;
+            }
+            x = pContext->rxBufferSize - pChannel->rxIn;
+            if (x > accepted) {
+                x = accepted;
+            }
+            memcpy(pChannel->pRxBuffer + pChannel->rxIn, pData, x);
+            memcpy(pChannel->pRxBuffer, pData + x, accepted - x);
+            pChannel->rxIn = (pChannel->rxIn + accepted) % pContext->rxBufferSize;
+            // Tell the application when the watermark is reached
+            notify = (pChannel->rxCount < pContext->rxWatermark) &&
+                     (pChannel->rxCount + accepted >= pContext->rxWatermark);
+            pChannel->rxCount += accepted;
+            pChannel->rxDiscarded += (uint32_t) (length - accepted);
+            x = pChannel->rxCount;
+            buffered = true;
+        }
+
+        U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+        if (notify && (pContext->pRxCallback != NULL)) {
+            pContext->pRxCallback(channel, x, pContext->pRxCallbackParameter);
+        }
+    }
+
+    return buffered;
+}
+
+// Whether dataCallback() needs to be registered with the EDM stream.
+static bool dataCallbackNeeded(const uShortRangePrivateInstance_t *pInstance)
+{
+    const uBleDataSpsContext_t *pContext = (const uBleDataSpsContext_t *) pInstance->pSpsContext;
+
+    return (pInstance->pBtDataCallback != NULL) ||
+           ((pContext != NULL) && (pContext->rxBufferSize > 0));
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -129,9 +453,16 @@ static void btEdmConnectionCallback(int32_t streamHandle, uint32_t type,
                                     uint32_t channel, bool ble, int32_t mtu,
                                     char *address, void *pParam)
 {
-    (void) ble;
     (void) streamHandle;
     uShortRangePrivateInstance_t *pInstance = (uShortRangePrivateInstance_t *) pParam;
+
+    if ((pInstance != NULL) && (ble || (type != 0))) {
+        // Only SPS connections are in the EDM connected events for
+        // ble while a disconnected event doesn't say, the channel
+        // will simply not be found if it is not SPS
+        spsChannelConnection(pInstance, (type == 0), (int32_t) channel, mtu);
+    }
+
     // Type 0 == connected
     if (pInstance != NULL && pInstance->atHandle != NULL) {
         uBleDataSpsConnection_t *pStatus = (uBleDataSpsConnection_t *)
@@ -199,9 +530,32 @@ static void dataCallback(int32_t handle, int32_t channel, int32_t length,
     (void)handle;
     uShortRangePrivateInstance_t *pInstance = (uShortRangePrivateInstance_t *) pParameters;
 
-    if ((pInstance != NULL) && (pInstance->pBtDataCallback)) {
-        pInstance->pBtDataCallback(channel, length, pData, pInstance->pBtDataCallbackParameter);
+    if (pInstance != NULL) {
+        spsChannelCount(pInstance, channel, 0, (uint32_t) length);
+        if (!spsChannelReceive(pInstance, channel, pData, (size_t) length) &&
+            (pInstance->pBtDataCallback != NULL)) {
+            pInstance->pBtDataCallback(channel, length, pData, pInstance->pBtDataCallbackParameter);
+        }
+    }
+}
+
+// Register dataCallback() with the EDM stream, or remove it, if
+// that is now needed and wasn't before, or the other way around.
+static int32_t dataCallbackUpdate(uShortRangePrivateInstance_t *pInstance,
+                                  bool wasNeeded)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    bool needed = dataCallbackNeeded(pInstance);
+
+    if (needed && !wasNeeded) {
+        errorCode = uShortRangeEdmStreamDataEventCallbackSet(pInstance->streamHandle, 0, dataCallback,
+                                                             pInstance, U_AT_CLIENT_URC_TASK_STACK_SIZE_BYTES,
+                                                             U_CFG_OS_PRIORITY_MAX - 5);
+    } else if (!needed && wasNeeded) {
+        errorCode = uShortRangeEdmStreamDataEventCallbackSet(pInstance->streamHandle, 0, NULL, NULL, 0, 0);
     }
+
+    return errorCode;
 }
 
 /* ----------------------------------------------------------------
@@ -224,8 +578,13 @@ int32_t uBleDataSetCallbackConnectionStatus(int32_t bleHandle,
                 pInstance->pSpsConnectionCallback = pCallback;
                 pInstance->pSpsConnectionCallbackParameter = pCallbackParameter;
 
-                errorCode = uAtClientSetUrcHandler(pInstance->atHandle, "+UUBTACLC:",
-                                                   UUBTACLC_urc, pInstance);
+                // Needed to track the SPS channels
+                errorCode = spsContextCreate(pInstance);
+
+                if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                    errorCode = uAtClientSetUrcHandler(pInstance->atHandle, "+UUBTACLC:",
+                                                       UUBTACLC_urc, pInstance);
+                }
 
                 if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
                     errorCode = uAtClientSetUrcHandler(pInstance->atHandle, "+UUBTACLD:",
@@ -343,6 +702,9 @@ int32_t uBleDataSend(int32_t bleHandle, int32_t channel, const char *pData, int3
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pInstance != NULL) {
             errorCode = uShortRangeEdmStreamWrite(pInstance->streamHandle, channel, pData, length);
+            if (errorCode > 0) {
+                spsChannelCount(pInstance, channel, (uint32_t) errorCode, 0);
+            }
         }
 
         uShortRangeUnlock();
@@ -363,18 +725,17 @@ int32_t uBleDataSetCallbackData(int32_t bleHandle,
         pInstance = pUShortRangePrivateGetInstance(bleHandle);
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (pInstance != NULL) {
+            bool wasNeeded = dataCallbackNeeded(pInstance);
             if (pInstance->pBtDataCallback == NULL && pCallback != NULL) {
                 pInstance->pBtDataCallback = pCallback;
                 pInstance->pBtDataCallbackParameter = pCallbackParameter;
 
-                errorCode = uShortRangeEdmStreamDataEventCallbackSet(pInstance->streamHandle, 0, dataCallback,
-                                                                     pInstance, U_AT_CLIENT_URC_TASK_STACK_SIZE_BYTES,
-                                                                     U_CFG_OS_PRIORITY_MAX - 5);
+                errorCode = dataCallbackUpdate(pInstance, wasNeeded);
             } else if (pInstance->pBtDataCallback != NULL && pCallback == NULL) {
                 pInstance->pBtDataCallback = NULL;
                 pInstance->pBtDataCallbackParameter = NULL;
 
-                errorCode = uShortRangeEdmStreamDataEventCallbackSet(pInstance->streamHandle, 0, NULL, NULL, 0, 0);
+                errorCode = dataCallbackUpdate(pInstance, wasNeeded);
             }
         }
 
@@ -384,4 +745,285 @@ int32_t uBleDataSetCallbackData(int32_t bleHandle,
     return errorCode;
 }
 
+int32_t uBleDataSendQueued(int32_t bleHandle, int32_t channel,
+                           const char *pData, int32_t length)
+{
+    int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+    uBleDataSpsContext_t *pContext;
+    uBleDataSpsChannel_t *pChannel;
+    size_t accepted;
+    size_t x;
+    bool notify = false;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+
+        pInstance = pUShortRangePrivateGetInstance(bleHandle);
+        sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pInstance->pSpsContext != NULL) &&
+            (pData != NULL) && (length > 0)) {
+            pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+
+            U_PORT_MUTEX_LOCK(pContext->mutex);
+
+            pChannel = pSpsChannelGet(pContext, channel);
+            if ((channel >= 0) && (pChannel != NULL)) {
+                // Take as much as there is credit for, copying up
+                // to the end of the buffer and then from the start
+                accepted = sizeof(pChannel->txBuffer) - pChannel->txCount;
+                if (accepted > (size_t) length) {
+                    accepted = (size_t) length;
+                }
+                x = sizeof(pChannel->txBuffer) - pChannel->txIn;
+                if (x > accepted) {
+                    x = accepted;
+                }
+                memcpy(pChannel->txBuffer + pChannel->txIn, pData, x);
+                memcpy(pChannel->txBuffer, pData + x, accepted - x);
+                pChannel->txIn = (pChannel->txIn + accepted) % sizeof(pChannel->txBuffer);
+                pChannel->txCount += accepted;
+                sizeOrErrorCode = (int32_t) accepted;
+                if ((accepted > 0) && !pContext->txPending) {
+                    pContext->txPending = true;
+                    notify = true;
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+            if (notify) {
+                // Only one event is ever outstanding so there
+                // should always be room in the queue; even so, use
+                // the send that can't block since the short range
+                // lock is held
+                if (uPortEventQueueSendIrq(pContext->txEventQueueHandle,
+                                           &pContext, sizeof(pContext)) != 0) {
+
+                    U_PORT_MUTEX_LOCK(pContext->mutex);
+
+                    // Let the next call try again
+                    pContext->txPending = false;
+
+                    U_PORT_MUTEX_UNLOCK(pContext->mutex);
+                }
+            }
+        }
+
+        uShortRangeUnlock();
+    }
+
+    return sizeOrErrorCode;
+}
+
+int32_t uBleDataGetCredits(int32_t bleHandle, int32_t channel)
+{
+    int32_t creditsOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uBleDataSpsStats_t stats;
+
+    creditsOrErrorCode = uBleDataGetStats(bleHandle, channel, &stats);
+    if (creditsOrErrorCode == 0) {
+        creditsOrErrorCode = stats.txCredits;
+    }
+
+    return creditsOrErrorCode;
+}
+
+int32_t uBleDataGetStats(int32_t bleHandle, int32_t channel,
+                         uBleDataSpsStats_t *pStats)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+    uBleDataSpsContext_t *pContext;
+    uBleDataSpsChannel_t *pChannel;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+
+        pInstance = pUShortRangePrivateGetInstance(bleHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pInstance->pSpsContext != NULL) &&
+            (channel >= 0) && (pStats != NULL)) {
+            pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+
+            U_PORT_MUTEX_LOCK(pContext->mutex);
+
+            pChannel = pSpsChannelGet(pContext, channel);
+            if (pChannel != NULL) {
+                pStats->frameSize = pChannel->frameSize;
+                pStats->txCredits = (int32_t) (sizeof(pChannel->txBuffer) - pChannel->txCount);
+                pStats->txBytes = pChannel->txBytes;
+                pStats->txDiscarded = pChannel->txDiscarded;
+                pStats->rxBytes = pChannel->rxBytes;
+                pStats->rxDiscarded = pChannel->rxDiscarded;
+                pStats->txBytesPerSecond = bytesPerSecond(pChannel->txBytes,
+                                                          pChannel->connectedTimeMs);
+                pStats->rxBytesPerSecond = bytesPerSecond(pChannel->rxBytes,
+                                                          pChannel->connectedTimeMs);
+                errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+            }
+
+            U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        }
+
+        uShortRangeUnlock();
+    }
+
+    return errorCode;
+}
+
+int32_t uBleDataSetReceiveBuffer(int32_t bleHandle, size_t bufferSize,
+                                 size_t watermark,
+                                 void (*pCallback) (int32_t, size_t, void *),
+                                 void *pCallbackParameter)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+    uBleDataSpsContext_t *pContext;
+    uBleDataSpsChannel_t *pChannel;
+    bool wasNeeded;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+
+        pInstance = pUShortRangePrivateGetInstance(bleHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (watermark <= bufferSize)) {
+            wasNeeded = dataCallbackNeeded(pInstance);
+            errorCode = spsContextCreate(pInstance);
+            if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+
+                U_PORT_MUTEX_LOCK(pContext->mutex);
+
+                pContext->rxBufferSize = bufferSize;
+                pContext->rxWatermark = watermark;
+                pContext->pRxCallback = pCallback;
+                pContext->pRxCallbackParameter = pCallbackParameter;
+                // Start again with the channels already connected
+                for (size_t x = 0; x < U_BLE_DATA_SPS_MAX_CHANNELS; x++) {
+                    pChannel = &(pContext->channels[x]);
+                    free(pChannel->pRxBuffer);
+                    pChannel->pRxBuffer = NULL;
+                    pChannel->rxIn = 0;
+                    pChannel->rxOut = 0;
+                    pChannel->rxCount = 0;
+                    if ((pChannel->channel >= 0) && (bufferSize > 0)) {
+                        pChannel->pRxBuffer = (char *) malloc(bufferSize);
+                        if (pChannel->pRxBuffer == NULL) {
+                            errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+                        }
+                    }
+                }
+                if (errorCode != (int32_t) U_ERROR_COMMON_SUCCESS) {
+                    // Don't leave some channels buffered and
+                    // some not: go back to no buffering at all
+                    pContext->rxBufferSize = 0;
+                    pContext->rxWatermark = 0;
+                    pContext->pRxCallback = NULL;
+                    pContext->pRxCallbackParameter = NULL;
+                    for (size_t x = 0; x < U_BLE_DATA_SPS_MAX_CHANNELS; x++) {
+                        pChannel = &(pContext->channels[x]);
+                        free(pChannel->pRxBuffer);
+                        pChannel->pRxBuffer = NULL;
+                    }
+                }
+
+                U_PORT_MUTEX_UNLOCK(pContext->mutex);
+
+                // Done either way since, on failure, buffering may
+                // have been switched off where it was on before
+                if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                    errorCode = dataCallbackUpdate(pInstance, wasNeeded);
+                } else {
+                    (void) dataCallbackUpdate(pInstance, wasNeeded);
+                }
+            }
+        }
+
+        uShortRangeUnlock();
+    }
+
+    return errorCode;
+}
+
+int32_t uBleDataReceive(int32_t bleHandle, int32_t channel,
+                        char *pData, int32_t length)
+{
+    int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+    uBleDataSpsContext_t *pContext;
+    uBleDataSpsChannel_t *pChannel;
+    size_t size;
+    size_t x;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+
+        pInstance = pUShortRangePrivateGetInstance(bleHandle);
+        sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pInstance->pSpsContext != NULL) &&
+            (channel >= 0) && (pData != NULL) && (length > 0)) {
+            pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+
+            U_PORT_MUTEX_LOCK(pContext->mutex);
+
+            pChannel = pSpsChannelGet(pContext, channel);
+            if ((pChannel != NULL) && (pChannel->pRxBuffer != NULL)) {
+                // Copy from the read position up to the end of
+                // the buffer and then any remainder from the start
+                size = pChannel->rxCount;
+                if (size > (size_t) length) {
+                    size = (size_t) length;
+                }
+                x = pContext->rxBufferSize - pChannel->rxOut;
+                if (x > size) {
+                    x = size;
+                }
+                memcpy(pData, pChannel->pRxBuffer + pChannel->rxOut, x);
+                memcpy(pData + x, pChannel->pRxBuffer, size - x);
+                pChannel->rxOut = (pChannel->rxOut + size) % pContext->rxBufferSize;
+                pChannel->rxCount -= size;
+                sizeOrErrorCode = (int32_t) size;
+            }
+
+            U_PORT_MUTEX_UNLOCK(pContext->mutex);
+        }
+
+        uShortRangeUnlock();
+    }
+
+    return sizeOrErrorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: PRIVATE TO BLE
+ * -------------------------------------------------------------- */
+
+void uBleDataPrivateRemoveInstance(uShortRangePrivateInstance_t *pInstance)
+{
+    uBleDataSpsContext_t *pContext;
+
+    if (pInstance != NULL) {
+        // Nothing that refers to the instance must be left
+        // running in the EDM stream
+        if (pInstance->pSpsConnectionCallback != NULL) {
+            uShortRangeEdmStreamBtEventCallbackSet(pInstance->streamHandle, NULL, NULL, 0, 0);
+            pInstance->pSpsConnectionCallback = NULL;
+            pInstance->pSpsConnectionCallbackParameter = NULL;
+        }
+        if (dataCallbackNeeded(pInstance)) {
+            uShortRangeEdmStreamDataEventCallbackSet(pInstance->streamHandle, 0, NULL, NULL, 0, 0);
+            pInstance->pBtDataCallback = NULL;
+            pInstance->pBtDataCallbackParameter = NULL;
+        }
+        pContext = (uBleDataSpsContext_t *) pInstance->pSpsContext;
+        if (pContext != NULL) {
+            for (size_t x = 0; x < U_BLE_DATA_SPS_MAX_CHANNELS; x++) {
+                free(pContext->channels[x].pRxBuffer);
+            }
+            uPortEventQueueClose(pContext->txEventQueueHandle);
+            uPortMutexDelete(pContext->mutex);
+            free(pContext);
+            pInstance->pSpsContext = NULL;
+        }
+    }
+}
+
 // End of file
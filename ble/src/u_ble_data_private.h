@@ -0,0 +1,50 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_BLE_DATA_PRIVATE_H_
+#define _U_BLE_DATA_PRIVATE_H_
+
+/* No #includes allowed here */
+
+/** @file
+ * @brief This header file defines functions that are private to
+ * the ble API.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Release everything the data API holds for a short range
+ * instance, which is about to be removed: the EDM stream
+ * callbacks that refer to it and the SPS channel state.
+ * Note: the short range lock should be held when this is called.
+ *
+ * @param pInstance  the short range instance.
+ */
+void uBleDataPrivateRemoveInstance(uShortRangePrivateInstance_t *pInstance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_BLE_DATA_PRIVATE_H_
+
+// End of file
@@ -33,6 +33,7 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // memset()
 
 #include "u_cfg_sw.h"
 #include "u_cfg_app_platform_specific.h"
@@ -60,6 +61,65 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/* The SPS tests and the EDM write benchmark need an SPS peer to
+ * connect to, its address given in 0012F398DD12p format by defining
+ * U_CFG_TEST_BLE_SPS_PEER_ADDRESS; without that they are not run.
+ */
+
+/* The SPS receive buffer test also needs the peer to send back
+ * whatever it receives; define U_CFG_TEST_BLE_SPS_PEER_ECHO if it
+ * does.
+ */
+
+#ifndef U_BLE_DATA_TEST_RECEIVE_LENGTH
+/** The amount of data to have echoed back in the SPS receive
+ * buffer test.
+ */
+# define U_BLE_DATA_TEST_RECEIVE_LENGTH 200
+#endif
+
+#ifndef U_BLE_DATA_TEST_RECEIVE_BUFFER_SIZE
+/** The size of receive buffer to use in the SPS receive buffer
+ * test, more than U_BLE_DATA_TEST_RECEIVE_LENGTH so that nothing
+ * is thrown away.
+ */
+# define U_BLE_DATA_TEST_RECEIVE_BUFFER_SIZE 512
+#endif
+
+#ifndef U_BLE_DATA_TEST_SEND_QUEUED_LENGTH
+/** The amount of data to send in the SPS queued send test,
+ * more than the credit of a channel so that the queue has to
+ * drain part way through.
+ */
+# define U_BLE_DATA_TEST_SEND_QUEUED_LENGTH (U_BLE_DATA_SPS_TX_BUDGET_BYTES * 3)
+#endif
+
+#ifndef U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES
+/** The number of frames to send in each pass of the benchmark.
+ */
+# define U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES 200
+#endif
+
+#ifndef U_BLE_DATA_TEST_BENCHMARK_FRAME_SIZE
+/** The size of each frame sent by the benchmark, kept small
+ * so that the per-frame overhead dominates.
+ */
+# define U_BLE_DATA_TEST_BENCHMARK_FRAME_SIZE 20
+#endif
+
+#ifndef U_BLE_DATA_TEST_BENCHMARK_SUSTAINED_MS
+/** How long to send for in throughput mode.
+ */
+# define U_BLE_DATA_TEST_BENCHMARK_SUSTAINED_MS 5000
+#endif
+
+#ifndef U_BLE_DATA_TEST_BENCHMARK_BATCH_SIZE
+/** The number of frames queued before each flush in the
+ * batched pass of the benchmark.
+ */
+# define U_BLE_DATA_TEST_BENCHMARK_BATCH_SIZE 10
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -70,6 +130,24 @@
 
 static uBleTestPrivate_t gHandles = { -1, -1, NULL, -1 };
 
+#if defined(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE) && defined(U_CFG_TEST_BLE_SPS_PEER_ADDRESS)
+/** The channel of the SPS connection to the peer, -1 when not
+ * connected.
+ */
+static volatile int32_t gSpsChannel = -1;
+
+/** The connection handle of the SPS connection.
+ */
+static volatile int32_t gSpsConnHandle = -1;
+
+# ifdef U_CFG_TEST_BLE_SPS_PEER_ECHO
+/** The number of times the receive buffer watermark callback
+ * has been called.
+ */
+static volatile int32_t gRxWatermarkCount = 0;
+# endif
+#endif
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -106,6 +184,7 @@ static void connectionCallback(int32_t connHandle, char *address, int32_t type,
 U_PORT_TEST_FUNCTION("[bleData]", "bleData")
 {
     int32_t heapUsed;
+    char buffer[8];
     heapUsed = uPortGetHeapFree();
 
     U_PORT_TEST_ASSERT(uBleTestPrivatePreamble(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
@@ -120,6 +199,21 @@ U_PORT_TEST_FUNCTION("[bleData]", "bleData")
                                                            connectionCallback,
                                                            NULL) != 0);
 
+    // Nothing is connected so there are no SPS channels
+    U_PORT_TEST_ASSERT(uBleDataGetCredits(gHandles.bleHandle, 0) < 0);
+    U_PORT_TEST_ASSERT(uBleDataSendQueued(gHandles.bleHandle, 0, "x", 1) < 0);
+
+    // Receive buffering can be switched on and off but,
+    // with nothing connected, there is nothing to read
+    U_PORT_TEST_ASSERT(uBleDataSetReceiveBuffer(gHandles.bleHandle, 16, 17,
+                                                NULL, NULL) < 0);
+    U_PORT_TEST_ASSERT(uBleDataSetReceiveBuffer(gHandles.bleHandle, 512, 1,
+                                                NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(uBleDataReceive(gHandles.bleHandle, 0, buffer,
+                                       sizeof(buffer)) < 0);
+    U_PORT_TEST_ASSERT(uBleDataSetReceiveBuffer(gHandles.bleHandle, 0, 0,
+                                                NULL, NULL) == 0);
+
     U_PORT_TEST_ASSERT(uBleDataSetCallbackConnectionStatus(gHandles.bleHandle,
                                                            NULL, NULL) == 0);
 
@@ -155,6 +249,349 @@ U_PORT_TEST_FUNCTION("[bleData]", "bleData")
 #endif
 }
 
+#ifdef U_CFG_TEST_BLE_SPS_PEER_ADDRESS
+
+static void spsConnectionCallback(int32_t connHandle, char *address,
+                                        int32_t type, int32_t channel,
+                                        int32_t mtu, void *pParameters)
+{
+    (void) address;
+    (void) mtu;
+    (void) pParameters;
+
+    if (type == 0) {
+        gSpsConnHandle = connHandle;
+        gSpsChannel = channel;
+    } else {
+        gSpsChannel = -1;
+    }
+}
+
+// Make an SPS connection to the peer, having set
+// spsConnectionCallback() as the connection status callback.
+static void spsConnect()
+{
+    gSpsChannel = -1;
+    uPortLog("U_BLE_DATA_TEST: connecting SPS to %s...\n",
+             U_CFG_TEST_BLE_SPS_PEER_ADDRESS);
+    U_PORT_TEST_ASSERT(uBleDataConnectSps(gHandles.bleHandle,
+                                          U_CFG_TEST_BLE_SPS_PEER_ADDRESS) == 0);
+    for (int32_t x = 0; (x < 100) && (gSpsChannel < 0); x++) {
+        uPortTaskBlock(100);
+    }
+    U_PORT_TEST_ASSERT(gSpsChannel >= 0);
+    // Advised delay before sending data on a new connection
+    uPortTaskBlock(50);
+}
+
+// Drop the SPS connection to the peer.
+static void spsDisconnect()
+{
+    // Advised delay before disconnecting after sending data
+    uPortTaskBlock(50);
+    U_PORT_TEST_ASSERT(uBleDataDisconnect(gHandles.bleHandle, gSpsConnHandle) == 0);
+    for (int32_t x = 0; (x < 50) && (gSpsChannel >= 0); x++) {
+        uPortTaskBlock(100);
+    }
+}
+
+// Wait for everything queued with uBleDataSendQueued() to have
+// been sent, i.e. for all of the credit to have come back,
+// returning the credit.
+static int32_t spsQueueDrain()
+{
+    int32_t x;
+
+    x = uBleDataGetCredits(gHandles.bleHandle, gSpsChannel);
+    while ((x >= 0) && (x < U_BLE_DATA_SPS_TX_BUDGET_BYTES)) {
+        uPortTaskBlock(10);
+        x = uBleDataGetCredits(gHandles.bleHandle, gSpsChannel);
+    }
+
+    return x;
+}
+
+/** Queue data in lumps of varying size, faster than it can be
+ * sent, and check that all of it goes and that credit is used
+ * up and given back as it should be.
+ */
+U_PORT_TEST_FUNCTION("[bleData]", "bleDataSendQueued")
+{
+    int32_t heapUsed;
+    uBleDataSpsStats_t stats;
+    char buffer[100];
+    int32_t queued = 0;
+    int32_t length;
+    int32_t channel;
+    int32_t x;
+
+    heapUsed = uPortGetHeapFree();
+
+    U_PORT_TEST_ASSERT(uBleTestPrivatePreamble(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
+                                               &gHandles) == 0);
+    U_PORT_TEST_ASSERT(uBleDataSetCallbackConnectionStatus(gHandles.bleHandle,
+                                                           spsConnectionCallback,
+                                                           NULL) == 0);
+    spsConnect();
+
+    U_PORT_TEST_ASSERT(uBleDataGetCredits(gHandles.bleHandle, gSpsChannel) ==
+                       U_BLE_DATA_SPS_TX_BUDGET_BYTES);
+    // Bad parameters
+    U_PORT_TEST_ASSERT(uBleDataSendQueued(gHandles.bleHandle, gSpsChannel, NULL, 1) < 0);
+    U_PORT_TEST_ASSERT(uBleDataSendQueued(gHandles.bleHandle, gSpsChannel, buffer, 0) < 0);
+
+    memset(buffer, 'q', sizeof(buffer));
+    while (queued < U_BLE_DATA_TEST_SEND_QUEUED_LENGTH) {
+        // 1 to sizeof(buffer) bytes at a time, so that lumps
+        // straddle the end of the channel's queue
+        length = (queued % (int32_t) sizeof(buffer)) + 1;
+        if (length > U_BLE_DATA_TEST_SEND_QUEUED_LENGTH - queued) {
+            length = U_BLE_DATA_TEST_SEND_QUEUED_LENGTH - queued;
+        }
+        x = uBleDataSendQueued(gHandles.bleHandle, gSpsChannel, buffer, length);
+        U_PORT_TEST_ASSERT((x >= 0) && (x <= length));
+        queued += x;
+        if (x < length) {
+            // Out of credit, let it drain
+            uPortTaskBlock(10);
+        }
+    }
+    U_PORT_TEST_ASSERT(spsQueueDrain() == U_BLE_DATA_SPS_TX_BUDGET_BYTES);
+    U_PORT_TEST_ASSERT(uBleDataGetStats(gHandles.bleHandle, gSpsChannel, &stats) == 0);
+    uPortLog("U_BLE_DATA_TEST: %d byte(s) queued, %d sent, %d discarded.\n",
+             queued, stats.txBytes, stats.txDiscarded);
+    U_PORT_TEST_ASSERT(stats.txBytes == (uint32_t) queued);
+    U_PORT_TEST_ASSERT(stats.txDiscarded == 0);
+
+    channel = gSpsChannel;
+    spsDisconnect();
+    // Once the connection has gone the channel is no more
+    U_PORT_TEST_ASSERT(uBleDataSendQueued(gHandles.bleHandle, channel, buffer, 1) < 0);
+    U_PORT_TEST_ASSERT(uBleDataSetCallbackConnectionStatus(gHandles.bleHandle,
+                                                           NULL, NULL) == 0);
+
+    uBleTestPrivatePostamble(&gHandles);
+
+#ifndef __XTENSA__
+    // Check for memory leaks
+    heapUsed -= uPortGetHeapFree();
+    uPortLog("U_BLE_DATA_TEST: we have leaked %d byte(s).\n", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+#else
+    (void) heapUsed;
+#endif
+}
+
+#ifdef U_CFG_TEST_BLE_SPS_PEER_ECHO
+
+static void rxWatermarkCallback(int32_t channel, size_t length,
+                                void *pParameters)
+{
+    (void) channel;
+    (void) length;
+    (void) pParameters;
+
+    gRxWatermarkCount++;
+}
+
+/** Have the peer echo data back with receive buffering on and
+ * check that it can all be read with uBleDataReceive().
+ */
+U_PORT_TEST_FUNCTION("[bleData]", "bleDataReceiveBuffered")
+{
+    int32_t heapUsed;
+    uBleDataSpsStats_t stats;
+    char txBuffer[U_BLE_DATA_TEST_RECEIVE_LENGTH];
+    char rxBuffer[U_BLE_DATA_TEST_RECEIVE_LENGTH];
+    int32_t received = 0;
+    int64_t startTimeMs;
+    int32_t x;
+
+    heapUsed = uPortGetHeapFree();
+
+    U_PORT_TEST_ASSERT(uBleTestPrivatePreamble(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
+                                               &gHandles) == 0);
+    // The connection status callback has to be set first since
+    // that is how the connection becomes known
+    U_PORT_TEST_ASSERT(uBleDataSetCallbackConnectionStatus(gHandles.bleHandle,
+                                                           spsConnectionCallback,
+                                                           NULL) == 0);
+    gRxWatermarkCount = 0;
+    U_PORT_TEST_ASSERT(uBleDataSetReceiveBuffer(gHandles.bleHandle,
+                                                U_BLE_DATA_TEST_RECEIVE_BUFFER_SIZE, 1,
+                                                rxWatermarkCallback, NULL) == 0);
+    spsConnect();
+
+    // Nothing has been received yet
+    U_PORT_TEST_ASSERT(uBleDataReceive(gHandles.bleHandle, gSpsChannel,
+                                       rxBuffer, sizeof(rxBuffer)) == 0);
+
+    for (size_t y = 0; y < sizeof(txBuffer); y++) {
+        txBuffer[y] = (char) ('a' + (y % 26));
+    }
+    U_PORT_TEST_ASSERT(uBleDataSend(gHandles.bleHandle, gSpsChannel,
+                                    txBuffer, sizeof(txBuffer)) >= 0);
+
+    // Read the echo a few bytes at a time as it comes in
+    startTimeMs = uPortGetTickTimeMs();
+    while ((received < (int32_t) sizeof(rxBuffer)) &&
+           (uPortGetTickTimeMs() - startTimeMs < 10000)) {
+        x = (int32_t) sizeof(rxBuffer) - received;
+        if (x > 7) {
+            x = 7;
+        }
+        x = uBleDataReceive(gHandles.bleHandle, gSpsChannel, rxBuffer + received, x);
+        U_PORT_TEST_ASSERT(x >= 0);
+        received += x;
+        if (x == 0) {
+            uPortTaskBlock(10);
+        }
+    }
+    uPortLog("U_BLE_DATA_TEST: %d byte(s) of %d echoed back, watermark"
+             " callback called %d time(s).\n", received, (int32_t) sizeof(txBuffer),
+             gRxWatermarkCount);
+    U_PORT_TEST_ASSERT(received == (int32_t) sizeof(txBuffer));
+    U_PORT_TEST_ASSERT(memcmp(rxBuffer, txBuffer, sizeof(txBuffer)) == 0);
+    U_PORT_TEST_ASSERT(gRxWatermarkCount > 0);
+    U_PORT_TEST_ASSERT(uBleDataGetStats(gHandles.bleHandle, gSpsChannel, &stats) == 0);
+    U_PORT_TEST_ASSERT(stats.rxBytes == sizeof(txBuffer));
+    U_PORT_TEST_ASSERT(stats.rxDiscarded == 0);
+
+    spsDisconnect();
+    U_PORT_TEST_ASSERT(uBleDataSetReceiveBuffer(gHandles.bleHandle, 0, 0,
+                                                NULL, NULL) == 0);
+    U_PORT_TEST_ASSERT(uBleDataSetCallbackConnectionStatus(gHandles.bleHandle,
+                                                           NULL, NULL) == 0);
+
+    uBleTestPrivatePostamble(&gHandles);
+
+#ifndef __XTENSA__
+    // Check for memory leaks
+    heapUsed -= uPortGetHeapFree();
+    uPortLog("U_BLE_DATA_TEST: we have leaked %d byte(s).\n", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+#else
+    (void) heapUsed;
+#endif
+}
+
+#endif // U_CFG_TEST_BLE_SPS_PEER_ECHO
+
+// Send U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES frames, batchSize at a
+// time (1 meaning one write per frame), returning the number of
+// frames per second.
+static int32_t benchmarkSend(int32_t batchSize)
+{
+    char buffer[U_BLE_DATA_TEST_BENCHMARK_FRAME_SIZE];
+    int64_t startTimeMs;
+    int32_t durationMs;
+
+    memset(buffer, 'x', sizeof(buffer));
+    startTimeMs = uPortGetTickTimeMs();
+    for (int32_t x = 0; x < U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES; x++) {
+        if (batchSize > 1) {
+            U_PORT_TEST_ASSERT(uShortRangeEdmStreamWriteQueue(gHandles.edmStreamHandle,
+                                                              gSpsChannel,
+                                                              buffer, sizeof(buffer)) == sizeof(buffer));
+            if (((x + 1) % batchSize == 0) || (x == U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES - 1)) {
+                U_PORT_TEST_ASSERT(uShortRangeEdmStreamWriteFlush(gHandles.edmStreamHandle) == 0);
+            }
+        } else {
+            U_PORT_TEST_ASSERT(uShortRangeEdmStreamWrite(gHandles.edmStreamHandle,
+                                                         gSpsChannel,
+                                                         buffer, sizeof(buffer)) == sizeof(buffer));
+        }
+    }
+    durationMs = (int32_t) (uPortGetTickTimeMs() - startTimeMs);
+    if (durationMs <= 0) {
+        durationMs = 1;
+    }
+
+    return (U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES * 1000) / durationMs;
+}
+
+/** Measure how many small frames per second can be written to an
+ * SPS connection, first one write per frame, then batched, then
+ * the sustained rate in throughput mode.
+ */
+U_PORT_TEST_FUNCTION("[bleData]", "bleDataWriteBenchmark")
+{
+    int32_t heapUsed;
+    int32_t framesPerSecond;
+    uBleDataSpsStats_t stats;
+    char buffer[128];
+    uint32_t txBytesStart;
+    int64_t startTimeMs;
+    int32_t durationMs;
+    int32_t x;
+
+    heapUsed = uPortGetHeapFree();
+
+    U_PORT_TEST_ASSERT(uBleTestPrivatePreamble(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
+                                               &gHandles) == 0);
+    U_PORT_TEST_ASSERT(uBleDataSetCallbackConnectionStatus(gHandles.bleHandle,
+                                                           spsConnectionCallback,
+                                                           NULL) == 0);
+    spsConnect();
+
+    framesPerSecond = benchmarkSend(1);
+    uPortLog("U_BLE_DATA_TEST: %d frame(s) of %d byte(s), one write per frame:"
+             " %d frames/second.\n", U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES,
+             U_BLE_DATA_TEST_BENCHMARK_FRAME_SIZE, framesPerSecond);
+    framesPerSecond = benchmarkSend(U_BLE_DATA_TEST_BENCHMARK_BATCH_SIZE);
+    uPortLog("U_BLE_DATA_TEST: %d frame(s) of %d byte(s), flushed every %d:"
+             " %d frames/second.\n", U_BLE_DATA_TEST_BENCHMARK_NUM_FRAMES,
+             U_BLE_DATA_TEST_BENCHMARK_FRAME_SIZE,
+             U_BLE_DATA_TEST_BENCHMARK_BATCH_SIZE, framesPerSecond);
+
+    // Sustained rate in throughput mode, sending whenever there
+    // is credit
+    U_PORT_TEST_ASSERT(uBleDataGetStats(gHandles.bleHandle, gSpsChannel, &stats) == 0);
+    txBytesStart = stats.txBytes;
+    startTimeMs = uPortGetTickTimeMs();
+    memset(buffer, 'y', sizeof(buffer));
+    while (uPortGetTickTimeMs() - startTimeMs < U_BLE_DATA_TEST_BENCHMARK_SUSTAINED_MS) {
+        x = uBleDataSendQueued(gHandles.bleHandle, gSpsChannel,
+                               buffer, sizeof(buffer));
+        U_PORT_TEST_ASSERT(x >= 0);
+        if (x == 0) {
+            // No credit, let it drain
+            uPortTaskBlock(10);
+        }
+    }
+    // Wait for everything queued to go
+    U_PORT_TEST_ASSERT(spsQueueDrain() == U_BLE_DATA_SPS_TX_BUDGET_BYTES);
+    durationMs = (int32_t) (uPortGetTickTimeMs() - startTimeMs);
+    U_PORT_TEST_ASSERT(uBleDataGetStats(gHandles.bleHandle, gSpsChannel, &stats) == 0);
+    uPortLog("U_BLE_DATA_TEST: throughput mode, frame size %d: %d byte(s) in %d ms"
+             " (%d bytes/second).\n", stats.frameSize,
+             (int32_t) (stats.txBytes - txBytesStart), durationMs,
+             (int32_t) (((int64_t) (stats.txBytes - txBytesStart) * 1000) / durationMs));
+
+    spsDisconnect();
+    U_PORT_TEST_ASSERT(uBleDataSetCallbackConnectionStatus(gHandles.bleHandle,
+                                                           NULL, NULL) == 0);
+
+    uBleTestPrivatePostamble(&gHandles);
+
+#ifndef __XTENSA__
+    // Check for memory leaks
+    heapUsed -= uPortGetHeapFree();
+    uPortLog("U_BLE_DATA_TEST: we have leaked %d byte(s).\n", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+#else
+    (void) heapUsed;
+#endif
+}
+
+#endif // U_CFG_TEST_BLE_SPS_PEER_ADDRESS
+
 #endif
 
 /** Clean-up to be run at the end of this round of tests, just
@@ -33,6 +33,11 @@ extern "C" {
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+/** The highest TLS security profile ID that a cellular module
+ * supports (AT+USECPRF); the lowest is zero.
+ */
+#define U_CELL_SEC_TLS_PROFILE_ID_MAX 4
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -296,6 +301,67 @@ int32_t uCellSecE2eEncrypt(int32_t cellHandle,
  */
 int32_t uCellSecHeartbeatTrigger(int32_t cellHandle);
 
+/* ----------------------------------------------------------------
+ * FUNCTIONS: TLS
+ * -------------------------------------------------------------- */
+
+/** Store a TLS credential in the file store of a cellular module
+ * using AT+USECMNG.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param type        the type of credential.
+ * @param pName       the null-terminated name to store the
+ *                    credential under; cannot be NULL.
+ * @param pData       the credential; cannot be NULL.
+ * @param sizeBytes   the number of bytes at pData.
+ * @param pPassword   the null-terminated password for a
+ *                    private key, NULL if there is none.
+ * @return            zero on success else negative error code.
+ */
+int32_t uCellSecTlsCredentialStore(int32_t cellHandle,
+                                   uSecurityTlsCredentialType_t type,
+                                   const char *pName,
+                                   const char *pData,
+                                   size_t sizeBytes,
+                                   const char *pPassword);
+
+/** Remove a TLS credential from the file store of a cellular
+ * module.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param type        the type of credential.
+ * @param pName       the null-terminated name of the
+ *                    credential; cannot be NULL.
+ * @return            zero on success else negative error code.
+ */
+int32_t uCellSecTlsCredentialRemove(int32_t cellHandle,
+                                    uSecurityTlsCredentialType_t type,
+                                    const char *pName);
+
+/** Reset a TLS security profile in a cellular module and then
+ * apply the given settings to it with AT+USECPRF.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param profileId   the ID of the profile, 0 to
+ *                    U_CELL_SEC_TLS_PROFILE_ID_MAX.
+ * @param pProfile    the profile settings; cannot be NULL.
+ * @return            zero on success else negative error code.
+ */
+int32_t uCellSecTlsProfileSet(int32_t cellHandle,
+                              int32_t profileId,
+                              const uSecurityTlsProfile_t *pProfile);
+
+/** Reset a TLS security profile in a cellular module to its
+ * defaults.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param profileId   the ID of the profile, 0 to
+ *                    U_CELL_SEC_TLS_PROFILE_ID_MAX.
+ * @return            zero on success else negative error code.
+ */
+int32_t uCellSecTlsProfileReset(int32_t cellHandle,
+                                int32_t profileId);
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,16 +47,25 @@ extern "C" {
  */
 #define U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES 1024
 
+/** The maximum size of a datagram or TCP segment when the
+ * module is in hex mode (see uCellSockHexModeOn()), where
+ * each byte crosses the AT interface as two ASCII hex
+ * characters.
+ */
+#define U_CELL_SOCK_HEX_MODE_MAX_SEGMENT_SIZE_BYTES 512
+
 #ifndef U_CELL_SOCK_TCP_RETRY_LIMIT
 /** The number of times to retry sending TCP data:
- * if the module is accepting less than
- * U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES each time,
- * helps to prevent lock-ups.
+ * if the module is accepting less than a full
+ * segment each time, helps to prevent lock-ups.
  */
 # define U_CELL_SOCK_TCP_RETRY_LIMIT 3
 #endif
 
-/** The maximum number of sockets that can be open at one time.
+/** The maximum number of sockets that can be open at one time
+ * on any one cellular module; the actual limit is that of the
+ * module type, which may be lower.  Each cellular instance has
+ * its own socket table.
  */
 #define U_CELL_SOCK_MAX_NUM_SOCKETS 7
 
@@ -72,6 +81,45 @@ extern "C" {
 # define U_CELL_SOCK_DNS_LOOKUP_TIME_SECONDS 60
 #endif
 
+#ifndef U_CELL_SOCK_TRUST_URC_PENDING_BYTES
+/** When this is 0, uCellSockRead() and uCellSockReceiveFrom()
+ * ask the module how much data is waiting (with a zero-length
+ * AT+USORD/AT+USORF) every time they are called on a socket
+ * for which no data has been indicated by URC.  Set this to 1
+ * to trust the +UUSORD/+UUSORF URCs instead: a read on such a
+ * socket then returns -U_SOCK_EWOULDBLOCK straight away and
+ * the module is only asked, as a resync, if it has not been
+ * asked about that socket for
+ * U_CELL_SOCK_PENDING_BYTES_RESYNC_INTERVAL_MS.
+ */
+# define U_CELL_SOCK_TRUST_URC_PENDING_BYTES 0
+#endif
+
+#ifndef U_CELL_SOCK_PENDING_BYTES_RESYNC_INTERVAL_MS
+/** The interval at which the module is asked how much data is
+ * waiting on an apparently empty socket when
+ * U_CELL_SOCK_TRUST_URC_PENDING_BYTES is 1.
+ */
+# define U_CELL_SOCK_PENDING_BYTES_RESYNC_INTERVAL_MS 1000
+#endif
+
+#ifndef U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS
+/** The silent period required either side of the "+++"
+ * escape sequence that takes the module out of direct link
+ * mode: must be longer than the module's configured escape
+ * guard time (ATS12, default one second).
+ */
+# define U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS 1200
+#endif
+
+#ifndef U_CELL_SOCK_DIRECT_LINK_STOP_RETRIES
+/** The number of times to try to get an "OK" back from the
+ * module after sending the escape sequence to leave direct
+ * link mode.
+ */
+# define U_CELL_SOCK_DIRECT_LINK_STOP_RETRIES 3
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -141,6 +189,40 @@ int32_t uCellSockConnect(int32_t cellHandle,
                          int32_t sockHandle,
                          const uSockAddress_t *pRemoteAddress);
 
+/** Start connecting to a server without waiting for the
+ * connection to be made; this is only supported by modules
+ * that can indicate the outcome of a connection attempt with
+ * a URC (e.g. SARA-R5).  While the connection is being made
+ * the AT interface remains free for use by other sockets,
+ * hence several connections may be in progress at once.
+ *
+ * @param cellHandle     the handle of the cellular instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pRemoteAddress the address of the server to
+ *                       connect to, including port number.
+ * @param pCallback      the function to call when the
+ *                       connection attempt has completed,
+ *                       with the first parameter the cellHandle,
+ *                       the second parameter the sockHandle and
+ *                       the third parameter zero if the
+ *                       connection was made, else a negated value
+ *                       of U_SOCK_Exxx from u_sock_errno.h;
+ *                       cannot be NULL.
+ * @return               zero if the connection attempt has
+ *                       been started else negated value of
+ *                       U_SOCK_Exxx from u_sock_errno.h; in
+ *                       particular -U_SOCK_ENOSYS is returned
+ *                       if the module does not support
+ *                       asynchronous connection, in which case
+ *                       uCellSockConnect() should be used.
+ */
+int32_t uCellSockConnectAsync(int32_t cellHandle,
+                              int32_t sockHandle,
+                              const uSockAddress_t *pRemoteAddress,
+                              void (*pCallback) (int32_t,
+                                                 int32_t,
+                                                 int32_t));
+
 /** Close a socket.
  *
  * @param cellHandle  the handle of the cellular instance.
@@ -156,6 +238,18 @@ int32_t uCellSockConnect(int32_t cellHandle,
  *                    with the first parameter the cellHandle
  *                    and the second parameter the sockHandle,
  *                    when the socket is eventually closed.
+ *                    If this function returns success
+ *                    then pCallback, where non-NULL, is
+ *                    ALWAYS called, from the AT client
+ *                    callback task, possibly before this
+ *                    function has returned.  This includes
+ *                    the case where the module does not
+ *                    support asynchronous closure: this
+ *                    call then blocks, as if pCallback
+ *                    were NULL, and pCallback is called
+ *                    once it returns, so that the caller
+ *                    can track completion in the same way
+ *                    in all cases.
  * @return            zero on success else negated
  *                    value of U_SOCK_Exxx from
  *                    u_sock_errno.h.
@@ -253,12 +347,56 @@ int32_t uCellSockOptionGet(int32_t cellHandle,
                            void *pOptionValue,
                            size_t *pOptionValueLength);
 
+/** Switch the module into hex mode (AT+UDCONF=1,1) for all
+ * sockets of this cellular instance: socket data is then
+ * exchanged with the module as ASCII hex rather than
+ * binary, which some module firmware/network combinations
+ * require.  This is transparent to the user: uCellSockWrite(),
+ * uCellSockRead(), uCellSockSendTo() and uCellSockReceiveFrom()
+ * continue to take and return binary data.  Note that in hex
+ * mode the maximum datagram size is
+ * U_CELL_SOCK_HEX_MODE_MAX_SEGMENT_SIZE_BYTES.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            zero on success else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockHexModeOn(int32_t cellHandle);
+
+/** Switch the module back into binary mode (AT+UDCONF=1,0),
+ * the default.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            zero on success else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockHexModeOff(int32_t cellHandle);
+
+/** Determine whether hex mode is on or not.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @return            true if hex mode is on, else false.
+ */
+bool uCellSockHexModeIsOn(int32_t cellHandle);
+
+/** Get the number of times, since uCellSockInit() was called,
+ * that uCellSockRead() or uCellSockReceiveFrom() did not need
+ * to ask the module how much data is waiting because
+ * U_CELL_SOCK_TRUST_URC_PENDING_BYTES is 1.
+ *
+ * @return  the number of zero-length AT+USORD/AT+USORF
+ *          commands avoided; always zero if
+ *          U_CELL_SOCK_TRUST_URC_PENDING_BYTES is 0.
+ */
+int32_t uCellSockGetNumProbesAvoided();
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: UDP ONLY
  * -------------------------------------------------------------- */
 
 /** Send a datagram.  The maximum length of datagram
- * that can be transmitted is U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES:
+ * that can be transmitted is U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES
+ * (U_CELL_SOCK_HEX_MODE_MAX_SEGMENT_SIZE_BYTES in hex mode):
  * if dataSizeBytes is longer than this nothing will be
  * transmitted and an error will be returned.
  *
@@ -307,6 +445,51 @@ int32_t uCellSockReceiveFrom(int32_t cellHandle,
                              uSockAddress_t *pRemoteAddress,
                              void *pData, size_t dataSizeBytes);
 
+/** Send a batch of datagrams with the AT interface locked only
+ * once.  The IP address of each datagram is only turned into a
+ * string if it differs from that of the one before.  Sending
+ * stops at the first datagram that fails.
+ *
+ * @param cellHandle            the handle of the cellular instance.
+ * @param sockHandle            the handle of the socket.
+ * @param pRemoteAddressDefault the address to use for any datagram
+ *                              where pAddress is NULL; may be NULL.
+ * @param pDatagrams            the datagrams to send; the result
+ *                              field of each one attempted is
+ *                              filled in.  Cannot be NULL.
+ * @param numDatagrams          the number of datagrams at
+ *                              pDatagrams.
+ * @return                      the number of datagrams sent if
+ *                              at least one was sent, else the
+ *                              negated value of U_SOCK_Exxx from
+ *                              u_sock_errno.h.
+ */
+int32_t uCellSockSendToBatch(int32_t cellHandle,
+                             int32_t sockHandle,
+                             const uSockAddress_t *pRemoteAddressDefault,
+                             uSockDatagram_t *pDatagrams,
+                             size_t numDatagrams);
+
+/** Receive as many datagrams as are waiting, up to numDatagrams,
+ * with the AT interface locked only once.
+ *
+ * @param cellHandle     the handle of the cellular instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pDatagrams     the datagrams to receive into; the result
+ *                       field of each one attempted is filled in.
+ *                       Cannot be NULL.
+ * @param numDatagrams   the number of datagrams at pDatagrams.
+ * @return               the number of datagrams received if at
+ *                       least one was received, else the negated
+ *                       value of U_SOCK_Exxx from u_sock_errno.h
+ *                       (-U_SOCK_EWOULDBLOCK if there was nothing
+ *                       to receive).
+ */
+int32_t uCellSockReceiveFromBatch(int32_t cellHandle,
+                                  int32_t sockHandle,
+                                  uSockDatagram_t *pDatagrams,
+                                  size_t numDatagrams);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: STREAM (TCP)
  * -------------------------------------------------------------- */
@@ -382,6 +565,11 @@ void uCellSockRegisterCallbackClosed(int32_t cellHandle,
 
 /** Bind a socket to a local address for receiving
  * incoming TCP connections (required for a TCP server only).
+ * Only the port number of pLocalAddress is used, the IP
+ * address is always that of the module.  Note that cellular
+ * networks do not generally allow incoming TCP connections
+ * unless a private APN or similar has been arranged with
+ * the network operator.
  *
  * @param cellHandle    the handle of the cellular instance.
  * @param sockHandle    the handle of the socket.
@@ -395,6 +583,11 @@ int32_t uCellSockBind(int32_t cellHandle,
                       const uSockAddress_t *pLocalAddress);
 
 /** Set listening mode (required for TCP server only).
+ * uCellSockBind() must have been called first.  Incoming
+ * connections are queued, up to backlog of them, and are
+ * indicated to the data callback of this socket (see
+ * uCellSockRegisterCallbackData()); connections beyond
+ * backlog are closed.
  *
  * @param cellHandle  the handle of the cellular instance.
  * @param sockHandle  the handle of the socket.
@@ -408,7 +601,8 @@ int32_t uCellSockListen(int32_t cellHandle,
                         size_t backlog);
 
 /** Accept an incoming TCP connection (required for TCP
- * server only).
+ * server only).  This does not block: if no connection has
+ * arrived -U_SOCK_EWOULDBLOCK is returned.
  *
  * @param cellHandle      the handle of the cellular instance.
  * @param sockHandle      the handle of the socket.
@@ -424,6 +618,84 @@ int32_t uCellSockAccept(int32_t cellHandle,
                         int32_t sockHandle,
                         uSockAddress_t *pRemoteAddress);
 
+/* ----------------------------------------------------------------
+ * FUNCTIONS: DIRECT LINK
+ * -------------------------------------------------------------- */
+
+/** Switch a connected socket into direct link mode
+ * (AT+USODL): from then on the data of this socket is
+ * carried transparently over the AT interface, with none
+ * of the command framing of uCellSockWrite()/uCellSockRead(),
+ * which is useful for bulk transfers.  While in direct
+ * link mode the AT interface belongs to this socket: no
+ * other function of the cellular API may be called for
+ * this cellular instance, and no URCs will be handled,
+ * until uCellSockDirectLinkStop() has been called.  Only
+ * one socket per cellular instance may be in direct link
+ * mode at a time.  Not supported over chip-to-chip security.
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param sockHandle  the handle of the socket.
+ * @return            zero on success else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockDirectLinkStart(int32_t cellHandle,
+                                 int32_t sockHandle);
+
+/** Send bytes over a socket in direct link mode.  Note that
+ * if the data contains the escape sequence "+++" with the
+ * guard time of silence either side the module will leave
+ * direct link mode.
+ *
+ * @param cellHandle     the handle of the cellular instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pData          the data to send.
+ * @param dataSizeBytes  the number of bytes of data to send.
+ * @return               the number of bytes sent on success
+ *                       else negated value of U_SOCK_Exxx
+ *                       from u_sock_errno.h.
+ */
+int32_t uCellSockDirectLinkWrite(int32_t cellHandle,
+                                 int32_t sockHandle,
+                                 const void *pData,
+                                 size_t dataSizeBytes);
+
+/** Receive bytes on a socket in direct link mode.  This does
+ * not block: if there is nothing to receive
+ * -U_SOCK_EWOULDBLOCK is returned.
+ *
+ * @param cellHandle     the handle of the cellular instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pData          a buffer in which to store the received
+ *                       bytes.
+ * @param dataSizeBytes  the number of bytes of storage available
+ *                       at pData.
+ * @return               the number of bytes received else negated
+ *                       value of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uCellSockDirectLinkRead(int32_t cellHandle,
+                                int32_t sockHandle,
+                                void *pData, size_t dataSizeBytes);
+
+/** Leave direct link mode, returning the AT interface to
+ * command mode: this takes at least twice
+ * U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS.  Any received data
+ * that has not been read with uCellSockDirectLinkRead() is
+ * lost.  This must be called from the same task that called
+ * uCellSockDirectLinkStart().  Note that some modules close
+ * the socket when direct link mode ends, in which case
+ * the socket should be closed with uCellSockClose().
+ *
+ * @param cellHandle  the handle of the cellular instance.
+ * @param sockHandle  the handle of the socket.
+ * @return            zero on success else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h; even
+ *                    on failure the socket is no longer
+ *                    considered to be in direct link mode.
+ */
+int32_t uCellSockDirectLinkStop(int32_t cellHandle,
+                                int32_t sockHandle);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: FINDING ADDRESSES
  * -------------------------------------------------------------- */
@@ -448,7 +720,9 @@ int32_t uCellSockGetHostByName(int32_t cellHandle,
  * @param cellHandle    the handle of the cellular instance.
  * @param sockHandle    the handle of the socket.
  * @param pLocalAddress a place to put the local IP address
- *                      of the socket.
+ *                      of the socket; the port is the one
+ *                      given to uCellSockBind(), zero if the
+ *                      socket has not been bound.
  * @return              zero on success else negated
  *                      value of U_SOCK_Exxx from
  *                      u_sock_errno.h.
@@ -71,21 +71,6 @@ static int32_t gNextInstanceHandle = (int32_t) U_NETWORK_HANDLE_CELL_MIN;
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
-// Find a cellular instance in the list by AT handle.
-// gUCellPrivateMutex should be locked before this is called.
-//lint -e{818} suppress "could be declared as pointing to const":
-// atHandle is anonymous
-static uCellPrivateInstance_t *pGetCellInstanceAtHandle(uAtClientHandle_t atHandle)
-{
-    uCellPrivateInstance_t *pInstance = gpUCellPrivateInstanceList;
-
-    while ((pInstance != NULL) && (pInstance->atHandle != atHandle)) {
-        pInstance = pInstance->pNext;
-    }
-
-    return pInstance;
-}
-
 // Add a cellular instance to the list.
 // gUCellPrivateMutex should be locked before this is called.
 // Note: doesn't copy it, just adds it.
@@ -153,6 +138,8 @@ void uCellDeinit()
             uCellPrivateScanFree(&(pInstance->pScanResults));
             // Free any chip to chip security context
             uCellPrivateC2cRemoveContext(pInstance);
+            // Free any socket table
+            free(pInstance->pSockContext);
             free(pInstance);
         }
 
@@ -183,7 +170,7 @@ int32_t uCellAdd(uCellModuleType_t moduleType,
         handleOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
         if (((size_t) moduleType < gUCellPrivateModuleListSize) &&
             (atHandle != NULL) &&
-            (pGetCellInstanceAtHandle(atHandle) == NULL)) {
+            (pUCellPrivateGetInstanceAtHandle(atHandle) == NULL)) {
             handleOrErrorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
             // Allocate memory for the instance
             pInstance = (uCellPrivateInstance_t *) malloc(sizeof(uCellPrivateInstance_t));
@@ -211,6 +198,7 @@ int32_t uCellAdd(uCellModuleType_t moduleType,
                 uCellPrivateClearRadioParameters(&(pInstance->radioParameters));
                 pInstance->pModule = &(gUCellPrivateModuleList[moduleType]);
                 pInstance->pSecurityC2cContext = NULL;
+                pInstance->pSockContext = NULL;
                 pInstance->pNext = NULL;
 
                 // Now set up the pins
@@ -337,6 +325,8 @@ void uCellRemove(int32_t cellHandle)
             uCellPrivateScanFree(&(pInstance->pScanResults));
             // Free any chip to chip security context
             uCellPrivateC2cRemoveContext(pInstance);
+            // Free any socket table
+            free(pInstance->pSockContext);
             free(pInstance);
         }
 
@@ -81,7 +81,8 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         50 /* Cmd wait ms */, 2000 /* Resp max wait ms */, 0 /* radioOffCfun */, 2 /* Simultaneous RATs */,
         ((1UL << (int32_t) U_CELL_NET_RAT_GSM_GPRS_EGPRS) |
          (1UL << (int32_t) U_CELL_NET_RAT_UTRAN)) /* RATs */,
-        (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION) /* features */
+        (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_USE_UPSD_CONTEXT_ACTIVATION) /* features */,
+        7 /* Max num sockets */
     },
     {
         U_CELL_MODULE_TYPE_SARA_R410M_02B, 300 /* Pwr On pull ms */, 2000 /* Pwr off pull ms */,
@@ -90,7 +91,8 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
         ((1UL << (int32_t) U_CELL_NET_RAT_CATM1)          |
          (1UL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
         ((1UL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE) |
-         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)) /* features */
+         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)) /* features */,
+        7 /* Max num sockets */
     },
     {
         U_CELL_MODULE_TYPE_SARA_R412M_02B, 300 /* Pwr On pull ms */, 2000 /* Pwr off pull ms */,
@@ -101,7 +103,8 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
          (1UL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
         ((1UL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE) |
          (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON) |
-         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)) /* features */
+         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)) /* features */,
+        7 /* Max num sockets */
     },
     {
         U_CELL_MODULE_TYPE_SARA_R412M_03B, 300 /* Pwr On pull ms */, 2000 /* Pwr off pull ms */,
@@ -111,7 +114,8 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
          (1UL << (int32_t) U_CELL_NET_RAT_CATM1)          |
          (1UL << (int32_t) U_CELL_NET_RAT_NB1)) /* RATs */,
         ((1UL << (int32_t) U_CELL_PRIVATE_FEATURE_MNO_PROFILE) |
-         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)) /* features */
+         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)) /* features */,
+        7 /* Max num sockets */
     },
     {
         U_CELL_MODULE_TYPE_SARA_R5, 1500 /* Pwr On pull ms */, 2000 /* Pwr off pull ms */,
@@ -122,7 +126,9 @@ const uCellPrivateModule_t gUCellPrivateModuleList[] = {
          (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_CSCON)         |
          (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST) |
          (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_SECURITY_C2C)  |
-         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_DATA_COUNTERS)) /* features */
+         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_DATA_COUNTERS) |
+         (1UL << (int32_t) U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CONNECT)) /* features */,
+        7 /* Max num sockets */
     }
 };
 
@@ -137,12 +143,26 @@ const size_t gUCellPrivateModuleListSize = sizeof(gUCellPrivateModuleList) /
  * VARIABLES
  * -------------------------------------------------------------- */
 
-/** For binary/hex conversion.
+/** For binary to hex conversion.
  */
 static const char gHex[] = {'0', '1', '2', '3', '4', '5', '6', '7',
                             '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
                            };
 
+/** For hex to binary conversion: indexed by ASCII character,
+ * the value of that hex digit plus one, or zero if the
+ * character is not a hex digit.
+ */
+static const uint8_t gHexToNibblePlusOne[256] = {
+    ['0'] = 0x01, ['1'] = 0x02, ['2'] = 0x03, ['3'] = 0x04,
+    ['4'] = 0x05, ['5'] = 0x06, ['6'] = 0x07, ['7'] = 0x08,
+    ['8'] = 0x09, ['9'] = 0x0a,
+    ['A'] = 0x0b, ['B'] = 0x0c, ['C'] = 0x0d, ['D'] = 0x0e,
+    ['E'] = 0x0f, ['F'] = 0x10,
+    ['a'] = 0x0b, ['b'] = 0x0c, ['c'] = 0x0d, ['d'] = 0x0e,
+    ['e'] = 0x0f, ['f'] = 0x10
+};
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -176,6 +196,20 @@ uCellPrivateInstance_t *pUCellPrivateGetInstance(int32_t handle)
     return pInstance;
 }
 
+// Find a cellular instance in the list by AT client handle.
+//lint -e{818} suppress "could be declared as pointing to const":
+// atHandle is anonymous
+uCellPrivateInstance_t *pUCellPrivateGetInstanceAtHandle(uAtClientHandle_t atHandle)
+{
+    uCellPrivateInstance_t *pInstance = gpUCellPrivateInstanceList;
+
+    while ((pInstance != NULL) && (pInstance->atHandle != atHandle)) {
+        pInstance = pInstance->pNext;
+    }
+
+    return pInstance;
+}
+
 // Set the radio parameters back to defaults.
 void uCellPrivateClearRadioParameters(uCellPrivateRadioParameters_t *pParameters)
 {
@@ -381,12 +415,14 @@ const uCellPrivateModule_t *pUCellPrivateGetModule(int32_t handle)
 size_t uCellPrivateBinToHex(const char *pBin, size_t binLength,
                             char *pHex)
 {
+    const unsigned char *pIn = (const unsigned char *) pBin;
+
     for (size_t x = 0; x < binLength; x++) {
-        *pHex = gHex[((unsigned char) * pBin) >> 4];
+        *pHex = gHex[*pIn >> 4];
         pHex++;
-        *pHex = gHex[*pBin & 0x0f];
+        *pHex = gHex[*pIn & 0x0f];
         pHex++;
-        pBin++;
+        pIn++;
     }
 
     return binLength * 2;
@@ -396,34 +432,22 @@ size_t uCellPrivateBinToHex(const char *pBin, size_t binLength,
 size_t uCellPrivateHexToBin(const char *pHex, size_t hexLength,
                             char *pBin)
 {
-    bool success = true;
+    const unsigned char *pIn = (const unsigned char *) pHex;
     size_t length;
-    char z[2];
-
-    for (length = 0; (length < hexLength / 2) && success; length++) {
-        z[0] = *pHex - '0';
-        pHex++;
-        z[1] = *pHex - '0';
-        pHex++;
-        for (size_t y = 0; (y < sizeof(z)) && success; y++) {
-            if (z[y] > 9) {
-                // Must be A to F or a to f
-                z[y] -= 'A' - '0';
-                z[y] += 10;
-            }
-            if (z[y] > 15) {
-                // Must be a to f
-                z[y] -= 'a' - 'A';
-            }
-            // Cast here to shut-up a warning under ESP-IDF
-            // which appears to have chars as unsigned and
-            // hence thinks the first condition is always true
-            success = ((signed char) z[y] >= 0) && (z[y] <= 15);
-        }
-        if (success) {
-            *pBin = (char) (((z[0] & 0x0f) << 4) | z[1]);
-            pBin++;
+    uint8_t high;
+    uint8_t low;
+
+    for (length = 0; length < hexLength / 2; length++) {
+        high = gHexToNibblePlusOne[*pIn];
+        pIn++;
+        low = gHexToNibblePlusOne[*pIn];
+        pIn++;
+        if ((high == 0) || (low == 0)) {
+            // Not hex, stop here
+            break;
         }
+        *pBin = (char) (((high - 1) << 4) | (low - 1));
+        pBin++;
     }
 
     return length;
@@ -135,7 +135,8 @@ typedef enum {
     U_CELL_PRIVATE_FEATURE_ROOT_OF_TRUST,
     U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE,
     U_CELL_PRIVATE_FEATURE_SECURITY_C2C,
-    U_CELL_PRIVATE_FEATURE_DATA_COUNTERS
+    U_CELL_PRIVATE_FEATURE_DATA_COUNTERS,
+    U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CONNECT
 } uCellPrivateFeature_t;
 
 /** The characteristics that may differ between cellular modules.
@@ -186,6 +187,9 @@ typedef struct {
                                        module. */
     uint32_t featuresBitmap; /**< a bit-map of the uCellPrivateFeature_t
                                   characteristics of this module. */
+    size_t maxNumSockets; /**< The maximum number of sockets that the
+                               module can have open at one time, never
+                               more than U_CELL_SOCK_MAX_NUM_SOCKETS. */
 } uCellPrivateModule_t;
 
 /** The radio parameters.
@@ -245,6 +249,9 @@ typedef struct uCellPrivateInstance_t {
     void *pConnectionStatusCallbackParameter;
     uCellPrivateNet_t *pScanResults;    /**< Anchor for list of network scan results. */
     void *pSecurityC2cContext;  /**< Hook for a chip to chip security context. */
+    void *pSockContext;  /**< Hook for the socket table of this instance. */
+    bool sockHexMode;  /**< True if socket data is exchanged with the
+                            module as ASCII hex (AT+UDCONF=1,1). */
     struct uCellPrivateInstance_t *pNext;
 } uCellPrivateInstance_t;
 
@@ -291,6 +298,14 @@ extern uPortMutexHandle_t gUCellPrivateMutex;
  */
 uCellPrivateInstance_t *pUCellPrivateGetInstance(int32_t handle);
 
+/** Find a cellular instance in the list by AT client handle.
+ * Note: gUCellPrivateMutex should be locked before this is called.
+ *
+ * @param atHandle  the AT client handle.
+ * @return          a pointer to the instance.
+ */
+uCellPrivateInstance_t *pUCellPrivateGetInstanceAtHandle(uAtClientHandle_t atHandle);
+
 /** Set the radio parameters back to defaults.
  *
  * @param pParameters pointer to a radio parameters structure.
@@ -397,6 +412,7 @@ size_t uCellPrivateBinToHex(const char *pBin, size_t binLength,
                             char *pHex);
 
 /** Convert a buffer of ASCII hex into the binary equivalent.
+ * Upper or lower case ASCII hex is accepted.
  * If it is not possible to convert character (e.g. because
  * it is not valid ASCII hex) then conversion stops there.
  *
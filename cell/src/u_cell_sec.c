@@ -83,6 +83,18 @@
 # error U_CELL_SEC_HEX_BUFFER_LENGTH_BYTES not the same size as the ASCII hex version of U_SECURITY_C2C_HMAC_TAG_LENGTH_BYTES.
 #endif
 
+/** The AT+USECPRF op-codes used when setting up a TLS
+ * security profile.
+ */
+#define U_CELL_SEC_TLS_PRF_OP_VALIDATION        0
+#define U_CELL_SEC_TLS_PRF_OP_TLS_VERSION_MIN   1
+#define U_CELL_SEC_TLS_PRF_OP_ROOT_CA_NAME      3
+#define U_CELL_SEC_TLS_PRF_OP_SERVER_HOSTNAME   4
+#define U_CELL_SEC_TLS_PRF_OP_CLIENT_CERT_NAME  5
+#define U_CELL_SEC_TLS_PRF_OP_CLIENT_KEY_NAME   6
+#define U_CELL_SEC_TLS_PRF_OP_CLIENT_KEY_PWD    7
+#define U_CELL_SEC_TLS_PRF_OP_SNI               10
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -123,6 +135,35 @@ static bool moduleIsSealed(const uCellPrivateInstance_t *pInstance)
     return isSealed;
 }
 
+// Write a single integer op-code of a TLS security profile;
+// the AT client must already be locked.
+static void tlsProfileWriteInt(uAtClientHandle_t atHandle,
+                               int32_t profileId,
+                               int32_t opCode, int32_t value)
+{
+    uAtClientCommandStart(atHandle, "AT+USECPRF=");
+    uAtClientWriteInt(atHandle, profileId);
+    uAtClientWriteInt(atHandle, opCode);
+    uAtClientWriteInt(atHandle, value);
+    uAtClientCommandStopReadResponse(atHandle);
+}
+
+// Write a single string op-code of a TLS security profile,
+// doing nothing if pValue is NULL; the AT client must already
+// be locked.
+static void tlsProfileWriteString(uAtClientHandle_t atHandle,
+                                  int32_t profileId,
+                                  int32_t opCode, const char *pValue)
+{
+    if (pValue != NULL) {
+        uAtClientCommandStart(atHandle, "AT+USECPRF=");
+        uAtClientWriteInt(atHandle, profileId);
+        uAtClientWriteInt(atHandle, opCode);
+        uAtClientWriteString(atHandle, pValue, true);
+        uAtClientCommandStopReadResponse(atHandle);
+    }
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: INFORMATION
  * -------------------------------------------------------------- */
@@ -691,4 +732,179 @@ int32_t uCellSecHeartbeatTrigger(int32_t cellHandle)
     return errorCode;
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TLS
+ * -------------------------------------------------------------- */
+
+// Store a TLS credential in the module's file store.
+int32_t uCellSecTlsCredentialStore(int32_t cellHandle,
+                                   uSecurityTlsCredentialType_t type,
+                                   const char *pName,
+                                   const char *pData,
+                                   size_t sizeBytes,
+                                   const char *pPassword)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pName != NULL) &&
+            (pData != NULL) && (sizeBytes > 0)) {
+            atHandle = pInstance->atHandle;
+            uAtClientLock(atHandle);
+            uAtClientCommandStart(atHandle, "AT+USECMNG=");
+            // Import from serial
+            uAtClientWriteInt(atHandle, 0);
+            uAtClientWriteInt(atHandle, (int32_t) type);
+            uAtClientWriteString(atHandle, pName, true);
+            uAtClientWriteInt(atHandle, (int32_t) sizeBytes);
+            if (pPassword != NULL) {
+                uAtClientWriteString(atHandle, pPassword, true);
+            }
+            uAtClientCommandStop(atHandle);
+            // Wait for the prompt
+            if (uAtClientWaitCharacter(atHandle, '>') == 0) {
+                // Go!
+                uAtClientWriteBytes(atHandle, pData, sizeBytes, true);
+                // The response includes the MD5 hash of what was
+                // stored, which we don't need: the OK is enough
+                uAtClientResponseStart(atHandle, "+USECMNG:");
+                uAtClientResponseStop(atHandle);
+            }
+            errorCode = uAtClientUnlock(atHandle);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Remove a TLS credential from the module's file store.
+int32_t uCellSecTlsCredentialRemove(int32_t cellHandle,
+                                    uSecurityTlsCredentialType_t type,
+                                    const char *pName)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pName != NULL)) {
+            atHandle = pInstance->atHandle;
+            uAtClientLock(atHandle);
+            uAtClientCommandStart(atHandle, "AT+USECMNG=");
+            uAtClientWriteInt(atHandle, 2);
+            uAtClientWriteInt(atHandle, (int32_t) type);
+            uAtClientWriteString(atHandle, pName, true);
+            uAtClientCommandStopReadResponse(atHandle);
+            errorCode = uAtClientUnlock(atHandle);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Set up a TLS security profile.
+int32_t uCellSecTlsProfileSet(int32_t cellHandle,
+                              int32_t profileId,
+                              const uSecurityTlsProfile_t *pProfile)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (profileId >= 0) &&
+            (profileId <= U_CELL_SEC_TLS_PROFILE_ID_MAX) &&
+            (pProfile != NULL)) {
+            atHandle = pInstance->atHandle;
+            // Do the lot under one lock: the AT client
+            // remembers the first error, if there is one
+            uAtClientLock(atHandle);
+            // Reset the profile to start with
+            uAtClientCommandStart(atHandle, "AT+USECPRF=");
+            uAtClientWriteInt(atHandle, profileId);
+            uAtClientCommandStopReadResponse(atHandle);
+            tlsProfileWriteInt(atHandle, profileId,
+                               U_CELL_SEC_TLS_PRF_OP_VALIDATION,
+                               (int32_t) pProfile->validation);
+            tlsProfileWriteInt(atHandle, profileId,
+                               U_CELL_SEC_TLS_PRF_OP_TLS_VERSION_MIN,
+                               (int32_t) pProfile->tlsVersionMin);
+            tlsProfileWriteString(atHandle, profileId,
+                                  U_CELL_SEC_TLS_PRF_OP_ROOT_CA_NAME,
+                                  pProfile->pRootCaName);
+            tlsProfileWriteString(atHandle, profileId,
+                                  U_CELL_SEC_TLS_PRF_OP_SERVER_HOSTNAME,
+                                  pProfile->pExpectedServerHostname);
+            tlsProfileWriteString(atHandle, profileId,
+                                  U_CELL_SEC_TLS_PRF_OP_CLIENT_CERT_NAME,
+                                  pProfile->pClientCertificateName);
+            tlsProfileWriteString(atHandle, profileId,
+                                  U_CELL_SEC_TLS_PRF_OP_CLIENT_KEY_NAME,
+                                  pProfile->pClientPrivateKeyName);
+            tlsProfileWriteString(atHandle, profileId,
+                                  U_CELL_SEC_TLS_PRF_OP_CLIENT_KEY_PWD,
+                                  pProfile->pClientPrivateKeyPassword);
+            tlsProfileWriteString(atHandle, profileId,
+                                  U_CELL_SEC_TLS_PRF_OP_SNI,
+                                  pProfile->pServerNameIndication);
+            errorCode = uAtClientUnlock(atHandle);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
+// Reset a TLS security profile.
+int32_t uCellSecTlsProfileReset(int32_t cellHandle,
+                                int32_t profileId)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstance(cellHandle);
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (profileId >= 0) &&
+            (profileId <= U_CELL_SEC_TLS_PROFILE_ID_MAX)) {
+            atHandle = pInstance->atHandle;
+            uAtClientLock(atHandle);
+            uAtClientCommandStart(atHandle, "AT+USECPRF=");
+            uAtClientWriteInt(atHandle, profileId);
+            uAtClientCommandStopReadResponse(atHandle);
+            errorCode = uAtClientUnlock(atHandle);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+    }
+
+    return errorCode;
+}
+
 // End of file
@@ -29,6 +29,7 @@
 #endif
 
 #include "stdio.h"     // snprintf()
+#include "stdlib.h"    // malloc() and free()
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
@@ -39,16 +40,20 @@
 #include "u_port.h"
 #include "u_port_debug.h"
 #include "u_port_os.h"
+#include "u_port_uart.h"
 
 #include "u_at_client.h"
 
 #include "u_sock_errno.h"
 #include "u_sock.h"
 
+#include "u_security.h"
+
 #include "u_cell_module_type.h"
 #include "u_cell_net.h"
 #include "u_cell_private.h"
 #include "u_cell_sock.h"
+#include "u_cell_sec.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -75,6 +80,39 @@
 # define U_CELL_SOCK_DNS_SHOULD_RETRY_MS 2000
 #endif
 
+#ifndef U_CELL_SOCK_WRITE_PROMPT_DELAY_MS
+/** The time to wait after the "@" prompt of AT+USOWR/AT+USOST
+ * has been received before sending the binary data.  The prompt
+ * is only sent once the module is ready for the data so, by
+ * default, the data follows it straight away; this may be set
+ * to add a gap should a module/firmware version turn out to
+ * need one.
+ */
+# define U_CELL_SOCK_WRITE_PROMPT_DELAY_MS 0
+#endif
+
+/** The number of bits at the bottom of a socket handle that
+ * hold the index of the socket in the socket table of its
+ * cellular instance, the remaining bits being a sequence number
+ * so that a handle is not immediately re-used.
+ */
+#define U_CELL_SOCK_HANDLE_INDEX_BITS 4
+
+/** Mask for the index part of a socket handle.
+ */
+#define U_CELL_SOCK_HANDLE_INDEX_MASK ((1 << U_CELL_SOCK_HANDLE_INDEX_BITS) - 1)
+
+#if U_CELL_SOCK_MAX_NUM_SOCKETS > U_CELL_SOCK_HANDLE_INDEX_MASK + 1
+# error U_CELL_SOCK_MAX_NUM_SOCKETS is too large for U_CELL_SOCK_HANDLE_INDEX_BITS
+#endif
+
+#ifndef U_CELL_SOCK_HEX_BUFFER_LENGTH_BYTES
+/** The size of the buffer on the stack used when converting
+ * socket data to or from ASCII hex in hex mode; must be even.
+ */
+# define U_CELL_SOCK_HEX_BUFFER_LENGTH_BYTES 128
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -92,6 +130,9 @@ typedef struct {
                                    uses for the socket instance.
                                    -1 if this socket is not in use. */
     volatile int32_t pendingBytes;
+    int64_t lastProbeTimeMs; /**< The last time the module was asked
+                                  how much data is waiting on this
+                                  socket. */
     void (*pAsyncClosedCallback) (int32_t, int32_t); /**< Set to NULL
                                                           if socket is
                                                           not in use. */
@@ -101,8 +142,55 @@ typedef struct {
     void (*pClosedCallback) (int32_t, int32_t); /**< Set to NULL
                                                      if socket is
                                                      not in use. */
+    void (*pConnectCallback) (int32_t, int32_t, int32_t); /**< Set to NULL
+                                                               if no
+                                                               asynchronous
+                                                               connect is
+                                                               in progress. */
+    volatile int32_t connectResult; /**< The outcome of an asynchronous
+                                         connect, passed to
+                                         pConnectCallback. */
+    uint16_t localPort; /**< The port set by uCellSockBind(). */
+    size_t listenBacklog; /**< The maximum number of incoming
+                               connections waiting to be
+                               accepted, zero if this is not a
+                               listening socket. */
+    int32_t acceptListenerSockHandle; /**< For an incoming connection
+                                           that has not yet been
+                                           accepted, the handle of
+                                           the listening socket, else
+                                           -1. */
+    uint32_t acceptOrder; /**< For an incoming connection that has
+                               not yet been accepted, the order
+                               in which it arrived. */
+    uSockAddress_t remoteAddress; /**< For an incoming connection, the
+                                       address it came from. */
+    bool directLink; /**< True if this socket is in direct link
+                          mode and hence owns the AT interface. */
+    int32_t securityProfileId; /**< The module security profile
+                                    applied to this socket, -1
+                                    if there is none. */
 } uCellSockSocket_t;
 
+/** The socket table of a cellular instance, hung off
+ * pSockContext in the instance; the two arrays follow the
+ * structure in the same allocation.
+ */
+typedef struct {
+    size_t numSockets; /**< The number of entries in both arrays. */
+    int32_t nextSequence; /**< The sequence number to put into
+                               the next socket handle. */
+    uint32_t nextAcceptOrder; /**< The arrival order to give the
+                                   next incoming connection. */
+    uCellSockSocket_t *pSockets; /**< The sockets, indexed by the
+                                      bottom bits of the socket
+                                      handle. */
+    uCellSockSocket_t **ppByModuleHandle; /**< The sockets, indexed by
+                                               the module's socket
+                                               handle, NULL where
+                                               there is none. */
+} uCellSockTable_t;
+
 /** Definition of a URC handler.
  */
 typedef struct {
@@ -117,27 +205,86 @@ typedef struct {
 // Keep track of whether we're initialised or not.
 static bool gInitialised = false;
 
-/** The next socket handle to use.
+/** Mutex to protect the allocation of entries in the socket
+ * tables, which happens both in API calls and in URCs; it is
+ * never held across an AT transaction.
  */
-static int32_t gNextSockHandle = 0;
+static uPortMutexHandle_t gMutex = NULL;
 
-/** The sockets: a nice simple array, nothing fancy.
+/** The number of zero-length AT+USORD/AT+USORF commands that
+ * were not sent because the URCs were trusted; protected by gMutex.
  */
-static uCellSockSocket_t gSockets[U_CELL_SOCK_MAX_NUM_SOCKETS];
+static int32_t gNumProbesAvoided = 0;
 
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: LIST MANAGEMENT
  * -------------------------------------------------------------- */
 
-// Find the entry for the given socket handle.
-static uCellSockSocket_t *pFindBySockHandle(int32_t sockHandle)
+// Set a socket entry to its unused state.
+static void sockClear(uCellSockSocket_t *pSock)
 {
+    pSock->sockHandle = -1;
+    pSock->cellHandle = -1;
+    pSock->atHandle = NULL;
+    pSock->sockHandleModule = -1;
+    pSock->pendingBytes = 0;
+    pSock->lastProbeTimeMs = 0;
+    pSock->pAsyncClosedCallback = NULL;
+    pSock->pDataCallback = NULL;
+    pSock->pClosedCallback = NULL;
+    pSock->pConnectCallback = NULL;
+    pSock->localPort = 0;
+    pSock->listenBacklog = 0;
+    pSock->acceptListenerSockHandle = -1;
+    pSock->directLink = false;
+    pSock->securityProfileId = -1;
+}
+
+// Create the socket table for an instance if it doesn't
+// already have one, returning the socket table.
+static uCellSockTable_t *pTableCreate(uCellPrivateInstance_t *pInstance)
+{
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
+    size_t numSockets = pInstance->pModule->maxNumSockets;
+
+    if (pTable == NULL) {
+        if (numSockets > U_CELL_SOCK_MAX_NUM_SOCKETS) {
+            numSockets = U_CELL_SOCK_MAX_NUM_SOCKETS;
+        }
+        pTable = (uCellSockTable_t *) malloc(sizeof(uCellSockTable_t) +
+                                             (numSockets * (sizeof(uCellSockSocket_t) +
+                                                            sizeof(uCellSockSocket_t *))));
+        if (pTable != NULL) {
+            pTable->numSockets = numSockets;
+            pTable->nextSequence = 0;
+            pTable->nextAcceptOrder = 0;
+            pTable->pSockets = (uCellSockSocket_t *) (pTable + 1);
+            pTable->ppByModuleHandle = (uCellSockSocket_t **) (pTable->pSockets + numSockets);
+            for (size_t x = 0; x < numSockets; x++) {
+                sockClear(&(pTable->pSockets[x]));
+                pTable->ppByModuleHandle[x] = NULL;
+            }
+            pInstance->pSockContext = pTable;
+        }
+    }
+
+    return pTable;
+}
+
+// Find the entry for the given socket handle: the bottom bits
+// of the handle are the index into the table.
+static uCellSockSocket_t *pFindBySockHandle(const uCellPrivateInstance_t *pInstance,
+                                            int32_t sockHandle)
+{
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
     uCellSockSocket_t *pSock = NULL;
+    size_t x;
 
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
-         (pSock == NULL); x++) {
-        if (gSockets[x].sockHandle == sockHandle) {
-            pSock = &(gSockets[x]);
+    if ((pTable != NULL) && (sockHandle >= 0)) {
+        x = (size_t) (sockHandle & U_CELL_SOCK_HANDLE_INDEX_MASK);
+        if ((x < pTable->numSockets) &&
+            (pTable->pSockets[x].sockHandle == sockHandle)) {
+            pSock = &(pTable->pSockets[x]);
         }
     }
 
@@ -145,71 +292,190 @@ static uCellSockSocket_t *pFindBySockHandle(int32_t sockHandle)
 }
 
 // Find the entry for the given module socket handle.
-//lint -e{818} suppress "could be declared as pointing to const": it is!
-static uCellSockSocket_t *pFindBySockHandleModule(const uAtClientHandle_t atHandle,
+static uCellSockSocket_t *pFindBySockHandleModule(const uCellPrivateInstance_t *pInstance,
                                                   int32_t sockHandleModule)
 {
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
     uCellSockSocket_t *pSock = NULL;
 
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
-         (pSock == NULL); x++) {
-        if ((gSockets[x].sockHandle >= 0) &&
-            (gSockets[x].atHandle == atHandle) &&
-            (gSockets[x].sockHandleModule == sockHandleModule)) {
-            pSock = &(gSockets[x]);
+    if ((pTable != NULL) && (sockHandleModule >= 0)) {
+        if ((size_t) sockHandleModule < pTable->numSockets) {
+            pSock = pTable->ppByModuleHandle[sockHandleModule];
+        } else {
+            // Not a module handle we would expect, have a look anyway
+            for (size_t x = 0; (x < pTable->numSockets) && (pSock == NULL); x++) {
+                if ((pTable->pSockets[x].sockHandle >= 0) &&
+                    (pTable->pSockets[x].sockHandleModule == sockHandleModule)) {
+                    pSock = &(pTable->pSockets[x]);
+                }
+            }
         }
     }
 
     return pSock;
 }
 
-// Create a socket entry in the list.
-static uCellSockSocket_t *pSockCreate(int32_t sockHandle,
-                                      int32_t cellHandle,
-                                      uAtClientHandle_t atHandle)
+// Set the module socket handle of an entry.
+static void sockHandleModuleSet(const uCellPrivateInstance_t *pInstance,
+                                uCellSockSocket_t *pSock,
+                                int32_t sockHandleModule)
 {
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
+
+    pSock->sockHandleModule = sockHandleModule;
+    if ((sockHandleModule >= 0) &&
+        ((size_t) sockHandleModule < pTable->numSockets)) {
+        pTable->ppByModuleHandle[sockHandleModule] = pSock;
+    }
+}
+
+// Create a socket entry in the table: gMutex must be locked.
+static uCellSockSocket_t *pSockCreate(const uCellPrivateInstance_t *pInstance)
+{
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
     uCellSockSocket_t *pSock = NULL;
+    size_t x = 0;
 
-    // Find an empty entry in the list
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
-         (pSock == NULL); x++) {
-        if (gSockets[x].sockHandle < 0) {
-            pSock = &(gSockets[x]);
+    if (pTable != NULL) {
+        // Find an empty entry in the table
+        for (x = 0; (x < pTable->numSockets) && (pSock == NULL); x++) {
+            if (pTable->pSockets[x].sockHandle < 0) {
+                pSock = &(pTable->pSockets[x]);
+            }
         }
     }
 
     // Set it up
     if (pSock != NULL) {
-        pSock->sockHandle = sockHandle;
-        pSock->cellHandle = cellHandle;
-        pSock->atHandle = atHandle;
+        x--;
+        pSock->sockHandle = (pTable->nextSequence << U_CELL_SOCK_HANDLE_INDEX_BITS) | (int32_t) x;
+        pTable->nextSequence++;
+        if (pTable->nextSequence > (INT32_MAX >> U_CELL_SOCK_HANDLE_INDEX_BITS)) {
+            pTable->nextSequence = 0;
+        }
+        pSock->cellHandle = pInstance->handle;
+        pSock->atHandle = pInstance->atHandle;
         pSock->sockHandleModule = -1;
+        pSock->pendingBytes = 0;
         pSock->pAsyncClosedCallback = NULL;
         pSock->pDataCallback = NULL;
         pSock->pClosedCallback = NULL;
+        pSock->pConnectCallback = NULL;
+        pSock->localPort = 0;
+        pSock->listenBacklog = 0;
+        pSock->acceptListenerSockHandle = -1;
+        pSock->directLink = false;
+        pSock->lastProbeTimeMs = 0;
+        pSock->securityProfileId = -1;
+    }
+
+    return pSock;
+}
+
+// Free an entry in the table: gMutex must be locked.
+static void sockFree(const uCellPrivateInstance_t *pInstance,
+                     int32_t sockHandle)
+{
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
+    uCellSockSocket_t *pSock;
+    int32_t sockHandleModule;
+
+    pSock = pFindBySockHandle(pInstance, sockHandle);
+    if (pSock != NULL) {
+        sockHandleModule = pSock->sockHandleModule;
+        if ((sockHandleModule >= 0) &&
+            ((size_t) sockHandleModule < pTable->numSockets) &&
+            (pTable->ppByModuleHandle[sockHandleModule] == pSock)) {
+            pTable->ppByModuleHandle[sockHandleModule] = NULL;
+        }
+        sockClear(pSock);
+    }
+}
+
+// Count the incoming connections waiting to be accepted
+// on the given listening socket.
+static size_t numPendingAccept(const uCellPrivateInstance_t *pInstance,
+                               int32_t sockHandle)
+{
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
+    size_t numPending = 0;
+
+    for (size_t x = 0; (pTable != NULL) && (x < pTable->numSockets); x++) {
+        if ((pTable->pSockets[x].sockHandle >= 0) &&
+            (pTable->pSockets[x].acceptListenerSockHandle == sockHandle)) {
+            numPending++;
+        }
+    }
+
+    return numPending;
+}
+
+// Find the incoming connection that has been waiting
+// longest to be accepted on the given listening socket:
+// gMutex must be locked.
+static uCellSockSocket_t *pFindPendingAccept(const uCellPrivateInstance_t *pInstance,
+                                             int32_t sockHandle)
+{
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
+    uCellSockSocket_t *pSock = NULL;
+
+    for (size_t x = 0; (pTable != NULL) && (x < pTable->numSockets); x++) {
+        if ((pTable->pSockets[x].sockHandle >= 0) &&
+            (pTable->pSockets[x].acceptListenerSockHandle == sockHandle) &&
+            ((pSock == NULL) ||
+             ((int32_t) (pTable->pSockets[x].acceptOrder - pSock->acceptOrder) < 0))) {
+            // Compare the difference, rather than the values,
+            // so that this still works when the counter wraps
+            pSock = &(pTable->pSockets[x]);
+        }
     }
 
     return pSock;
 }
 
-// Free an entry in the list.
-static void sockFree(int32_t sockHandle)
+// Find the socket, if any, that is in direct link mode
+// on the given instance.
+static uCellSockSocket_t *pFindDirectLink(const uCellPrivateInstance_t *pInstance)
 {
+    uCellSockTable_t *pTable = (uCellSockTable_t *) pInstance->pSockContext;
     uCellSockSocket_t *pSock = NULL;
 
-    for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])) &&
+    for (size_t x = 0; (pTable != NULL) && (x < pTable->numSockets) &&
          (pSock == NULL); x++) {
-        if (gSockets[x].sockHandle == sockHandle) {
-            pSock = &(gSockets[x]);
-            pSock->sockHandle = -1;
-            pSock->cellHandle = -1;
-            pSock->atHandle = NULL;
-            pSock->sockHandleModule = -1;
-            pSock->pAsyncClosedCallback = NULL;
-            pSock->pDataCallback = NULL;
-            pSock->pClosedCallback = NULL;
+        if ((pTable->pSockets[x].sockHandle >= 0) &&
+            pTable->pSockets[x].directLink) {
+            pSock = &(pTable->pSockets[x]);
         }
     }
+
+    return pSock;
+}
+
+// Determine whether the module should be asked how much data
+// is waiting on a socket for which no +UUSORD/+UUSORF has
+// arrived.
+static bool probeRequired(uCellSockSocket_t *pSocket)
+{
+    bool required = true;
+#if U_CELL_SOCK_TRUST_URC_PENDING_BYTES
+    int64_t nowMs = uPortGetTickTimeMs();
+
+    if (nowMs - pSocket->lastProbeTimeMs <
+        U_CELL_SOCK_PENDING_BYTES_RESYNC_INTERVAL_MS) {
+        // Trust the URCs
+        required = false;
+        U_PORT_MUTEX_LOCK(gMutex);
+        gNumProbesAvoided++;
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    } else {
+        // Time to resync
+        pSocket->lastProbeTimeMs = nowMs;
+    }
+#else
+    (void) pSocket;
+#endif
+
+    return required;
 }
 
 /* ----------------------------------------------------------------
@@ -224,16 +490,31 @@ static void dataCallback(const uAtClientHandle_t atHandle,
     // we use for Lint checking is 64 bit so has 8 byte pointers
     // and Lint doesn't like them being used to carry 4 byte integers
     int32_t sockHandle = (int32_t) pParameter;
+    uCellPrivateInstance_t *pInstance;
     uCellSockSocket_t *pSocket;
+    int32_t cellHandle = -1;
+    void (*pCallback) (int32_t, int32_t) = NULL;
 
-    (void) atHandle;
+    if (gUCellPrivateMutex != NULL) {
 
-    if (sockHandle >= 0) {
-        // Find the entry
-        pSocket = pFindBySockHandle(sockHandle);
-        if ((pSocket != NULL) && (pSocket->pDataCallback != NULL)) {
-            pSocket->pDataCallback(pSocket->cellHandle,
-                                   sockHandle);
+        // Copy out what is needed under the lock and
+        // then call the user callback without it
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstanceAtHandle(atHandle);
+        if ((pInstance != NULL) && (sockHandle >= 0)) {
+            // Find the entry
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
+            if (pSocket != NULL) {
+                cellHandle = pSocket->cellHandle;
+                pCallback = pSocket->pDataCallback;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+
+        if (pCallback != NULL) {
+            pCallback(cellHandle, sockHandle);
         }
     }
 }
@@ -246,43 +527,101 @@ static void closedCallback(const uAtClientHandle_t atHandle,
     // we use for Lint checking is 64 bit so has 8 byte pointers
     // and Lint doesn't like them being used to carry 4 byte integers
     int32_t sockHandle = (int32_t) pParameter;
+    uCellPrivateInstance_t *pInstance;
     uCellSockSocket_t *pSocket;
+    int32_t cellHandle = -1;
+    void (*pClosedCallback) (int32_t, int32_t) = NULL;
+    void (*pAsyncClosedCallback) (int32_t, int32_t) = NULL;
 
-    (void) atHandle;
+    if (gUCellPrivateMutex != NULL) {
 
-    if (sockHandle >= 0) {
-        // Find the entry
-        pSocket = pFindBySockHandle(sockHandle);
-        if (pSocket != NULL) {
-            if (pSocket->pClosedCallback != NULL) {
-                pSocket->pClosedCallback(pSocket->cellHandle,
-                                         sockHandle);
-                // Socket is now closed, can lose the callback
+        // Copy out what is needed and free the entry
+        // under the lock, then call the user callbacks
+        // without it
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstanceAtHandle(atHandle);
+        if ((pInstance != NULL) && (sockHandle >= 0)) {
+            // Find the entry
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
+            if (pSocket != NULL) {
+                // Socket is now closed, can lose the callbacks
+                cellHandle = pSocket->cellHandle;
+                pClosedCallback = pSocket->pClosedCallback;
                 pSocket->pClosedCallback = NULL;
-            }
-            if (pSocket->pAsyncClosedCallback != NULL) {
-                pSocket->pAsyncClosedCallback(pSocket->cellHandle,
-                                              sockHandle);
-                // Socket is now closed, lose the
-                // async closure callback
+                pAsyncClosedCallback = pSocket->pAsyncClosedCallback;
                 pSocket->pAsyncClosedCallback = NULL;
+
+                // Free the entry
+                U_PORT_MUTEX_LOCK(gMutex);
+                sockFree(pInstance, pSocket->sockHandle);
+                U_PORT_MUTEX_UNLOCK(gMutex);
             }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
 
-            // Free the entry
-            sockFree(pSocket->sockHandle);
+        if (pClosedCallback != NULL) {
+            pClosedCallback(cellHandle, sockHandle);
+        }
+        if (pAsyncClosedCallback != NULL) {
+            pAsyncClosedCallback(cellHandle, sockHandle);
+        }
+    }
+}
+
+// Callback trampoline for asynchronous connect completed.
+static void connectCallback(const uAtClientHandle_t atHandle,
+                            void *pParameter)
+{
+    //lint -e(507) Suppress size incompatibility: the compiler
+    // we use for Lint checking is 64 bit so has 8 byte pointers
+    // and Lint doesn't like them being used to carry 4 byte integers
+    int32_t sockHandle = (int32_t) pParameter;
+    uCellPrivateInstance_t *pInstance;
+    uCellSockSocket_t *pSocket;
+    int32_t cellHandle = -1;
+    int32_t connectResult = 0;
+    void (*pCallback) (int32_t, int32_t, int32_t) = NULL;
+
+    if (gUCellPrivateMutex != NULL) {
+
+        // Copy out what is needed under the lock and
+        // then call the user callback without it
+        U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+
+        pInstance = pUCellPrivateGetInstanceAtHandle(atHandle);
+        if ((pInstance != NULL) && (sockHandle >= 0)) {
+            // Find the entry
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
+            if (pSocket != NULL) {
+                // Connect is done, lose the callback
+                // before calling it in case it wants
+                // to connect again
+                cellHandle = pSocket->cellHandle;
+                connectResult = pSocket->connectResult;
+                pCallback = pSocket->pConnectCallback;
+                pSocket->pConnectCallback = NULL;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+
+        if (pCallback != NULL) {
+            pCallback(cellHandle, sockHandle, connectResult);
         }
     }
 }
 
 // Socket Read/Read-From URC.
 static void UUSORD_UUSORF_urc(const uAtClientHandle_t atHandle,
-                              void *pUnused)
+                              void *pParameter)
 {
     int32_t sockHandleModule;
     int32_t dataSizeBytes;
     uCellSockSocket_t *pSocket = NULL;
 
-    (void) pUnused;
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
 
     // +UUSORx: <socket>,<length>
     sockHandleModule = uAtClientReadInt(atHandle);
@@ -290,8 +629,7 @@ static void UUSORD_UUSORF_urc(const uAtClientHandle_t atHandle,
 
     if (sockHandleModule >= 0) {
         // Find the entry
-        pSocket = pFindBySockHandleModule(atHandle,
-                                          sockHandleModule);
+        pSocket = pFindBySockHandleModule(pInstance, sockHandleModule);
         if (pSocket != NULL) {
             // Call the user call-back via the trampoline
             if ((dataSizeBytes > 0) &&
@@ -307,21 +645,24 @@ static void UUSORD_UUSORF_urc(const uAtClientHandle_t atHandle,
 
 // Callback for Socket Close URC.
 static void UUSOCL_urc(const uAtClientHandle_t atHandle,
-                       void *pUnused)
+                       void *pParameter)
 {
     int32_t sockHandleModule;
     uCellSockSocket_t *pSocket = NULL;
 
-    (void) pUnused;
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
 
     // +UUSOCL: <socket>
     sockHandleModule = uAtClientReadInt(atHandle);
     if (sockHandleModule >= 0) {
         // Find the entry
-        pSocket = pFindBySockHandleModule(atHandle,
-                                          sockHandleModule);
+        pSocket = pFindBySockHandleModule(pInstance, sockHandleModule);
         if (pSocket != NULL) {
-            if (pSocket->pClosedCallback != NULL) {
+            // An incoming connection that has not yet been
+            // accepted has no closed callback but must
+            // still be freed
+            if ((pSocket->pClosedCallback != NULL) ||
+                (pSocket->acceptListenerSockHandle >= 0)) {
                 uAtClientCallback(atHandle,
                                   closedCallback,
                                   (void *) (pSocket->sockHandle));
@@ -330,6 +671,118 @@ static void UUSOCL_urc(const uAtClientHandle_t atHandle,
     }
 }
 
+// Callback for asynchronous Socket Connect URC.
+static void UUSOCO_urc(const uAtClientHandle_t atHandle,
+                       void *pParameter)
+{
+    int32_t sockHandleModule;
+    int32_t socketError;
+    uCellSockSocket_t *pSocket = NULL;
+
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
+
+    // +UUSOCO: <socket>,<socket_error>
+    sockHandleModule = uAtClientReadInt(atHandle);
+    socketError = uAtClientReadInt(atHandle);
+    if (sockHandleModule >= 0) {
+        // Find the entry
+        pSocket = pFindBySockHandleModule(pInstance, sockHandleModule);
+        if ((pSocket != NULL) && (pSocket->pConnectCallback != NULL)) {
+            // socket_error is zero on success, else a
+            // value from the same BSD errno list as ours
+            pSocket->connectResult = -U_SOCK_ENONE;
+            if (socketError > 0) {
+                pSocket->connectResult = -socketError;
+            } else if (socketError < 0) {
+                pSocket->connectResult = -U_SOCK_EHOSTUNREACH;
+            }
+            uAtClientCallback(atHandle,
+                              connectCallback,
+                              (void *) (pSocket->sockHandle));
+        }
+    }
+}
+
+// Callback to close an incoming connection that
+// cannot be queued for acceptance.
+static void rejectCallback(const uAtClientHandle_t atHandle,
+                           void *pParameter)
+{
+    //lint -e(507) Suppress size incompatibility: the compiler
+    // we use for Lint checking is 64 bit so has 8 byte pointers
+    // and Lint doesn't like them being used to carry 4 byte integers
+    int32_t sockHandleModule = (int32_t) pParameter;
+
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+USOCL=");
+    uAtClientWriteInt(atHandle, sockHandleModule);
+    uAtClientCommandStopReadResponse(atHandle);
+    uAtClientUnlock(atHandle);
+}
+
+// Callback for Socket Listen URC, an incoming connection.
+static void UUSOLI_urc(const uAtClientHandle_t atHandle,
+                       void *pParameter)
+{
+    int32_t sockHandleModule;
+    int32_t listeningSockHandleModule;
+    int32_t port;
+    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    uCellSockSocket_t *pListener = NULL;
+    uCellSockSocket_t *pSocket = NULL;
+    uCellSockTable_t *pTable;
+    int32_t listenerSockHandle = -1;
+    uSockAddress_t remoteAddress;
+    bool addressOk;
+
+    uCellPrivateInstance_t *pInstance = (uCellPrivateInstance_t *) pParameter;
+
+    // +UUSOLI: <socket>,<ip_address>,<port>,<listening_socket>,
+    //          <local_ip_address>,<listening_port>
+    sockHandleModule = uAtClientReadInt(atHandle);
+    addressOk = (uAtClientReadString(atHandle, buffer,
+                                     sizeof(buffer), false) > 0) &&
+                (uSockStringToAddress(buffer, &remoteAddress) == 0);
+    port = uAtClientReadInt(atHandle);
+    listeningSockHandleModule = uAtClientReadInt(atHandle);
+    // Don't need the rest
+    if ((sockHandleModule >= 0) && (listeningSockHandleModule >= 0)) {
+        U_PORT_MUTEX_LOCK(gMutex);
+        pListener = pFindBySockHandleModule(pInstance,
+                                            listeningSockHandleModule);
+        if ((pListener != NULL) && (pListener->listenBacklog > 0) &&
+            addressOk && (port >= 0) &&
+            (numPendingAccept(pInstance, pListener->sockHandle) < pListener->listenBacklog)) {
+            // Queue the connection up for uCellSockAccept()
+            pSocket = pSockCreate(pInstance);
+            if (pSocket != NULL) {
+                pTable = (uCellSockTable_t *) pInstance->pSockContext;
+                sockHandleModuleSet(pInstance, pSocket, sockHandleModule);
+                remoteAddress.port = (uint16_t) port;
+                pSocket->remoteAddress = remoteAddress;
+                pSocket->acceptListenerSockHandle = pListener->sockHandle;
+                pSocket->acceptOrder = pTable->nextAcceptOrder;
+                pTable->nextAcceptOrder++;
+                if (pListener->pDataCallback != NULL) {
+                    listenerSockHandle = pListener->sockHandle;
+                }
+            }
+        }
+        U_PORT_MUTEX_UNLOCK(gMutex);
+        if (listenerSockHandle >= 0) {
+            // Tell the user via the data callback of
+            // the listening socket
+            uAtClientCallback(atHandle, dataCallback,
+                              (void *) listenerSockHandle);
+        }
+        if (pSocket == NULL) {
+            // Can't queue it, close it again
+            uAtClientCallback(atHandle, rejectCallback,
+                              (void *) sockHandleModule);
+        }
+    }
+}
+
 /* ----------------------------------------------------------------
  * MORE VARIABLES
  * -------------------------------------------------------------- */
@@ -339,13 +792,394 @@ static void UUSOCL_urc(const uAtClientHandle_t atHandle,
 static const uCellSockUrcHandler_t gUrcHandlers[] = {
     {"+UUSORD:", UUSORD_UUSORF_urc},
     {"+UUSORF:", UUSORD_UUSORF_urc},
-    {"+UUSOCL:", UUSOCL_urc}
+    {"+UUSOCL:", UUSOCL_urc},
+    {"+UUSOCO:", UUSOCO_urc},
+    {"+UUSOLI:", UUSOLI_urc}
 };
 
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: HEX MODE
+ * -------------------------------------------------------------- */
+
+// Write binary data as a quoted ASCII hex parameter of an AT
+// command, a buffer-full at a time.
+static void writeHex(uAtClientHandle_t atHandle,
+                     const char *pData, size_t dataSizeBytes)
+{
+    char buffer[U_CELL_SOCK_HEX_BUFFER_LENGTH_BYTES];
+    size_t x;
+
+    // Delimiter, if required, and opening quote
+    uAtClientWriteBytes(atHandle, "\"", 1, false);
+    while (dataSizeBytes > 0) {
+        x = sizeof(buffer) / 2;
+        if (x > dataSizeBytes) {
+            x = dataSizeBytes;
+        }
+        uCellPrivateBinToHex(pData, x, buffer);
+        uAtClientWriteBytes(atHandle, buffer, x * 2, true);
+        pData += x;
+        dataSizeBytes -= x;
+    }
+    // Closing quote
+    uAtClientWriteBytes(atHandle, "\"", 1, true);
+}
+
+// Read dataSizeBytes worth of ASCII hex from the AT
+// client (the opening quote must already have been consumed)
+// and convert it to binary, a buffer-full at a time; if pData
+// is NULL the data is thrown away.  Returns false if what was
+// read was not ASCII hex.
+static bool readHex(uAtClientHandle_t atHandle,
+                    char *pData, size_t dataSizeBytes)
+{
+    char buffer[U_CELL_SOCK_HEX_BUFFER_LENGTH_BYTES];
+    size_t x;
+    bool success = true;
+
+    while (dataSizeBytes > 0) {
+        x = sizeof(buffer) / 2;
+        if (x > dataSizeBytes) {
+            x = dataSizeBytes;
+        }
+        uAtClientReadBytes(atHandle, buffer, x * 2, true);
+        if (pData != NULL) {
+            if (uCellPrivateHexToBin(buffer, x * 2, pData) != x) {
+                success = false;
+            }
+            pData += x;
+        }
+        dataSizeBytes -= x;
+    }
+
+    return success;
+}
+
+// Set hex mode on or off.
+static int32_t hexModeSet(int32_t cellHandle, bool onNotOff)
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if (pInstance != NULL) {
+        errnoLocal = U_SOCK_EIO;
+        atHandle = pInstance->atHandle;
+        uAtClientLock(atHandle);
+        uAtClientCommandStart(atHandle, "AT+UDCONF=");
+        uAtClientWriteInt(atHandle, 1);
+        uAtClientWriteInt(atHandle, onNotOff ? 1 : 0);
+        uAtClientCommandStopReadResponse(atHandle);
+        if (uAtClientUnlock(atHandle) == 0) {
+            pInstance->sockHexMode = onNotOff;
+            errnoLocal = U_SOCK_ENONE;
+        }
+    }
+
+    return -errnoLocal;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: DATAGRAMS
+ * -------------------------------------------------------------- */
+
+// Send a datagram; the AT client must already be locked.
+// Returns the number of bytes sent or a negated value of
+// U_SOCK_Exxx.
+static int32_t sendToLocked(const uCellPrivateInstance_t *pInstance,
+                            const uCellSockSocket_t *pSocket,
+                            const char *pRemoteIpAddress,
+                            uint16_t port,
+                            const void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoLocalOrSize = -U_SOCK_EMSGSIZE;
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+    int32_t sentSize = 0;
+    size_t maxSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
+    bool dataSent = true;
+
+    if (pInstance->sockHexMode) {
+        maxSize = U_CELL_SOCK_HEX_MODE_MAX_SEGMENT_SIZE_BYTES;
+    }
+    if (dataSizeBytes <= maxSize) {
+        negErrnoLocalOrSize = -U_SOCK_EIO;
+        uAtClientCommandStart(atHandle, "AT+USOST=");
+        // Write module socket handle
+        uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
+        // Write IP address
+        uAtClientWriteString(atHandle, pRemoteIpAddress, true);
+        // Write port number
+        uAtClientWriteInt(atHandle, port);
+        // Number of bytes to follow
+        uAtClientWriteInt(atHandle, (int32_t) dataSizeBytes);
+        if (pInstance->sockHexMode) {
+            // In hex mode the data is a parameter
+            // of the command, there is no prompt
+            writeHex(atHandle, (const char *) pData, dataSizeBytes);
+            uAtClientCommandStop(atHandle);
+        } else {
+            uAtClientCommandStop(atHandle);
+            // Wait for the prompt
+            if (uAtClientWaitCharacter(atHandle, '@') == 0) {
+#if U_CELL_SOCK_WRITE_PROMPT_DELAY_MS > 0
+                // Wait for it...
+                uPortTaskBlock(U_CELL_SOCK_WRITE_PROMPT_DELAY_MS);
+#endif
+                // Go!
+                uAtClientWriteBytes(atHandle, (const char *) pData,
+                                    dataSizeBytes, true);
+            } else {
+                dataSent = false;
+            }
+        }
+        if (dataSent && (uAtClientErrorGet(atHandle) == 0)) {
+            // Grab the response
+            uAtClientResponseStart(atHandle, "+USOST:");
+            // Skip the socket ID
+            uAtClientSkipParameters(atHandle, 1);
+            // Bytes sent
+            sentSize = uAtClientReadInt(atHandle);
+            uAtClientResponseStop(atHandle);
+            if ((uAtClientErrorGet(atHandle) == 0) &&
+                (sentSize >= 0)) {
+                // All is good, probably
+                negErrnoLocalOrSize = sentSize;
+            }
+        }
+    }
+
+    return negErrnoLocalOrSize;
+}
+
+// Receive a datagram; the AT client must already be locked.
+// Returns the number of bytes received or a negated value of
+// U_SOCK_Exxx.
+static int32_t receiveFromLocked(const uCellPrivateInstance_t *pInstance,
+                                 uCellSockSocket_t *pSocket,
+                                 uSockAddress_t *pRemoteAddress,
+                                 void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoLocalOrSize = -U_SOCK_EWOULDBLOCK;
+    uAtClientHandle_t atHandle = pInstance->atHandle;
+    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    int32_t x = -1;
+    int32_t receivedSize = -1;
+    int32_t maxSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
+    bool hexOk = true;
+
+    buffer[0] = 0;  // In case of slip-ups
+
+    // Note: the real maximum length of UDP packet we can receive
+    // comes from fitting all of the following into one buffer:
+    //
+    // +USORF: xx,"max.len.ip.address.ipv4.or.ipv6",yyyyy,wwww,"the_data"\r\n
+    //
+    // where xx is the handle, max.len.ip.address.ipv4.or.ipv6 is NSAPI_IP_SIZE,
+    // yyyyy is the port number (max 65536), wwww is the length of the data and
+    // the_data is binary data. I make that 29 + 48 + len(the_data),
+    // so the overhead is 77 bytes.
+
+    if ((pSocket->pendingBytes == 0) &&
+        probeRequired(pSocket)) {
+        // If the URC has not filled in pendingBytes,
+        // ask the module directly if there is anything
+        // to read
+        uAtClientCommandStart(atHandle, "AT+USORF=");
+        uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
+        // Zero bytes to read, just want to know the number
+        // of bytes waiting
+        uAtClientWriteInt(atHandle, 0);
+        uAtClientCommandStop(atHandle);
+        uAtClientResponseStart(atHandle, "+USORF:");
+        // Skip the socket ID
+        uAtClientSkipParameters(atHandle, 1);
+        // Read the amount of data
+        x = uAtClientReadInt(atHandle);
+        uAtClientResponseStop(atHandle);
+        // Update pending bytes here, while the AT
+        // interface is still locked, as otherwise a data
+        // callback triggered by a URC could be sitting
+        // waiting to grab the AT lock and jump in before
+        // pending bytes has been updated, leading it
+        // back into here again, etc, etc.
+        if (x > 0) {
+            pSocket->pendingBytes = x;
+            // DON'T call the user data callback here:
+            // we already have the AT interface locked
+            // and a user might try to call back into
+            // here which would result in deadlock.
+            // They will get their received data, there
+            // is no need to worry.
+        }
+        x = -1;
+    }
+    if ((pSocket->pendingBytes > 0) &&
+        (uAtClientErrorGet(atHandle) == 0)) {
+        if (pInstance->sockHexMode) {
+            maxSize = U_CELL_SOCK_HEX_MODE_MAX_SEGMENT_SIZE_BYTES;
+        }
+        // In the UDP case we HAVE to read the number
+        // of bytes pending as this will be the size
+        // of the next UDP packet in the module and the
+        // module can only deliver whole UDP packets.
+        uAtClientCommandStart(atHandle, "AT+USORF=");
+        uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
+        // Number of bytes to read
+        uAtClientWriteInt(atHandle, maxSize);
+        uAtClientCommandStop(atHandle);
+        uAtClientResponseStart(atHandle, "+USORF:");
+        // Skip the socket ID
+        uAtClientSkipParameters(atHandle, 1);
+        // Read the IP address
+        uAtClientReadString(atHandle, buffer,
+                            sizeof(buffer), false);
+        // Read the port
+        x = uAtClientReadInt(atHandle);
+        // Read the amount of data
+        receivedSize = uAtClientReadInt(atHandle);
+        if (receivedSize > maxSize) {
+            receivedSize = maxSize;
+        }
+        if ((int32_t) dataSizeBytes > receivedSize) {
+            dataSizeBytes = receivedSize;
+        }
+        if (receivedSize > 0) {
+            // Don't stop for anything!
+            uAtClientIgnoreStopTag(atHandle);
+            // Get the leading quote mark out of the way
+            uAtClientReadBytes(atHandle, NULL, 1, true);
+            if (pInstance->sockHexMode) {
+                // Same as below but two characters
+                // of ASCII hex per byte
+                hexOk = readHex(atHandle, (char *) pData,
+                                dataSizeBytes);
+                if (receivedSize > (int32_t) dataSizeBytes) {
+                    readHex(atHandle, NULL,
+                            receivedSize - dataSizeBytes);
+                }
+            } else {
+                // Now read out all the actual data,
+                // first the bit we want
+                uAtClientReadBytes(atHandle, (char *) pData,
+                                   dataSizeBytes, true);
+                if (receivedSize > (int32_t) dataSizeBytes) {
+                    //...and then the rest poured away to NULL
+                    uAtClientReadBytes(atHandle, NULL,
+                                       receivedSize -
+                                       dataSizeBytes, true);
+                }
+            }
+        }
+        uAtClientResponseStop(atHandle);
+        // BEFORE unlocking, work out what's happened.
+        // This is to prevent a URC being processed that
+        // may indicate data left and over-write pendingBytes
+        // while we're also writing to it.
+        if (uAtClientErrorGet(atHandle) == 0) {
+            // Must use what +USORF returns here as it may be less
+            // or more than we asked for and also may be
+            // more than pendingBytes, depending on how
+            // the URCs landed
+            // This update of pendingBytes will be overwritten
+            // by the URC but we have to do something here
+            // 'cos we don't get a URC to tell us when pendingBytes
+            // has gone to zero.
+            if (receivedSize > pSocket->pendingBytes) {
+                pSocket->pendingBytes = 0;
+            } else {
+                pSocket->pendingBytes -= receivedSize;
+            }
+            if (receivedSize >= 0) {
+                negErrnoLocalOrSize = receivedSize;
+            }
+            if (!hexOk) {
+                negErrnoLocalOrSize = -U_SOCK_EIO;
+            }
+        }
+    }
+
+    if ((negErrnoLocalOrSize >= 0) && (pRemoteAddress != NULL) && (x >= 0)) {
+        if (uSockStringToAddress(buffer, pRemoteAddress) == 0) {
+            pRemoteAddress->port = (uint16_t) x;
+        } else {
+            // If we can't decode the remote address this becomes
+            // an error, can't go receiving things from servers
+            // we know not who they are
+            negErrnoLocalOrSize = -U_SOCK_EIO;
+        }
+    }
+
+    return negErrnoLocalOrSize;
+}
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: SOCKET OPTIONS
  * -------------------------------------------------------------- */
 
+// Set the security profile socket option, returning a
+// (non-negated) value of U_SOCK_Exxx.
+static int32_t setOptionSecProfile(uCellSockSocket_t *pSocket,
+                                   const void *pOptionValue,
+                                   size_t optionValueLength)
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uAtClientHandle_t atHandle = pSocket->atHandle;
+    int32_t profileId;
+
+    if ((pOptionValue != NULL) &&
+        (optionValueLength >= sizeof(int32_t))) {
+        profileId = *((const int32_t *) pOptionValue);
+        if ((profileId >= -1) &&
+            (profileId <= U_CELL_SEC_TLS_PROFILE_ID_MAX)) {
+            errnoLocal = U_SOCK_EIO;
+            uAtClientLock(atHandle);
+            uAtClientCommandStart(atHandle, "AT+USOSEC=");
+            uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
+            if (profileId >= 0) {
+                uAtClientWriteInt(atHandle, 1);
+                uAtClientWriteInt(atHandle, profileId);
+            } else {
+                uAtClientWriteInt(atHandle, 0);
+            }
+            uAtClientCommandStopReadResponse(atHandle);
+            if (uAtClientUnlock(atHandle) == 0) {
+                // All good
+                pSocket->securityProfileId = profileId;
+                errnoLocal = U_SOCK_ENONE;
+            }
+        }
+    }
+
+    return errnoLocal;
+}
+
+// Get the security profile socket option, returning a
+// (non-negated) value of U_SOCK_Exxx.
+static int32_t getOptionSecProfile(const uCellSockSocket_t *pSocket,
+                                   void *pOptionValue,
+                                   size_t *pOptionValueLength)
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+
+    if (pOptionValueLength != NULL) {
+        if (pOptionValue != NULL) {
+            if (*pOptionValueLength >= sizeof(int32_t)) {
+                // No need to ask the module, we know
+                *((int32_t *) pOptionValue) = pSocket->securityProfileId;
+                *pOptionValueLength = sizeof(int32_t);
+                errnoLocal = U_SOCK_ENONE;
+            }
+        } else {
+            errnoLocal = U_SOCK_ENONE;
+            // Caller just wants to know the length required
+            *pOptionValueLength = sizeof(int32_t);
+        }
+    }
+
+    return errnoLocal;
+}
+
 // Set a socket option that has an integer as a parameter
 // returning a (non-negated) value of U_SOCK_Exxx.
 static int32_t setOptionInt(const uCellSockSocket_t *pSocket,
@@ -522,24 +1356,20 @@ static int32_t getOptionLinger(const uCellSockSocket_t *pSocket,
 // Initialise the cellular sockets layer.
 int32_t uCellSockInit()
 {
-    uCellSockSocket_t *pSock = NULL;
+    int32_t errnoLocal = U_SOCK_ENONE;
 
     if (!gInitialised) {
-
-        // Clear the list
-        for (size_t x = 0; (x < sizeof(gSockets) / sizeof(gSockets[0])); x++) {
-            pSock = &(gSockets[x]);
-            pSock->cellHandle = -1;
-            pSock->sockHandle = -1;
-            pSock->sockHandleModule = -1;
-            pSock->pDataCallback = NULL;
-            pSock->pClosedCallback = NULL;
+        // The socket tables are per instance, created
+        // by uCellSockInitInstance()
+        gNumProbesAvoided = 0;
+        if (uPortMutexCreate(&gMutex) == 0) {
+            gInitialised = true;
+        } else {
+            errnoLocal = U_SOCK_ENOMEM;
         }
-
-        gInitialised = true;
     }
 
-    return U_SOCK_ENONE;
+    return -errnoLocal;
 }
 
 // Initialise the cellular sockets instance.
@@ -551,7 +1381,11 @@ int32_t uCellSockInitInstance(int32_t cellHandle)
     if (gInitialised) {
         pInstance = pUCellPrivateGetInstance(cellHandle);
         if (pInstance != NULL) {
-            errnoLocal = U_SOCK_ENONE;
+            errnoLocal = U_SOCK_ENOMEM;
+            // Create the socket table for this instance
+            if (pTableCreate(pInstance) != NULL) {
+                errnoLocal = U_SOCK_ENONE;
+            }
             // Set up the URCs
             for (size_t x = 0; (x < sizeof(gUrcHandlers) /
                                 sizeof(gUrcHandlers[0])) &&
@@ -559,7 +1393,7 @@ int32_t uCellSockInitInstance(int32_t cellHandle)
                 if (uAtClientSetUrcHandler(pInstance->atHandle,
                                            gUrcHandlers[x].pPrefix,
                                            gUrcHandlers[x].pHandler,
-                                           NULL) != 0) {
+                                           pInstance) != 0) {
                     errnoLocal = U_SOCK_ENOMEM;
                 }
             }
@@ -572,9 +1406,23 @@ int32_t uCellSockInitInstance(int32_t cellHandle)
 // Deinitialise the cellular sockets layer.
 void uCellSockDeinit()
 {
+    uCellPrivateInstance_t *pInstance;
+
     if (gInitialised) {
-        // Nothing to do, URCs will have been
-        // removed on close
+        // URCs will have been removed on close,
+        // just need to free the socket tables
+        if (gUCellPrivateMutex != NULL) {
+            U_PORT_MUTEX_LOCK(gUCellPrivateMutex);
+            pInstance = gpUCellPrivateInstanceList;
+            while (pInstance != NULL) {
+                free(pInstance->pSockContext);
+                pInstance->pSockContext = NULL;
+                pInstance = pInstance->pNext;
+            }
+            U_PORT_MUTEX_UNLOCK(gUCellPrivateMutex);
+        }
+        uPortMutexDelete(gMutex);
+        gMutex = NULL;
         gInitialised = false;
     }
 }
@@ -592,6 +1440,7 @@ int32_t uCellSockCreate(int32_t cellHandle,
     uCellPrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
     uCellSockSocket_t *pSocket;
+    int32_t sockHandleModule;
 
     (void) type;
 
@@ -601,11 +1450,9 @@ int32_t uCellSockCreate(int32_t cellHandle,
         negErrnoLocal = -U_SOCK_ENOBUFS;
         atHandle = pInstance->atHandle;
         // Create the entry
-        pSocket = pSockCreate(gNextSockHandle, cellHandle, atHandle);
-        gNextSockHandle++;
-        if (gNextSockHandle < 0) {
-            gNextSockHandle = 0;
-        }
+        U_PORT_MUTEX_LOCK(gMutex);
+        pSocket = pSockCreate(pInstance);
+        U_PORT_MUTEX_UNLOCK(gMutex);
         if (pSocket != NULL) {
             // Create the socket in the cellular module
             uAtClientLock(atHandle);
@@ -614,25 +1461,31 @@ int32_t uCellSockCreate(int32_t cellHandle,
             uAtClientWriteInt(atHandle, (int32_t) protocol);
             uAtClientCommandStop(atHandle);
             uAtClientResponseStart(atHandle, "+USOCR:");
-            pSocket->sockHandleModule = uAtClientReadInt(atHandle);
+            sockHandleModule = uAtClientReadInt(atHandle);
             uAtClientResponseStop(atHandle);
+            U_PORT_MUTEX_LOCK(gMutex);
             if (uAtClientUnlock(atHandle) == 0) {
                 // All good
+                sockHandleModuleSet(pInstance, pSocket, sockHandleModule);
                 negErrnoLocal = pSocket->sockHandle;
             } else {
                 // Free the socket again
-                sockFree(pSocket->sockHandle);
+                sockFree(pInstance, pSocket->sockHandle);
             }
+            U_PORT_MUTEX_UNLOCK(gMutex);
         }
     }
 
     return negErrnoLocal;
 }
 
-// Connect to a server.
-int32_t uCellSockConnect(int32_t cellHandle,
-                         int32_t sockHandle,
-                         const uSockAddress_t *pRemoteAddress)
+// Connect to a server, either waiting for the connection
+// to complete or, if pCallback is non-NULL, asking the
+// module to connect asynchronously.
+static int32_t sockConnect(int32_t cellHandle,
+                           int32_t sockHandle,
+                           const uSockAddress_t *pRemoteAddress,
+                           void (*pCallback) (int32_t, int32_t, int32_t))
 {
     int32_t errnoLocal = U_SOCK_EINVAL;
     uCellPrivateInstance_t *pInstance;
@@ -648,12 +1501,27 @@ int32_t uCellSockConnect(int32_t cellHandle,
         atHandle = pInstance->atHandle;
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
+            if ((pCallback != NULL) &&
+                !U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                    U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CONNECT)) {
+                // Asynchronous connect not supported
+                errnoLocal = U_SOCK_ENOSYS;
+                pSocket = NULL;
+            }
+            if ((pSocket != NULL) && (pSocket->pConnectCallback != NULL)) {
+                // Already connecting
+                errnoLocal = U_SOCK_EALREADY;
+                pSocket = NULL;
+            }
             if ((pSocket != NULL) &&
                 (uSockAddressToString(pRemoteAddress, buffer,
                                       sizeof(buffer)) > 0)) {
                 pRemoteIpAddress = pUSockDomainRemovePort(buffer);
                 errnoLocal = U_SOCK_EHOSTUNREACH;
+                // Set the callback before sending the command
+                // in case the URC arrives quickly
+                pSocket->pConnectCallback = pCallback;
                 // Connect the socket through the cellular module
                 // If have seen modules return ERROR to this
                 // immediately so try a few times
@@ -662,9 +1530,11 @@ int32_t uCellSockConnect(int32_t cellHandle,
                      (deviceError.type != U_AT_CLIENT_DEVICE_ERROR_TYPE_NO_ERROR);
                      x--) {
                     uAtClientLock(atHandle);
-                    // Leave a little longer to connect
-                    uAtClientTimeoutSet(atHandle,
-                                        U_CELL_SOCK_CONNECT_TIMEOUT_SECONDS * 1000);
+                    if (pCallback == NULL) {
+                        // Leave a little longer to connect
+                        uAtClientTimeoutSet(atHandle,
+                                            U_CELL_SOCK_CONNECT_TIMEOUT_SECONDS * 1000);
+                    }
                     uAtClientCommandStart(atHandle, "AT+USOCO=");
                     // Write module socket handle
                     uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
@@ -672,6 +1542,12 @@ int32_t uCellSockConnect(int32_t cellHandle,
                     uAtClientWriteString(atHandle, pRemoteIpAddress, true);
                     // Write port number
                     uAtClientWriteInt(atHandle, pRemoteAddress->port);
+                    if (pCallback != NULL) {
+                        // Ask for the connection to be made
+                        // asynchronously, the outcome being
+                        // indicated by +UUSOCO
+                        uAtClientWriteInt(atHandle, 1);
+                    }
                     uAtClientCommandStopReadResponse(atHandle);
                     uAtClientDeviceErrorGet(atHandle, &deviceError);
                     if (uAtClientUnlock(atHandle) == 0) {
@@ -682,10 +1558,40 @@ int32_t uCellSockConnect(int32_t cellHandle,
                         uPortTaskBlock(1000);
                     }
                 }
+                if (errnoLocal != U_SOCK_ENONE) {
+                    // No URC will be coming
+                    pSocket->pConnectCallback = NULL;
+                }
             }
         }
     }
 
+    return errnoLocal;
+}
+
+// Connect to a server.
+int32_t uCellSockConnect(int32_t cellHandle,
+                         int32_t sockHandle,
+                         const uSockAddress_t *pRemoteAddress)
+{
+    return -sockConnect(cellHandle, sockHandle, pRemoteAddress, NULL);
+}
+
+// Start connecting to a server asynchronously.
+int32_t uCellSockConnectAsync(int32_t cellHandle,
+                              int32_t sockHandle,
+                              const uSockAddress_t *pRemoteAddress,
+                              void (*pCallback) (int32_t,
+                                                 int32_t,
+                                                 int32_t))
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+
+    if (pCallback != NULL) {
+        errnoLocal = sockConnect(cellHandle, sockHandle,
+                                 pRemoteAddress, pCallback);
+    }
+
     return -errnoLocal;
 }
 
@@ -699,8 +1605,11 @@ int32_t uCellSockClose(int32_t cellHandle,
     uCellPrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
     uCellSockSocket_t *pSocket;
+    uCellSockSocket_t *pPending;
+    int32_t pendingSockHandleModule;
     uAtClientDeviceError_t deviceError;
     int32_t atError = -1;
+    bool asyncClose;
 
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
@@ -708,9 +1617,33 @@ int32_t uCellSockClose(int32_t cellHandle,
         atHandle = pInstance->atHandle;
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
                 errnoLocal = U_SOCK_EIO;
+                // Only ask for asynchronous closure if a
+                // callback was given and the module supports it
+                asyncClose = (pCallback != NULL) &&
+                             U_CELL_PRIVATE_HAS(pInstance->pModule,
+                                                U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE);
+                if (pSocket->listenBacklog > 0) {
+                    // Close any incoming connections on a
+                    // listening socket that were never accepted
+                    pSocket->listenBacklog = 0;
+                    do {
+                        pendingSockHandleModule = -1;
+                        U_PORT_MUTEX_LOCK(gMutex);
+                        pPending = pFindPendingAccept(pInstance, sockHandle);
+                        if (pPending != NULL) {
+                            pendingSockHandleModule = pPending->sockHandleModule;
+                            sockFree(pInstance, pPending->sockHandle);
+                        }
+                        U_PORT_MUTEX_UNLOCK(gMutex);
+                        if (pendingSockHandleModule >= 0) {
+                            rejectCallback(atHandle,
+                                           (void *) pendingSockHandleModule);
+                        }
+                    } while (pPending != NULL);
+                }
                 // Close the socket through the cellular module
                 // If have seen modules return ERROR to this
                 // immediately so try a few times
@@ -724,15 +1657,7 @@ int32_t uCellSockClose(int32_t cellHandle,
                     uAtClientCommandStart(atHandle, "AT+USOCL=");
                     // Write module socket handle
                     uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                    if (!U_CELL_PRIVATE_HAS(pInstance->pModule,
-                                            U_CELL_PRIVATE_FEATURE_ASYNC_SOCK_CLOSE)) {
-                        // Asynchronous closure not supported
-                        pCallback = NULL;
-                    }
-                    if (pCallback != NULL) {
-                        // If a callback was given and the module
-                        // supports asynchronous socket closure then
-                        // request it
+                    if (asyncClose) {
                         uAtClientWriteInt(atHandle, 1);
                     }
                     uAtClientCommandStopReadResponse(atHandle);
@@ -747,11 +1672,15 @@ int32_t uCellSockClose(int32_t cellHandle,
                     // All good
                     errnoLocal = U_SOCK_ENONE;
                     pSocket->pAsyncClosedCallback = pCallback;
-                    if (pCallback == NULL) {
+                    if (!asyncClose) {
                         // If no callback was given, or one
                         // was given and the the module
                         // doesn't support asynchronous closure,
-                        // call the trampoline from here
+                        // the socket is already closed: call the
+                        // trampoline from here, which will also
+                        // call any callback so that the caller
+                        // always finds out about completion the
+                        // same way
                         uAtClientCallback(atHandle, closedCallback,
                                           (void *) sockHandle);
                     }
@@ -812,7 +1741,7 @@ int32_t uCellSockOptionSet(int32_t cellHandle,
     if (pInstance != NULL) {
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
                 if ((optionValueLength == 0) ||
                     ((optionValueLength > 0) && (pOptionValue != NULL))) {
@@ -869,6 +1798,18 @@ int32_t uCellSockOptionSet(int32_t cellHandle,
                                     break;
                             }
                             break;
+                        case U_SOCK_OPT_LEVEL_SEC:
+                            switch (option) {
+                                // Apply a module security profile
+                                case U_SOCK_OPT_SEC_PROFILE:
+                                    errnoLocal = setOptionSecProfile(pSocket,
+                                                                     pOptionValue,
+                                                                     optionValueLength);
+                                    break;
+                                default:
+                                    break;
+                            }
+                            break;
                         default:
                             break;
                     }
@@ -897,7 +1838,7 @@ int32_t uCellSockOptionGet(int32_t cellHandle,
     if (pInstance != NULL) {
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
                 // If there's an optionValue then there must be a length
                 if ((pOptionValue == NULL) ||
@@ -955,6 +1896,17 @@ int32_t uCellSockOptionGet(int32_t cellHandle,
                                     break;
                             }
                             break;
+                        case U_SOCK_OPT_LEVEL_SEC:
+                            switch (option) {
+                                case U_SOCK_OPT_SEC_PROFILE:
+                                    errnoLocal = getOptionSecProfile(pSocket,
+                                                                     pOptionValue,
+                                                                     pOptionValueLength);
+                                    break;
+                                default:
+                                    break;
+                            }
+                            break;
                         default:
                             break;
                     }
@@ -966,6 +1918,46 @@ int32_t uCellSockOptionGet(int32_t cellHandle,
     return -errnoLocal;
 }
 
+// Switch hex mode on.
+int32_t uCellSockHexModeOn(int32_t cellHandle)
+{
+    return hexModeSet(cellHandle, true);
+}
+
+// Switch hex mode off.
+int32_t uCellSockHexModeOff(int32_t cellHandle)
+{
+    return hexModeSet(cellHandle, false);
+}
+
+// Get whether hex mode is on.
+bool uCellSockHexModeIsOn(int32_t cellHandle)
+{
+    bool isOn = false;
+    uCellPrivateInstance_t *pInstance;
+
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if (pInstance != NULL) {
+        isOn = pInstance->sockHexMode;
+    }
+
+    return isOn;
+}
+
+// Get the number of probes avoided.
+int32_t uCellSockGetNumProbesAvoided()
+{
+    int32_t numProbesAvoided = gNumProbesAvoided;
+
+    if (gInitialised) {
+        U_PORT_MUTEX_LOCK(gMutex);
+        numProbesAvoided = gNumProbesAvoided;
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return numProbesAvoided;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS: UDP ONLY
  * -------------------------------------------------------------- */
@@ -982,65 +1974,116 @@ int32_t uCellSockSendTo(int32_t cellHandle,
     uCellSockSocket_t *pSocket;
     char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
     char *pRemoteIpAddress;
-    int32_t sentSize = 0;
 
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
-    if (pInstance != NULL) {
+    if (pInstance != NULL) {
+        atHandle = pInstance->atHandle;
+        // Find the entry
+        if (sockHandle >= 0) {
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
+            if (pSocket != NULL) {
+                negErrnoLocalOrSize = -U_SOCK_EDESTADDRREQ;
+                if (uSockAddressToString(pRemoteAddress, buffer,
+                                         sizeof(buffer)) > 0) {
+                    pRemoteIpAddress = pUSockDomainRemovePort(buffer);
+                    if (pRemoteIpAddress != NULL) {
+                        uAtClientLock(atHandle);
+                        negErrnoLocalOrSize = sendToLocked(pInstance, pSocket,
+                                                           pRemoteIpAddress,
+                                                           pRemoteAddress->port,
+                                                           pData, dataSizeBytes);
+                        if ((uAtClientUnlock(atHandle) != 0) &&
+                            (negErrnoLocalOrSize >= 0)) {
+                            negErrnoLocalOrSize = -U_SOCK_EIO;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return negErrnoLocalOrSize;
+}
+
+// Send a batch of datagrams.
+int32_t uCellSockSendToBatch(int32_t cellHandle,
+                             int32_t sockHandle,
+                             const uSockAddress_t *pRemoteAddressDefault,
+                             uSockDatagram_t *pDatagrams,
+                             size_t numDatagrams)
+{
+    int32_t negErrnoLocalOrNum = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uCellSockSocket_t *pSocket;
+    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    const uSockAddress_t *pRemoteAddress;
+    const uSockIpAddress_t *pIpAddressInBuffer = NULL;
+    uSockDatagram_t *pDatagram;
+    int32_t numSent = 0;
+    int32_t result = 0;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) && (pDatagrams != NULL) &&
+        (numDatagrams > 0)) {
         atHandle = pInstance->atHandle;
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
-                negErrnoLocalOrSize = -U_SOCK_EDESTADDRREQ;
-                if (uSockAddressToString(pRemoteAddress, buffer,
-                                         sizeof(buffer)) > 0) {
-                    pRemoteIpAddress = pUSockDomainRemovePort(buffer);
-                    if (pRemoteIpAddress != NULL) {
-                        negErrnoLocalOrSize = -U_SOCK_EMSGSIZE;
-                        if (dataSizeBytes <= U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES) {
-                            negErrnoLocalOrSize = -U_SOCK_EIO;
-                            uAtClientLock(atHandle);
-                            uAtClientCommandStart(atHandle, "AT+USOST=");
-                            // Write module socket handle
-                            uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                            // Write IP address
-                            uAtClientWriteString(atHandle, pRemoteIpAddress, true);
-                            // Write port number
-                            uAtClientWriteInt(atHandle, pRemoteAddress->port);
-                            // Number of bytes to follow
-                            uAtClientWriteInt(atHandle, (int32_t) dataSizeBytes);
-                            uAtClientCommandStop(atHandle);
-                            // Wait for the prompt
-                            if (uAtClientWaitCharacter(atHandle, '@') == 0) {
-                                // Wait for it...
-                                uPortTaskBlock(50);
-                                // Go!
-                                uAtClientWriteBytes(atHandle, (const char *) pData,
-                                                    dataSizeBytes, true);
-                                // Grab the response
-                                uAtClientResponseStart(atHandle, "+USOST:");
-                                // Skip the socket ID
-                                uAtClientSkipParameters(atHandle, 1);
-                                // Bytes sent
-                                sentSize = uAtClientReadInt(atHandle);
-                                uAtClientResponseStop(atHandle);
-                                if ((uAtClientUnlock(atHandle) == 0) &&
-                                    (sentSize >= 0)) {
-                                    // All is good, probably
-                                    negErrnoLocalOrSize = sentSize;
-                                }
-                            } else {
-                                uAtClientUnlock(atHandle);
+                // Lock once for the whole batch, stopping
+                // at the first datagram that fails
+                uAtClientLock(atHandle);
+                for (size_t x = 0; (x < numDatagrams) && (result >= 0); x++) {
+                    pDatagram = pDatagrams + x;
+                    pRemoteAddress = pDatagram->pAddress;
+                    if (pRemoteAddress == NULL) {
+                        pRemoteAddress = pRemoteAddressDefault;
+                    }
+                    result = -U_SOCK_EDESTADDRREQ;
+                    if (pRemoteAddress != NULL) {
+                        // Only turn the IP address into a string
+                        // if it is not the one already there
+                        if ((pIpAddressInBuffer == NULL) ||
+                            (memcmp(pIpAddressInBuffer,
+                                    &(pRemoteAddress->ipAddress),
+                                    sizeof(*pIpAddressInBuffer)) != 0)) {
+                            pIpAddressInBuffer = NULL;
+                            if (uSockIpAddressToString(&(pRemoteAddress->ipAddress),
+                                                       buffer,
+                                                       sizeof(buffer)) > 0) {
+                                pIpAddressInBuffer = &(pRemoteAddress->ipAddress);
+                            }
+                        }
+                        if (pIpAddressInBuffer != NULL) {
+                            result = -U_SOCK_EINVAL;
+                            if ((pDatagram->pData != NULL) ||
+                                (pDatagram->dataSizeBytes == 0)) {
+                                result = sendToLocked(pInstance, pSocket,
+                                                      buffer,
+                                                      pRemoteAddress->port,
+                                                      pDatagram->pData,
+                                                      pDatagram->dataSizeBytes);
                             }
                         }
                     }
+                    pDatagram->result = result;
+                    if (result >= 0) {
+                        numSent++;
+                    }
+                }
+                uAtClientUnlock(atHandle);
+                negErrnoLocalOrNum = numSent;
+                if (numSent == 0) {
+                    negErrnoLocalOrNum = pDatagrams->result;
                 }
             }
         }
     }
 
-    return negErrnoLocalOrSize;
+    return negErrnoLocalOrNum;
 }
 
 // Receive a datagram.
@@ -1053,149 +2096,78 @@ int32_t uCellSockReceiveFrom(int32_t cellHandle,
     uCellPrivateInstance_t *pInstance;
     uAtClientHandle_t atHandle;
     uCellSockSocket_t *pSocket;
-    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
-    int32_t x = -1;
-    int32_t receivedSize = -1;
 
-    buffer[0] = 0;  // In case of slip-ups
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if (pInstance != NULL) {
+        atHandle = pInstance->atHandle;
+        // Find the entry
+        if (sockHandle >= 0) {
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
+            if (pSocket != NULL) {
+                uAtClientLock(atHandle);
+                negErrnoLocalOrSize = receiveFromLocked(pInstance, pSocket,
+                                                        pRemoteAddress,
+                                                        pData, dataSizeBytes);
+                uAtClientUnlock(atHandle);
+            }
+        }
+    }
 
-    // Note: the real maximum length of UDP packet we can receive
-    // comes from fitting all of the following into one buffer:
-    //
-    // +USORF: xx,"max.len.ip.address.ipv4.or.ipv6",yyyyy,wwww,"the_data"\r\n
-    //
-    // where xx is the handle, max.len.ip.address.ipv4.or.ipv6 is NSAPI_IP_SIZE,
-    // yyyyy is the port number (max 65536), wwww is the length of the data and
-    // the_data is binary data. I make that 29 + 48 + len(the_data),
-    // so the overhead is 77 bytes.
+    return negErrnoLocalOrSize;
+}
+
+// Receive a batch of datagrams.
+int32_t uCellSockReceiveFromBatch(int32_t cellHandle,
+                                  int32_t sockHandle,
+                                  uSockDatagram_t *pDatagrams,
+                                  size_t numDatagrams)
+{
+    int32_t negErrnoLocalOrNum = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uCellSockSocket_t *pSocket;
+    uSockDatagram_t *pDatagram;
+    int32_t numReceived = 0;
+    int32_t result = 0;
 
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
-    if (pInstance != NULL) {
+    if ((pInstance != NULL) && (pDatagrams != NULL) &&
+        (numDatagrams > 0)) {
         atHandle = pInstance->atHandle;
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
-                negErrnoLocalOrSize = -U_SOCK_EWOULDBLOCK;
-                if (pSocket->pendingBytes == 0) {
-                    // If the URC has not filled in pendingBytes,
-                    // ask the module directly if there is anything
-                    // to read
-                    uAtClientLock(atHandle);
-                    uAtClientCommandStart(atHandle, "AT+USORF=");
-                    uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                    // Zero bytes to read, just want to know the number
-                    // of bytes waiting
-                    uAtClientWriteInt(atHandle, 0);
-                    uAtClientCommandStop(atHandle);
-                    uAtClientResponseStart(atHandle, "+USORF:");
-                    // Skip the socket ID
-                    uAtClientSkipParameters(atHandle, 1);
-                    // Read the amount of data
-                    x = uAtClientReadInt(atHandle);
-                    uAtClientResponseStop(atHandle);
-                    // Update pending bytes here, before
-                    // unlocking, as otherwise a data callback
-                    // triggered by a URC could be sitting waiting
-                    // to grab the AT lock and jump in before
-                    // pending bytes has been updated, leading it
-                    // back into here again, etc, etc.
-                    if (x > 0) {
-                        pSocket->pendingBytes = x;
-                        // DON'T call the user data callback here:
-                        // we already have the AT interface locked
-                        // and a user might try to call back into
-                        // here which would result in deadlock.
-                        // They will get their received data, there
-                        // is no need to worry.
-                    }
-                    uAtClientUnlock(atHandle);
-                }
-                if (pSocket->pendingBytes > 0) {
-                    // In the UDP case we HAVE to read the number
-                    // of bytes pending as this will be the size
-                    // of the next UDP packet in the module and the
-                    // module can only deliver whole UDP packets.
-                    uAtClientLock(atHandle);
-                    uAtClientCommandStart(atHandle, "AT+USORF=");
-                    uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                    // Number of bytes to read
-                    uAtClientWriteInt(atHandle, U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES);
-                    uAtClientCommandStop(atHandle);
-                    uAtClientResponseStart(atHandle, "+USORF:");
-                    // Skip the socket ID
-                    uAtClientSkipParameters(atHandle, 1);
-                    // Read the IP address
-                    uAtClientReadString(atHandle, buffer,
-                                        sizeof(buffer), false);
-                    // Read the port
-                    x = uAtClientReadInt(atHandle);
-                    // Read the amount of data
-                    receivedSize = uAtClientReadInt(atHandle);
-                    if (receivedSize > U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES) {
-                        receivedSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
-                    }
-                    if ((int32_t) dataSizeBytes > receivedSize) {
-                        dataSizeBytes = receivedSize;
-                    }
-                    if (receivedSize > 0) {
-                        // Don't stop for anything!
-                        uAtClientIgnoreStopTag(atHandle);
-                        // Get the leading quote mark out of the way
-                        uAtClientReadBytes(atHandle, NULL, 1, true);
-                        // Now read out all the actual data,
-                        // first the bit we want
-                        uAtClientReadBytes(atHandle, (char *) pData,
-                                           dataSizeBytes, true);
-                        if (receivedSize > (int32_t) dataSizeBytes) {
-                            //...and then the rest poured away to NULL
-                            uAtClientReadBytes(atHandle, NULL,
-                                               receivedSize -
-                                               dataSizeBytes, true);
-                        }
+                // Lock once for the whole batch, stopping
+                // when there is nothing more to read
+                uAtClientLock(atHandle);
+                for (size_t x = 0; (x < numDatagrams) && (result >= 0); x++) {
+                    pDatagram = pDatagrams + x;
+                    result = -U_SOCK_EINVAL;
+                    if ((pDatagram->pData != NULL) ||
+                        (pDatagram->dataSizeBytes == 0)) {
+                        result = receiveFromLocked(pInstance, pSocket,
+                                                   pDatagram->pAddress,
+                                                   pDatagram->pData,
+                                                   pDatagram->dataSizeBytes);
                     }
-                    uAtClientResponseStop(atHandle);
-                    // BEFORE unlocking, work out what's happened.
-                    // This is to prevent a URC being processed that
-                    // may indicate data left and over-write pendingBytes
-                    // while we're also writing to it.
-                    if (uAtClientErrorGet(atHandle) == 0) {
-                        // Must use what +USORF returns here as it may be less
-                        // or more than we asked for and also may be
-                        // more than pendingBytes, depending on how
-                        // the URCs landed
-                        // This update of pendingBytes will be overwritten
-                        // by the URC but we have to do something here
-                        // 'cos we don't get a URC to tell us when pendingBytes
-                        // has gone to zero.
-                        if (receivedSize > pSocket->pendingBytes) {
-                            pSocket->pendingBytes = 0;
-                        } else {
-                            pSocket->pendingBytes -= receivedSize;
-                        }
-                        if (receivedSize >= 0) {
-                            negErrnoLocalOrSize = receivedSize;
-                        }
+                    pDatagram->result = result;
+                    if (result >= 0) {
+                        numReceived++;
                     }
-                    uAtClientUnlock(atHandle);
+                }
+                uAtClientUnlock(atHandle);
+                negErrnoLocalOrNum = numReceived;
+                if (numReceived == 0) {
+                    negErrnoLocalOrNum = pDatagrams->result;
                 }
             }
         }
     }
 
-    if ((negErrnoLocalOrSize >= 0) && (pRemoteAddress != NULL) && (x >= 0)) {
-        if (uSockStringToAddress(buffer, pRemoteAddress) == 0) {
-            pRemoteAddress->port = (uint16_t) x;
-        } else {
-            // If we can't decode the remote address this becomes
-            // an error, can't go receiving things from servers
-            // we know not who they are
-            negErrnoLocalOrSize = -U_SOCK_EIO;
-        }
-    }
-
-    return negErrnoLocalOrSize;
+    return negErrnoLocalOrNum;
 }
 
 /* ----------------------------------------------------------------
@@ -1213,8 +2185,10 @@ int32_t uCellSockWrite(int32_t cellHandle,
     uCellSockSocket_t *pSocket;
     int32_t leftToSendSize = (int32_t) dataSizeBytes;
     int32_t sentSize = 0;
-    int32_t thisSendSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
+    int32_t maxSendSize;
+    int32_t thisSendSize;
     size_t loopCounter = 0;
+    bool dataSent = true;
 
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
@@ -1222,29 +2196,52 @@ int32_t uCellSockWrite(int32_t cellHandle,
         atHandle = pInstance->atHandle;
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
                 negErrnoLocalOrSize = U_SOCK_ENONE;
+                maxSendSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
+                if (pInstance->sockHexMode) {
+                    maxSendSize = U_CELL_SOCK_HEX_MODE_MAX_SEGMENT_SIZE_BYTES;
+                }
+                // Hold the AT interface for the whole write so
+                // that the segments are streamed to the module
+                // back-to-back rather than competing with other
+                // AT commands between each one
+                uAtClientLock(atHandle);
                 while ((leftToSendSize > 0) &&
                        (negErrnoLocalOrSize == U_SOCK_ENONE) &&
                        (loopCounter < U_CELL_SOCK_TCP_RETRY_LIMIT)) {
+                    thisSendSize = maxSendSize;
                     if (leftToSendSize < thisSendSize) {
                         thisSendSize = leftToSendSize;
                     }
-                    uAtClientLock(atHandle);
                     uAtClientCommandStart(atHandle, "AT+USOWR=");
                     // Write module socket handle
                     uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
-                    // Number of bytes to follow
-                    uAtClientWriteInt(atHandle, (int32_t) dataSizeBytes);
-                    uAtClientCommandStop(atHandle);
-                    // Wait for the prompt
-                    if (uAtClientWaitCharacter(atHandle, '@') == 0) {
-                        // Wait for it...
-                        uPortTaskBlock(50);
-                        // Go!
-                        uAtClientWriteBytes(atHandle, (const char *) pData,
-                                            dataSizeBytes, true);
+                    // Number of bytes to follow in this segment
+                    uAtClientWriteInt(atHandle, thisSendSize);
+                    if (pInstance->sockHexMode) {
+                        // In hex mode the data is a parameter
+                        // of the command, there is no prompt
+                        writeHex(atHandle, (const char *) pData,
+                                 thisSendSize);
+                        uAtClientCommandStop(atHandle);
+                    } else {
+                        uAtClientCommandStop(atHandle);
+                        // Wait for the prompt
+                        if (uAtClientWaitCharacter(atHandle, '@') == 0) {
+#if U_CELL_SOCK_WRITE_PROMPT_DELAY_MS > 0
+                            // Wait for it...
+                            uPortTaskBlock(U_CELL_SOCK_WRITE_PROMPT_DELAY_MS);
+#endif
+                            // Go!
+                            uAtClientWriteBytes(atHandle, (const char *) pData,
+                                                thisSendSize, true);
+                        } else {
+                            dataSent = false;
+                        }
+                    }
+                    if (dataSent && (uAtClientErrorGet(atHandle) == 0)) {
                         // Grab the response
                         uAtClientResponseStart(atHandle, "+USOWR:");
                         // Skip the socket ID
@@ -1252,7 +2249,8 @@ int32_t uCellSockWrite(int32_t cellHandle,
                         // Bytes sent
                         sentSize = uAtClientReadInt(atHandle);
                         uAtClientResponseStop(atHandle);
-                        if (uAtClientUnlock(atHandle) == 0) {
+                        if ((uAtClientErrorGet(atHandle) == 0) &&
+                            (sentSize >= 0) && (sentSize <= thisSendSize)) {
                             pData = (const char *) pData + sentSize;
                             leftToSendSize -= sentSize;
                             // Technically, it should be OK to
@@ -1268,15 +2266,18 @@ int32_t uCellSockWrite(int32_t cellHandle,
                         }
                     } else {
                         negErrnoLocalOrSize = -U_SOCK_EIO;
-                        uAtClientUnlock(atHandle);
                     }
                 }
+                uAtClientUnlock(atHandle);
             }
         }
     }
 
-    if (negErrnoLocalOrSize == U_SOCK_ENONE) {
-        // All is good
+    if ((negErrnoLocalOrSize == U_SOCK_ENONE) ||
+        ((negErrnoLocalOrSize < 0) &&
+         (leftToSendSize < (int32_t) dataSizeBytes))) {
+        // All is good or, at least, some data was sent
+        // before the error occurred: report what was sent
         negErrnoLocalOrSize = ((int32_t) dataSizeBytes) - leftToSendSize;
     }
 
@@ -1296,6 +2297,8 @@ int32_t uCellSockRead(int32_t cellHandle,
     int32_t thisWantedReceiveSize;
     int32_t thisActualReceiveSize;
     int32_t totalReceivedSize = 0;
+    int32_t maxSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
+    bool hexOk = true;
 
     // Find the instance
     pInstance = pUCellPrivateGetInstance(cellHandle);
@@ -1303,10 +2306,11 @@ int32_t uCellSockRead(int32_t cellHandle,
         atHandle = pInstance->atHandle;
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
                 negErrnoLocalOrSize = -U_SOCK_EWOULDBLOCK;
-                if (pSocket->pendingBytes == 0) {
+                if ((pSocket->pendingBytes == 0) &&
+                    probeRequired(pSocket)) {
                     // If the URC has not filled in pendingBytes,
                     // ask the module directly if there is anything
                     // to read
@@ -1342,12 +2346,15 @@ int32_t uCellSockRead(int32_t cellHandle,
                 }
                 if (pSocket->pendingBytes > 0) {
                     negErrnoLocalOrSize = U_SOCK_ENONE;
+                    if (pInstance->sockHexMode) {
+                        maxSize = U_CELL_SOCK_HEX_MODE_MAX_SEGMENT_SIZE_BYTES;
+                    }
                     // Run around the loop until we run out of
                     // pending data or room in the buffer
                     while ((dataSizeBytes > 0) &&
                            (pSocket->pendingBytes > 0) &&
                            (negErrnoLocalOrSize == U_SOCK_ENONE)) {
-                        thisWantedReceiveSize = U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES;
+                        thisWantedReceiveSize = maxSize;
                         if (thisWantedReceiveSize > (int32_t) dataSizeBytes) {
                             thisWantedReceiveSize = (int32_t) dataSizeBytes;
                         }
@@ -1371,10 +2378,17 @@ int32_t uCellSockRead(int32_t cellHandle,
                             // Get the leading quote mark out of the way
                             uAtClientReadBytes(atHandle, NULL, 1, true);
                             // Now read out the available data
-                            uAtClientReadBytes(atHandle,
-                                               (char *) pData +
-                                               totalReceivedSize,
-                                               thisActualReceiveSize, true);
+                            if (pInstance->sockHexMode) {
+                                hexOk = readHex(atHandle,
+                                                (char *) pData +
+                                                totalReceivedSize,
+                                                thisActualReceiveSize);
+                            } else {
+                                uAtClientReadBytes(atHandle,
+                                                   (char *) pData +
+                                                   totalReceivedSize,
+                                                   thisActualReceiveSize, true);
+                            }
                         }
                         uAtClientResponseStop(atHandle);
                         // BEFORE unlocking, work out what's happened.
@@ -1395,9 +2409,15 @@ int32_t uCellSockRead(int32_t cellHandle,
                             } else {
                                 pSocket->pendingBytes -= thisActualReceiveSize;
                             }
-                            if (thisActualReceiveSize > 0) {
+                            if (!hexOk) {
+                                negErrnoLocalOrSize = -U_SOCK_EIO;
+                            } else if (thisActualReceiveSize > 0) {
                                 totalReceivedSize += thisActualReceiveSize;
                                 dataSizeBytes -= thisActualReceiveSize;
+                            } else {
+                                // The module has nothing after all,
+                                // don't keep asking it
+                                pSocket->pendingBytes = 0;
                             }
                         } else {
                             negErrnoLocalOrSize = -U_SOCK_EIO;
@@ -1434,7 +2454,7 @@ void uCellSockRegisterCallbackData(int32_t cellHandle,
     if (pInstance != NULL) {
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
                 // Set the callback
                 pSocket->pDataCallback = pCallback;
@@ -1457,7 +2477,7 @@ void uCellSockRegisterCallbackClosed(int32_t cellHandle,
     if (pInstance != NULL) {
         // Find the entry
         if (sockHandle >= 0) {
-            pSocket = pFindBySockHandle(sockHandle);
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
             if (pSocket != NULL) {
                 // Set the callback
                 pSocket->pClosedCallback = pCallback;
@@ -1475,15 +2495,28 @@ int32_t uCellSockBind(int32_t cellHandle,
                       int32_t sockHandle,
                       const uSockAddress_t *pLocalAddress)
 {
-    // The firewalls of cellular networks do not
-    // generally allow incoming TCP connections
-    // and hence this function is not implemented
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uCellSockSocket_t *pSocket;
 
-    (void) cellHandle;
-    (void) sockHandle;
-    (void) pLocalAddress;
+    // Note that the firewalls of cellular networks do not
+    // generally allow incoming TCP connections: a private
+    // APN or similar arrangement with the network operator
+    // is required for this to be of any use.
+    // The module has no separate bind operation, the
+    // address is always that of the module, so all we
+    // need is the port number for AT+USOLI
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) &&
+        (sockHandle >= 0) && (pLocalAddress != NULL)) {
+        pSocket = pFindBySockHandle(pInstance, sockHandle);
+        if (pSocket != NULL) {
+            pSocket->localPort = pLocalAddress->port;
+            errnoLocal = U_SOCK_ENONE;
+        }
+    }
 
-    return -U_SOCK_ENOSYS;
+    return -errnoLocal;
 }
 
 // Set listening mode.
@@ -1491,15 +2524,41 @@ int32_t uCellSockListen(int32_t cellHandle,
                         int32_t sockHandle,
                         size_t backlog)
 {
-    // The firewalls of cellular networks do not
-    // generally allow incoming TCP connections
-    // and hence this function is not implemented
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uCellSockSocket_t *pSocket;
 
-    (void) cellHandle;
-    (void) sockHandle;
-    (void) backlog;
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) && (sockHandle >= 0)) {
+        atHandle = pInstance->atHandle;
+        pSocket = pFindBySockHandle(pInstance, sockHandle);
+        if ((pSocket != NULL) && (pSocket->localPort > 0)) {
+            errnoLocal = U_SOCK_EIO;
+            if (backlog == 0) {
+                backlog = 1;
+            }
+            // Set the backlog first in case a
+            // connection arrives straight away
+            pSocket->listenBacklog = backlog;
+            uAtClientLock(atHandle);
+            uAtClientCommandStart(atHandle, "AT+USOLI=");
+            // Write module socket handle
+            uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
+            // Write port number
+            uAtClientWriteInt(atHandle, pSocket->localPort);
+            uAtClientCommandStopReadResponse(atHandle);
+            if (uAtClientUnlock(atHandle) == 0) {
+                // All good
+                errnoLocal = U_SOCK_ENONE;
+            } else {
+                pSocket->listenBacklog = 0;
+            }
+        }
+    }
 
-    return -U_SOCK_ENOSYS;
+    return -errnoLocal;
 }
 
 // Accept an incoming TCP connection.
@@ -1507,15 +2566,217 @@ int32_t uCellSockAccept(int32_t cellHandle,
                         int32_t sockHandle,
                         uSockAddress_t *pRemoteAddress)
 {
-    // The firewalls of cellular networks do not
-    // generally allow incoming TCP connections
-    // and hence this function is not implemented
+    int32_t negErrnoLocalOrSockHandle = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uCellSockSocket_t *pSocket;
 
-    (void) cellHandle;
-    (void) sockHandle;
-    (void) pRemoteAddress;
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) &&
+        (sockHandle >= 0)) {
+        pSocket = pFindBySockHandle(pInstance, sockHandle);
+        if ((pSocket != NULL) && (pSocket->listenBacklog > 0)) {
+            // Connections are queued up by UUSOLI_urc(),
+            // nothing to ask the module
+            negErrnoLocalOrSockHandle = -U_SOCK_EWOULDBLOCK;
+            U_PORT_MUTEX_LOCK(gMutex);
+            pSocket = pFindPendingAccept(pInstance, sockHandle);
+            if (pSocket != NULL) {
+                pSocket->acceptListenerSockHandle = -1;
+                if (pRemoteAddress != NULL) {
+                    *pRemoteAddress = pSocket->remoteAddress;
+                }
+                negErrnoLocalOrSockHandle = pSocket->sockHandle;
+            }
+            U_PORT_MUTEX_UNLOCK(gMutex);
+        }
+    }
+
+    return negErrnoLocalOrSockHandle;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: DIRECT LINK
+ * -------------------------------------------------------------- */
+
+// Switch a socket into direct link mode.
+int32_t uCellSockDirectLinkStart(int32_t cellHandle,
+                                 int32_t sockHandle)
+{
+    int32_t negErrnoLocal = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uCellSockSocket_t *pSocket;
+    uAtClientStream_t streamType;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if (pInstance != NULL) {
+        atHandle = pInstance->atHandle;
+        // Find the entry
+        if (sockHandle >= 0) {
+            pSocket = pFindBySockHandle(pInstance, sockHandle);
+            if (pSocket != NULL) {
+                negErrnoLocal = -U_SOCK_EALREADY;
+                if (pFindDirectLink(pInstance) == NULL) {
+                    negErrnoLocal = -U_SOCK_EOPNOTSUPP;
+                    // The data is going to be read from and
+                    // written to the UART directly, so that
+                    // is all that can be supported
+                    uAtClientStreamGet(atHandle, &streamType);
+                    if ((streamType == U_AT_CLIENT_STREAM_TYPE_UART) &&
+                        (pInstance->pSecurityC2cContext == NULL)) {
+                        negErrnoLocal = -U_SOCK_EIO;
+                        uAtClientLock(atHandle);
+                        uAtClientCommandStart(atHandle, "AT+USODL=");
+                        // Write module socket handle
+                        uAtClientWriteInt(atHandle, pSocket->sockHandleModule);
+                        uAtClientCommandStop(atHandle);
+                        uAtClientResponseStart(atHandle, "CONNECT");
+                        // Consume the remainder of the CONNECT line
+                        // but nothing more: anything after it is data
+                        uAtClientReadBytes(atHandle, NULL, 0, false);
+                        if (uAtClientErrorGet(atHandle) == 0) {
+                            // Keep hold of the AT client lock: it
+                            // is released by uCellSockDirectLinkStop()
+                            pSocket->directLink = true;
+                            negErrnoLocal = U_SOCK_ENONE;
+                        } else {
+                            uAtClientResponseStop(atHandle);
+                            uAtClientUnlock(atHandle);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return negErrnoLocal;
+}
+
+// Send bytes in direct link mode.
+int32_t uCellSockDirectLinkWrite(int32_t cellHandle,
+                                 int32_t sockHandle,
+                                 const void *pData,
+                                 size_t dataSizeBytes)
+{
+    int32_t negErrnoLocalOrSize = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uCellSockSocket_t *pSocket;
+    uAtClientStream_t streamType;
+    int32_t streamHandle;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) && (sockHandle >= 0) &&
+        ((pData != NULL) || (dataSizeBytes == 0))) {
+        pSocket = pFindBySockHandle(pInstance, sockHandle);
+        if ((pSocket != NULL) && pSocket->directLink) {
+            negErrnoLocalOrSize = -U_SOCK_EIO;
+            streamHandle = uAtClientStreamGet(pInstance->atHandle,
+                                              &streamType);
+            if (dataSizeBytes > 0) {
+                negErrnoLocalOrSize = uPortUartWrite(streamHandle, pData,
+                                                     dataSizeBytes);
+                if (negErrnoLocalOrSize < 0) {
+                    negErrnoLocalOrSize = -U_SOCK_EIO;
+                }
+            } else {
+                negErrnoLocalOrSize = 0;
+            }
+        }
+    }
+
+    return negErrnoLocalOrSize;
+}
+
+// Receive bytes in direct link mode.
+int32_t uCellSockDirectLinkRead(int32_t cellHandle,
+                                int32_t sockHandle,
+                                void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoLocalOrSize = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uCellSockSocket_t *pSocket;
+    uAtClientStream_t streamType;
+    int32_t streamHandle;
+    int32_t x;
 
-    return -U_SOCK_ENOSYS;
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) && (sockHandle >= 0) && (pData != NULL)) {
+        atHandle = pInstance->atHandle;
+        pSocket = pFindBySockHandle(pInstance, sockHandle);
+        if ((pSocket != NULL) && pSocket->directLink) {
+            // First take anything that the AT client had
+            // already buffered when direct link mode began,
+            // then anything waiting in the UART
+            negErrnoLocalOrSize = (int32_t) uAtClientReadBuffered(atHandle,
+                                                                  (char *) pData,
+                                                                  dataSizeBytes);
+            if (negErrnoLocalOrSize < (int32_t) dataSizeBytes) {
+                streamHandle = uAtClientStreamGet(atHandle, &streamType);
+                x = uPortUartRead(streamHandle,
+                                  (char *) pData + negErrnoLocalOrSize,
+                                  dataSizeBytes - negErrnoLocalOrSize);
+                if (x > 0) {
+                    negErrnoLocalOrSize += x;
+                }
+            }
+            if ((negErrnoLocalOrSize == 0) && (dataSizeBytes > 0)) {
+                negErrnoLocalOrSize = -U_SOCK_EWOULDBLOCK;
+            }
+        }
+    }
+
+    return negErrnoLocalOrSize;
+}
+
+// Leave direct link mode.
+int32_t uCellSockDirectLinkStop(int32_t cellHandle,
+                                int32_t sockHandle)
+{
+    int32_t negErrnoLocal = -U_SOCK_EINVAL;
+    uCellPrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle;
+    uCellSockSocket_t *pSocket;
+    uAtClientStream_t streamType;
+    int32_t streamHandle;
+
+    // Find the instance
+    pInstance = pUCellPrivateGetInstance(cellHandle);
+    if ((pInstance != NULL) && (sockHandle >= 0)) {
+        atHandle = pInstance->atHandle;
+        pSocket = pFindBySockHandle(pInstance, sockHandle);
+        if ((pSocket != NULL) && pSocket->directLink) {
+            negErrnoLocal = -U_SOCK_EIO;
+            streamHandle = uAtClientStreamGet(atHandle, &streamType);
+            // Send the escape sequence with the
+            // required silence either side of it
+            uPortTaskBlock(U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS);
+            uPortUartWrite(streamHandle, "+++", 3);
+            uPortTaskBlock(U_CELL_SOCK_DIRECT_LINK_GUARD_TIME_MS);
+            // Throw away whatever is left over, including the
+            // DISCONNECT the module sends, and check that the
+            // module is back in command mode
+            for (size_t x = 0; (x < U_CELL_SOCK_DIRECT_LINK_STOP_RETRIES) &&
+                 (negErrnoLocal != U_SOCK_ENONE); x++) {
+                uAtClientFlush(atHandle);
+                uAtClientClearError(atHandle);
+                uAtClientCommandStart(atHandle, "AT");
+                uAtClientCommandStopReadResponse(atHandle);
+                if (uAtClientErrorGet(atHandle) == 0) {
+                    negErrnoLocal = U_SOCK_ENONE;
+                }
+            }
+            pSocket->directLink = false;
+            // Release the AT client lock that was
+            // taken in uCellSockDirectLinkStart()
+            uAtClientUnlock(atHandle);
+        }
+    }
+
+    return negErrnoLocal;
 }
 
 /* ----------------------------------------------------------------
@@ -1602,12 +2863,14 @@ int32_t uCellSockGetLocalAddress(int32_t cellHandle,
 {
     int32_t errnoLocal = U_SOCK_EINVAL;
     uCellPrivateInstance_t *pInstance;
+    uCellSockSocket_t *pSocket = NULL;
     char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
 
-    (void) sockHandle;
-
     pInstance = pUCellPrivateGetInstance(cellHandle);
-    if ((pInstance != NULL) && (pLocalAddress != NULL)) {
+    if ((pInstance != NULL) && (sockHandle >= 0)) {
+        pSocket = pFindBySockHandle(pInstance, sockHandle);
+    }
+    if ((pSocket != NULL) && (pLocalAddress != NULL)) {
         // IP address is that of cellular, for all sockets.
         // uCellNetGetIpAddressStr() returns a positive size
         // on success
@@ -1615,11 +2878,9 @@ int32_t uCellSockGetLocalAddress(int32_t cellHandle,
         if ((uCellNetGetIpAddressStr(pInstance->handle, buffer) > 0) &&
             (uSockStringToAddress(buffer,
                                   pLocalAddress) == 0)) {
-            // TODO: set port number to zero for now but
-            // if we implement TCP server then the port
-            // number should probably be socket-specific
-            // and represent the port the socket is bound to.
-            pLocalAddress->port = 0;
+            // The port is the one the socket is bound to,
+            // zero if it has not been bound
+            pLocalAddress->port = pSocket->localPort;
             errnoLocal = U_SOCK_ENONE;
         }
     }
@@ -52,6 +52,7 @@
 
 #include "u_at_client.h"
 
+#include "u_sock_errno.h"
 #include "u_sock.h"
 
 #include "u_cell_module_type.h"
@@ -70,6 +71,20 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES
+/** The amount of data to send in the write throughput test,
+ * should be a few segments' worth.
+ */
+# define U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES (U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES * 4)
+#endif
+
+#ifndef U_CELL_SOCK_TEST_THROUGHPUT_RECEIVE_SECONDS
+/** How long to wait for the echoed data to come back in the
+ * write throughput test.
+ */
+# define U_CELL_SOCK_TEST_THROUGHPUT_RECEIVE_SECONDS 30
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -479,6 +494,7 @@ U_PORT_TEST_FUNCTION("[cellSock]", "cellSockBasic")
     int32_t z;
     size_t count;
     char *pBuffer;
+    int32_t sockHandles[U_CELL_SOCK_MAX_NUM_SOCKETS];
     int32_t heapUsed;
 
     // In case a previous test failed
@@ -736,16 +752,34 @@ U_PORT_TEST_FUNCTION("[cellSock]", "cellSockBasic")
                               sizeof(gAllChars)) == 0);
     U_PORT_TEST_ASSERT(!gClosedCallbackCalledTcp);
 
+#if U_CELL_SOCK_TRUST_URC_PENDING_BYTES
+    // Everything has been read so reads in quick
+    // succession should be answered without asking
+    // the module
+    y = uCellSockGetNumProbesAvoided();
+    for (size_t x = 0; x < 3; x++) {
+        U_PORT_TEST_ASSERT(uCellSockRead(cellHandle, gSockHandleTcp,
+                                         pBuffer, 1) == -U_SOCK_EWOULDBLOCK);
+    }
+    uPortLog("U_CELL_SOCK_TEST: %d probe(s) avoided in total.\n",
+             uCellSockGetNumProbesAvoided());
+    U_PORT_TEST_ASSERT(uCellSockGetNumProbesAvoided() > y);
+#else
+    U_PORT_TEST_ASSERT(uCellSockGetNumProbesAvoided() == 0);
+#endif
+
     // Sockets should both still be open
     U_PORT_TEST_ASSERT(!gClosedCallbackCalledUdp);
     U_PORT_TEST_ASSERT(!gClosedCallbackCalledTcp);
     U_PORT_TEST_ASSERT(!gAsyncClosedCallbackCalled);
 
     // Get the local address of the TCP socket,
-    // though there's not much we can do to check it.
+    // though there's not much we can do to check it
+    // other than that, not being bound, it has no port
     U_PORT_TEST_ASSERT(uCellSockGetLocalAddress(cellHandle,
                                                 gSockHandleTcp,
                                                 &address) == 0);
+    U_PORT_TEST_ASSERT(address.port == 0);
 
     // Close TCP socket with asynchronous callback
     uPortLog("U_CELL_SOCK_TEST: closing sockets...\n");
@@ -766,6 +800,28 @@ U_PORT_TEST_FUNCTION("[cellSock]", "cellSockBasic")
     U_PORT_TEST_ASSERT(gClosedCallbackCalledTcp);
     U_PORT_TEST_ASSERT(gCallbackErrorNum == 0);
 
+    // Fill the socket table of this instance: it should hold
+    // exactly as many sockets as the module supports, each with
+    // a different handle
+    uPortLog("U_CELL_SOCK_TEST: opening %d socket(s)...\n",
+             (int32_t) pModule->maxNumSockets);
+    U_PORT_TEST_ASSERT(pModule->maxNumSockets > 0);
+    U_PORT_TEST_ASSERT(pModule->maxNumSockets <= U_CELL_SOCK_MAX_NUM_SOCKETS);
+    for (size_t x = 0; x < pModule->maxNumSockets; x++) {
+        sockHandles[x] = uCellSockCreate(cellHandle, U_SOCK_TYPE_DGRAM,
+                                         U_SOCK_PROTOCOL_UDP);
+        U_PORT_TEST_ASSERT(sockHandles[x] >= 0);
+        for (size_t i = 0; i < x; i++) {
+            U_PORT_TEST_ASSERT(sockHandles[i] != sockHandles[x]);
+        }
+    }
+    U_PORT_TEST_ASSERT(uCellSockCreate(cellHandle, U_SOCK_TYPE_DGRAM,
+                                       U_SOCK_PROTOCOL_UDP) == -U_SOCK_ENOBUFS);
+    for (size_t x = 0; x < pModule->maxNumSockets; x++) {
+        U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, sockHandles[x],
+                                          NULL) == 0);
+    }
+
     // Deinit cell sockets
     uCellSockDeinit();
 
@@ -970,6 +1026,294 @@ U_PORT_TEST_FUNCTION("[cellSock]", "cellSockOptionSetGet")
     U_PORT_TEST_ASSERT(heapUsed <= 0);
 }
 
+/** Measure the throughput of a large uCellSockWrite(), which
+ * has to be split into several segments on the AT interface,
+ * and check that the data is echoed back intact.
+ */
+U_PORT_TEST_FUNCTION("[cellSock]", "cellSockWriteThroughput")
+{
+    int32_t cellHandle;
+    uSockAddress_t echoServerAddressTcp;
+    char *pTxBuffer;
+    char *pRxBuffer;
+    int64_t startTimeMs;
+    int32_t timeMs;
+    int32_t y;
+    int32_t z;
+    int32_t heapUsed;
+
+    // In case a previous test failed
+    uCellSockDeinit();
+    uCellTestPrivateCleanup(&gHandles);
+
+    // Obtain the initial heap size
+    heapUsed = uPortGetHeapFree();
+
+    memset(&echoServerAddressTcp, 0, sizeof(echoServerAddressTcp));
+
+    // Malloc buffers to send from and receive into, filling
+    // the transmit buffer with repeated copies of gAllChars
+    pTxBuffer = (char *) malloc(U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(pTxBuffer != NULL);
+    pRxBuffer = (char *) malloc(U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(pRxBuffer != NULL);
+    for (size_t x = 0; x < U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES; x++) {
+        *(pTxBuffer + x) = gAllChars[x % sizeof(gAllChars)];
+    }
+    memset(pRxBuffer, 0, U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES);
+
+    // Do the standard preamble
+    U_PORT_TEST_ASSERT(uCellTestPrivatePreamble(U_CFG_TEST_CELL_MODULE_TYPE,
+                                                &gHandles, true) == 0);
+    cellHandle = gHandles.cellHandle;
+
+    // Connect to the network
+    gStopTimeMs = uPortGetTickTimeMs() +
+                  (U_CELL_TEST_CFG_CONNECT_TIMEOUT_SECONDS * 1000);
+    U_PORT_TEST_ASSERT(uCellNetConnect(cellHandle, NULL,
+#ifdef U_CELL_TEST_CFG_APN
+                                       U_PORT_STRINGIFY_QUOTED(U_CELL_TEST_CFG_APN),
+#else
+                                       NULL,
+#endif
+#ifdef U_CELL_TEST_CFG_USERNAME
+                                       U_PORT_STRINGIFY_QUOTED(U_CELL_TEST_CFG_USERNAME),
+#else
+                                       NULL,
+#endif
+#ifdef U_CELL_TEST_CFG_PASSWORD
+                                       U_PORT_STRINGIFY_QUOTED(U_CELL_TEST_CFG_PASSWORD),
+#else
+                                       NULL,
+#endif
+                                       keepGoingCallback) == 0);
+
+    // Init cell sockets
+    U_PORT_TEST_ASSERT(uCellSockInit() == 0);
+    U_PORT_TEST_ASSERT(uCellSockInitInstance(cellHandle) == 0);
+
+    // Look up the address of the server we use for TCP echo
+    U_PORT_TEST_ASSERT(uCellSockGetHostByName(cellHandle,
+                                              U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                              &(echoServerAddressTcp.ipAddress)) == 0);
+    echoServerAddressTcp.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+    // Create and connect a TCP socket
+    gSockHandleTcp = uCellSockCreate(cellHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(gSockHandleTcp >= 0);
+    U_PORT_TEST_ASSERT(uCellSockConnect(cellHandle, gSockHandleTcp,
+                                        &echoServerAddressTcp) == 0);
+
+    // Send the lot in one go and time it
+    uPortLog("U_CELL_SOCK_TEST: sending %d byte(s) to %s:%d in one"
+             " write, %d byte(s) per segment...\n",
+             U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES,
+             U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+             U_SOCK_TEST_ECHO_TCP_SERVER_PORT,
+             U_CELL_SOCK_MAX_SEGMENT_SIZE_BYTES);
+    startTimeMs = uPortGetTickTimeMs();
+    y = uCellSockWrite(cellHandle, gSockHandleTcp, pTxBuffer,
+                       U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES);
+    timeMs = (int32_t) (uPortGetTickTimeMs() - startTimeMs);
+    uPortLog("U_CELL_SOCK_TEST: %d byte(s) written in %d ms", y, timeMs);
+    if (timeMs > 0) {
+        uPortLog(", %d byte(s)/second", (y * 1000) / timeMs);
+    }
+    uPortLog(".\n");
+    U_PORT_TEST_ASSERT(y == U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES);
+
+    // Get the data back again
+    y = 0;
+    startTimeMs = uPortGetTickTimeMs();
+    while ((y < U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES) &&
+           (uPortGetTickTimeMs() - startTimeMs <
+            U_CELL_SOCK_TEST_THROUGHPUT_RECEIVE_SECONDS * 1000)) {
+        z = uCellSockRead(cellHandle, gSockHandleTcp, pRxBuffer + y,
+                          U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES - y);
+        if (z > 0) {
+            y += z;
+        } else {
+            uPortTaskBlock(500);
+        }
+    }
+    uPortLog("U_CELL_SOCK_TEST: %d byte(s) echoed back.\n", y);
+    U_PORT_TEST_ASSERT(y == U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(memcmp(pRxBuffer, pTxBuffer,
+                              U_CELL_SOCK_TEST_THROUGHPUT_SIZE_BYTES) == 0);
+
+    // Close the socket, synchronously
+    U_PORT_TEST_ASSERT(uCellSockClose(cellHandle, gSockHandleTcp,
+                                      NULL) == 0);
+    gSockHandleTcp = -1;
+
+    // Deinit cell sockets
+    uCellSockDeinit();
+
+    // Disconnect
+    U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+
+    // Do the standard postamble, leaving the module on for the next
+    // test to speed things up
+    uCellTestPrivatePostamble(&gHandles, false);
+
+    // Free memory
+    free(pRxBuffer);
+    free(pTxBuffer);
+
+    // Check for memory leaks
+    heapUsed -= uPortGetHeapFree();
+    uPortLog("U_CELL_SOCK_TEST: we have leaked %d byte(s).\n", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+}
+
+/** Test direct link mode: switch a TCP socket into direct link
+ * mode, exchange data with the echo server and switch back again.
+ */
+U_PORT_TEST_FUNCTION("[cellSock]", "cellSockDirectLink")
+{
+    int32_t cellHandle;
+    uSockAddress_t echoServerAddressTcp;
+    uSockAddress_t address;
+    char *pBuffer;
+    int64_t startTimeMs;
+    int32_t y;
+    int32_t z;
+    int32_t heapUsed;
+
+    // In case a previous test failed
+    uCellSockDeinit();
+    uCellTestPrivateCleanup(&gHandles);
+
+    // Obtain the initial heap size
+    heapUsed = uPortGetHeapFree();
+
+    memset(&echoServerAddressTcp, 0, sizeof(echoServerAddressTcp));
+    memset(&address, 0, sizeof(address));
+
+    pBuffer = (char *) malloc(sizeof(gAllChars));
+    U_PORT_TEST_ASSERT(pBuffer != NULL);
+    memset(pBuffer, 0, sizeof(gAllChars));
+
+    // Do the standard preamble
+    U_PORT_TEST_ASSERT(uCellTestPrivatePreamble(U_CFG_TEST_CELL_MODULE_TYPE,
+                                                &gHandles, true) == 0);
+    cellHandle = gHandles.cellHandle;
+
+    // Connect to the network
+    gStopTimeMs = uPortGetTickTimeMs() +
+                  (U_CELL_TEST_CFG_CONNECT_TIMEOUT_SECONDS * 1000);
+    U_PORT_TEST_ASSERT(uCellNetConnect(cellHandle, NULL,
+#ifdef U_CELL_TEST_CFG_APN
+                                       U_PORT_STRINGIFY_QUOTED(U_CELL_TEST_CFG_APN),
+#else
+                                       NULL,
+#endif
+#ifdef U_CELL_TEST_CFG_USERNAME
+                                       U_PORT_STRINGIFY_QUOTED(U_CELL_TEST_CFG_USERNAME),
+#else
+                                       NULL,
+#endif
+#ifdef U_CELL_TEST_CFG_PASSWORD
+                                       U_PORT_STRINGIFY_QUOTED(U_CELL_TEST_CFG_PASSWORD),
+#else
+                                       NULL,
+#endif
+                                       keepGoingCallback) == 0);
+
+    // Init cell sockets
+    U_PORT_TEST_ASSERT(uCellSockInit() == 0);
+    U_PORT_TEST_ASSERT(uCellSockInitInstance(cellHandle) == 0);
+
+    // Look up the address of the server we use for TCP echo
+    U_PORT_TEST_ASSERT(uCellSockGetHostByName(cellHandle,
+                                              U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                              &(echoServerAddressTcp.ipAddress)) == 0);
+    echoServerAddressTcp.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+    // Create and connect a TCP socket
+    gSockHandleTcp = uCellSockCreate(cellHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(gSockHandleTcp >= 0);
+    U_PORT_TEST_ASSERT(uCellSockConnect(cellHandle, gSockHandleTcp,
+                                        &echoServerAddressTcp) == 0);
+
+    // Direct link functions should fail when not in direct link mode
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkWrite(cellHandle, gSockHandleTcp,
+                                                gAllChars,
+                                                sizeof(gAllChars)) < 0);
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkRead(cellHandle, gSockHandleTcp,
+                                               pBuffer,
+                                               sizeof(gAllChars)) < 0);
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkStop(cellHandle,
+                                               gSockHandleTcp) < 0);
+
+    // Go into direct link mode; doing so twice should fail
+    uPortLog("U_CELL_SOCK_TEST: entering direct link mode...\n");
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkStart(cellHandle,
+                                                gSockHandleTcp) == 0);
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkStart(cellHandle,
+                                                gSockHandleTcp) == -U_SOCK_EALREADY);
+
+    // Send the data and get it back again
+    y = uCellSockDirectLinkWrite(cellHandle, gSockHandleTcp,
+                                 gAllChars, sizeof(gAllChars));
+    U_PORT_TEST_ASSERT(y == sizeof(gAllChars));
+    y = 0;
+    startTimeMs = uPortGetTickTimeMs();
+    while ((y < sizeof(gAllChars)) &&
+           (uPortGetTickTimeMs() - startTimeMs < 10000)) {
+        z = uCellSockDirectLinkRead(cellHandle, gSockHandleTcp,
+                                    pBuffer + y, sizeof(gAllChars) - y);
+        if (z > 0) {
+            y += z;
+        } else {
+            U_PORT_TEST_ASSERT(z == -U_SOCK_EWOULDBLOCK);
+            uPortTaskBlock(100);
+        }
+    }
+    uPortLog("U_CELL_SOCK_TEST: %d byte(s) echoed in direct link mode.\n", y);
+    U_PORT_TEST_ASSERT(y == sizeof(gAllChars));
+    U_PORT_TEST_ASSERT(memcmp(pBuffer, gAllChars, sizeof(gAllChars)) == 0);
+
+    // Leave direct link mode
+    uPortLog("U_CELL_SOCK_TEST: leaving direct link mode...\n");
+    U_PORT_TEST_ASSERT(uCellSockDirectLinkStop(cellHandle,
+                                               gSockHandleTcp) == 0);
+
+    // The AT interface should be usable again
+    U_PORT_TEST_ASSERT(uCellSockGetHostByName(cellHandle,
+                                              U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                              &(address.ipAddress)) == 0);
+
+    // Close the socket: this may fail if the module
+    // closed it on leaving direct link mode, that's OK
+    uCellSockClose(cellHandle, gSockHandleTcp, NULL);
+    gSockHandleTcp = -1;
+
+    // Deinit cell sockets
+    uCellSockDeinit();
+
+    // Disconnect
+    U_PORT_TEST_ASSERT(uCellNetDisconnect(cellHandle, NULL) == 0);
+
+    // Do the standard postamble, leaving the module on for the next
+    // test to speed things up
+    uCellTestPrivatePostamble(&gHandles, false);
+
+    // Free memory
+    free(pBuffer);
+
+    // Check for memory leaks
+    heapUsed -= uPortGetHeapFree();
+    uPortLog("U_CELL_SOCK_TEST: we have leaked %d byte(s).\n", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -30,9 +30,11 @@
 # include "u_cfg_override.h" // For a customer's configuration override
 #endif
 
+#include "stdlib.h"    // malloc(), free()
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // memcmp()
 
 #include "u_cfg_sw.h"
 #include "u_cfg_app_platform_specific.h"
@@ -49,11 +51,25 @@
 
 #include "u_cell_module_type.h"
 #include "u_cell.h"
+#include "u_cell_net.h"     // Required by u_cell_private.h
+#include "u_cell_private.h" // So that we can get at the hex codec
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_CELL_TEST_HEX_CODEC_SIZE_BYTES
+/** The size of binary buffer to use when timing the hex codec.
+ */
+# define U_CELL_TEST_HEX_CODEC_SIZE_BYTES 1024
+#endif
+
+#ifndef U_CELL_TEST_HEX_CODEC_ITERATIONS
+/** The number of times to run the hex codec when timing it.
+ */
+# define U_CELL_TEST_HEX_CODEC_ITERATIONS 1000
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -227,6 +243,93 @@ U_PORT_TEST_FUNCTION("[cell]", "cellAdd")
 }
 #endif
 
+/** Check the binary/hex codec used by hex mode sockets and
+ * measure how fast it is.  No module or UART is required.
+ */
+U_PORT_TEST_FUNCTION("[cell]", "cellHexCodec")
+{
+    char *pBin;
+    char *pHex;
+    char *pBinOut;
+    int64_t timeMs;
+    int32_t heapUsed;
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+
+    // Obtain the initial heap size
+    heapUsed = uPortGetHeapFree();
+
+    pBin = (char *) malloc(U_CELL_TEST_HEX_CODEC_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(pBin != NULL);
+    pHex = (char *) malloc(U_CELL_TEST_HEX_CODEC_SIZE_BYTES * 2);
+    U_PORT_TEST_ASSERT(pHex != NULL);
+    pBinOut = (char *) malloc(U_CELL_TEST_HEX_CODEC_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(pBinOut != NULL);
+
+    // Every byte value, round trip
+    for (size_t x = 0; x < U_CELL_TEST_HEX_CODEC_SIZE_BYTES; x++) {
+        *(pBin + x) = (char) x;
+    }
+    U_PORT_TEST_ASSERT(uCellPrivateBinToHex(pBin, 256, pHex) == 512);
+    U_PORT_TEST_ASSERT(memcmp(pHex, "000102", 6) == 0);
+    U_PORT_TEST_ASSERT(memcmp(pHex + 0x7f * 2, "7F80", 4) == 0);
+    U_PORT_TEST_ASSERT(memcmp(pHex + 0xfe * 2, "FEFF", 4) == 0);
+    U_PORT_TEST_ASSERT(uCellPrivateHexToBin(pHex, 512, pBinOut) == 256);
+    U_PORT_TEST_ASSERT(memcmp(pBin, pBinOut, 256) == 0);
+
+    // Lower case, an odd length and invalid characters
+    U_PORT_TEST_ASSERT(uCellPrivateHexToBin("aBcDeF0", 7, pBinOut) == 3);
+    U_PORT_TEST_ASSERT(memcmp(pBinOut, "\xab\xcd\xef", 3) == 0);
+    U_PORT_TEST_ASSERT(uCellPrivateHexToBin("01g2", 4, pBinOut) == 1);
+    U_PORT_TEST_ASSERT(uCellPrivateHexToBin("0 ", 2, pBinOut) == 0);
+
+    // Time it
+    timeMs = uPortGetTickTimeMs();
+    for (size_t x = 0; x < U_CELL_TEST_HEX_CODEC_ITERATIONS; x++) {
+        uCellPrivateBinToHex(pBin, U_CELL_TEST_HEX_CODEC_SIZE_BYTES, pHex);
+    }
+    timeMs = uPortGetTickTimeMs() - timeMs;
+    uPortLog("U_CELL_TEST: hex encode of %d byte(s) %d times took %d ms",
+             U_CELL_TEST_HEX_CODEC_SIZE_BYTES,
+             U_CELL_TEST_HEX_CODEC_ITERATIONS, (int32_t) timeMs);
+    if (timeMs > 0) {
+        uPortLog(", %d kbytes/second",
+                 (int32_t) (((int64_t) U_CELL_TEST_HEX_CODEC_SIZE_BYTES *
+                             U_CELL_TEST_HEX_CODEC_ITERATIONS) / timeMs));
+    }
+    uPortLog(".\n");
+    timeMs = uPortGetTickTimeMs();
+    for (size_t x = 0; x < U_CELL_TEST_HEX_CODEC_ITERATIONS; x++) {
+        U_PORT_TEST_ASSERT(uCellPrivateHexToBin(pHex,
+                                                U_CELL_TEST_HEX_CODEC_SIZE_BYTES * 2,
+                                                pBinOut) == U_CELL_TEST_HEX_CODEC_SIZE_BYTES);
+    }
+    timeMs = uPortGetTickTimeMs() - timeMs;
+    uPortLog("U_CELL_TEST: hex decode of %d byte(s) %d times took %d ms",
+             U_CELL_TEST_HEX_CODEC_SIZE_BYTES,
+             U_CELL_TEST_HEX_CODEC_ITERATIONS, (int32_t) timeMs);
+    if (timeMs > 0) {
+        uPortLog(", %d kbytes/second",
+                 (int32_t) (((int64_t) U_CELL_TEST_HEX_CODEC_SIZE_BYTES *
+                             U_CELL_TEST_HEX_CODEC_ITERATIONS) / timeMs));
+    }
+    uPortLog(".\n");
+    U_PORT_TEST_ASSERT(memcmp(pBin, pBinOut, U_CELL_TEST_HEX_CODEC_SIZE_BYTES) == 0);
+
+    free(pBinOut);
+    free(pHex);
+    free(pBin);
+
+    // Check for memory leaks
+    heapUsed -= uPortGetHeapFree();
+    uPortLog("U_CELL_TEST: we have leaked %d byte(s).\n", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+
+    uPortDeinit();
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
@@ -1029,6 +1029,29 @@ void uAtClientDeviceErrorGet(uAtClientHandle_t atHandle,
 int32_t uAtClientStreamGet(uAtClientHandle_t atHandle,
                            uAtClientStream_t *pStreamType);
 
+/** Take data that the AT client has already read from the
+ * stream into its receive buffer but has not yet processed.
+ * This does NOT read anything more from the stream; it is
+ * intended for use when the stream is handed over to
+ * something else, e.g. when a module has switched into a
+ * transparent data mode, where the first few bytes of that
+ * data may already have been pulled into the AT client
+ * receive buffer along with the final line of the
+ * response that caused the switch.
+ *
+ * This function should only be called when the AT client has
+ * been locked (with uAtClientLock()) to ensure thread safety.
+ *
+ * @param atHandle     the handle of the AT client.
+ * @param pBuffer      a place to put the data; cannot be NULL.
+ * @param lengthBytes  the number of bytes of storage at pBuffer.
+ * @return             the number of bytes copied to pBuffer,
+ *                     which are consumed from the AT client
+ *                     receive buffer.
+ */
+size_t uAtClientReadBuffered(uAtClientHandle_t atHandle,
+                             char *pBuffer, size_t lengthBytes);
+
 /** Add a function that will intercept the transmitted
  * data before it is presented to the stream and may return
  * a modified buffer or hold onto the data until a whole
@@ -2675,6 +2675,35 @@ int32_t uAtClientStreamGet(uAtClientHandle_t atHandle,
     return pClient->streamHandle;
 }
 
+// Take data that is already in the receive buffer.
+size_t uAtClientReadBuffered(uAtClientHandle_t atHandle,
+                             char *pBuffer, size_t lengthBytes)
+{
+    uAtClientInstance_t *pClient = (uAtClientInstance_t *) atHandle;
+    uAtClientReceiveBuffer_t *pReceiveBuffer;
+    size_t length = 0;
+
+    U_PORT_MUTEX_LOCK(pClient->mutex);
+
+    pReceiveBuffer = pClient->pReceiveBuffer;
+    if (pReceiveBuffer->readIndex < pReceiveBuffer->length) {
+        length = pReceiveBuffer->length - pReceiveBuffer->readIndex;
+        if (length > lengthBytes) {
+            length = lengthBytes;
+        }
+        memcpy(pBuffer, U_AT_CLIENT_DATA_BUFFER_PTR(pReceiveBuffer) +
+               pReceiveBuffer->readIndex, length);
+        pReceiveBuffer->readIndex += length;
+    }
+    if (pReceiveBuffer->readIndex >= pReceiveBuffer->length) {
+        bufferReset(pClient, false);
+    }
+
+    U_PORT_MUTEX_UNLOCK(pClient->mutex);
+
+    return length;
+}
+
 // Add a transmit intercept function.
 void uAtClientStreamInterceptTx(uAtClientHandle_t atHandle,
                                 const char *(*pCallback) (uAtClientHandle_t,
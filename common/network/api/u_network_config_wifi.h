@@ -44,7 +44,24 @@ typedef struct {
     uNetworkType_t type; /**< All uNetworkConfigurationXxx structures
                               must begin with this for error checking
                               purposes. */
-    // TODO
+    int32_t module; /**< The module type that is connected,
+                         see uWifiModuleType_t in u_wifi_module_type.h. */
+    int32_t uart; /**< The UART HW block to use. */
+    int32_t pinTxd; /** The output pin that sends UART data to
+                        the short range module. */
+    int32_t pinRxd; /** The input pin that receives UART data from
+                        the short range module. */
+    int32_t pinCts; /**< The input pin that the short range module
+                         will use to indicate that data can be sent
+                         to it; use -1 if there is no such connection. */
+    int32_t pinRts; /**< The output pin output pin that tells the
+                         short range module that it can send more UART
+                         data; use -1 if there is no such connection. */
+    const char *pSsid; /**< The SSID of the access point to connect to. */
+    int32_t authentication; /**< The authentication mode, see
+                                 uWifiNetAuth_t in u_wifi_net.h. */
+    const char *pPassPhrase; /**< The passphrase, may be NULL if
+                                  authentication is open. */
 } uNetworkConfigurationWifi_t;
 
 #endif // _U_NETWORK_CONFIG_WIFI_H_
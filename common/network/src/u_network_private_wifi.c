@@ -37,6 +37,18 @@
 
 #include "u_error_common.h"
 
+#include "u_port_uart.h"
+
+#include "u_at_client.h"
+
+#include "u_short_range_module_type.h"
+#include "u_short_range.h"
+#include "u_short_range_edm_stream.h"
+
+#include "u_wifi_module_type.h"
+#include "u_wifi.h"
+#include "u_wifi_net.h"
+
 #include "u_network.h"
 #include "u_network_config_wifi.h"
 #include "u_network_private_wifi.h"
@@ -45,18 +57,76 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#ifndef U_NETWORK_PRIVATE_WIFI_MAX_NUM
+# define U_NETWORK_PRIVATE_WIFI_MAX_NUM 1
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+typedef struct {
+    int32_t uartHandle; /**< The handle returned by uPortUartOpen(). */
+    int32_t edmStreamHandle; /**< The handle returned by uShortRangeEdmStreamOpen(). */
+    uAtClientHandle_t atClientHandle; /**< The handle returned by uAtClientAdd(). */
+    int32_t wifiHandle;  /**< The handle returned by uWifiAdd(). */
+} uNetworkPrivateWifiInstance_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
 
+/** Array to keep track of the instances.
+ */
+static uNetworkPrivateWifiInstance_t gInstance[U_NETWORK_PRIVATE_WIFI_MAX_NUM];
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
+// Find a free place in the list.
+static uNetworkPrivateWifiInstance_t *pGetFree()
+{
+    uNetworkPrivateWifiInstance_t *pFree = NULL;
+
+    for (size_t x = 0; (x < sizeof(gInstance) / sizeof(gInstance[0])) &&
+         (pFree == NULL); x++) {
+        if (gInstance[x].uartHandle < 0) {
+            pFree = &(gInstance[x]);
+        }
+    }
+
+    return pFree;
+}
+
+// Find the given instance in the list.
+static uNetworkPrivateWifiInstance_t *pGetInstance(int32_t wifiHandle)
+{
+    uNetworkPrivateWifiInstance_t *pInstance = NULL;
+
+    for (size_t x = 0; (x < sizeof(gInstance) / sizeof(gInstance[0])) &&
+         (pInstance == NULL); x++) {
+        if (gInstance[x].wifiHandle == wifiHandle) {
+            pInstance = &(gInstance[x]);
+        }
+    }
+
+    return pInstance;
+}
+
+// Free an instance.
+static void instanceFree(uNetworkPrivateWifiInstance_t *pInstance)
+{
+    uWifiRemove(pInstance->wifiHandle);
+    pInstance->wifiHandle = -1;
+    uAtClientRemove(pInstance->atClientHandle);
+    pInstance->atClientHandle = NULL;
+    uShortRangeEdmStreamClose(pInstance->edmStreamHandle);
+    pInstance->edmStreamHandle = -1;
+    uPortUartClose(pInstance->uartHandle);
+    pInstance->uartHandle = -1;
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -64,45 +134,138 @@
 // Initialise the network API for Wifi.
 int32_t uNetworkInitWifi()
 {
-    // Nothing [yet] to do
+    uShortRangeEdmStreamInit();
+    uAtClientInit();
+    uWifiInit();
+
+    for (size_t x = 0; x < sizeof(gInstance) / sizeof(gInstance[0]); x++) {
+        gInstance[x].uartHandle = -1;
+        gInstance[x].atClientHandle = NULL;
+        gInstance[x].edmStreamHandle = -1;
+        gInstance[x].wifiHandle = -1;
+    }
+
     return (int32_t) U_ERROR_COMMON_SUCCESS;
 }
 
-// Deinitialise the sho network API.
+// Deinitialise the Wifi network API.
 void uNetworkDeinitWifi()
 {
+    uWifiDeinit();
+    uAtClientDeinit();
+    uShortRangeEdmStreamDeinit();
 }
 
 // Add a Wifi network instance.
 int32_t uNetworkAddWifi(const uNetworkConfigurationWifi_t *pConfiguration)
 {
-    (void) pConfiguration;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+    uNetworkPrivateWifiInstance_t *pInstance;
+    uWifiModuleType_t module;
+
+    pInstance = pGetFree();
+    if (pInstance != NULL) {
+        // Open a UART with the recommended buffer length
+        // and default baud rate.
+        errorCode = uPortUartOpen(pConfiguration->uart,
+                                  U_WIFI_UART_BAUD_RATE, NULL,
+                                  U_WIFI_UART_BUFFER_LENGTH_BYTES,
+                                  pConfiguration->pinTxd,
+                                  pConfiguration->pinRxd,
+                                  pConfiguration->pinCts,
+                                  pConfiguration->pinRts);
+        if (errorCode >= 0) {
+            pInstance->uartHandle = errorCode;
+            errorCode = (int32_t) U_WIFI_ERROR_AT;
+
+            pInstance->edmStreamHandle = uShortRangeEdmStreamOpen(pInstance->uartHandle);
+            if (pInstance->edmStreamHandle >= 0) {
+                // Add an AT client on the EDM stream with the
+                // recommended default buffer size.
+                pInstance->atClientHandle = uAtClientAdd(pInstance->edmStreamHandle,
+                                                         U_AT_CLIENT_STREAM_TYPE_EDM,
+                                                         NULL,
+                                                         U_WIFI_AT_BUFFER_LENGTH_BYTES);
+                if (pInstance->atClientHandle != NULL) {
+                    uShortRangeEdmStreamSetAtHandle(pInstance->edmStreamHandle,
+                                                    pInstance->atClientHandle);
+
+                    // Set printing of AT commands by the wifi driver,
+                    // which can be useful while debugging.
+                    uAtClientPrintAtSet(pInstance->atClientHandle, true);
+
+                    errorCode = uWifiAdd((uWifiModuleType_t) pConfiguration->module,
+                                         pInstance->atClientHandle);
+                    if (errorCode >= 0) {
+                        pInstance->wifiHandle = errorCode;
+                        module = uWifiDetectModule(pInstance->wifiHandle);
+                        if (module == U_WIFI_MODULE_TYPE_INVALID) {
+                            errorCode = (int32_t) U_SHORT_RANGE_ERROR_NOT_DETECTED;
+                        } else if ((int32_t) module != pConfiguration->module) {
+                            errorCode = (int32_t) U_SHORT_RANGE_ERROR_WRONG_TYPE;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (errorCode < 0) {
+            instanceFree(pInstance);
+        }
+    }
+
+    return errorCode;
 }
 
 // Remove a Wifi network instance.
 int32_t uNetworkRemoveWifi(int32_t handle)
 {
-    (void) handle;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uNetworkPrivateWifiInstance_t *pInstance;
+
+    pInstance = pGetInstance(handle);
+    if (pInstance != NULL) {
+        instanceFree(pInstance);
+        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    }
+
+    return errorCode;
 }
 
 // Bring up the given Wifi network instance.
 int32_t uNetworkUpWifi(int32_t handle,
                        const uNetworkConfigurationWifi_t *pConfiguration)
 {
-    (void) handle;
-    (void) pConfiguration;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uNetworkPrivateWifiInstance_t *pInstance;
+
+    pInstance = pGetInstance(handle);
+    if ((pInstance != NULL) && (pInstance->wifiHandle >= 0) &&
+        (pConfiguration->pSsid != NULL)) {
+        errorCode = uWifiNetStationConnect(pInstance->wifiHandle,
+                                           pConfiguration->pSsid,
+                                           (uWifiNetAuth_t) pConfiguration->authentication,
+                                           pConfiguration->pPassPhrase);
+    }
+
+    return errorCode;
 }
 
 // Take down the given Wifi network instance.
 int32_t uNetworkDownWifi(int32_t handle,
                          const uNetworkConfigurationWifi_t *pConfiguration)
 {
-    (void) handle;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uNetworkPrivateWifiInstance_t *pInstance;
+
     (void) pConfiguration;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+
+    pInstance = pGetInstance(handle);
+    if ((pInstance != NULL) && (pInstance->wifiHandle >= 0)) {
+        errorCode = uWifiNetStationDisconnect(pInstance->wifiHandle);
+    }
+
+    return errorCode;
 }
 
 // End of file
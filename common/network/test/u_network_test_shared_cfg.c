@@ -70,9 +70,10 @@
  * VARIABLES
  * -------------------------------------------------------------- */
 
-/** The network configuration for BLE.
+/** The network configuration for BLE; BLE and Wifi share the
+ * short range UART so only one of them can be tested at a time.
  */
-#ifdef U_CFG_TEST_SHORT_RANGE_MODULE_TYPE
+#if defined(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE) && !defined(U_CFG_TEST_WIFI_SSID)
 static const uNetworkConfigurationBle_t gConfigurationBle = {
     U_NETWORK_TYPE_BLE,
     U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
@@ -114,11 +115,29 @@ static const uNetworkConfigurationCell_t gConfigurationCell = {
 static const uNetworkConfigurationCell_t gConfigurationCell = {U_NETWORK_TYPE_NONE};
 #endif
 
+#if defined(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE) && defined(U_CFG_TEST_WIFI_SSID)
 /** The network configuration for Wifi.
  */
 static const uNetworkConfigurationWifi_t gConfigurationWifi = {
-    U_NETWORK_TYPE_NONE /* TODO: replace this with Wifi config info. */
+    U_NETWORK_TYPE_WIFI,
+    U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
+    U_CFG_APP_SHORT_RANGE_UART,
+    U_CFG_APP_PIN_SHORT_RANGE_TXD,
+    U_CFG_APP_PIN_SHORT_RANGE_RXD,
+    U_CFG_APP_PIN_SHORT_RANGE_CTS,
+    U_CFG_APP_PIN_SHORT_RANGE_RTS,
+    U_PORT_STRINGIFY_QUOTED(U_CFG_TEST_WIFI_SSID),
+#ifdef U_CFG_TEST_WIFI_PASSPHRASE
+    2, // WPA/WPA2, see uWifiNetAuth_t
+    U_PORT_STRINGIFY_QUOTED(U_CFG_TEST_WIFI_PASSPHRASE)
+#else
+    1, // Open, see uWifiNetAuth_t
+    NULL
+#endif
 };
+#else
+static const uNetworkConfigurationWifi_t gConfigurationWifi = {U_NETWORK_TYPE_NONE};
+#endif
 
 /** All of the information for the underlying network
  * types as an array.
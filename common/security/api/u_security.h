@@ -61,10 +61,74 @@ extern "C" {
  */
 #define U_SECURITY_C2C_HMAC_TAG_LENGTH_BYTES 16
 
+/** The maximum length of the name under which a TLS credential
+ * is stored in the module, not including the null terminator.
+ */
+#define U_SECURITY_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES 200
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The types of TLS credential that can be stored in a module;
+ * the values match those of the cellular AT+USECMNG command.
+ */
+typedef enum {
+    U_SECURITY_TLS_CREDENTIAL_ROOT_CA_X509 = 0,
+    U_SECURITY_TLS_CREDENTIAL_CLIENT_X509 = 1,
+    U_SECURITY_TLS_CREDENTIAL_CLIENT_KEY_PRIVATE = 2,
+    U_SECURITY_TLS_CREDENTIAL_SERVER_X509 = 3,
+    U_SECURITY_TLS_CREDENTIAL_MAX_NUM
+} uSecurityTlsCredentialType_t;
+
+/** The level of certificate validation that a module should
+ * apply when making a TLS connection; the values match those
+ * of the cellular AT+USECPRF command.
+ */
+typedef enum {
+    U_SECURITY_TLS_VALIDATION_NONE = 0, /**< no validation of the
+                                             server at all. */
+    U_SECURITY_TLS_VALIDATION_ROOT_CA = 1, /**< check the server
+                                                certificate against
+                                                the root CA. */
+    U_SECURITY_TLS_VALIDATION_ROOT_CA_URL = 2, /**< as above and also
+                                                    check that the URL
+                                                    matches
+                                                    pExpectedServerHostname. */
+    U_SECURITY_TLS_VALIDATION_ROOT_CA_URL_DATE = 3, /**< as above and also
+                                                         check the
+                                                         expiry date. */
+    U_SECURITY_TLS_VALIDATION_MAX_NUM
+} uSecurityTlsValidation_t;
+
+/** The minimum TLS version that a module should accept; the
+ * values match those of the cellular AT+USECPRF command.
+ */
+typedef enum {
+    U_SECURITY_TLS_VERSION_ANY = 0,
+    U_SECURITY_TLS_VERSION_1_0 = 1,
+    U_SECURITY_TLS_VERSION_1_1 = 2,
+    U_SECURITY_TLS_VERSION_1_2 = 3,
+    U_SECURITY_TLS_VERSION_MAX_NUM
+} uSecurityTlsVersion_t;
+
+/** A TLS security profile, to be applied inside a module with
+ * uSecurityTlsProfileSet().  The strings are the names under
+ * which credentials have been stored with
+ * uSecurityTlsCredentialStore(); any that are NULL are left at
+ * the module's default.
+ */
+typedef struct {
+    uSecurityTlsValidation_t validation;
+    uSecurityTlsVersion_t tlsVersionMin;
+    const char *pRootCaName;
+    const char *pClientCertificateName;
+    const char *pClientPrivateKeyName;
+    const char *pClientPrivateKeyPassword;
+    const char *pExpectedServerHostname;
+    const char *pServerNameIndication;
+} uSecurityTlsProfile_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: INFORMATION
  * -------------------------------------------------------------- */
@@ -336,6 +400,78 @@ int32_t uSecurityE2eEncrypt(int32_t networkHandle,
  */
 int32_t uSecurityHeartbeatTrigger(int32_t networkHandle);
 
+/* ----------------------------------------------------------------
+ * FUNCTIONS: TLS
+ * -------------------------------------------------------------- */
+
+/** Store a TLS credential (a root CA certificate, a client
+ * certificate or a client private key, PEM or DER format) in the
+ * file store of a module, from where it can be referred to by
+ * name in a TLS security profile.  Any existing credential of the
+ * same type and name is overwritten.
+ *
+ * @param networkHandle  the handle of the instance to be used,
+ *                       e.g. as returned by uNetworkAdd().
+ * @param type           the type of credential.
+ * @param pName          the null-terminated name to store the
+ *                       credential under, no more than
+ *                       U_SECURITY_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES
+ *                       long; cannot be NULL.
+ * @param pData          the credential; cannot be NULL.
+ * @param sizeBytes      the number of bytes at pData.
+ * @param pPassword      the null-terminated password for a
+ *                       private key, NULL if there is none.
+ * @return               zero on success else negative error code.
+ */
+int32_t uSecurityTlsCredentialStore(int32_t networkHandle,
+                                    uSecurityTlsCredentialType_t type,
+                                    const char *pName,
+                                    const char *pData,
+                                    size_t sizeBytes,
+                                    const char *pPassword);
+
+/** Remove a TLS credential from the file store of a module.
+ *
+ * @param networkHandle  the handle of the instance to be used,
+ *                       e.g. as returned by uNetworkAdd().
+ * @param type           the type of credential.
+ * @param pName          the null-terminated name of the
+ *                       credential; cannot be NULL.
+ * @return               zero on success else negative error code.
+ */
+int32_t uSecurityTlsCredentialRemove(int32_t networkHandle,
+                                     uSecurityTlsCredentialType_t type,
+                                     const char *pName);
+
+/** Set up a TLS security profile inside a module.  The profile
+ * is first reset to its defaults and then the fields of pProfile
+ * are applied.  The profile may then be applied to a socket by
+ * setting the socket option U_SOCK_OPT_SEC_PROFILE (level
+ * U_SOCK_OPT_LEVEL_SEC) before the socket is connected, after
+ * which the TLS handshake and record layer are handled entirely
+ * by the module.
+ *
+ * @param networkHandle  the handle of the instance to be used,
+ *                       e.g. as returned by uNetworkAdd().
+ * @param profileId      the ID of the profile, for cellular
+ *                       0 to U_CELL_SEC_TLS_PROFILE_ID_MAX.
+ * @param pProfile       the profile settings; cannot be NULL.
+ * @return               zero on success else negative error code.
+ */
+int32_t uSecurityTlsProfileSet(int32_t networkHandle,
+                               int32_t profileId,
+                               const uSecurityTlsProfile_t *pProfile);
+
+/** Reset a TLS security profile inside a module to its defaults.
+ *
+ * @param networkHandle  the handle of the instance to be used,
+ *                       e.g. as returned by uNetworkAdd().
+ * @param profileId      the ID of the profile.
+ * @return               zero on success else negative error code.
+ */
+int32_t uSecurityTlsProfileReset(int32_t networkHandle,
+                                 int32_t profileId);
+
 #ifdef __cplusplus
 }
 #endif
@@ -96,6 +96,34 @@
  *
  * int32_t uXxxSecHeartbeatTrigger(int32_t handle);
  *
+ * Store a TLS credential in the module (optional):
+ *
+ * int32_t uXxxSecTlsCredentialStore(int32_t handle,
+ *                                   uSecurityTlsCredentialType_t type,
+ *                                   const char *pName,
+ *                                   const char *pData,
+ *                                   size_t sizeBytes,
+ *                                   const char *pPassword);
+ *
+ * Remove a TLS credential from the module (mandatory if
+ * uXxxSecTlsCredentialStore() is implemented):
+ *
+ * int32_t uXxxSecTlsCredentialRemove(int32_t handle,
+ *                                    uSecurityTlsCredentialType_t type,
+ *                                    const char *pName);
+ *
+ * Set up a TLS security profile in the module (optional):
+ *
+ * int32_t uXxxSecTlsProfileSet(int32_t handle,
+ *                              int32_t profileId,
+ *                              const uSecurityTlsProfile_t *pProfile);
+ *
+ * Reset a TLS security profile in the module (mandatory if
+ * uXxxSecTlsProfileSet() is implemented):
+ *
+ * int32_t uXxxSecTlsProfileReset(int32_t handle,
+ *                                int32_t profileId);
+ *
  */
 
 #ifdef U_CFG_OVERRIDE
@@ -105,13 +133,13 @@
 #include "stddef.h"    // NULL, size_t etc.
 #include "stdint.h"    // int32_t etc.
 #include "stdbool.h"
+#include "string.h"    // strlen()
 
 #include "u_error_common.h"
 
-#include "u_cell_sec.h"
-
 #include "u_network_handle.h"
-#include "u_security.h"
+#include "u_security.h" // Order is important here: u_cell_sec.h
+#include "u_cell_sec.h" // uses the types from u_security.h
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
@@ -325,4 +353,92 @@ int32_t uSecurityHeartbeatTrigger(int32_t networkHandle)
     return errorCode;
 }
 
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: TLS
+ * -------------------------------------------------------------- */
+
+// Store a TLS credential in a module.
+int32_t uSecurityTlsCredentialStore(int32_t networkHandle,
+                                    uSecurityTlsCredentialType_t type,
+                                    const char *pName,
+                                    const char *pData,
+                                    size_t sizeBytes,
+                                    const char *pPassword)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (((int32_t) type >= 0) &&
+        (type < U_SECURITY_TLS_CREDENTIAL_MAX_NUM) &&
+        (pName != NULL) &&
+        (strlen(pName) <= U_SECURITY_TLS_CREDENTIAL_NAME_MAX_LENGTH_BYTES) &&
+        (pData != NULL) && (sizeBytes > 0)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+        if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+            errorCode = uCellSecTlsCredentialStore(networkHandle, type,
+                                                   pName, pData,
+                                                   sizeBytes, pPassword);
+        }
+    }
+
+    return errorCode;
+}
+
+// Remove a TLS credential from a module.
+int32_t uSecurityTlsCredentialRemove(int32_t networkHandle,
+                                     uSecurityTlsCredentialType_t type,
+                                     const char *pName)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (((int32_t) type >= 0) &&
+        (type < U_SECURITY_TLS_CREDENTIAL_MAX_NUM) &&
+        (pName != NULL)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+        if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+            errorCode = uCellSecTlsCredentialRemove(networkHandle,
+                                                    type, pName);
+        }
+    }
+
+    return errorCode;
+}
+
+// Set up a TLS security profile in a module.
+int32_t uSecurityTlsProfileSet(int32_t networkHandle,
+                               int32_t profileId,
+                               const uSecurityTlsProfile_t *pProfile)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if ((profileId >= 0) && (pProfile != NULL) &&
+        ((int32_t) pProfile->validation >= 0) &&
+        (pProfile->validation < U_SECURITY_TLS_VALIDATION_MAX_NUM) &&
+        ((int32_t) pProfile->tlsVersionMin >= 0) &&
+        (pProfile->tlsVersionMin < U_SECURITY_TLS_VERSION_MAX_NUM)) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+        if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+            errorCode = uCellSecTlsProfileSet(networkHandle, profileId,
+                                              pProfile);
+        }
+    }
+
+    return errorCode;
+}
+
+// Reset a TLS security profile in a module.
+int32_t uSecurityTlsProfileReset(int32_t networkHandle,
+                                 int32_t profileId)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+
+    if (profileId >= 0) {
+        errorCode = (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+        if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+            errorCode = uCellSecTlsProfileReset(networkHandle, profileId);
+        }
+    }
+
+    return errorCode;
+}
+
 // End of file
@@ -40,6 +40,8 @@
 #include "u_cfg_app_platform_specific.h"
 #include "u_cfg_test_platform_specific.h"
 
+#include "u_error_common.h"
+
 #include "u_port.h"
 #include "u_port_debug.h"
 #include "u_port_os.h"
@@ -678,6 +680,115 @@ U_PORT_TEST_FUNCTION("[security]", "securityE2eEncryption")
     }
 }
 
+/** Test setting up a TLS security profile inside the module and
+ * applying it to a socket.
+ */
+U_PORT_TEST_FUNCTION("[security]", "securityTls")
+{
+    int32_t networkHandle;
+    uSecurityTlsProfile_t profile;
+    uSockDescriptor_t descriptor;
+    int32_t profileId;
+    size_t length;
+    int32_t y;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    memset(&profile, 0, sizeof(profile));
+    profile.validation = U_SECURITY_TLS_VALIDATION_NONE;
+    profile.tlsVersionMin = U_SECURITY_TLS_VERSION_1_2;
+    profile.pServerNameIndication = U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME;
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if (networkHandle >= 0) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            // Parameter checking
+            U_PORT_TEST_ASSERT(uSecurityTlsCredentialStore(networkHandle,
+                                                           U_SECURITY_TLS_CREDENTIAL_ROOT_CA_X509,
+                                                           NULL, gAllChars,
+                                                           sizeof(gAllChars),
+                                                           NULL) < 0);
+            U_PORT_TEST_ASSERT(uSecurityTlsCredentialRemove(networkHandle,
+                                                            U_SECURITY_TLS_CREDENTIAL_MAX_NUM,
+                                                            "ubxlib_test") < 0);
+            U_PORT_TEST_ASSERT(uSecurityTlsProfileSet(networkHandle, 0, NULL) < 0);
+
+            uPortLog("U_SECURITY_TEST: setting up TLS security profile"
+                     " 0 on handle %d...\n", networkHandle);
+            y = uSecurityTlsProfileSet(networkHandle, 0, &profile);
+            if (y != (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED) {
+                U_PORT_TEST_ASSERT(y == 0);
+
+                // The first call to a sockets API needs to
+                // initialise the underlying sockets layer; take
+                // account of that initialisation heap cost here.
+                heapSockInitLoss = uPortGetHeapFree();
+                descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                                         U_SOCK_PROTOCOL_TCP);
+                heapSockInitLoss -= uPortGetHeapFree();
+                U_PORT_TEST_ASSERT(descriptor >= 0);
+
+                // No security to start with
+                length = sizeof(profileId);
+                U_PORT_TEST_ASSERT(uSockOptionGet(descriptor,
+                                                  U_SOCK_OPT_LEVEL_SEC,
+                                                  U_SOCK_OPT_SEC_PROFILE,
+                                                  &profileId, &length) == 0);
+                U_PORT_TEST_ASSERT(length == sizeof(profileId));
+                U_PORT_TEST_ASSERT(profileId == -1);
+
+                // Apply the profile, read it back and then remove it
+                profileId = 0;
+                U_PORT_TEST_ASSERT(uSockOptionSet(descriptor,
+                                                  U_SOCK_OPT_LEVEL_SEC,
+                                                  U_SOCK_OPT_SEC_PROFILE,
+                                                  &profileId,
+                                                  sizeof(profileId)) == 0);
+                profileId = -1;
+                U_PORT_TEST_ASSERT(uSockOptionGet(descriptor,
+                                                  U_SOCK_OPT_LEVEL_SEC,
+                                                  U_SOCK_OPT_SEC_PROFILE,
+                                                  &profileId, &length) == 0);
+                U_PORT_TEST_ASSERT(profileId == 0);
+                profileId = -1;
+                U_PORT_TEST_ASSERT(uSockOptionSet(descriptor,
+                                                  U_SOCK_OPT_LEVEL_SEC,
+                                                  U_SOCK_OPT_SEC_PROFILE,
+                                                  &profileId,
+                                                  sizeof(profileId)) == 0);
+                // An out of range profile ID should be rejected
+                profileId = 100;
+                U_PORT_TEST_ASSERT(uSockOptionSet(descriptor,
+                                                  U_SOCK_OPT_LEVEL_SEC,
+                                                  U_SOCK_OPT_SEC_PROFILE,
+                                                  &profileId,
+                                                  sizeof(profileId)) < 0);
+
+                U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+                uSockCleanUp();
+
+                U_PORT_TEST_ASSERT(uSecurityTlsProfileReset(networkHandle, 0) == 0);
+            }
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SECURITY_TEST: we have leaked %d byte(s).\n",
+                     heapUsed - heapSockInitLoss);
+            // heapUsed < 0 for the Zephyr case where the heap can look
+            // like it increases (negative leak)
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss);
+        }
+    }
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
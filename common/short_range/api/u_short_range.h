@@ -57,7 +57,7 @@ extern "C" {
 #define U_SHORT_RANGE_EVENT_DISCONNECTED 1
 
 #define U_SHORT_RANGE_CONNECTION_TYPE_BT   0
-#define U_SHORT_RANGE_CONNECTION_TYPE_WIFI 0
+#define U_SHORT_RANGE_CONNECTION_TYPE_WIFI 1
 
 /* ----------------------------------------------------------------
  * TYPES
@@ -43,10 +43,43 @@ extern "C" {
 # define U_EDM_STREAM_BT_EVENT_QUEUE_SIZE 1
 #endif
 
+#ifndef U_EDM_STREAM_WIFI_EVENT_QUEUE_SIZE
+# define U_EDM_STREAM_WIFI_EVENT_QUEUE_SIZE 1
+#endif
+
+/** The largest IP address carried in an EDM connect event, IPv6.
+ */
+#define U_EDM_STREAM_IP_ADDRESS_MAX_LENGTH 16
+
 #ifndef U_EDM_STREAM_DATA_EVENT_QUEUE_SIZE
-# define U_EDM_STREAM_DATA_EVENT_QUEUE_SIZE 1
+/* This is also the number of data events that may be waiting
+ * for the data callback before the stream stops parsing.
+ */
+# define U_EDM_STREAM_DATA_EVENT_QUEUE_SIZE 4
 #endif
 
+#ifndef U_EDM_STREAM_TX_BUFFER_SIZE
+/* The size of the buffer, one per stream, in which outgoing data
+ * frames are assembled so that each goes to the UART in a single
+ * write; it is also the most that uShortRangeEdmStreamWriteQueue()
+ * can hold before frames are written.
+ */
+# define U_EDM_STREAM_TX_BUFFER_SIZE 1024
+#endif
+
+#ifndef U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH
+/* The size of the FIFO, one per stream, holding AT responses
+ * and URCs until they are read by the AT client.
+ */
+# define U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH 1024
+#endif
+
+#ifndef U_EDM_STREAM_MAX_NUM_INSTANCES
+/* The number of EDM streams, i.e. short range modules on
+ * separate UARTs, that may be open at the same time.
+ */
+# define U_EDM_STREAM_MAX_NUM_INSTANCES 2
+#endif
 
 #ifndef U_EDM_STREAM_TASK_PRIORITY
 # define U_EDM_STREAM_TASK_PRIORITY (U_CFG_OS_PRIORITY_MAX - 4)
@@ -56,6 +89,25 @@ extern "C" {
  * TYPES
  * -------------------------------------------------------------- */
 
+/** The details of an IP connection, as given in an EDM connect
+ * event, passed to the wifi event callback.
+ */
+typedef struct {
+    int32_t protocol; /**< 0 for TCP, 1 for UDP. */
+    bool ipv6; /**< True if the addresses are IPv6, else IPv4. */
+    uint8_t remoteAddress[U_EDM_STREAM_IP_ADDRESS_MAX_LENGTH]; /**< Most
+                                                                    significant
+                                                                    byte first,
+                                                                    only the first
+                                                                    four bytes
+                                                                    are used
+                                                                    for IPv4. */
+    int32_t remotePort;
+    uint8_t localAddress[U_EDM_STREAM_IP_ADDRESS_MAX_LENGTH]; /**< As
+                                                                   remoteAddress. */
+    int32_t localPort;
+} uShortRangeEdmStreamIpConnection_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS
  * -------------------------------------------------------------- */
@@ -71,7 +123,10 @@ int32_t uShortRangeEdmStreamInit();
 void uShortRangeEdmStreamDeinit();
 
 /** Open an instance. Needs an open UART instance that is not accessed
- * by any other module.
+ * by any other module.  Up to U_EDM_STREAM_MAX_NUM_INSTANCES
+ * instances, each on its own UART, may be open at the same time;
+ * each has its own buffers, event queues and locks so they run
+ * independently of one another.
  *
  * @param uartHandle             the UART HW block to use.
  *
@@ -80,7 +135,8 @@ void uShortRangeEdmStreamDeinit();
  */
 int32_t uShortRangeEdmStreamOpen(int32_t uartHandle);
 
-/** Close a stream.
+/** Close a stream.  This must not be called while another
+ * call on the same handle is in progress.
  *
  * @param handle  the handle of the stream instance to close.
  */
@@ -131,7 +187,11 @@ int32_t uShortRangeEdmStreamAtRead(int32_t handle, void *pBuffer,
                                    size_t sizeBytes);
 
 /** Write to the given interface on given channel.  Will block until
- * all of the data has been written or an error has occurred.
+ * all of the data has been written or an error has occurred.  Any
+ * data already queued with uShortRangeEdmStreamWriteQueue() is
+ * written first.  On error, any frames that could not be written
+ * in full are dropped and counted, see
+ * uShortRangeEdmStreamTxDroppedCountGet().
  *
  * @param handle    the handle of the stream instance.
  * @param channel   the number of for the connection channel given in
@@ -144,6 +204,36 @@ int32_t uShortRangeEdmStreamAtRead(int32_t handle, void *pBuffer,
 int32_t uShortRangeEdmStreamWrite(int32_t handle, int32_t channel,
                                   const void *pBuffer, size_t sizeBytes);
 
+/** Queue data for the given channel without writing it, so that
+ * the frames for several writes, which may be on different
+ * channels, go to the UART together when
+ * uShortRangeEdmStreamWriteFlush() is called.  If the queue, of
+ * U_EDM_STREAM_TX_BUFFER_SIZE bytes including EDM overhead, fills
+ * up then what is in it is written straight away, with a write
+ * error being handled as for uShortRangeEdmStreamWriteFlush().
+ *
+ * @param handle    the handle of the stream instance.
+ * @param channel   the number of for the connection channel given in
+ *                  the connected event callback.
+ * @param pBuffer   a pointer to a buffer of data to send.
+ * @param sizeBytes the number of bytes in pBuffer.
+ * @return          the number of bytes queued or negative
+ *                  error code.
+ */
+int32_t uShortRangeEdmStreamWriteQueue(int32_t handle, int32_t channel,
+                                       const void *pBuffer, size_t sizeBytes);
+
+/** Write everything queued with uShortRangeEdmStreamWriteQueue().
+ * Will block until all of the data has been written or an error
+ * has occurred; either way the queue is empty afterwards.  On
+ * error, the frames that could not be written in full are dropped
+ * and counted, see uShortRangeEdmStreamTxDroppedCountGet().
+ *
+ * @param handle    the handle of the stream instance.
+ * @return          zero on success else negative error code.
+ */
+int32_t uShortRangeEdmStreamWriteFlush(int32_t handle);
+
 /** Set a callback to be called when an AT event occurs.
  * pFunction will be called asynchronously in its own task.
  *
@@ -184,22 +274,37 @@ int32_t uShortRangeEdmStreamAtCallbackSet(int32_t handle,
  */
 void uShortRangeEdmStreamAtCallbackRemove(int32_t handle);
 
-/** Set a callback to be called when an wifi event occurs.
- * pFunction will be called asynchronously in its own task.
+/** Set a callback to be called when a wifi event occurs, i.e.
+ * when an IP connection over an EDM channel is made or ends.
+ * pFunction will be called asynchronously in its own task with
+ * the handle of the stream instance, the event type (0 for
+ * connected, 1 for disconnected), the EDM channel and, for a
+ * connect event only, the details of the connection (NULL for
+ * a disconnect event).  Use NULL for pFunction to remove the
+ * callback.
  *
  * @param handle           the handle of the stream instance.
- * @param pFunction        the function to call, cannot be
- *                         NULL.
+ * @param pFunction        the function to call.
  * @param pParam           a parameter which will be passed
  *                         to pFunction as its last parameter
  *                         when it is called.
+ * @param stackSizeBytes   the number of bytes of stack for
+ *                         the task in which pFunction is
+ *                         called, must be at least
+ *                         U_PORT_EVENT_QUEUE_MIN_TASK_STACK_SIZE_BYTES.
+ * @param priority         the priority of the task in which
+ *                         pFunction is called, see
+ *                         uShortRangeEdmStreamBtEventCallbackSet().
  * @return                 zero on success else negative error
  *                         code.
  */
 int32_t uShortRangeEdmStreamWifiEventCallbackSet(int32_t handle,
-                                                 void (*pFunction)(int32_t, uint32_t,
+                                                 void (*pFunction)(int32_t, uint32_t, uint32_t,
+                                                                   const uShortRangeEdmStreamIpConnection_t *,
                                                                    void *),
-                                                 void *pParam);
+                                                 void *pParam,
+                                                 size_t stackSizeBytes,
+                                                 int32_t priority);
 
 /** Remove a wifi event callback.
  *
@@ -305,6 +410,64 @@ void uShortRangeEdmStreamDataCallbackRemove(int32_t handle);
  */
 int32_t uShortRangeEdmStreamAtEventSend(int32_t handle, uint32_t eventBitMap);
 
+/** Get the number of times the stream has had to stop parsing
+ * incoming data because data events had not yet been dealt
+ * with by the data callback: either all of the UART buffers
+ * had data events pointing into them or the data event queue
+ * was full.  A steadily rising count means that a data callback
+ * is too slow.
+ *
+ * @param handle  the handle of the stream instance.
+ * @return        the count, else negative error code.
+ */
+int32_t uShortRangeEdmStreamBufferExhaustedCountGet(int32_t handle);
+
+/** Get the number of times the stream has lost track of the
+ * EDM frames coming from the module, e.g. because of noise on
+ * the UART, and had to look for the start of the next frame.
+ * Frames lost this way are not recovered, so a rising count
+ * means a poor link.
+ *
+ * @param handle  the handle of the stream instance.
+ * @return        the count, else negative error code.
+ */
+int32_t uShortRangeEdmStreamResyncCountGet(int32_t handle);
+
+/** Get the number of bytes received from the module that the
+ * stream has thrown away because they were not part of a valid
+ * EDM frame.
+ *
+ * @param handle  the handle of the stream instance.
+ * @return        the count, else negative error code.
+ */
+int32_t uShortRangeEdmStreamDiscardedCountGet(int32_t handle);
+
+/** Get the number of EDM data frames that the stream has dropped
+ * because writing them to the UART failed part way through.
+ * The write that failed will have returned an error but the data
+ * in a dropped frame may have been queued by an earlier call to
+ * uShortRangeEdmStreamWriteQueue() that succeeded.
+ *
+ * @param handle  the handle of the stream instance.
+ * @return        the count, else negative error code.
+ */
+int32_t uShortRangeEdmStreamTxDroppedCountGet(int32_t handle);
+
+/** Get the number of data bytes sent and received on an EDM
+ * channel since it was connected.
+ *
+ * @param handle    the handle of the stream instance.
+ * @param channel   the EDM channel.
+ * @param pTxBytes  a place to put the number of bytes sent,
+ *                  may be NULL.
+ * @param pRxBytes  a place to put the number of bytes received,
+ *                  may be NULL.
+ * @return          zero on success else negative error code,
+ *                  e.g. if the channel is not connected.
+ */
+int32_t uShortRangeEdmStreamChannelStatsGet(int32_t handle, int32_t channel,
+                                            uint32_t *pTxBytes, uint32_t *pRxBytes);
+
 /** Get the stack high watermark, i.e. the minimum amount of
  * free stack, in bytes, for the task at the end of the event
  * queue.
@@ -48,6 +48,7 @@
 
 #include "u_short_range_module_type.h"
 #include "u_short_range.h"
+#include "u_short_range_edm.h"
 #include "u_short_range_private.h"
 #include "u_short_range_edm_stream.h"
 
@@ -93,24 +94,6 @@ static const uShortRangeStringToModule_t stringToModule[] = {
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
 
-// Find a connHandle, or use -1 for a free spot
-static int32_t findFreeConnection(const uShortRangePrivateInstance_t *pInstance, int32_t connHandle)
-{
-    int32_t i;
-
-    for (i = 0; i < U_SHORT_RANGE_MAX_CONNECTIONS; i++) {
-        if (pInstance->connections[i].connHandle == connHandle) {
-            break;
-        }
-    }
-
-    if (i == U_SHORT_RANGE_MAX_CONNECTIONS) {
-        i = -1;
-    }
-
-    return i;
-}
-
 // Find a short range instance in the list by AT handle.
 // gUShortRangePrivateMutex should be locked before this is called.
 //lint -e{818} suppress "could be declared as pointing to const": atHandle is anonymous
@@ -200,17 +183,20 @@ static void UUDPC_urc(uAtClientHandle_t atHandle,
                       void *pParameter)
 {
     uShortRangePrivateInstance_t *pInstance = (uShortRangePrivateInstance_t *) pParameter;
+    uShortRangeEdmConnection_t *pConnection;
     int32_t connHandle;
     int32_t type;
 
     connHandle = uAtClientReadInt(atHandle);
     type = uAtClientReadInt(atHandle);
 
-    int32_t id = findFreeConnection(pInstance, -1);
-
-    if (id != -1) {
-        pInstance->connections[id].connHandle = connHandle;
-        pInstance->connections[id].type = type;
+    pConnection = pUShortRangeEdmConnectionAdd(&pInstance->connections, connHandle, type);
+    if (pConnection == NULL) {
+        // The disconnect could not be matched up with the connection
+        // so don't report the connection either
+        uPortLog("U_SHORT_RANGE: can't track peer handle %d (table full"
+                 " or handle out of range), connection not reported.\n",
+                 connHandle);
     }
 
     if (type == (int32_t)U_SHORT_RANGE_UUDPC_TYPE_BT) {
@@ -219,13 +205,16 @@ static void UUDPC_urc(uAtClientHandle_t atHandle,
         (void)uAtClientReadString(atHandle, address, U_SHORT_RANGE_BT_ADDRESS_SIZE, false);
         (void)uAtClientReadInt(atHandle);
 
-        if (pInstance->pBtConnectionStatusCallback != NULL) {
+        if ((pConnection != NULL) && (pInstance->pBtConnectionStatusCallback != NULL)) {
             pInstance->pBtConnectionStatusCallback(connHandle, U_SHORT_RANGE_EVENT_CONNECTED,
                                                    pInstance->pBtConnectionStatusCallbackParameter);
         }
     } else if (type == U_SHORT_RANGE_UUDPC_TYPE_IPv4 ||
                type == U_SHORT_RANGE_UUDPC_TYPE_IPv6) {
-
+        if ((pConnection != NULL) && (pInstance->pWifiConnectionStatusCallback != NULL)) {
+            pInstance->pWifiConnectionStatusCallback(connHandle, U_SHORT_RANGE_EVENT_CONNECTED,
+                                                     pInstance->pWifiConnectionStatusCallbackParameter);
+        }
     }
 }
 
@@ -239,21 +228,24 @@ static void UUDPD_urc(uAtClientHandle_t atHandle,
 
     connHandle = uAtClientReadInt(atHandle);
 
-    int32_t id = findFreeConnection(pInstance, connHandle);
+    uShortRangeEdmConnection_t *pConnection = pUShortRangeEdmConnectionGet(&pInstance->connections,
+                                                                           connHandle);
 
-    if (id != -1) {
-        if (pInstance->connections[id].type == (int32_t)U_SHORT_RANGE_UUDPC_TYPE_BT) {
+    if (pConnection != NULL) {
+        if (pConnection->type == (int32_t)U_SHORT_RANGE_UUDPC_TYPE_BT) {
             if (pInstance->pBtConnectionStatusCallback != NULL) {
                 pInstance->pBtConnectionStatusCallback(connHandle, U_SHORT_RANGE_EVENT_DISCONNECTED,
                                                        pInstance->pBtConnectionStatusCallbackParameter);
             }
-        } else if (pInstance->connections[id].type == U_SHORT_RANGE_UUDPC_TYPE_IPv4 ||
-                   pInstance->connections[id].type == U_SHORT_RANGE_UUDPC_TYPE_IPv6) {
-
+        } else if (pConnection->type == U_SHORT_RANGE_UUDPC_TYPE_IPv4 ||
+                   pConnection->type == U_SHORT_RANGE_UUDPC_TYPE_IPv6) {
+            if (pInstance->pWifiConnectionStatusCallback != NULL) {
+                pInstance->pWifiConnectionStatusCallback(connHandle, U_SHORT_RANGE_EVENT_DISCONNECTED,
+                                                         pInstance->pWifiConnectionStatusCallbackParameter);
+            }
         }
 
-        pInstance->connections[id].connHandle = -1;
-        pInstance->connections[id].type = -1;
+        uShortRangeEdmConnectionRemove(&pInstance->connections, connHandle);
     }
 }
 
@@ -416,10 +408,7 @@ int32_t uShortRangeAdd(uShortRangeModuleType_t moduleType,
                     gNextInstanceHandle = 0;
                 }
 
-                for (int32_t i = 0; i < U_SHORT_RANGE_MAX_CONNECTIONS; i++) {
-                    pInstance->connections[i].connHandle = -1;
-                    pInstance->connections[i].type = -1;
-                }
+                uShortRangeEdmConnectionTableInit(&pInstance->connections);
 
                 pInstance->atHandle = atHandle;
                 pInstance->mode = U_SHORT_RANGE_MODE_COMMAND;
@@ -28,8 +28,6 @@
 #define U_SHORT_RANGE_EDM_SIZE_HEAD               1
 #define U_SHORT_RANGE_EDM_SIZE_TAIL               1
 #define U_SHORT_RANGE_EDM_SIZE_LENGTH             2
-#define U_SHORT_RANGE_EDM_HEAD                    0xAA
-#define U_SHORT_RANGE_EDM_TAIL                    0x55
 #define U_SHORT_RANGE_EDM_LENGTH_FILTER           0x0F
 
 #define U_SHORT_RANGE_EDM_TYPE_CONNECT_EVENT      0x11
@@ -327,3 +325,64 @@ int32_t uShortRangeEdmZeroCopyTail(char *pTail)
     return 1;
 }
 
+
+void uShortRangeEdmConnectionTableInit(uShortRangeEdmConnectionTable_t *pTable)
+{
+    memset(pTable->index, 0, sizeof(pTable->index));
+    for (size_t i = 0; i < U_SHORT_RANGE_EDM_MAX_CONNECTIONS; i++) {
+        pTable->connections[i].id = -1;
+        pTable->connections[i].type = -1;
+        pTable->connections[i].frameSize = -1;
+    }
+}
+
+uShortRangeEdmConnection_t *pUShortRangeEdmConnectionGet(uShortRangeEdmConnectionTable_t *pTable,
+                                                         int32_t id)
+{
+    uShortRangeEdmConnection_t *pConnection = NULL;
+
+    if ((id >= 0) && (id < U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS) && (pTable->index[id] > 0)) {
+        pConnection = &pTable->connections[pTable->index[id] - 1];
+    }
+
+    return pConnection;
+}
+
+uShortRangeEdmConnection_t *pUShortRangeEdmConnectionAdd(uShortRangeEdmConnectionTable_t *pTable,
+                                                         int32_t id, int32_t type)
+{
+    uShortRangeEdmConnection_t *pConnection = pUShortRangeEdmConnectionGet(pTable, id);
+
+    if ((pConnection == NULL) && (id >= 0) && (id < U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS)) {
+        // Only connecting needs a search, for a free entry
+        for (size_t i = 0; (i < U_SHORT_RANGE_EDM_MAX_CONNECTIONS) && (pConnection == NULL); i++) {
+            if (pTable->connections[i].id < 0) {
+                pConnection = &pTable->connections[i];
+                pTable->index[id] = (uint8_t) (i + 1);
+            }
+        }
+    }
+
+    if (pConnection != NULL) {
+        pConnection->id = id;
+        pConnection->type = type;
+        pConnection->frameSize = -1;
+        pConnection->txBytes = 0;
+        pConnection->rxBytes = 0;
+    }
+
+    return pConnection;
+}
+
+void uShortRangeEdmConnectionRemove(uShortRangeEdmConnectionTable_t *pTable, int32_t id)
+{
+    uShortRangeEdmConnection_t *pConnection = pUShortRangeEdmConnectionGet(pTable, id);
+
+    if (pConnection != NULL) {
+        pConnection->id = -1;
+        pConnection->type = -1;
+        pConnection->frameSize = -1;
+        pTable->index[id] = 0;
+    }
+}
+
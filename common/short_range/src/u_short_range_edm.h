@@ -26,6 +26,9 @@
 #define U_SHORT_RANGE_EDM_ERROR_SIZE          -5
 #define U_SHORT_RANGE_EDM_ERROR_CORRUPTED     -6
 
+#define U_SHORT_RANGE_EDM_HEAD                0xAA
+#define U_SHORT_RANGE_EDM_TAIL                0x55
+
 #define U_SHORT_RANGE_EDM_BT_ADDRESS_LENGTH   6
 #define U_SHORT_RANGE_EDM_IPv4_ADDRESS_LENGTH 4
 #define U_SHORT_RANGE_EDM_IPv6_ADDRESS_LENGTH 16
@@ -47,6 +50,16 @@
 //lint -esym(755, U_SHORT_RANGE_EDM_MTU_IP_MAX_SIZE) Suppress lack of a reference
 #define U_SHORT_RANGE_EDM_MTU_IP_MAX_SIZE     635
 
+/** The number of connections a connection table can hold.
+ */
+#define U_SHORT_RANGE_EDM_MAX_CONNECTIONS     9
+
+/** The number of IDs a connection table can look up directly:
+ * EDM channels are a single byte, as are the peer handles the
+ * module gives out in practice.
+ */
+#define U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS  256
+
 
 typedef enum {
     U_SHORT_RANGE_EDM_BT_PROFILE_SPP,
@@ -124,6 +137,31 @@ typedef struct uShortRangeEdmEvent_t {
     } params;
 } uShortRangeEdmEvent_t;
 
+/** A connection in a connection table.
+ */
+typedef struct uShortRangeEdmConnection_t {
+    int32_t id;        /**< the EDM channel or peer handle, -1 if free. */
+    int32_t type;      /**< connection type, meaning up to the user. */
+    int32_t frameSize; /**< the frame size, -1 if not known. */
+    uint32_t txBytes;  /**< bytes sent since the connection was made. */
+    uint32_t rxBytes;  /**< bytes received since the connection was made. */
+} uShortRangeEdmConnection_t;
+
+/** A table of connections, looked up directly by ID so that
+ * finding the connection for a frame doesn't depend on how many
+ * connections there are.  Used by the EDM stream, where the ID
+ * is the EDM channel, and by the short range instance, where it
+ * is the peer handle.
+ */
+typedef struct uShortRangeEdmConnectionTable_t {
+    uint8_t index[U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS]; /**< one more than
+                                                              the entry in
+                                                              connections[]
+                                                              for an ID, 0
+                                                              for none. */
+    uShortRangeEdmConnection_t connections[U_SHORT_RANGE_EDM_MAX_CONNECTIONS];
+} uShortRangeEdmConnectionTable_t;
+
 /**
  *
  * @brief Function for parsing binary EDM data into the event structure
@@ -244,4 +282,49 @@ int32_t uShortRangeEdmZeroCopyHeadData(uint8_t channel, uint32_t size, char *pHe
  */
 int32_t uShortRangeEdmZeroCopyTail(char *pTail);
 
+/**
+ *
+ * @brief Empties a connection table.
+ *
+ * @param[out] pTable Pointer to the connection table.
+ */
+void uShortRangeEdmConnectionTableInit(uShortRangeEdmConnectionTable_t *pTable);
+
+/**
+ *
+ * @brief Finds the connection with the given ID in a connection table.
+ *
+ * @param[in] pTable Pointer to the connection table.
+ * @param id The EDM channel or peer handle.
+ *
+ * @retval Pointer to the connection, NULL if there is none with this ID.
+ */
+uShortRangeEdmConnection_t *pUShortRangeEdmConnectionGet(uShortRangeEdmConnectionTable_t *pTable,
+                                                         int32_t id);
+
+/**
+ *
+ * @brief Adds a connection to a connection table, or returns the existing
+ *        connection if there is already one with this ID.  The statistics
+ *        of a new connection start at zero and its frame size at -1.
+ *
+ * @param[in] pTable Pointer to the connection table.
+ * @param id The EDM channel or peer handle.
+ * @param type The connection type.
+ *
+ * @retval Pointer to the connection, NULL if the table is full or the ID
+ *         is out of range.
+ */
+uShortRangeEdmConnection_t *pUShortRangeEdmConnectionAdd(uShortRangeEdmConnectionTable_t *pTable,
+                                                         int32_t id, int32_t type);
+
+/**
+ *
+ * @brief Removes a connection from a connection table, if it is there.
+ *
+ * @param[in] pTable Pointer to the connection table.
+ * @param id The EDM channel or peer handle.
+ */
+void uShortRangeEdmConnectionRemove(uShortRangeEdmConnectionTable_t *pTable, int32_t id);
+
 #endif
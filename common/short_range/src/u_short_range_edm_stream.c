@@ -44,17 +44,19 @@
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
-#ifndef U_SHORT_RANGE_EDM_STREAM_UART_RETRIES
-#define U_SHORT_RANGE_EDM_STREAM_UART_RETRIES       1
-#endif
-#ifndef U_SHORT_RANGE_EDM_STREAM_UART_RETRY_TIMEOUT
-#define U_SHORT_RANGE_EDM_STREAM_UART_RETRY_TIMEOUT 1
-#endif
-
 #define U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE        0x1001
+// The smallest EDM payload: identifier and type
+#define U_SHORT_RANGE_EDM_STREAM_MIN_PAYLOAD_LENGTH 2
+#ifndef U_SHORT_RANGE_EDM_STREAM_NUM_BUFFERS
+// The number of UART buffers: while data events point into one
+// the parser carries on in another
+#define U_SHORT_RANGE_EDM_STREAM_NUM_BUFFERS        2
+#endif
 #define U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH  200
-#define U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH 200
-#define U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS    9
+
+#if U_EDM_STREAM_TX_BUFFER_SIZE <= U_SHORT_RANGE_EDM_DATA_OVERHEAD
+# error U_EDM_STREAM_TX_BUFFER_SIZE must be larger than U_SHORT_RANGE_EDM_DATA_OVERHEAD.
+#endif
 
 /* ----------------------------------------------------------------
  * TYPES
@@ -78,6 +80,7 @@ typedef enum {
 } uShortRangeEdmStreamConnectionEvent_t;
 
 typedef struct uShortRangeEdmStreamBtEvent_t {
+    struct uEdmStreamInstance_t *pInstance;
     uShortRangeEdmStreamConnectionEvent_t type;
     uint32_t channel;
     bool ble;
@@ -85,103 +88,278 @@ typedef struct uShortRangeEdmStreamBtEvent_t {
     uint32_t frameSize;
 } uShortRangeEdmStreamBtEvent_t;
 
+typedef struct uShortRangeEdmStreamWifiEvent_t {
+    struct uEdmStreamInstance_t *pInstance;
+    uShortRangeEdmStreamConnectionEvent_t type;
+    uint32_t channel;
+    uShortRangeEdmStreamIpConnection_t connection; // Only for a connect event
+} uShortRangeEdmStreamWifiEvent_t;
+
 typedef struct uShortRangeEdmStreamDataEvent_t {
+    struct uEdmStreamInstance_t *pInstance;
     int32_t channel;
     char *pData;
     int32_t length;
+    int32_t buffer; // Index of the UART buffer pData points into
 } uShortRangeEdmStreamDataEvent_t;
 
-typedef struct uShortRangeEdmStreamConnections_t {
-    int32_t channel;
-    uShortRangeEdmStreamConnectionType_t type;
-    int32_t frameSize;
-} uShortRangeEdmStreamConnections_t;
+typedef struct uShortRangeEdmStreamBuffer_t {
+    char *pData;
+    int32_t refCount; // Number of data events pointing into pData
+} uShortRangeEdmStreamBuffer_t;
 
 typedef struct uEdmStreamInstance_t {
     int32_t handle;
+    uPortMutexHandle_t mutex; // Serialises the API calls for this instance
+    // Protects the reference counts of the UART buffers and the AT
+    // response FIFO, kept apart from mutex so that the parser and
+    // the data event task never wait on the API
+    uPortMutexHandle_t bufferMutex;
     int32_t uartHandle;
     void *atHandle;
     int32_t atEventQueueHandle;
     int32_t btEventQueueHandle;
+    int32_t wifiEventQueueHandle;
     int32_t dataEventQueueHandle;
     void (*pAtCallback)(int32_t, uint32_t, void *);
     void *pAtCallbackParam;
     void (*pBtEventCallback)(int32_t, uint32_t, uint32_t, bool, int32_t, char *, void *);
     void *pBtEventCallbackParam;
-    //void (*pWifiEventCallback)(int32_t, uint32_t, void *);
-    //void *pWifiEventCallbackParam;
+    void (*pWifiEventCallback)(int32_t, uint32_t, uint32_t,
+                               const uShortRangeEdmStreamIpConnection_t *, void *);
+    void *pWifiEventCallbackParam;
     void (*pBtDataCallback)(int32_t, int32_t, int32_t, char *, void *);
     void *pBtDataCallbackParam;
     void (*pWifiDataCallback)(int32_t, int32_t, int32_t, char *, void *);
     void *pWifiDataCallbackParam;
     bool uartBufferAvailable;
-    char *pUartBuffer;
+    char *pUartBuffer; // The buffer in buffers[] being filled
+    int32_t currentBuffer;
+    uShortRangeEdmStreamBuffer_t buffers[U_SHORT_RANGE_EDM_STREAM_NUM_BUFFERS];
+    int32_t dataEventsPending; // Total of the reference counts
+    bool bufferWait; // Stopped until a data event is done
+    int32_t bufferExhaustedCount;
+    size_t uartBufferStart; // Start of the bytes not yet parsed
+    size_t uartBufferEnd;   // End of the bytes read from the UART
+    uShortRangeEdmStreamParseState_t parseState;
+    size_t parseLength;     // Length of the frame being parsed
+    bool resyncing;         // Bytes thrown away since the last good frame
+    int32_t resyncCount;
+    int32_t discardedCount; // Bytes thrown away while resyncing
+    char *pTxBuffer;        // Data frames waiting to be written
+    size_t txBufferLength;
+    int32_t txDroppedCount; // Frames not written in full
     char *pAtCommandBuffer;
     int32_t atCommandCurrent;
-    char *pAtResponseBuffer;
-    int32_t atResponseLength;
-    int32_t atResponseRead;
-    uShortRangeEdmStreamConnections_t connections[U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS];
+    char *pAtResponseBuffer; // FIFO of AT responses and URCs
+    size_t atResponseIn;     // Where the next byte is written
+    size_t atResponseOut;    // Where the next byte is read from
+    size_t atResponseCount;  // Number of bytes in the FIFO
+    bool atResponseWait;     // Stopped until there is room in the FIFO
+    uShortRangeEdmConnectionTable_t connections; // By EDM channel
 } uShortRangeEdmStreamInstance_t;
 
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
 
+// Protects gpEdmStream[] only: it is held just long enough to
+// look up an instance and never on the data path.
 static uPortMutexHandle_t gMutex = NULL;
-static uShortRangeEdmStreamInstance_t gEdmStream;
+// The instances, indexed by handle.
+static uShortRangeEdmStreamInstance_t *gpEdmStream[U_EDM_STREAM_MAX_NUM_INSTANCES] = {NULL};
 
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
-static void fillBuffer(void);
+static void fillBuffer(uShortRangeEdmStreamInstance_t *pInstance);
 static void flushUart(int32_t uartHandle);
 
-// Find connection from channel, use -1 to get the first free slot
-static uShortRangeEdmStreamConnections_t *findConnection(int32_t channel)
+// Drop a reference to a UART buffer, returning true if the
+// parser was waiting for this and should be woken up.
+static bool releaseBuffer(uShortRangeEdmStreamInstance_t *pInstance,
+                          int32_t buffer)
+{
+    bool wake = false;
+
+    U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+    if ((buffer >= 0) && (buffer < U_SHORT_RANGE_EDM_STREAM_NUM_BUFFERS) &&
+        (pInstance->buffers[buffer].refCount > 0)) {
+        pInstance->buffers[buffer].refCount--;
+        pInstance->dataEventsPending--;
+        if (pInstance->bufferWait) {
+            pInstance->bufferWait = false;
+            pInstance->uartBufferAvailable = true;
+            wake = true;
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+
+    return wake;
+}
+
+// Add an AT payload to the AT response FIFO, returning false if
+// there is not yet room for it, in which case parsing stops until
+// the AT client has read enough.  A payload larger than the whole
+// FIFO is truncated.
+static bool atResponsePut(uShortRangeEdmStreamInstance_t *pInstance,
+                          const char *pData, size_t length)
 {
-    uShortRangeEdmStreamConnections_t *pConnection = NULL;
+    bool success = false;
+    size_t x;
 
-    for (uint32_t i = 0; i < U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS; i++) {
-        if (gEdmStream.connections[i].channel == channel) {
-            pConnection = &gEdmStream.connections[i];
-            break;
+    if (length > U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH) {
+        length = U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH;
+    }
+
+    U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+    if (pInstance->atResponseCount + length <= U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH) {
+        // Copy up to the end of the FIFO and then any remainder
+        // to the start
+        x = U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH - pInstance->atResponseIn;
+        if (x > length) {
+            x = length;
         }
+        memcpy(pInstance->pAtResponseBuffer + pInstance->atResponseIn, pData, x);
+        memcpy(pInstance->pAtResponseBuffer, pData + x, length - x);
+        pInstance->atResponseIn = (pInstance->atResponseIn + length) %
+                                  U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH;
+        pInstance->atResponseCount += length;
+        success = true;
+    } else {
+        pInstance->atResponseWait = true;
+        pInstance->uartBufferAvailable = false;
     }
 
-    return pConnection;
+    U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+
+    return success;
+}
+
+// Read up to length bytes from the AT response FIFO, returning
+// the number read and setting *pWake to true if the parser was
+// waiting for room and should be woken up.
+static size_t atResponseGet(uShortRangeEdmStreamInstance_t *pInstance,
+                            char *pData, size_t length, bool *pWake)
+{
+    size_t x;
+
+    U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+    if (length > pInstance->atResponseCount) {
+        length = pInstance->atResponseCount;
+    }
+    x = U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH - pInstance->atResponseOut;
+    if (x > length) {
+        x = length;
+    }
+    memcpy(pData, pInstance->pAtResponseBuffer + pInstance->atResponseOut, x);
+    memcpy(pData + x, pInstance->pAtResponseBuffer, length - x);
+    pInstance->atResponseOut = (pInstance->atResponseOut + length) %
+                               U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH;
+    pInstance->atResponseCount -= length;
+    *pWake = false;
+    if (pInstance->atResponseWait && (length > 0)) {
+        pInstance->atResponseWait = false;
+        pInstance->uartBufferAvailable = true;
+        *pWake = true;
+    }
+
+    U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+
+    return length;
+}
+
+// Stop parsing until a data event is done; this is the pool
+// being exhausted and is counted as such.
+// pInstance->bufferMutex must be locked before calling this function.
+static void waitBuffer(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    if (!pInstance->bufferWait) {
+        pInstance->bufferWait = true;
+        pInstance->bufferExhaustedCount++;
+    }
+    pInstance->uartBufferAvailable = false;
+}
+
+// Throw away bytes at the start of the unparsed part of the
+// UART buffer, counting a resync if they are the first since
+// a good frame.
+static void discard(uShortRangeEdmStreamInstance_t *pInstance, size_t length)
+{
+    pInstance->uartBufferStart += length;
+    pInstance->parseState = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_HEADER;
+
+    U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+    if (!pInstance->resyncing) {
+        pInstance->resyncing = true;
+        pInstance->resyncCount++;
+    }
+    pInstance->discardedCount += (int32_t) length;
+
+    U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
 }
 
 // Event handler, calls the user's event callback.
 static void atEventHandler(void *pParam, size_t paramLength)
 {
-    (void) pParam;
+    uShortRangeEdmStreamInstance_t *pInstance = *((uShortRangeEdmStreamInstance_t **) pParam);
+
     (void) paramLength;
 
-    if (gEdmStream.pAtCallback != NULL) {
-        gEdmStream.pAtCallback(gEdmStream.handle,
+    if (pInstance->pAtCallback != NULL) {
+        pInstance->pAtCallback(pInstance->handle,
                                U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
-                               gEdmStream.pAtCallbackParam);
+                               pInstance->pAtCallbackParam);
     }
 }
 
 static void btEventHandler(void *pParam, size_t paramLength)
 {
     uShortRangeEdmStreamBtEvent_t *pBtEvent = (uShortRangeEdmStreamBtEvent_t *) pParam;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
     (void) paramLength;
 
     if (pBtEvent != NULL) {
-        if (gEdmStream.pBtEventCallback != NULL) {
-            gEdmStream.pBtEventCallback(gEdmStream.handle, (uint32_t) pBtEvent->type, pBtEvent->channel,
+        pInstance = pBtEvent->pInstance;
+        if (pInstance->pBtEventCallback != NULL) {
+            pInstance->pBtEventCallback(pInstance->handle, (uint32_t) pBtEvent->type, pBtEvent->channel,
                                         pBtEvent->ble, (int32_t) pBtEvent->frameSize, (char *)&pBtEvent->address[0],
-                                        gEdmStream.pBtEventCallbackParam);
+                                        pInstance->pBtEventCallbackParam);
         }
+
+        pInstance->uartBufferAvailable = true;
+        uPortUartEventSend(pInstance->uartHandle,
+                           U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED);
     }
+}
+
+static void wifiEventHandler(void *pParam, size_t paramLength)
+{
+    uShortRangeEdmStreamWifiEvent_t *pWifiEvent = (uShortRangeEdmStreamWifiEvent_t *) pParam;
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    (void) paramLength;
 
-    gEdmStream.uartBufferAvailable = true;
-    uPortUartEventSend(gEdmStream.uartHandle,
-                       U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED);
+    if (pWifiEvent != NULL) {
+        pInstance = pWifiEvent->pInstance;
+        if (pInstance->pWifiEventCallback != NULL) {
+            pInstance->pWifiEventCallback(pInstance->handle, (uint32_t) pWifiEvent->type,
+                                          pWifiEvent->channel,
+                                          (pWifiEvent->type == U_SHORT_RANGE_EDM_STREAM_CONNECTED) ?
+                                          &pWifiEvent->connection : NULL,
+                                          pInstance->pWifiEventCallbackParam);
+        }
+
+        pInstance->uartBufferAvailable = true;
+        uPortUartEventSend(pInstance->uartHandle,
+                           U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED);
+    }
 }
 
 static void dataEventHandler(void *pParam, size_t paramLength)
@@ -191,191 +369,377 @@ static void dataEventHandler(void *pParam, size_t paramLength)
     (void) paramLength;
 
     if (pDataEvent != NULL) {
-        uShortRangeEdmStreamConnections_t *pConnection = findConnection(pDataEvent->channel);
+        uShortRangeEdmStreamInstance_t *pInstance = pDataEvent->pInstance;
+        uShortRangeEdmConnection_t *pConnection = pUShortRangeEdmConnectionGet(&pInstance->connections,
+                                                                               pDataEvent->channel);
 
-        if (pConnection != NULL && pConnection->type == U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) {
-            if (gEdmStream.pBtDataCallback != NULL) {
-                gEdmStream.pBtDataCallback(gEdmStream.handle, pDataEvent->channel, pDataEvent->length,
-                                           pDataEvent->pData, gEdmStream.pBtDataCallbackParam);
+        if (pConnection != NULL) {
+            pConnection->rxBytes += (uint32_t) pDataEvent->length;
+        }
+        if (pConnection != NULL && pConnection->type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) {
+            if (pInstance->pBtDataCallback != NULL) {
+                pInstance->pBtDataCallback(pInstance->handle, pDataEvent->channel, pDataEvent->length,
+                                           pDataEvent->pData, pInstance->pBtDataCallbackParam);
             }
         } else if (pConnection != NULL &&
-                   pConnection->type == U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI) {
-            if (gEdmStream.pWifiDataCallback != NULL) {
-                gEdmStream.pWifiDataCallback(gEdmStream.handle, pDataEvent->channel, pDataEvent->length,
-                                             pDataEvent->pData, gEdmStream.pWifiDataCallbackParam);
+                   pConnection->type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI) {
+            if (pInstance->pWifiDataCallback != NULL) {
+                pInstance->pWifiDataCallback(pInstance->handle, pDataEvent->channel, pDataEvent->length,
+                                             pDataEvent->pData, pInstance->pWifiDataCallbackParam);
             }
         }
-    }
 
-    gEdmStream.uartBufferAvailable = true;
-    uPortUartEventSend(gEdmStream.uartHandle,
-                       U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED);
+        // Done with the data, release the UART buffer and, if the
+        // parser was waiting for one, wake it up
+        if (releaseBuffer(pInstance, pDataEvent->buffer)) {
+            uPortUartEventSend(pInstance->uartHandle,
+                               U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED);
+        }
+    }
 }
 
 static void uartCallback(int32_t uartHandle, uint32_t eventBitmask,
                          void *pParameters)
 {
-    (void)pParameters;
-    if (gEdmStream.uartHandle == uartHandle &&
-        eventBitmask == U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED) {
-        if (gEdmStream.uartBufferAvailable) {
-            fillBuffer();
+    uShortRangeEdmStreamInstance_t *pInstance = (uShortRangeEdmStreamInstance_t *) pParameters;
+
+    if ((pInstance != NULL) && (pInstance->uartHandle == uartHandle) &&
+        (eventBitmask == U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED)) {
+        if (pInstance->uartBufferAvailable) {
+            fillBuffer(pInstance);
         }
     }
 }
 
-//gEdmStream.uartBufferMutex must be locked before calling this function
-static void fillBuffer(void)
+// Deal with a complete EDM frame at the start of pFrame,
+// returning false if it could not be dealt with yet because
+// too many data events are pending or the AT response FIFO
+// is full.  A data event points into the frame so takes a
+// reference to the UART buffer, which can't then be re-used
+// until the data event is done; AT payloads are copied into
+// the AT response FIFO; other events stop the parser until
+// their consumer is done.
+static bool handleFrame(uShortRangeEdmStreamInstance_t *pInstance,
+                        char *pFrame, size_t length)
 {
-    int32_t sizeOrError = -1;
-    size_t read = 0;
-    int32_t length = 0;
-    uShortRangeEdmStreamParseState_t state = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_HEADER;
-
-    do {
-        uShortRangeEdmEvent_t evt;
-        size_t consumed;
-        if (state == U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_HEADER) {
-            sizeOrError = uPortUartRead(gEdmStream.uartHandle,
-                                        gEdmStream.pUartBuffer,
-                                        1);
-            if (sizeOrError > 0) {
-                int32_t dummy;
-                int32_t res = uShortRangeEdmParse(gEdmStream.pUartBuffer, 1, &evt, &dummy, &consumed);
-                if (res == U_SHORT_RANGE_EDM_ERROR_INCOMPLETE) {
-                    read = 1;
-                    state = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_LENGTH;
-                }
-            } else {
-                gEdmStream.uartBufferAvailable = true;
-            }
-        } else if (state == U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_LENGTH) {
-            sizeOrError = uPortUartRead(gEdmStream.uartHandle,
-                                        gEdmStream.pUartBuffer + read,
-                                        2);
-            if (sizeOrError == 1) {
-                read++;
-            } else if ((sizeOrError == 1 && read == 2) || sizeOrError == 2) {
-                int32_t res = uShortRangeEdmParse(gEdmStream.pUartBuffer, 3, &evt, &length, &consumed);
-                if (res == U_SHORT_RANGE_EDM_ERROR_INCOMPLETE && length != -1) {
-                    //Add for header and tail
-                    length += 4;
-                    if (length > U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE) {
-                        //Packet is to large, discard by setting base state
-                        read = 0;
-                        state = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_HEADER;
+    bool handled = true;
+    uShortRangeEdmEvent_t evt;
+    int32_t expected;
+    size_t consumed;
+
+    pInstance->uartBufferAvailable = false;
+    int32_t res = uShortRangeEdmParse(pFrame, length, &evt, &expected, &consumed);
+    if (res != U_SHORT_RANGE_EDM_OK) {
+        pInstance->uartBufferAvailable = true;
+    } else {
+        if (evt.type == U_SHORT_RANGE_EDM_EVENT_AT) {
+            pInstance->uartBufferAvailable = true;
+            handled = atResponsePut(pInstance, evt.params.atEvent.pData,
+                                    (size_t) evt.params.atEvent.length);
+            // Always nudge the AT client: if the FIFO is full it
+            // needs to read what is there already
+            uPortEventQueueSendIrq(pInstance->atEventQueueHandle,
+                                   &pInstance, sizeof(pInstance));
+        } else if (evt.type == U_SHORT_RANGE_EDM_EVENT_CONNECT_BT) {
+            uShortRangeEdmConnection_t *pConnection;
+            pConnection = pUShortRangeEdmConnectionAdd(&pInstance->connections,
+                                                       evt.params.btConnectEvent.channel,
+                                                       (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT);
+            if (pConnection != NULL) {
+                uShortRangeEdmStreamBtEvent_t event;
+                event.pInstance = pInstance;
+                pConnection->frameSize = evt.params.btConnectEvent.framesize;
+
+                event.type = U_SHORT_RANGE_EDM_STREAM_CONNECTED;
+                event.ble = (evt.params.btConnectEvent.profile == U_SHORT_RANGE_EDM_BT_PROFILE_SPS);
+                event.channel = evt.params.btConnectEvent.channel;
+                memcpy(event.address, evt.params.btConnectEvent.address, U_SHORT_RANGE_EDM_BT_ADDRESS_LENGTH);
+                event.frameSize = evt.params.btConnectEvent.framesize;
+
+                if (uPortEventQueueSendIrq(pInstance->btEventQueueHandle,
+                                           &event, sizeof(uShortRangeEdmStreamBtEvent_t)) != 0) {
+                    if (pInstance->btEventQueueHandle >= 0) {
+                        // The queue is full: forget the connection
+                        // and try the frame again once the event
+                        // handler, which restarts the parser, has
+                        // made room
+                        uShortRangeEdmConnectionRemove(&pInstance->connections,
+                                                       (int32_t) event.channel);
+                        handled = false;
                     } else {
-                        read = 3;
-                        state = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_REST;
+                        // Nobody wants the event
+                        pInstance->uartBufferAvailable = true;
                     }
                 }
             } else {
-                gEdmStream.uartBufferAvailable = true;
-            }
-        } else if (state == U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_REST) {
-            int8_t retryCounter = 0;
-            //We can only handle a full EDM packet and the module will always try to send
-            //a full packet, so if there are not enough data retry after a short delay to
-            //make sure this is not due to a slow UART.
-            //If this still fails, returning from this function at least recover so that
-            //the next EDM packet are handle correctly.
-            do {
-                sizeOrError = uPortUartRead(gEdmStream.uartHandle,
-                                            gEdmStream.pUartBuffer + read,
-                                            length - read);
+                pInstance->uartBufferAvailable = true;
+            }
+        } else if ((evt.type == U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv4) ||
+                   (evt.type == U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv6)) {
+            uShortRangeEdmStreamWifiEvent_t event;
+
+            memset(&event, 0, sizeof(event));
+            event.pInstance = pInstance;
+            event.type = U_SHORT_RANGE_EDM_STREAM_CONNECTED;
+            if (evt.type == U_SHORT_RANGE_EDM_EVENT_CONNECT_IPv4) {
+                event.channel = evt.params.ipv4ConnectEvent.channel;
+                event.connection.protocol = (int32_t) evt.params.ipv4ConnectEvent.protocol;
+                memcpy(event.connection.remoteAddress, evt.params.ipv4ConnectEvent.remoteAddress,
+                       U_SHORT_RANGE_EDM_IPv4_ADDRESS_LENGTH);
+                event.connection.remotePort = evt.params.ipv4ConnectEvent.remotePort;
+                memcpy(event.connection.localAddress, evt.params.ipv4ConnectEvent.localAddress,
+                       U_SHORT_RANGE_EDM_IPv4_ADDRESS_LENGTH);
+                event.connection.localPort = evt.params.ipv4ConnectEvent.localPort;
+            } else {
+                event.channel = evt.params.ipv6ConnectEvent.channel;
+                event.connection.protocol = (int32_t) evt.params.ipv6ConnectEvent.protocol;
+                event.connection.ipv6 = true;
+                memcpy(event.connection.remoteAddress, evt.params.ipv6ConnectEvent.remoteAddress,
+                       U_SHORT_RANGE_EDM_IPv6_ADDRESS_LENGTH);
+                event.connection.remotePort = evt.params.ipv6ConnectEvent.remotePort;
+                memcpy(event.connection.localAddress, evt.params.ipv6ConnectEvent.localAddress,
+                       U_SHORT_RANGE_EDM_IPv6_ADDRESS_LENGTH);
+                event.connection.localPort = evt.params.ipv6ConnectEvent.localPort;
+            }
 
-                if (sizeOrError > 0) {
-                    break;
+            // The connection must be known for its data to be
+            // passed on, even if nobody wants the event
+            uShortRangeEdmConnection_t *pConnection;
+            pConnection = pUShortRangeEdmConnectionAdd(&pInstance->connections,
+                                                       (int32_t) event.channel,
+                                                       (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI);
+            if (pConnection != NULL) {
+                // IP connections have no frame size of their own,
+                // the frames are only limited by EDM
+                pConnection->frameSize = U_SHORT_RANGE_EDM_MAX_SIZE;
+            }
+            if ((pConnection == NULL) ||
+                (uPortEventQueueSendIrq(pInstance->wifiEventQueueHandle,
+                                        &event, sizeof(uShortRangeEdmStreamWifiEvent_t)) != 0)) {
+                pInstance->uartBufferAvailable = true;
+            }
+        } else if (evt.type == U_SHORT_RANGE_EDM_EVENT_DISCONNECT) {
+            int32_t channel = (int32_t)evt.params.disconnectEvent.channel;
+            uShortRangeEdmConnection_t *pConnection = pUShortRangeEdmConnectionGet(&pInstance->connections,
+                                                                                   channel);
+
+            if (pConnection != NULL && pConnection->type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) {
+                uShortRangeEdmStreamBtEvent_t event;
+
+                event.pInstance = pInstance;
+                uShortRangeEdmConnectionRemove(&pInstance->connections, channel);
+                event.type = U_SHORT_RANGE_EDM_STREAM_DISCONNECTED;
+                event.channel = channel;
+
+                if (uPortEventQueueSendIrq(pInstance->btEventQueueHandle,
+                                           &event, sizeof(uShortRangeEdmStreamBtEvent_t)) != 0) {
+                    pInstance->uartBufferAvailable = true;
+                }
+            } else if (pConnection != NULL &&
+                       pConnection->type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI) {
+                uShortRangeEdmStreamWifiEvent_t event;
+
+                memset(&event, 0, sizeof(event));
+                event.pInstance = pInstance;
+                uShortRangeEdmConnectionRemove(&pInstance->connections, channel);
+                event.type = U_SHORT_RANGE_EDM_STREAM_DISCONNECTED;
+                event.channel = (uint32_t) channel;
+
+                if (uPortEventQueueSendIrq(pInstance->wifiEventQueueHandle,
+                                           &event, sizeof(uShortRangeEdmStreamWifiEvent_t)) != 0) {
+                    pInstance->uartBufferAvailable = true;
                 }
-                uPortTaskBlock(U_SHORT_RANGE_EDM_STREAM_UART_RETRY_TIMEOUT);
-                retryCounter++;
-            } while (retryCounter <= U_SHORT_RANGE_EDM_STREAM_UART_RETRIES);
+            } else {
+                pInstance->uartBufferAvailable = true;
+            }
+        } else if (evt.type == U_SHORT_RANGE_EDM_EVENT_DATA) {
+            uShortRangeEdmStreamDataEvent_t event;
+            event.pInstance = pInstance;
+            event.channel = evt.params.dataEvent.channel;
+            event.pData = evt.params.dataEvent.pData;
+            event.length = evt.params.dataEvent.length;
+            event.buffer = pInstance->currentBuffer;
+
+            U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+            pInstance->uartBufferAvailable = true;
+            if (pInstance->dataEventsPending >= U_EDM_STREAM_DATA_EVENT_QUEUE_SIZE) {
+                // No room in the queue, try again when
+                // a data event is done
+                waitBuffer(pInstance);
+                handled = false;
+            } else {
+                pInstance->buffers[event.buffer].refCount++;
+                pInstance->dataEventsPending++;
+            }
 
-            if (sizeOrError > 0) {
-                //parse if ok
-                read += sizeOrError;
-                if (length == read) {
-                    //Full packet process
-                    gEdmStream.uartBufferAvailable = false;
-                    int res = uShortRangeEdmParse(gEdmStream.pUartBuffer, read, &evt, &length, &consumed);
-                    if (res != U_SHORT_RANGE_EDM_OK) {
-                        gEdmStream.uartBufferAvailable = true;
-                        sizeOrError = 0;
-                    } else {
-                        if (evt.type == U_SHORT_RANGE_EDM_EVENT_AT) {
-                            gEdmStream.atResponseLength = evt.params.atEvent.length;
-                            gEdmStream.atResponseRead = 0;
-                            memcpy(gEdmStream.pAtResponseBuffer, evt.params.atEvent.pData, gEdmStream.atResponseLength);
-
-                            uPortEventQueueSendIrq(gEdmStream.atEventQueueHandle,
-                                                   &gEdmStream.handle, sizeof(int32_t));
-
-                            sizeOrError = 0;
-                        } else if (evt.type == U_SHORT_RANGE_EDM_EVENT_CONNECT_BT) {
-                            uShortRangeEdmStreamConnections_t *pConnection = findConnection(evt.params.btConnectEvent.channel);
-                            if (pConnection == NULL) {
-                                pConnection = findConnection(-1);
-                            }
-                            if (pConnection != NULL) {
-                                uShortRangeEdmStreamBtEvent_t event;
-                                pConnection->channel = evt.params.btConnectEvent.channel;
-                                pConnection->type = U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT;
-                                pConnection->frameSize = evt.params.btConnectEvent.framesize;
-
-                                event.type = U_SHORT_RANGE_EDM_STREAM_CONNECTED;
-                                event.ble = (evt.params.btConnectEvent.profile == U_SHORT_RANGE_EDM_BT_PROFILE_SPS);
-                                event.channel = evt.params.btConnectEvent.channel;
-                                memcpy(event.address, evt.params.btConnectEvent.address, U_SHORT_RANGE_EDM_BT_ADDRESS_LENGTH);
-                                event.frameSize = evt.params.btConnectEvent.framesize;
-
-                                uPortEventQueueSendIrq(gEdmStream.btEventQueueHandle,
-                                                       &event, sizeof(uShortRangeEdmStreamBtEvent_t));
-
-                                sizeOrError = 0;
-                            }
-                        } else if (evt.type == U_SHORT_RANGE_EDM_EVENT_DISCONNECT) {
-                            int32_t channel = (int32_t)evt.params.disconnectEvent.channel;
-                            uShortRangeEdmStreamConnections_t *pConnection = findConnection(channel);
-
-                            if (pConnection != NULL && pConnection->type == U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) {
-                                uShortRangeEdmStreamBtEvent_t event;
-
-                                pConnection->channel = -1;
-                                pConnection->type = U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_INVALID;
-                                pConnection->frameSize = -1;
-                                event.type = U_SHORT_RANGE_EDM_STREAM_DISCONNECTED;
-                                event.channel = channel;
-
-                                uPortEventQueueSendIrq(gEdmStream.btEventQueueHandle,
-                                                       &event, sizeof(uShortRangeEdmStreamBtEvent_t));
-                            } else if (pConnection != NULL &&
-                                       pConnection->type == U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI) {
-                                gEdmStream.uartBufferAvailable = true;
-                            } else {
-                                gEdmStream.uartBufferAvailable = true;
-                            }
-
-                            sizeOrError = 0;
-                        } else if (evt.type == U_SHORT_RANGE_EDM_EVENT_DATA) {
-                            uShortRangeEdmStreamDataEvent_t event;
-                            event.channel = evt.params.dataEvent.channel;
-                            event.pData = evt.params.dataEvent.pData;
-                            event.length = evt.params.dataEvent.length;
-
-                            uPortEventQueueSendIrq(gEdmStream.dataEventQueueHandle,
-                                                   &event, sizeof(uShortRangeEdmStreamDataEvent_t));
-
-                            sizeOrError = 0;
-                        } else if (evt.type == U_SHORT_RANGE_EDM_EVENT_STARTUP) {
-                            gEdmStream.uartBufferAvailable = true;
-                        } else {
-                            gEdmStream.uartBufferAvailable = true;
-                        }
-                    }
+            U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+
+            if (handled &&
+                (uPortEventQueueSendIrq(pInstance->dataEventQueueHandle,
+                                        &event, sizeof(uShortRangeEdmStreamDataEvent_t)) != 0)) {
+                // Nobody to send it to, give the reference back
+                releaseBuffer(pInstance, event.buffer);
+            }
+        } else {
+            pInstance->uartBufferAvailable = true;
+        }
+    }
+
+    return handled;
+}
+
+// Move forward through the bytes in the UART buffer, returning
+// true if a complete frame was found (and handled) or bytes
+// were thrown away, false if more bytes are needed from the UART.
+// A header is only believed if its length is one the module
+// could send and, once the whole frame is in, it ends with a
+// tail; if not, only the header byte is thrown away and the
+// search for the next header carries on through the bytes
+// already buffered, so that a stray header byte in noise can't
+// swallow the good frames that follow it.
+static bool parseBuffer(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    bool progress = false;
+    char *pStart = pInstance->pUartBuffer + pInstance->uartBufferStart;
+    size_t available = pInstance->uartBufferEnd - pInstance->uartBufferStart;
+    const char *pHead;
+    size_t length;
+
+    switch (pInstance->parseState) {
+        case U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_HEADER:
+            // Throw away anything before the start of a frame
+            pHead = (const char *) memchr(pStart, U_SHORT_RANGE_EDM_HEAD, available);
+            length = available;
+            if (pHead != NULL) {
+                length = (size_t) (pHead - pStart);
+            }
+            if (length > 0) {
+                discard(pInstance, length);
+            }
+            if (pHead != NULL) {
+                pInstance->parseState = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_LENGTH;
+            }
+            progress = (available > 0);
+            break;
+        case U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_LENGTH:
+            if (available >= 3) {
+                length = (((size_t) (uint8_t) * (pStart + 1)) << 8) +
+                         (uint8_t) * (pStart + 2);
+                // Add for header, length and tail
+                pInstance->parseLength = length + 4;
+                pInstance->parseState = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_REST;
+                // A length the module could not have sent, e.g. one
+                // with any of the top four bits set, which puts it
+                // over U_SHORT_RANGE_EDM_MAX_SIZE, or one that
+                // wouldn't fit in a UART buffer, means that this
+                // wasn't a header
+                if ((length < U_SHORT_RANGE_EDM_STREAM_MIN_PAYLOAD_LENGTH) ||
+                    (length > U_SHORT_RANGE_EDM_MAX_SIZE) ||
+                    (pInstance->parseLength > U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE)) {
+                    // Not a header after all
+                    discard(pInstance, 1);
+                }
+                progress = true;
+            }
+            break;
+        case U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_REST:
+            if (available >= pInstance->parseLength) {
+                if (*(pStart + pInstance->parseLength - 1) != (char) U_SHORT_RANGE_EDM_TAIL) {
+                    // Not a frame after all
+                    discard(pInstance, 1);
+                    progress = true;
+                } else if (handleFrame(pInstance, pStart, pInstance->parseLength)) {
+                    // Full frame, dealt with: move on, the bytes stay
+                    // in place while a data event points to them
+                    pInstance->uartBufferStart += pInstance->parseLength;
+                    pInstance->parseState = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_HEADER;
+                    pInstance->resyncing = false;
+                    progress = true;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    return progress;
+}
+
+// Make room at the end of the UART buffer, if it is full or the
+// partial frame in it can't be finished in the space left, by
+// moving the partial frame to the start of it or, if data events
+// still point into it, to the start of a free UART buffer,
+// returning false if there is none.  While there is space the
+// bytes stay where they are, so that a burst of frames doesn't
+// hop from buffer to buffer and use up the pool.
+static bool makeRoom(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    bool success = true;
+    size_t unparsed = pInstance->uartBufferEnd - pInstance->uartBufferStart;
+    int32_t buffer = pInstance->currentBuffer;
+
+    if ((pInstance->uartBufferStart > 0) &&
+        ((pInstance->uartBufferEnd >= U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE) ||
+         ((pInstance->parseState == U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_REST) &&
+          (pInstance->uartBufferStart + pInstance->parseLength >
+           U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE)))) {
+
+        U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+        if (pInstance->buffers[buffer].refCount > 0) {
+            buffer = -1;
+            for (int32_t x = 0; (x < U_SHORT_RANGE_EDM_STREAM_NUM_BUFFERS) &&
+                 (buffer < 0); x++) {
+                if (pInstance->buffers[x].refCount == 0) {
+                    buffer = x;
                 }
             }
+            if (buffer < 0) {
+                waitBuffer(pInstance);
+                success = false;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+
+        if (buffer >= 0) {
+            memmove(pInstance->buffers[buffer].pData,
+                    pInstance->pUartBuffer + pInstance->uartBufferStart,
+                    unparsed);
+            pInstance->currentBuffer = buffer;
+            pInstance->pUartBuffer = pInstance->buffers[buffer].pData;
+            pInstance->uartBufferStart = 0;
+            pInstance->uartBufferEnd = unparsed;
+        }
+    }
+
+    return success;
+}
+
+// Pull everything the UART has into the UART buffer in one
+// read and handle as many complete EDM frames as are found,
+// stopping only when a consumer has to be waited for; this
+// never sleeps, an incomplete frame is simply finished next time.
+static void fillBuffer(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    int32_t sizeOrError = 1;
+
+    while (pInstance->uartBufferAvailable && (sizeOrError > 0)) {
+        if (!parseBuffer(pInstance) && makeRoom(pInstance)) {
+            // Need more, read it
+            sizeOrError = 0;
+            if (pInstance->uartBufferEnd < U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE) {
+                sizeOrError = uPortUartRead(pInstance->uartHandle,
+                                            pInstance->pUartBuffer + pInstance->uartBufferEnd,
+                                            U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE -
+                                            pInstance->uartBufferEnd);
+            }
+            if (sizeOrError > 0) {
+                pInstance->uartBufferEnd += sizeOrError;
+            }
         }
-    } while ((sizeOrError > 0) && (read <= U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE));
+    }
 }
 
 static void flushUart(int32_t uartHandle)
@@ -389,13 +753,102 @@ static void flushUart(int32_t uartHandle)
     }
 }
 
-static int32_t uartWrite(const void *pData, size_t length)
+static int32_t uartWrite(const uShortRangeEdmStreamInstance_t *pInstance,
+                         const void *pData, size_t length)
 {
-    return uPortUartWrite(gEdmStream.uartHandle,
+    return uPortUartWrite(pInstance->uartHandle,
                           pData, length);
 }
 
-// A transmit intercept function.
+// Write all of the frames in the transmit buffer to the UART
+// in one go, returning zero on success else negative error code.
+// The buffer is emptied either way: on error, the frames that
+// did not get out in full are counted as dropped.
+// The instance mutex must be locked before calling this function.
+static int32_t txFlush(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    size_t written = 0;
+    size_t frameLength;
+    int32_t result;
+
+    while (written < pInstance->txBufferLength) {
+        result = uartWrite(pInstance, pInstance->pTxBuffer + written,
+                           pInstance->txBufferLength - written);
+        if (result <= 0) {
+            errorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+            break;
+        }
+        written += result;
+    }
+    if (written < pInstance->txBufferLength) {
+        // Walk the frames, each being the length in its header
+        // plus the header byte, the two length bytes and the tail
+        for (size_t x = 0; x < pInstance->txBufferLength; x += frameLength) {
+            frameLength = (((size_t) (uint8_t) pInstance->pTxBuffer[x + 1]) << 8) +
+                          (size_t) (uint8_t) pInstance->pTxBuffer[x + 2] + 4;
+            if (x + frameLength > written) {
+                pInstance->txDroppedCount++;
+            }
+        }
+    }
+    pInstance->txBufferLength = 0;
+
+    return errorCode;
+}
+
+// Add data for a channel to the transmit buffer as EDM frames of
+// no more than the connection's frame size, each frame assembled
+// in place so that it goes to the UART in a single write, flushing
+// the buffer whenever it is full.  Returns the number of bytes
+// added else negative error code.
+// The instance mutex must be locked before calling this function.
+static int32_t txQueue(uShortRangeEdmStreamInstance_t *pInstance,
+                       int32_t channel, const char *pData, size_t length)
+{
+    int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+    uShortRangeEdmConnection_t *pConnection = pUShortRangeEdmConnectionGet(&pInstance->connections,
+                                                                           channel);
+    size_t maxSend;
+    size_t send;
+    char *pFrame;
+
+    if ((pConnection != NULL) && (pConnection->frameSize > 0)) {
+        maxSend = (size_t) pConnection->frameSize;
+        if (maxSend > U_EDM_STREAM_TX_BUFFER_SIZE - U_SHORT_RANGE_EDM_DATA_OVERHEAD) {
+            // Frames can be shorter than the frame size
+            maxSend = U_EDM_STREAM_TX_BUFFER_SIZE - U_SHORT_RANGE_EDM_DATA_OVERHEAD;
+        }
+        sizeOrErrorCode = 0;
+        while ((sizeOrErrorCode >= 0) && ((size_t) sizeOrErrorCode < length)) {
+            send = length - sizeOrErrorCode;
+            if (send > maxSend) {
+                send = maxSend;
+            }
+            if (pInstance->txBufferLength + send + U_SHORT_RANGE_EDM_DATA_OVERHEAD >
+                U_EDM_STREAM_TX_BUFFER_SIZE) {
+                if (txFlush(pInstance) < 0) {
+                    sizeOrErrorCode = (int32_t) U_ERROR_COMMON_DEVICE_ERROR;
+                }
+            }
+            if (sizeOrErrorCode >= 0) {
+                pFrame = pInstance->pTxBuffer + pInstance->txBufferLength;
+                (void) uShortRangeEdmZeroCopyHeadData((uint8_t) channel, send, pFrame);
+                pFrame += U_SHORT_RANGE_EDM_DATA_HEAD_SIZE;
+                memcpy(pFrame, pData + sizeOrErrorCode, send);
+                pFrame += send;
+                (void) uShortRangeEdmZeroCopyTail(pFrame);
+                pInstance->txBufferLength += send + U_SHORT_RANGE_EDM_DATA_OVERHEAD;
+                pConnection->txBytes += (uint32_t) send;
+                sizeOrErrorCode += (int32_t) send;
+            }
+        }
+    }
+
+    return sizeOrErrorCode;
+}
+
+// A transmit intercept function, pContext is the instance.
 //lint -e{818} Suppress 'pContext' could be declared as const:
 // need to follow function signature
 static const char *pInterceptTx(uAtClientHandle_t atHandle,
@@ -403,16 +856,17 @@ static const char *pInterceptTx(uAtClientHandle_t atHandle,
                                 size_t *pLength,
                                 void *pContext)
 {
-    (void) pContext;
+    uShortRangeEdmStreamInstance_t *pInstance = (uShortRangeEdmStreamInstance_t *) pContext;
+
     (void) atHandle;
 
     if ((*pLength != 0) || (ppData == NULL)) {
-        if (*pLength + gEdmStream.atCommandCurrent > U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH) {
+        if (*pLength + pInstance->atCommandCurrent > U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH) {
             // Command will not fit buffer, this makes all data drop until the next flush so that
             // we recover after that without sending garbage to the module.
-            gEdmStream.atCommandCurrent = U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH;
+            pInstance->atCommandCurrent = U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH;
             if (ppData == NULL) {
-                gEdmStream.atCommandCurrent = 0;
+                pInstance->atCommandCurrent = 0;
             } else {
                 // Tell the caller we've consumed the lot
                 *ppData += *pLength;
@@ -421,19 +875,19 @@ static const char *pInterceptTx(uAtClientHandle_t atHandle,
             if (ppData == NULL) {
                 //All data in buffer, create and send EDM packet
                 char packet[U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH + U_SHORT_RANGE_EDM_REQUEST_OVERHEAD];
-                int32_t size = uShortRangeEdmRequest(gEdmStream.pAtCommandBuffer, gEdmStream.atCommandCurrent,
+                int32_t size = uShortRangeEdmRequest(pInstance->pAtCommandBuffer, pInstance->atCommandCurrent,
                                                      (char *)&packet[0]);
                 if (size > 0) {
                     size_t written = 0;
                     while (written < (uint32_t)size) {
-                        written += uartWrite((void *)(&packet[0] + written), (uint32_t)size - written);
+                        written += uartWrite(pInstance, (void *)(&packet[0] + written), (uint32_t)size - written);
                     }
                 }
                 //Reset buffer
-                gEdmStream.atCommandCurrent = 0;
+                pInstance->atCommandCurrent = 0;
             } else {
-                memcpy(gEdmStream.pAtCommandBuffer + gEdmStream.atCommandCurrent, *ppData, *pLength);
-                gEdmStream.atCommandCurrent += (int32_t) * pLength;
+                memcpy(pInstance->pAtCommandBuffer + pInstance->atCommandCurrent, *ppData, *pLength);
+                pInstance->atCommandCurrent += (int32_t) * pLength;
                 // Tell the caller what we've consumed.
                 *ppData += *pLength;
             }
@@ -447,29 +901,177 @@ static const char *pInterceptTx(uAtClientHandle_t atHandle,
     return 0;
 }
 
+// Find the instance for a handle and lock its mutex, returning
+// NULL if there is no such instance.  gMutex is held until the
+// instance mutex has been taken so that the instance can't be
+// closed, and freed, in between; after that everything is
+// protected by the instance's own mutexes.  The caller must
+// call uPortMutexUnlock() on pInstance->mutex when done.
+static uShortRangeEdmStreamInstance_t *pInstanceLock(int32_t handle)
+{
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+
+    U_PORT_MUTEX_LOCK(gMutex);
+
+    if ((handle >= 0) && (handle < U_EDM_STREAM_MAX_NUM_INSTANCES)) {
+        pInstance = gpEdmStream[handle];
+        if (pInstance != NULL) {
+            uPortMutexLock(pInstance->mutex);
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gMutex);
+
+    return pInstance;
+}
+
+// Free an instance and everything it owns.
+static void instanceFree(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    for (int32_t x = 0; x < U_SHORT_RANGE_EDM_STREAM_NUM_BUFFERS; x++) {
+        free(pInstance->buffers[x].pData);
+    }
+    free(pInstance->pTxBuffer);
+    free(pInstance->pAtCommandBuffer);
+    free(pInstance->pAtResponseBuffer);
+    if (pInstance->bufferMutex != NULL) {
+        uPortMutexDelete(pInstance->bufferMutex);
+    }
+    if (pInstance->mutex != NULL) {
+        uPortMutexDelete(pInstance->mutex);
+    }
+    free(pInstance);
+}
+
+// Create an instance for the given handle and UART, returning NULL
+// if there is not enough memory.
+static uShortRangeEdmStreamInstance_t *pInstanceCreate(int32_t handle,
+                                                       int32_t uartHandle)
+{
+    uShortRangeEdmStreamInstance_t *pInstance;
+    bool success;
+
+    pInstance = (uShortRangeEdmStreamInstance_t *) malloc(sizeof(uShortRangeEdmStreamInstance_t));
+    if (pInstance != NULL) {
+        memset(pInstance, 0, sizeof(*pInstance));
+        success = (uPortMutexCreate(&(pInstance->mutex)) == 0) &&
+                  (uPortMutexCreate(&(pInstance->bufferMutex)) == 0);
+        for (int32_t x = 0; x < U_SHORT_RANGE_EDM_STREAM_NUM_BUFFERS; x++) {
+            pInstance->buffers[x].pData = (char *)malloc(U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE);
+            if (pInstance->buffers[x].pData == NULL) {
+                success = false;
+            }
+        }
+        pInstance->pTxBuffer = (char *)malloc(U_EDM_STREAM_TX_BUFFER_SIZE);
+        pInstance->pAtCommandBuffer = (char *)malloc(U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
+        pInstance->pAtResponseBuffer = (char *)malloc(U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
+        if (!success || (pInstance->pTxBuffer == NULL) ||
+            (pInstance->pAtCommandBuffer == NULL) ||
+            (pInstance->pAtResponseBuffer == NULL)) {
+            instanceFree(pInstance);
+            pInstance = NULL;
+        } else {
+            memset(pInstance->pAtCommandBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
+            memset(pInstance->pAtResponseBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
+            pInstance->handle = handle;
+            pInstance->uartHandle = uartHandle;
+            pInstance->atEventQueueHandle = -1;
+            pInstance->btEventQueueHandle = -1;
+            pInstance->wifiEventQueueHandle = -1;
+            pInstance->dataEventQueueHandle = -1;
+            pInstance->uartBufferAvailable = true;
+            pInstance->pUartBuffer = pInstance->buffers[0].pData;
+            pInstance->parseState = U_SHORT_RANGE_EDM_STREAM_PARSE_STATE_HEADER;
+            uShortRangeEdmConnectionTableInit(&pInstance->connections);
+        }
+    }
+
+    return pInstance;
+}
+
+// Shut down an instance that has already been taken out of
+// gpEdmStream[] and free it.  The event queues are closed
+// outside the instance mutex since their tasks may be waiting
+// on it.
+static void instanceClose(uShortRangeEdmStreamInstance_t *pInstance)
+{
+    int32_t atEventQueueHandle;
+    int32_t btEventQueueHandle;
+    int32_t wifiEventQueueHandle;
+    int32_t dataEventQueueHandle;
+
+    // Stop the parser first so that nothing new is sent
+    // to the event queues
+    uPortUartEventCallbackRemove(pInstance->uartHandle);
+
+    U_PORT_MUTEX_LOCK(pInstance->mutex);
+
+    atEventQueueHandle = pInstance->atEventQueueHandle;
+    pInstance->atEventQueueHandle = -1;
+    btEventQueueHandle = pInstance->btEventQueueHandle;
+    pInstance->btEventQueueHandle = -1;
+    wifiEventQueueHandle = pInstance->wifiEventQueueHandle;
+    pInstance->wifiEventQueueHandle = -1;
+    dataEventQueueHandle = pInstance->dataEventQueueHandle;
+    pInstance->dataEventQueueHandle = -1;
+    if (pInstance->atHandle != NULL) {
+        uAtClientStreamInterceptTx(pInstance->atHandle, NULL, NULL);
+    }
+    pInstance->atHandle = NULL;
+
+    U_PORT_MUTEX_UNLOCK(pInstance->mutex);
+
+    if (atEventQueueHandle >= 0) {
+        uPortEventQueueClose(atEventQueueHandle);
+    }
+    if (btEventQueueHandle >= 0) {
+        uPortEventQueueClose(btEventQueueHandle);
+    }
+    if (wifiEventQueueHandle >= 0) {
+        uPortEventQueueClose(wifiEventQueueHandle);
+    }
+    if (dataEventQueueHandle >= 0) {
+        uPortEventQueueClose(dataEventQueueHandle);
+    }
+
+    instanceFree(pInstance);
+}
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
 
 int32_t uShortRangeEdmStreamInit()
 {
-    uErrorCode_t errorCodeOrHandle = U_ERROR_COMMON_SUCCESS;
+    uErrorCode_t errorCode = U_ERROR_COMMON_SUCCESS;
 
     if (gMutex == NULL) {
-        errorCodeOrHandle = (uErrorCode_t)uPortMutexCreate(&gMutex);
-        gEdmStream.handle = -1;
+        errorCode = (uErrorCode_t)uPortMutexCreate(&gMutex);
     }
 
-    return (int32_t) errorCodeOrHandle;
+    return (int32_t) errorCode;
 }
 
 void uShortRangeEdmStreamDeinit()
 {
+    uShortRangeEdmStreamInstance_t *pInstance;
+
     if (gMutex != NULL) {
+        // Close any instances that are still open
+        for (int32_t x = 0; x < U_EDM_STREAM_MAX_NUM_INSTANCES; x++) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+            U_PORT_MUTEX_LOCK(gMutex);
+
+            pInstance = gpEdmStream[x];
+            gpEdmStream[x] = NULL;
+
+            U_PORT_MUTEX_UNLOCK(gMutex);
+
+            if (pInstance != NULL) {
+                instanceClose(pInstance);
+            }
+        }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
         uPortMutexDelete(gMutex);
         gMutex = NULL;
     }
@@ -478,58 +1080,44 @@ void uShortRangeEdmStreamDeinit()
 int32_t uShortRangeEdmStreamOpen(int32_t uartHandle)
 {
     uErrorCode_t handleOrErrorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+    int32_t handle = -1;
 
     if (gMutex != NULL) {
 
         U_PORT_MUTEX_LOCK(gMutex);
-        handleOrErrorCode = U_ERROR_COMMON_INVALID_PARAMETER;
 
-        if (uartHandle >= 0 && gEdmStream.handle == -1
-            && gEdmStream.pUartBuffer == NULL) {
-
-            int32_t errorCode = uPortUartEventCallbackSet(uartHandle,
-                                                          U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
-                                                          uartCallback, NULL,
-                                                          U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
-                                                          U_EDM_STREAM_TASK_PRIORITY);
-
-            if (errorCode == 0) {
-                gEdmStream.pUartBuffer = (char *)malloc(U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE);
-                memset(gEdmStream.pUartBuffer, 0, U_SHORT_RANGE_EDM_STREAM_BUFFER_SIZE);
-                gEdmStream.pAtCommandBuffer = (char *)malloc(U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
-                memset(gEdmStream.pAtCommandBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_COMMAND_LENGTH);
-                gEdmStream.pAtResponseBuffer = (char *)malloc(U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
-                memset(gEdmStream.pAtResponseBuffer, 0, U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH);
-                if (gEdmStream.pUartBuffer == NULL || gEdmStream.pAtCommandBuffer == NULL ||
-                    gEdmStream.pAtResponseBuffer == NULL) {
-                    handleOrErrorCode = U_ERROR_COMMON_NO_MEMORY;
-                    uPortUartEventCallbackRemove(uartHandle);
-                } else {
-                    gEdmStream.handle = 0;
-                    gEdmStream.uartHandle = uartHandle;
-                    gEdmStream.atHandle = NULL;
-                    gEdmStream.atEventQueueHandle = -1;
-                    gEdmStream.btEventQueueHandle = -1;
-                    gEdmStream.dataEventQueueHandle = -1;
-                    gEdmStream.pAtCallback = NULL;
-                    gEdmStream.pAtCallbackParam = NULL;
-                    gEdmStream.pBtEventCallback = NULL;
-                    gEdmStream.pBtEventCallbackParam = NULL;
-                    gEdmStream.pBtDataCallback = NULL;
-                    gEdmStream.pBtDataCallbackParam = NULL;
-                    gEdmStream.pWifiDataCallback = NULL;
-                    gEdmStream.pWifiDataCallbackParam = NULL;
-                    gEdmStream.atCommandCurrent = 0;
-                    gEdmStream.uartBufferAvailable = true;
-
-                    for (uint32_t i = 0; i < U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS; i++) {
-                        gEdmStream.connections[i].channel = -1;
-                        gEdmStream.connections[i].frameSize = -1;
-                        gEdmStream.connections[i].type = U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_INVALID;
+        handleOrErrorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        if (uartHandle >= 0) {
+            // Find a free handle, making sure that the UART
+            // is not already in use by another instance
+            for (int32_t x = 0; x < U_EDM_STREAM_MAX_NUM_INSTANCES; x++) {
+                if (gpEdmStream[x] == NULL) {
+                    if (handle < 0) {
+                        handle = x;
                     }
+                } else if (gpEdmStream[x]->uartHandle == uartHandle) {
+                    handle = -1;
+                    break;
+                }
+            }
+        }
 
-                    handleOrErrorCode = (uErrorCode_t)gEdmStream.handle;
+        if (handle >= 0) {
+            handleOrErrorCode = U_ERROR_COMMON_NO_MEMORY;
+            pInstance = pInstanceCreate(handle, uartHandle);
+            if (pInstance != NULL) {
+                handleOrErrorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+                if (uPortUartEventCallbackSet(uartHandle,
+                                              U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED,
+                                              uartCallback, pInstance,
+                                              U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
+                                              U_EDM_STREAM_TASK_PRIORITY) == 0) {
+                    gpEdmStream[handle] = pInstance;
+                    handleOrErrorCode = (uErrorCode_t) handle;
                     flushUart(uartHandle);
+                } else {
+                    instanceFree(pInstance);
                 }
             }
         }
@@ -542,54 +1130,22 @@ int32_t uShortRangeEdmStreamOpen(int32_t uartHandle)
 
 void uShortRangeEdmStreamClose(int32_t handle)
 {
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+
     if (gMutex != NULL) {
 
         U_PORT_MUTEX_LOCK(gMutex);
 
-        if ((handle != -1) && (handle == gEdmStream.handle)) {
-            gEdmStream.handle = -1;
-            if (gEdmStream.uartHandle >= 0) {
-                uPortUartEventCallbackRemove(gEdmStream.uartHandle);
-            }
-            gEdmStream.uartHandle = -1;
-            if (gEdmStream.atEventQueueHandle >= 0) {
-                uPortEventQueueClose(gEdmStream.atEventQueueHandle);
-            }
-            gEdmStream.atEventQueueHandle = -1;
-            if (gEdmStream.btEventQueueHandle >= 0) {
-                uPortEventQueueClose(gEdmStream.btEventQueueHandle);
-            }
-            gEdmStream.btEventQueueHandle = -1;
-            if (gEdmStream.dataEventQueueHandle >= 0) {
-                uPortEventQueueClose(gEdmStream.dataEventQueueHandle);
-            }
-            gEdmStream.dataEventQueueHandle = -1;
-            if (gEdmStream.atHandle != NULL) {
-                uAtClientStreamInterceptTx(gEdmStream.atHandle, NULL, NULL);
-            }
-            gEdmStream.atHandle = NULL;
-            gEdmStream.pAtCallback = NULL;
-            gEdmStream.pAtCallbackParam = NULL;
-            gEdmStream.pBtEventCallback = NULL;
-            gEdmStream.pBtEventCallbackParam = NULL;
-            gEdmStream.pBtDataCallback = NULL;
-            gEdmStream.pBtDataCallbackParam = NULL;
-            gEdmStream.pWifiDataCallback = NULL;
-            gEdmStream.pWifiDataCallbackParam = NULL;
-            free(gEdmStream.pUartBuffer);
-            gEdmStream.pUartBuffer = NULL;
-            free(gEdmStream.pAtCommandBuffer);
-            gEdmStream.pAtCommandBuffer = NULL;
-            free(gEdmStream.pAtResponseBuffer);
-            gEdmStream.pAtResponseBuffer = NULL;
-            for (uint32_t i = 0; i < U_SHORT_RANGE_EDM_STREAM_MAX_CONNECTIONS; i++) {
-                gEdmStream.connections[i].channel = -1;
-                gEdmStream.connections[i].frameSize = -1;
-                gEdmStream.connections[i].type = U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_INVALID;
-            }
+        if ((handle >= 0) && (handle < U_EDM_STREAM_MAX_NUM_INSTANCES)) {
+            pInstance = gpEdmStream[handle];
+            gpEdmStream[handle] = NULL;
         }
 
         U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if (pInstance != NULL) {
+            instanceClose(pInstance);
+        }
     }
 }
 
@@ -602,32 +1158,34 @@ int32_t uShortRangeEdmStreamAtCallbackSet(int32_t handle,
                                           int32_t priority)
 {
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
-
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((handle == gEdmStream.handle) &&
-            (gEdmStream.atEventQueueHandle < 0) &&
-            (pFunction != NULL)) {
-            // Open an event queue to eventHandler()
-            // useful name for debug purposes
-            int32_t result = uPortEventQueueOpen(atEventHandler, "eventEdmAT",
-                                                 sizeof(int32_t),
-                                                 stackSizeBytes,
-                                                 priority,
-                                                 U_EDM_STREAM_AT_EVENT_QUEUE_SIZE);
-            if (result >= 0) {
-                gEdmStream.atEventQueueHandle = result;
-                gEdmStream.pAtCallback = pFunction;
-                gEdmStream.pAtCallbackParam = pParam;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
 
-                errorCode = U_ERROR_COMMON_SUCCESS;
+            if ((pInstance->atEventQueueHandle < 0) &&
+                (pFunction != NULL)) {
+                // Open an event queue to eventHandler()
+                // useful name for debug purposes
+                int32_t result = uPortEventQueueOpen(atEventHandler, "eventEdmAT",
+                                                     sizeof(uShortRangeEdmStreamInstance_t *),
+                                                     stackSizeBytes,
+                                                     priority,
+                                                     U_EDM_STREAM_AT_EVENT_QUEUE_SIZE);
+                if (result >= 0) {
+                    pInstance->atEventQueueHandle = result;
+                    pInstance->pAtCallback = pFunction;
+                    pInstance->pAtCallbackParam = pParam;
+
+                    errorCode = U_ERROR_COMMON_SUCCESS;
+                }
             }
-        }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+            uPortMutexUnlock(pInstance->mutex);
+        }
     }
 
     return (int32_t)errorCode;
@@ -642,14 +1200,16 @@ int32_t uShortRangeEdmStreamBtEventCallbackSet(int32_t handle,
                                                int32_t priority)
 {
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+    int32_t eventQueueHandle = -1;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
-
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if (handle == gEdmStream.handle) {
-            if ((gEdmStream.btEventQueueHandle < 0) && (pFunction != NULL)) {
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            if ((pInstance->btEventQueueHandle < 0) && (pFunction != NULL)) {
                 // Open an event queue to eventHandler()
                 int32_t result = uPortEventQueueOpen(btEventHandler, "eventEdmBT",
                                                      sizeof(uShortRangeEdmStreamBtEvent_t),
@@ -657,27 +1217,92 @@ int32_t uShortRangeEdmStreamBtEventCallbackSet(int32_t handle,
                                                      priority,
                                                      U_EDM_STREAM_BT_EVENT_QUEUE_SIZE);
                 if (result >= 0) {
-                    gEdmStream.btEventQueueHandle = result;
-                    gEdmStream.pBtEventCallback = pFunction;
-                    gEdmStream.pBtEventCallbackParam = pParam;
+                    pInstance->btEventQueueHandle = result;
+                    pInstance->pBtEventCallback = pFunction;
+                    pInstance->pBtEventCallbackParam = pParam;
 
                     errorCode = U_ERROR_COMMON_SUCCESS;
                 }
-            } else if ((gEdmStream.btEventQueueHandle >= 0) && (pFunction == NULL)) {
-                uPortEventQueueClose(gEdmStream.btEventQueueHandle);
-                gEdmStream.btEventQueueHandle = -1;
-                gEdmStream.pBtEventCallback = NULL;
-                gEdmStream.pBtEventCallbackParam = NULL;
+            } else if ((pInstance->btEventQueueHandle >= 0) && (pFunction == NULL)) {
+                eventQueueHandle = pInstance->btEventQueueHandle;
+                pInstance->btEventQueueHandle = -1;
+                pInstance->pBtEventCallback = NULL;
+                pInstance->pBtEventCallbackParam = NULL;
+                errorCode = U_ERROR_COMMON_SUCCESS;
             }
 
+            uPortMutexUnlock(pInstance->mutex);
+
+            // Close the queue with the mutex released since this
+            // waits for the event handler, which may call back
+            // into this API
+            if (eventQueueHandle >= 0) {
+                uPortEventQueueClose(eventQueueHandle);
+            }
         }
+    }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+    return (int32_t)errorCode;
+}
+
+//lint -esym(593, pParam) Suppress pParam not being freed here
+int32_t uShortRangeEdmStreamWifiEventCallbackSet(int32_t handle,
+                                                 void (*pFunction)(int32_t, uint32_t, uint32_t,
+                                                                   const uShortRangeEdmStreamIpConnection_t *,
+                                                                   void *),
+                                                 void *pParam,
+                                                 size_t stackSizeBytes,
+                                                 int32_t priority)
+{
+    uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+    int32_t eventQueueHandle = -1;
+
+    if (gMutex != NULL) {
+
+        errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            if ((pInstance->wifiEventQueueHandle < 0) && (pFunction != NULL)) {
+                // Open an event queue to wifiEventHandler()
+                int32_t result = uPortEventQueueOpen(wifiEventHandler, "eventEdmWifi",
+                                                     sizeof(uShortRangeEdmStreamWifiEvent_t),
+                                                     stackSizeBytes,
+                                                     priority,
+                                                     U_EDM_STREAM_WIFI_EVENT_QUEUE_SIZE);
+                if (result >= 0) {
+                    pInstance->wifiEventQueueHandle = result;
+                    pInstance->pWifiEventCallback = pFunction;
+                    pInstance->pWifiEventCallbackParam = pParam;
+
+                    errorCode = U_ERROR_COMMON_SUCCESS;
+                }
+            } else if ((pInstance->wifiEventQueueHandle >= 0) && (pFunction == NULL)) {
+                eventQueueHandle = pInstance->wifiEventQueueHandle;
+                pInstance->wifiEventQueueHandle = -1;
+                pInstance->pWifiEventCallback = NULL;
+                pInstance->pWifiEventCallbackParam = NULL;
+                errorCode = U_ERROR_COMMON_SUCCESS;
+            }
+
+            uPortMutexUnlock(pInstance->mutex);
+
+            // Close the queue with the mutex released, as above
+            if (eventQueueHandle >= 0) {
+                uPortEventQueueClose(eventQueueHandle);
+            }
+        }
     }
 
     return (int32_t)errorCode;
 }
 
+void uShortRangeEdmStreamWifiEventCallbackRemove(int32_t handle)
+{
+    uShortRangeEdmStreamWifiEventCallbackSet(handle, NULL, NULL, 0, 0);
+}
+
 int32_t uShortRangeEdmStreamDataEventCallbackSet(int32_t handle,
                                                  int32_t type,
                                                  void (*pFunction)(int32_t, int32_t, int32_t,
@@ -687,41 +1312,44 @@ int32_t uShortRangeEdmStreamDataEventCallbackSet(int32_t handle,
                                                  int32_t priority)
 {
     uErrorCode_t errorCode = U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+    int32_t eventQueueHandle = -1;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
-
         errorCode = U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((handle == gEdmStream.handle) &&
-            (type >= (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) &&
+        if ((type >= (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) &&
             (type <= (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI)) {
+            pInstance = pInstanceLock(handle);
+        }
+        if (pInstance != NULL) {
+
             if (pFunction != NULL) {
                 if ((type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT &&
-                     gEdmStream.pBtDataCallback == NULL) ||
+                     pInstance->pBtDataCallback == NULL) ||
                     (type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI &&
-                     gEdmStream.pWifiDataCallback == NULL)) {
+                     pInstance->pWifiDataCallback == NULL)) {
 
                     int32_t result = 0;
-                    if (gEdmStream.pBtDataCallback == NULL && gEdmStream.pWifiDataCallback == NULL) {
+                    if (pInstance->pBtDataCallback == NULL && pInstance->pWifiDataCallback == NULL) {
                         // Open an event queue to eventHandler()
                         result = uPortEventQueueOpen(dataEventHandler, "eventEdmData",
-                                                     sizeof(uShortRangeEdmStreamBtEvent_t),
+                                                     sizeof(uShortRangeEdmStreamDataEvent_t),
                                                      stackSizeBytes,
                                                      priority,
                                                      U_EDM_STREAM_DATA_EVENT_QUEUE_SIZE);
                         if (result >= 0) {
-                            gEdmStream.dataEventQueueHandle = result;
+                            pInstance->dataEventQueueHandle = result;
                         }
                     }
 
                     if (result >= 0) {
                         if (type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) {
-                            gEdmStream.pBtDataCallback = pFunction;
-                            gEdmStream.pBtDataCallbackParam = pParam;
+                            pInstance->pBtDataCallback = pFunction;
+                            pInstance->pBtDataCallbackParam = pParam;
                         } else {
-                            gEdmStream.pWifiDataCallback = pFunction;
-                            gEdmStream.pWifiDataCallbackParam = pParam;
+                            pInstance->pWifiDataCallback = pFunction;
+                            pInstance->pWifiDataCallbackParam = pParam;
                         }
 
                         errorCode = U_ERROR_COMMON_SUCCESS;
@@ -729,28 +1357,35 @@ int32_t uShortRangeEdmStreamDataEventCallbackSet(int32_t handle,
                 }
             } else {
                 if ((type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT &&
-                     gEdmStream.pBtDataCallback != NULL) ||
+                     pInstance->pBtDataCallback != NULL) ||
                     (type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_WIFI &&
-                     gEdmStream.pWifiDataCallback != NULL)) {
+                     pInstance->pWifiDataCallback != NULL)) {
 
                     if (type == (int32_t) U_SHORT_RANGE_EDM_STREAM_CONNECTION_TYPE_BT) {
-                        gEdmStream.pBtDataCallback = NULL;
-                        gEdmStream.pBtDataCallbackParam = NULL;
+                        pInstance->pBtDataCallback = NULL;
+                        pInstance->pBtDataCallbackParam = NULL;
                     } else {
-                        gEdmStream.pWifiDataCallback = NULL;
-                        gEdmStream.pWifiDataCallbackParam = NULL;
+                        pInstance->pWifiDataCallback = NULL;
+                        pInstance->pWifiDataCallbackParam = NULL;
                     }
 
-                    if (gEdmStream.pBtDataCallback == NULL && gEdmStream.pWifiDataCallback == NULL) {
-                        uPortEventQueueClose(gEdmStream.dataEventQueueHandle);
-                        gEdmStream.dataEventQueueHandle = -1;
+                    if (pInstance->pBtDataCallback == NULL && pInstance->pWifiDataCallback == NULL) {
+                        eventQueueHandle = pInstance->dataEventQueueHandle;
+                        pInstance->dataEventQueueHandle = -1;
                     }
                     errorCode = U_ERROR_COMMON_SUCCESS;
                 }
             }
-        }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+            uPortMutexUnlock(pInstance->mutex);
+
+            // Close the queue with the mutex released since this
+            // waits for the event handler, which may call back
+            // into this API
+            if (eventQueueHandle >= 0) {
+                uPortEventQueueClose(eventQueueHandle);
+            }
+        }
     }
 
     return (int32_t)errorCode;
@@ -758,9 +1393,17 @@ int32_t uShortRangeEdmStreamDataEventCallbackSet(int32_t handle,
 
 void uShortRangeEdmStreamSetAtHandle(int32_t handle, void *atHandle)
 {
-    if (handle == gEdmStream.handle) {
-        uAtClientStreamInterceptTx(atHandle, pInterceptTx, NULL);
-        gEdmStream.atHandle = atHandle;
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    if (gMutex != NULL) {
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            uAtClientStreamInterceptTx(atHandle, pInterceptTx, pInstance);
+            pInstance->atHandle = atHandle;
+
+            uPortMutexUnlock(pInstance->mutex);
+        }
     }
 }
 
@@ -768,19 +1411,23 @@ int32_t uShortRangeEdmStreamAtWrite(int32_t handle, const void *pBuffer,
                                     size_t sizeBytes)
 {
     int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-        if (gEdmStream.handle == handle && pBuffer != NULL && sizeBytes != 0) {
+        if (pBuffer != NULL && sizeBytes != 0) {
+            pInstance = pInstanceLock(handle);
+        }
+        if (pInstance != NULL) {
+
             sizeOrErrorCode = (int32_t)U_ERROR_COMMON_PLATFORM;
 
             int32_t result;
             uint32_t sent = 0;
 
             do {
-                result = uartWrite(pBuffer, sizeBytes);
+                result = uartWrite(pInstance, pBuffer, sizeBytes);
                 if (result > 0) {
                     sent += result;
                 }
@@ -789,9 +1436,9 @@ int32_t uShortRangeEdmStreamAtWrite(int32_t handle, const void *pBuffer,
             if (sent > 0) {
                 sizeOrErrorCode = (int32_t)sent;
             }
-        }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+            uPortMutexUnlock(pInstance->mutex);
+        }
     }
 
     return sizeOrErrorCode;
@@ -801,31 +1448,27 @@ int32_t uShortRangeEdmStreamAtRead(int32_t handle, void *pBuffer,
                                    size_t sizeBytes)
 {
     int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+    bool wake;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-        if (gEdmStream.handle == handle && pBuffer != NULL && sizeBytes != 0) {
-            sizeOrErrorCode = (int32_t)(gEdmStream.atResponseLength - gEdmStream.atResponseRead);
-            if (sizeOrErrorCode > 0) {
-                if (sizeBytes < (uint32_t)sizeOrErrorCode) {
-                    sizeOrErrorCode = (int32_t)sizeBytes;
-                }
-                memcpy(pBuffer, gEdmStream.pAtResponseBuffer, gEdmStream.atResponseLength);
-                gEdmStream.atResponseRead += sizeOrErrorCode;
+        if (pBuffer != NULL && sizeBytes != 0) {
+            pInstance = pInstanceLock(handle);
+        }
+        if (pInstance != NULL) {
 
-                if (gEdmStream.atResponseRead == gEdmStream.atResponseLength) {
-                    gEdmStream.atResponseLength = 0;
-                    gEdmStream.atResponseRead = 0;
-                }
-                gEdmStream.uartBufferAvailable = true;
-                uPortUartEventSend(gEdmStream.uartHandle,
+            sizeOrErrorCode = (int32_t) atResponseGet(pInstance, (char *) pBuffer,
+                                                      sizeBytes, &wake);
+            if (wake) {
+                // The parser was waiting for room, get it going again
+                uPortUartEventSend(pInstance->uartHandle,
                                    U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED);
             }
-        }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+            uPortMutexUnlock(pInstance->mutex);
+        }
     }
 
     return sizeOrErrorCode;
@@ -835,66 +1478,87 @@ int32_t uShortRangeEdmStreamWrite(int32_t handle, int32_t channel,
                                   const void *pBuffer, size_t sizeBytes)
 {
     int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+    int32_t errorCode;
 
     if (gMutex != NULL) {
-        U_PORT_MUTEX_LOCK(gMutex);
         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-        if (gEdmStream.handle == handle && channel >= 0 &&
-            pBuffer != NULL && sizeBytes != 0) {
-            uShortRangeEdmStreamConnections_t *pConnection = findConnection(channel);
-            if (pConnection != NULL) {
-                int32_t sent;
-                int32_t send;
-                char head[U_SHORT_RANGE_EDM_DATA_HEAD_SIZE];
-                char tail[U_SHORT_RANGE_EDM_TAIL_SIZE];
-                sizeOrErrorCode = 0;
-
-                do {
-                    if (((int32_t)sizeBytes - sizeOrErrorCode) > pConnection->frameSize) {
-                        send = pConnection->frameSize;
-                    } else {
-                        send = ((int32_t)sizeBytes - sizeOrErrorCode);
-                    }
+        if (channel >= 0 && pBuffer != NULL && sizeBytes != 0) {
+            pInstance = pInstanceLock(handle);
+        }
+        if (pInstance != NULL) {
+            sizeOrErrorCode = txQueue(pInstance, channel, (const char *) pBuffer, sizeBytes);
+            if (sizeOrErrorCode >= 0) {
+                // Send it now, along with anything queued before
+                errorCode = txFlush(pInstance);
+                if (errorCode < 0) {
+                    sizeOrErrorCode = errorCode;
+                }
+            }
+            uPortMutexUnlock(pInstance->mutex);
+        }
+    }
 
-                    (void)uShortRangeEdmZeroCopyHeadData((uint8_t)channel, send, (char *)&head[0]);
-                    sent = uartWrite((void *)&head[0], U_SHORT_RANGE_EDM_DATA_HEAD_SIZE);
-                    sent += uartWrite((const void *)((const char *)pBuffer + sizeOrErrorCode), send);
-                    (void)uShortRangeEdmZeroCopyTail((char *)&tail[0]);
-                    sent += uartWrite((void *)&tail[0], U_SHORT_RANGE_EDM_TAIL_SIZE);
+    return sizeOrErrorCode;
+}
 
-                    if (sent != (send + U_SHORT_RANGE_EDM_DATA_HEAD_SIZE + U_SHORT_RANGE_EDM_TAIL_SIZE)) {
-                        sizeOrErrorCode = (int32_t)U_ERROR_COMMON_DEVICE_ERROR;
-                        break;
-                    } else {
-                        sizeOrErrorCode += send;
-                    }
-                } while ((int32_t)sizeBytes > sizeOrErrorCode);
-            }
+int32_t uShortRangeEdmStreamWriteQueue(int32_t handle, int32_t channel,
+                                       const void *pBuffer, size_t sizeBytes)
+{
+    int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance = NULL;
+
+    if (gMutex != NULL) {
+        sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+        if (channel >= 0 && pBuffer != NULL && sizeBytes != 0) {
+            pInstance = pInstanceLock(handle);
+        }
+        if (pInstance != NULL) {
+            sizeOrErrorCode = txQueue(pInstance, channel, (const char *) pBuffer, sizeBytes);
+            uPortMutexUnlock(pInstance->mutex);
         }
-        U_PORT_MUTEX_UNLOCK(gMutex);
     }
 
     return sizeOrErrorCode;
 }
 
+int32_t uShortRangeEdmStreamWriteFlush(int32_t handle)
+{
+    int32_t errorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    if (gMutex != NULL) {
+        errorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+            errorCode = txFlush(pInstance);
+            uPortMutexUnlock(pInstance->mutex);
+        }
+    }
+
+    return errorCode;
+}
+
 int32_t uShortRangeEdmStreamAtEventSend(int32_t handle, uint32_t eventBitMap)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
-
         errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((handle == 0) &&
-            (gEdmStream.atEventQueueHandle >= 0) &&
-            // The only event we support right now
-            (eventBitMap == U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED)) {
-            errorCode = uPortEventQueueSend(gEdmStream.atEventQueueHandle,
-                                            &gEdmStream.handle, sizeof(int32_t));
-        }
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            if ((pInstance->atEventQueueHandle >= 0) &&
+                // The only event we support right now
+                (eventBitMap == U_PORT_UART_EVENT_BITMASK_DATA_RECEIVED)) {
+                errorCode = uPortEventQueueSend(pInstance->atEventQueueHandle,
+                                                &pInstance, sizeof(pInstance));
+            }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+            uPortMutexUnlock(pInstance->mutex);
+        }
     }
 
     return errorCode;
@@ -903,17 +1567,18 @@ int32_t uShortRangeEdmStreamAtEventSend(int32_t handle, uint32_t eventBitMap)
 bool uShortRangeEdmStreamAtEventIsCallback(int32_t handle)
 {
     bool isEventCallback = false;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
     if (gMutex != NULL) {
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+            if (pInstance->atEventQueueHandle >= 0) {
+                isEventCallback = uPortEventQueueIsTask(pInstance->atEventQueueHandle);
+            }
 
-        if ((handle == gEdmStream.handle) &&
-            (gEdmStream.atEventQueueHandle >= 0)) {
-            isEventCallback = uPortEventQueueIsTask(gEdmStream.atEventQueueHandle);
+            uPortMutexUnlock(pInstance->mutex);
         }
-
-        U_PORT_MUTEX_UNLOCK(gMutex);
     }
 
     return isEventCallback;
@@ -922,61 +1587,187 @@ bool uShortRangeEdmStreamAtEventIsCallback(int32_t handle)
 void uShortRangeEdmStreamAtCallbackRemove(int32_t handle)
 {
     int32_t eventQueueHandle = -1;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
     if (gMutex != NULL) {
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+            if (pInstance->atEventQueueHandle >= 0) {
+                eventQueueHandle = pInstance->atEventQueueHandle;
+                pInstance->atEventQueueHandle = -1;
+                pInstance->pAtCallback = NULL;
+            }
+
+            uPortMutexUnlock(pInstance->mutex);
 
-        if ((handle == gEdmStream.handle) &&
-            (gEdmStream.atEventQueueHandle >= 0)) {
-            eventQueueHandle = gEdmStream.atEventQueueHandle;
-            gEdmStream.atEventQueueHandle = -1;
-            gEdmStream.pAtCallback = NULL;
+            if (eventQueueHandle >= 0) {
+                uPortEventQueueClose(eventQueueHandle);
+            }
         }
+    }
+}
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+int32_t uPortShortRangeEdmStremAtEventStackMinFree(int32_t handle)
+{
+    int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    if (gMutex != NULL) {
+
+        sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
 
-        if (eventQueueHandle >= 0) {
-            uPortEventQueueClose(eventQueueHandle);
+            if (pInstance->atEventQueueHandle >= 0) {
+                sizeOrErrorCode = uPortEventQueueStackMinFree(pInstance->atEventQueueHandle);
+            }
+
+            uPortMutexUnlock(pInstance->mutex);
         }
     }
+
+    return sizeOrErrorCode;
 }
 
+int32_t uShortRangeEdmStreamBufferExhaustedCountGet(int32_t handle)
+{
+    int32_t countOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
-int32_t uPortShortRangeEdmStremAtEventStackMinFree(int32_t handle)
+    if (gMutex != NULL) {
+
+        countOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+            countOrErrorCode = pInstance->bufferExhaustedCount;
+
+            U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+            uPortMutexUnlock(pInstance->mutex);
+        }
+    }
+
+    return countOrErrorCode;
+}
+
+int32_t uShortRangeEdmStreamResyncCountGet(int32_t handle)
 {
-    int32_t sizeOrErrorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    int32_t countOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
+        countOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
 
-        sizeOrErrorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
-        if ((handle == gEdmStream.handle) &&
-            (gEdmStream.atEventQueueHandle >= 0)) {
-            sizeOrErrorCode = uPortEventQueueStackMinFree(gEdmStream.atEventQueueHandle);
+            U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+            countOrErrorCode = pInstance->resyncCount;
+
+            U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+            uPortMutexUnlock(pInstance->mutex);
         }
+    }
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+    return countOrErrorCode;
+}
+
+int32_t uShortRangeEdmStreamDiscardedCountGet(int32_t handle)
+{
+    int32_t countOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    if (gMutex != NULL) {
+
+        countOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+            countOrErrorCode = pInstance->discardedCount;
+
+            U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+            uPortMutexUnlock(pInstance->mutex);
+        }
     }
 
-    return sizeOrErrorCode;
+    return countOrErrorCode;
+}
+
+int32_t uShortRangeEdmStreamTxDroppedCountGet(int32_t handle)
+{
+    int32_t countOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+
+    if (gMutex != NULL) {
+
+        countOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            countOrErrorCode = pInstance->txDroppedCount;
+
+            uPortMutexUnlock(pInstance->mutex);
+        }
+    }
+
+    return countOrErrorCode;
+}
+
+int32_t uShortRangeEdmStreamChannelStatsGet(int32_t handle, int32_t channel,
+                                            uint32_t *pTxBytes, uint32_t *pRxBytes)
+{
+    int32_t errorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
+    uShortRangeEdmConnection_t *pConnection;
+
+    if (gMutex != NULL) {
+
+        errorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
+
+            pConnection = pUShortRangeEdmConnectionGet(&pInstance->connections, channel);
+            if (pConnection != NULL) {
+                if (pTxBytes != NULL) {
+                    *pTxBytes = pConnection->txBytes;
+                }
+                if (pRxBytes != NULL) {
+                    *pRxBytes = pConnection->rxBytes;
+                }
+                errorCode = (int32_t)U_ERROR_COMMON_SUCCESS;
+            }
+
+            uPortMutexUnlock(pInstance->mutex);
+        }
+    }
+
+    return errorCode;
 }
 
 int32_t uShortRangeEdmStreamAtGetReceiveSize(int32_t handle)
 {
     int32_t sizeOrErrorCode = (int32_t)U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangeEdmStreamInstance_t *pInstance;
 
     if (gMutex != NULL) {
 
-        U_PORT_MUTEX_LOCK(gMutex);
-
         sizeOrErrorCode = (int32_t)U_ERROR_COMMON_INVALID_PARAMETER;
-        if (handle == gEdmStream.handle) {
-            sizeOrErrorCode = gEdmStream.atResponseLength - gEdmStream.atResponseRead;
-        }
+        pInstance = pInstanceLock(handle);
+        if (pInstance != NULL) {
 
-        U_PORT_MUTEX_UNLOCK(gMutex);
+            U_PORT_MUTEX_LOCK(pInstance->bufferMutex);
+
+            sizeOrErrorCode = (int32_t) pInstance->atResponseCount;
+
+            U_PORT_MUTEX_UNLOCK(pInstance->bufferMutex);
+            uPortMutexUnlock(pInstance->mutex);
+        }
     }
 
     return sizeOrErrorCode;
@@ -38,6 +38,7 @@
 #include "u_at_client.h"
 
 #include "u_short_range_module_type.h"
+#include "u_short_range_edm.h"
 #include "u_short_range_private.h"
 
 /* ----------------------------------------------------------------
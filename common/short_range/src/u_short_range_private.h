@@ -36,8 +36,6 @@ extern "C" {
 #define U_SHORT_RANGE_UUDPC_TYPE_IPv4 2
 #define U_SHORT_RANGE_UUDPC_TYPE_IPv6 3
 
-#define U_SHORT_RANGE_MAX_CONNECTIONS 9
-
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -76,11 +74,6 @@ typedef struct {
                                     normally immediate responses. */
 } uShortRangePrivateModule_t;
 
-typedef struct uShortRangePrivateConnection_t {
-    int32_t connHandle;
-    int32_t type;
-} uShortRangePrivateConnection_t;
-
 /** Definition of a ShortRange instance.
  */
 //lint -esym(768, uShortRangePrivateInstance_t::pSpsConnectionCallback) Suppress not reference, it is
@@ -97,7 +90,7 @@ typedef struct uShortRangePrivateInstance_t {
     uAtClientStream_t streamType; /**< Stream type. */
     int64_t startTimeMs;     /**< Used while restarting. */
     int64_t ticksLastRestart;
-    uShortRangePrivateConnection_t connections[U_SHORT_RANGE_MAX_CONNECTIONS];
+    uShortRangeEdmConnectionTable_t connections; /**< Connections by peer handle. */
     void (*pBtConnectionStatusCallback) (int32_t, int32_t, void *);
     void *pBtConnectionStatusCallbackParameter;
     void (*pWifiConnectionStatusCallback) (int32_t, int32_t, void *);
@@ -105,6 +98,7 @@ typedef struct uShortRangePrivateInstance_t {
     void (*pSpsConnectionCallback) (int32_t, char *, int32_t, int32_t, int32_t, void *);
     void *pSpsConnectionCallbackParameter;
     void *pPendingSpsConnectionEvent;
+    void *pSpsContext; /**< SPS channel state, owned by the ble data API. */
     void (*pBtDataCallback) (int32_t, size_t, char *, void *);
     void *pBtDataCallbackParameter;
     void (*pDataCallback) (int32_t, size_t, char *, void *);
@@ -51,25 +51,111 @@
 
 #include "u_short_range_module_type.h"
 #include "u_short_range.h"
+#include "u_short_range_edm.h"
 #ifdef U_CFG_TEST_SHORT_RANGE_MODULE_TYPE
 #include "u_short_range_private.h"
 #endif
+#if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B >= 0)
+#include "string.h"    // memset()
+#include "u_cfg_os_platform_specific.h"
+#include "u_port_os.h"
+#endif
 #include "u_short_range_test_private.h"
 
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
 
+#if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B >= 0)
+
+/** The EDM connect event type, as sent by the module.
+ */
+#define U_SHORT_RANGE_TEST_EDM_TYPE_CONNECT_EVENT 0x11
+
+/** The EDM data event type, as sent by the module.
+ */
+#define U_SHORT_RANGE_TEST_EDM_TYPE_DATA_EVENT 0x31
+
+/** The EDM AT response type, as sent by the module.
+ */
+#define U_SHORT_RANGE_TEST_EDM_TYPE_AT_RESPONSE 0x45
+
+/** The amount of text in each AT response frame of the EDM AT
+ * response FIFO test: not a factor of the FIFO length so that
+ * frames are split across the end of it.
+ */
+#define U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH 300
+
+/** The number of AT response frames to send in the EDM AT
+ * response FIFO test: enough to go round the FIFO a few times.
+ */
+#define U_SHORT_RANGE_TEST_EDM_NUM_AT_RESPONSES ((U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH * 3) / \
+                                                 U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH)
+
+/** The size of the reads in the EDM AT response FIFO test: not a
+ * factor of the frame length so that reads stop part way through
+ * a frame.
+ */
+#define U_SHORT_RANGE_TEST_EDM_AT_READ_LENGTH 101
+
+/** The EDM channel to use when testing the EDM stream.
+ */
+#define U_SHORT_RANGE_TEST_EDM_CHANNEL 1
+
+/** The number of data frames to send to each instance in the
+ * EDM stream two instances test.
+ */
+#define U_SHORT_RANGE_TEST_EDM_NUM_FRAMES_EACH 10
+
+/** The number of data frames to send in the EDM buffer pool test:
+ * as many as may be pending at once, all of which fit in a single
+ * UART buffer.
+ */
+#define U_SHORT_RANGE_TEST_EDM_NUM_DATA_FRAMES U_EDM_STREAM_DATA_EVENT_QUEUE_SIZE
+
+/** The amount of data in each frame of the EDM buffer pool test.
+ */
+#define U_SHORT_RANGE_TEST_EDM_DATA_LENGTH 100
+
+/** How long the slow data callback of the EDM buffer pool test
+ * takes over each data event.
+ */
+#define U_SHORT_RANGE_TEST_EDM_SLOW_CALLBACK_MS 100
+
+#endif
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
 
+#if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B >= 0)
+
+/** Context for dataCallback(), passed in as pParam.
+ */
+typedef struct {
+    int32_t edmStreamHandle; /**< The EDM stream the data should arrive on. */
+    int32_t delayMs; /**< How long to take over each data event. */
+    volatile int32_t framesReceived; /**< The number of data frames received. */
+    volatile bool error; /**< Set to true if a data frame is not what was expected. */
+} uShortRangeTestEdmData_t;
+
+#endif
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
 
 static uShortRangeTestPrivate_t gHandles = {-1, -1, NULL, -1};
 
+#if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B >= 0)
+
+/** Handle for the UART that plays the part of the module when
+ * testing the EDM stream.
+ */
+static int32_t gUartBHandle = -1;
+
+#endif
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -81,6 +167,210 @@ static void resetGlobals()
     gHandles.shortRangeHandle = -1;
 }
 
+#if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B >= 0)
+
+// Open an EDM stream on UART A and, on UART B, the far end
+// through which the EDM stream tests play the part of the module.
+static void edmStreamPreamble()
+{
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    gHandles.uartHandle = uPortUartOpen(U_CFG_TEST_UART_A,
+                                        U_CFG_TEST_BAUD_RATE,
+                                        NULL,
+                                        U_CFG_TEST_UART_BUFFER_LENGTH_BYTES,
+                                        U_CFG_TEST_PIN_UART_A_TXD,
+                                        U_CFG_TEST_PIN_UART_A_RXD,
+                                        U_CFG_TEST_PIN_UART_A_CTS,
+                                        U_CFG_TEST_PIN_UART_A_RTS);
+    U_PORT_TEST_ASSERT(gHandles.uartHandle >= 0);
+    gUartBHandle = uPortUartOpen(U_CFG_TEST_UART_B,
+                                 U_CFG_TEST_BAUD_RATE,
+                                 NULL,
+                                 U_CFG_TEST_UART_BUFFER_LENGTH_BYTES,
+                                 U_CFG_TEST_PIN_UART_B_TXD,
+                                 U_CFG_TEST_PIN_UART_B_RXD,
+                                 U_CFG_TEST_PIN_UART_B_CTS,
+                                 U_CFG_TEST_PIN_UART_B_RTS);
+    U_PORT_TEST_ASSERT(gUartBHandle >= 0);
+    uPortLog("U_SHORT_RANGE_TEST: EDM stream will be on UART %d and"
+             " the \"module\" on UART %d, make sure these are"
+             " cross-connected.\n", U_CFG_TEST_UART_A, U_CFG_TEST_UART_B);
+
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamInit() == 0);
+    gHandles.edmStreamHandle = uShortRangeEdmStreamOpen(gHandles.uartHandle);
+    U_PORT_TEST_ASSERT(gHandles.edmStreamHandle >= 0);
+}
+
+// Tidy up after edmStreamPreamble().
+static void edmStreamPostamble()
+{
+    uShortRangeEdmStreamClose(gHandles.edmStreamHandle);
+    uShortRangeEdmStreamDeinit();
+    uPortUartClose(gUartBHandle);
+    gUartBHandle = -1;
+    uPortUartClose(gHandles.uartHandle);
+    uPortDeinit();
+    resetGlobals();
+}
+
+// Write bytes to a UART, as the module would.
+static void uartWrite(int32_t uartHandle, const char *pData, size_t length)
+{
+    int32_t x;
+
+    while (length > 0) {
+        x = uPortUartWrite(uartHandle, pData, length);
+        U_PORT_TEST_ASSERT(x > 0);
+        pData += x;
+        length -= (size_t) x;
+    }
+}
+
+// Write an EDM frame of the given type to a UART.
+static void edmFrameSend(int32_t uartHandle, char type,
+                         const char *pPayload, size_t length)
+{
+    char head[5];
+    char tail = (char) U_SHORT_RANGE_EDM_TAIL;
+
+    // The length covers the identifier and type bytes
+    head[0] = (char) U_SHORT_RANGE_EDM_HEAD;
+    head[1] = (char) ((length + 2) >> 8);
+    head[2] = (char) (length + 2);
+    head[3] = 0;
+    head[4] = type;
+    uartWrite(uartHandle, head, sizeof(head));
+    uartWrite(uartHandle, pPayload, length);
+    uartWrite(uartHandle, &tail, 1);
+}
+
+// Send an EDM IPv4 connect event for the given channel to a UART,
+// so that the EDM stream at the far end will pass on data for it
+// as Wi-Fi data.
+static void edmConnectSend(int32_t uartHandle, uint8_t channel)
+{
+    // Channel, IPv4, TCP, remote address and port,
+    // local address and port
+    const char payload[] = {(char) channel, 0x02, 0x00,
+                            127, 0, 0, 1, 0x13, (char) 0x88,
+                            127, 0, 0, 1, 0x13, (char) 0x89
+                           };
+
+    edmFrameSend(uartHandle, U_SHORT_RANGE_TEST_EDM_TYPE_CONNECT_EVENT,
+                 payload, sizeof(payload));
+}
+
+// Send a data frame of U_SHORT_RANGE_TEST_EDM_DATA_LENGTH bytes
+// on U_SHORT_RANGE_TEST_EDM_CHANNEL to a UART, filled with the
+// given value.
+static void edmDataSend(int32_t uartHandle, char fill)
+{
+    char payload[U_SHORT_RANGE_TEST_EDM_DATA_LENGTH + 1];
+
+    payload[0] = (char) U_SHORT_RANGE_TEST_EDM_CHANNEL;
+    memset(payload + 1, fill, U_SHORT_RANGE_TEST_EDM_DATA_LENGTH);
+    edmFrameSend(uartHandle, U_SHORT_RANGE_TEST_EDM_TYPE_DATA_EVENT,
+                 payload, sizeof(payload));
+}
+
+// Wait for a number of data frames to have arrived, returning
+// true if they did within the given time.
+static bool edmDataWait(const uShortRangeTestEdmData_t *pContext,
+                        int32_t numFrames, int32_t timeoutMs)
+{
+    int64_t startTimeMs = uPortGetTickTimeMs();
+
+    while ((pContext->framesReceived < numFrames) &&
+           (uPortGetTickTimeMs() - startTimeMs < timeoutMs)) {
+        uPortTaskBlock(100);
+    }
+
+    return (pContext->framesReceived == numFrames);
+}
+
+// The byte at a given offset in the text carried by the AT
+// response frames of the EDM AT response FIFO test; 251 is prime
+// so the text doesn't line up with the FIFO or the frames.
+static char atResponseByte(int32_t offset)
+{
+    return (char) ('!' + (offset % 251) % 94);
+}
+
+// Send an AT response frame carrying the next
+// U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH bytes of text to UART B,
+// updating *pOffset.
+static void edmAtResponseSend(int32_t *pOffset)
+{
+    char payload[U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH];
+
+    for (size_t x = 0; x < sizeof(payload); x++) {
+        payload[x] = atResponseByte(*pOffset);
+        (*pOffset)++;
+    }
+    edmFrameSend(gUartBHandle, U_SHORT_RANGE_TEST_EDM_TYPE_AT_RESPONSE,
+                 payload, sizeof(payload));
+}
+
+// Wait for the AT response FIFO of the EDM stream to hold a given
+// number of bytes, returning true if it did within a second.
+static bool edmAtResponseWait(int32_t length)
+{
+    int64_t startTimeMs = uPortGetTickTimeMs();
+
+    while ((uShortRangeEdmStreamAtGetReceiveSize(gHandles.edmStreamHandle) != length) &&
+           (uPortGetTickTimeMs() - startTimeMs < 1000)) {
+        uPortTaskBlock(10);
+    }
+
+    return (uShortRangeEdmStreamAtGetReceiveSize(gHandles.edmStreamHandle) == length);
+}
+
+// Read up to length bytes from the AT response FIFO of the EDM
+// stream, checking that they carry on the text from *pOffset and
+// updating *pOffset, returning the number of bytes read.
+static int32_t edmAtResponseRead(int32_t length, int32_t *pOffset)
+{
+    char buffer[U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH];
+    int32_t x;
+
+    U_PORT_TEST_ASSERT(length <= (int32_t) sizeof(buffer));
+    x = uShortRangeEdmStreamAtRead(gHandles.edmStreamHandle, buffer, length);
+    U_PORT_TEST_ASSERT((x >= 0) && (x <= length));
+    for (int32_t y = 0; y < x; y++) {
+        U_PORT_TEST_ASSERT(buffer[y] == atResponseByte(*pOffset));
+        (*pOffset)++;
+    }
+
+    return x;
+}
+
+// The data callback for the EDM stream tests, pParam being
+// a pointer to a uShortRangeTestEdmData_t; each data frame is
+// expected to be filled with its sequence number.
+static void dataCallback(int32_t handle, int32_t channel,
+                         int32_t length, char *pData,
+                         void *pParam)
+{
+    uShortRangeTestEdmData_t *pContext = (uShortRangeTestEdmData_t *) pParam;
+
+    if (pContext->delayMs > 0) {
+        uPortTaskBlock(pContext->delayMs);
+    }
+    if ((handle != pContext->edmStreamHandle) ||
+        (channel != U_SHORT_RANGE_TEST_EDM_CHANNEL) ||
+        (length != U_SHORT_RANGE_TEST_EDM_DATA_LENGTH)) {
+        pContext->error = true;
+    }
+    for (int32_t x = 0; x < length; x++) {
+        if (*(pData + x) != (char) pContext->framesReceived) {
+            pContext->error = true;
+        }
+    }
+    pContext->framesReceived++;
+}
+
+#endif
+
 /* ----------------------------------------------------------------
  * PUBLIC FUNCTIONS
  * -------------------------------------------------------------- */
@@ -98,6 +388,84 @@ U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeInitialisation")
     resetGlobals();
 }
 
+/** Add, look up and remove entries in an EDM connection table,
+ * including IDs that are out of range and a table that is full.
+ * Note: this is pure logic, no UART or module is needed.
+ */
+U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeEdmConnectionTable")
+{
+    uShortRangeEdmConnectionTable_t table;
+    uShortRangeEdmConnection_t *pConnection;
+    int32_t id;
+
+    uShortRangeEdmConnectionTableInit(&table);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 0) == NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table,
+                                                    U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS - 1) == NULL);
+
+    // IDs out of range can't be added or found
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionAdd(&table, -1, 0) == NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionAdd(&table,
+                                                    U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS, 0) == NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, -1) == NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table,
+                                                    U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS) == NULL);
+    // Removing what isn't there does nothing
+    uShortRangeEdmConnectionRemove(&table, -1);
+    uShortRangeEdmConnectionRemove(&table, 1);
+    uShortRangeEdmConnectionRemove(&table, U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS);
+
+    // Add a new connection, which starts afresh
+    pConnection = pUShortRangeEdmConnectionAdd(&table, 1, 2);
+    U_PORT_TEST_ASSERT(pConnection != NULL);
+    U_PORT_TEST_ASSERT(pConnection->id == 1);
+    U_PORT_TEST_ASSERT(pConnection->type == 2);
+    U_PORT_TEST_ASSERT(pConnection->frameSize == -1);
+    U_PORT_TEST_ASSERT(pConnection->txBytes == 0);
+    U_PORT_TEST_ASSERT(pConnection->rxBytes == 0);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 1) == pConnection);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 0) == NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 2) == NULL);
+
+    // Adding it again gives the same entry, started afresh
+    pConnection->frameSize = 100;
+    pConnection->txBytes = 10;
+    pConnection->rxBytes = 20;
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionAdd(&table, 1, 3) == pConnection);
+    U_PORT_TEST_ASSERT(pConnection->type == 3);
+    U_PORT_TEST_ASSERT(pConnection->frameSize == -1);
+    U_PORT_TEST_ASSERT(pConnection->txBytes == 0);
+    U_PORT_TEST_ASSERT(pConnection->rxBytes == 0);
+
+    // Fill the table, using IDs up to the top of the range
+    for (int32_t x = 1; x < U_SHORT_RANGE_EDM_MAX_CONNECTIONS; x++) {
+        id = U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS - x;
+        pConnection = pUShortRangeEdmConnectionAdd(&table, id, 0);
+        U_PORT_TEST_ASSERT(pConnection != NULL);
+        U_PORT_TEST_ASSERT(pConnection->id == id);
+        U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, id) == pConnection);
+    }
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionAdd(&table, 0, 0) == NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 0) == NULL);
+    // ...but an existing connection can still be added again
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionAdd(&table, 1, 2) != NULL);
+
+    // Removing one makes room for another
+    uShortRangeEdmConnectionRemove(&table, 1);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 1) == NULL);
+    pConnection = pUShortRangeEdmConnectionAdd(&table, 0, 0);
+    U_PORT_TEST_ASSERT(pConnection != NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 0) == pConnection);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table,
+                                                    U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS - 1) != NULL);
+
+    // Init empties it again
+    uShortRangeEdmConnectionTableInit(&table);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table, 0) == NULL);
+    U_PORT_TEST_ASSERT(pUShortRangeEdmConnectionGet(&table,
+                                                    U_SHORT_RANGE_EDM_MAX_CONNECTION_IDS - 1) == NULL);
+}
+
 #if (U_CFG_TEST_UART_A >= 0)
 /** Add a ShortRange instance and remove it again using an uart stream.
  * Note: no short range operations are actually carried out and
@@ -185,6 +553,15 @@ U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeAddEdm")
     gHandles.edmStreamHandle = uShortRangeEdmStreamOpen(gHandles.uartHandle);
     U_PORT_TEST_ASSERT(gHandles.edmStreamHandle >= 0);
 
+    uPortLog("U_SHORT_RANGE_TEST: opening another edm stream on the same UART,"
+             " should fail...\n");
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamOpen(gHandles.uartHandle) < 0);
+
+    // The link quality counters can be read as soon as the stream is open
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(gHandles.edmStreamHandle) >= 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDiscardedCountGet(gHandles.edmStreamHandle) >= 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(-1) < 0);
+
     uPortLog("U_SHORT_RANGE_TEST: adding an AT client on edm stream...\n");
     gHandles.atClientHandle = uAtClientAdd(gHandles.edmStreamHandle, U_AT_CLIENT_STREAM_TYPE_EDM,
                                            NULL, U_SHORT_RANGE_AT_BUFFER_LENGTH_BYTES);
@@ -226,6 +603,250 @@ U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeAddEdm")
 }
 #endif
 
+#if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B >= 0)
+/** Check that a short burst of data to a slow data callback
+ * doesn't exhaust the EDM stream's buffer pool, i.e. that frames
+ * aren't moved out of a UART buffer that still has room, and that
+ * all of the data arrives, in order.
+ * Note: requires UARTs A and B to be cross-connected.
+ */
+U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeEdmBufferPool")
+{
+    uShortRangeTestEdmData_t context = {0};
+    int32_t exhaustedCount;
+
+    uPortDeinit();
+    edmStreamPreamble();
+
+    context.edmStreamHandle = gHandles.edmStreamHandle;
+    context.delayMs = U_SHORT_RANGE_TEST_EDM_SLOW_CALLBACK_MS;
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDataEventCallbackSet(gHandles.edmStreamHandle,
+                                                                U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                dataCallback, &context,
+                                                                U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
+                                                                U_CFG_OS_PRIORITY_MAX - 5) == 0);
+    edmConnectSend(gUartBHandle, U_SHORT_RANGE_TEST_EDM_CHANNEL);
+    exhaustedCount = uShortRangeEdmStreamBufferExhaustedCountGet(gHandles.edmStreamHandle);
+    U_PORT_TEST_ASSERT(exhaustedCount >= 0);
+
+    uPortLog("U_SHORT_RANGE_TEST: sending %d data frames to a slow"
+             " data callback...\n", U_SHORT_RANGE_TEST_EDM_NUM_DATA_FRAMES);
+    for (int32_t x = 0; x < U_SHORT_RANGE_TEST_EDM_NUM_DATA_FRAMES; x++) {
+        edmDataSend(gUartBHandle, (char) x);
+    }
+
+    // Wait for the slow callback to get through the lot
+    edmDataWait(&context, U_SHORT_RANGE_TEST_EDM_NUM_DATA_FRAMES,
+                (U_SHORT_RANGE_TEST_EDM_NUM_DATA_FRAMES *
+                 U_SHORT_RANGE_TEST_EDM_SLOW_CALLBACK_MS * 2) + 1000);
+    uPortLog("U_SHORT_RANGE_TEST: %d data frame(s) received, buffer pool"
+             " exhausted %d time(s).\n", context.framesReceived,
+             uShortRangeEdmStreamBufferExhaustedCountGet(gHandles.edmStreamHandle) -
+             exhaustedCount);
+    U_PORT_TEST_ASSERT(context.framesReceived == U_SHORT_RANGE_TEST_EDM_NUM_DATA_FRAMES);
+    U_PORT_TEST_ASSERT(!context.error);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamBufferExhaustedCountGet(gHandles.edmStreamHandle) ==
+                       exhaustedCount);
+
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDataEventCallbackSet(gHandles.edmStreamHandle,
+                                                                U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                NULL, NULL, 0, 0) == 0);
+    edmStreamPostamble();
+}
+
+/** Check that AT responses make it through the EDM stream's AT
+ * response FIFO intact when reads don't line up with frames, when
+ * frames are split across the end of the FIFO and when a frame has
+ * to wait for room in it.
+ * Note: requires UARTs A and B to be cross-connected.
+ */
+U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeEdmAtResponseFifo")
+{
+    int32_t sent = 0;
+    int32_t received = 0;
+    int32_t numFrames = 0;
+    char buffer[1];
+
+    uPortDeinit();
+    edmStreamPreamble();
+
+    // Reading an empty FIFO gets nothing
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gHandles.edmStreamHandle) == 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtRead(gHandles.edmStreamHandle,
+                                                  buffer, sizeof(buffer)) == 0);
+
+    // Send one more frame than will fit: the last should be held
+    // back until there is room for all of it
+    while (sent + U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH <=
+           U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH) {
+        edmAtResponseSend(&sent);
+        numFrames++;
+    }
+    edmAtResponseSend(&sent);
+    numFrames++;
+    U_PORT_TEST_ASSERT(edmAtResponseWait(sent - U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH));
+    uPortTaskBlock(100);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gHandles.edmStreamHandle) ==
+                       sent - U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH);
+
+    // Read a little at a time until there is room for the
+    // last frame, which should then arrive
+    while (U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH -
+           (sent - U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH - received) <
+           U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH) {
+        U_PORT_TEST_ASSERT(edmAtResponseRead(7, &received) == 7);
+    }
+    U_PORT_TEST_ASSERT(edmAtResponseWait(sent - received));
+
+    // Now keep the FIFO busy, reading it in lumps that don't match
+    // the frames, until the text has been round it a few times
+    while (numFrames < U_SHORT_RANGE_TEST_EDM_NUM_AT_RESPONSES) {
+        while (U_SHORT_RANGE_EDM_STREAM_AT_RESPONSE_LENGTH - (sent - received) <
+               U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH) {
+            U_PORT_TEST_ASSERT(edmAtResponseRead(U_SHORT_RANGE_TEST_EDM_AT_READ_LENGTH,
+                                                 &received) > 0);
+        }
+        edmAtResponseSend(&sent);
+        numFrames++;
+        U_PORT_TEST_ASSERT(edmAtResponseWait(sent - received));
+    }
+
+    // A read larger than what is left gets just what is left
+    while (received < sent) {
+        U_PORT_TEST_ASSERT(edmAtResponseRead(U_SHORT_RANGE_TEST_EDM_AT_RESPONSE_LENGTH,
+                                             &received) > 0);
+    }
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamAtGetReceiveSize(gHandles.edmStreamHandle) == 0);
+    uPortLog("U_SHORT_RANGE_TEST: %d byte(s) of AT response in %d frame(s)"
+             " through the FIFO.\n", received, numFrames);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(gHandles.edmStreamHandle) == 0);
+
+    edmStreamPostamble();
+}
+
+/** Feed the EDM stream noise and stray header bytes, each lot
+ * followed by a good data frame, and check that the bad bytes are
+ * counted and thrown away and that the good frames get through.
+ * Note: requires UARTs A and B to be cross-connected.
+ */
+U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeEdmResync")
+{
+    uShortRangeTestEdmData_t context = {0};
+    // No header byte in here
+    const char noise[] = {'n', 'o', 'i', 's', 'e', (char) U_SHORT_RANGE_EDM_TAIL};
+    // A header byte followed by a length with the top bits set,
+    // more than U_SHORT_RANGE_EDM_MAX_SIZE
+    const char badLength[] = {(char) U_SHORT_RANGE_EDM_HEAD, (char) 0xF0, 0x00};
+    // A header byte followed by a plausible length, but the byte
+    // where the tail should be will be in the next frame
+    const char noTail[] = {(char) U_SHORT_RANGE_EDM_HEAD, 0x00, 0x05};
+    int32_t discarded = (int32_t) (sizeof(noise) + sizeof(badLength) + sizeof(noTail));
+
+    uPortDeinit();
+    edmStreamPreamble();
+
+    context.edmStreamHandle = gHandles.edmStreamHandle;
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDataEventCallbackSet(gHandles.edmStreamHandle,
+                                                                U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                dataCallback, &context,
+                                                                U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
+                                                                U_CFG_OS_PRIORITY_MAX - 5) == 0);
+    edmConnectSend(gUartBHandle, U_SHORT_RANGE_TEST_EDM_CHANNEL);
+    edmDataSend(gUartBHandle, 0);
+    U_PORT_TEST_ASSERT(edmDataWait(&context, 1, 1000));
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(gHandles.edmStreamHandle) == 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDiscardedCountGet(gHandles.edmStreamHandle) == 0);
+
+    // Each lot of bad bytes is a resync, ended by the good
+    // frame that follows it
+    uartWrite(gUartBHandle, noise, sizeof(noise));
+    edmDataSend(gUartBHandle, 1);
+    U_PORT_TEST_ASSERT(edmDataWait(&context, 2, 1000));
+    uartWrite(gUartBHandle, badLength, sizeof(badLength));
+    edmDataSend(gUartBHandle, 2);
+    U_PORT_TEST_ASSERT(edmDataWait(&context, 3, 1000));
+    uartWrite(gUartBHandle, noTail, sizeof(noTail));
+    edmDataSend(gUartBHandle, 3);
+    U_PORT_TEST_ASSERT(edmDataWait(&context, 4, 1000));
+
+    uPortLog("U_SHORT_RANGE_TEST: %d resync(s), %d byte(s) discarded.\n",
+             uShortRangeEdmStreamResyncCountGet(gHandles.edmStreamHandle),
+             uShortRangeEdmStreamDiscardedCountGet(gHandles.edmStreamHandle));
+    U_PORT_TEST_ASSERT(!context.error);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(gHandles.edmStreamHandle) == 3);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDiscardedCountGet(gHandles.edmStreamHandle) ==
+                       discarded);
+
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDataEventCallbackSet(gHandles.edmStreamHandle,
+                                                                U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                NULL, NULL, 0, 0) == 0);
+    edmStreamPostamble();
+}
+
+/** Run two EDM stream instances at once, one on each of two
+ * cross-connected UARTs, each playing the module for the other,
+ * then close one while the other carries on.
+ */
+U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeEdmStreamTwoInstances")
+{
+    uShortRangeTestEdmData_t contextA = {0};
+    uShortRangeTestEdmData_t contextB = {0};
+    int32_t edmStreamHandleB;
+
+    uPortDeinit();
+    edmStreamPreamble();
+
+    // A UART can only have one EDM stream
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamOpen(gHandles.uartHandle) < 0);
+    edmStreamHandleB = uShortRangeEdmStreamOpen(gUartBHandle);
+    U_PORT_TEST_ASSERT(edmStreamHandleB >= 0);
+    U_PORT_TEST_ASSERT(edmStreamHandleB != gHandles.edmStreamHandle);
+
+    contextA.edmStreamHandle = gHandles.edmStreamHandle;
+    contextB.edmStreamHandle = edmStreamHandleB;
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDataEventCallbackSet(gHandles.edmStreamHandle,
+                                                                U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                dataCallback, &contextA,
+                                                                U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
+                                                                U_CFG_OS_PRIORITY_MAX - 5) == 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDataEventCallbackSet(edmStreamHandleB,
+                                                                U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                dataCallback, &contextB,
+                                                                U_EDM_STREAM_TASK_STACK_SIZE_BYTES,
+                                                                U_CFG_OS_PRIORITY_MAX - 5) == 0);
+
+    // What is written to UART B arrives at the EDM stream on
+    // UART A and vice versa
+    edmConnectSend(gUartBHandle, U_SHORT_RANGE_TEST_EDM_CHANNEL);
+    edmConnectSend(gHandles.uartHandle, U_SHORT_RANGE_TEST_EDM_CHANNEL);
+    for (int32_t x = 0; x < U_SHORT_RANGE_TEST_EDM_NUM_FRAMES_EACH; x++) {
+        edmDataSend(gUartBHandle, (char) x);
+        edmDataSend(gHandles.uartHandle, (char) x);
+    }
+    U_PORT_TEST_ASSERT(edmDataWait(&contextA, U_SHORT_RANGE_TEST_EDM_NUM_FRAMES_EACH, 5000));
+    U_PORT_TEST_ASSERT(edmDataWait(&contextB, U_SHORT_RANGE_TEST_EDM_NUM_FRAMES_EACH, 5000));
+    U_PORT_TEST_ASSERT(!contextA.error);
+    U_PORT_TEST_ASSERT(!contextB.error);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(gHandles.edmStreamHandle) == 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(edmStreamHandleB) == 0);
+
+    // Close the second instance while data is still arriving
+    // at the first: the first should be unaffected and the
+    // handle of the second should no longer work
+    edmDataSend(gUartBHandle, (char) U_SHORT_RANGE_TEST_EDM_NUM_FRAMES_EACH);
+    uShortRangeEdmStreamClose(edmStreamHandleB);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamResyncCountGet(edmStreamHandleB) < 0);
+    U_PORT_TEST_ASSERT(edmDataWait(&contextA, U_SHORT_RANGE_TEST_EDM_NUM_FRAMES_EACH + 1, 5000));
+    U_PORT_TEST_ASSERT(!contextA.error);
+    U_PORT_TEST_ASSERT(contextB.framesReceived == U_SHORT_RANGE_TEST_EDM_NUM_FRAMES_EACH);
+
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamDataEventCallbackSet(gHandles.edmStreamHandle,
+                                                                U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                NULL, NULL, 0, 0) == 0);
+    edmStreamPostamble();
+}
+#endif
+
 #ifdef U_CFG_TEST_SHORT_RANGE_MODULE_TYPE
 
 /** Short range edm stream add and sent attention command.
@@ -315,6 +936,12 @@ U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeRecover")
  */
 U_PORT_TEST_FUNCTION("[shortRange]", "shortRangeCleanUp")
 {
+#if (U_CFG_TEST_UART_A >= 0) && (U_CFG_TEST_UART_B >= 0)
+    if (gUartBHandle >= 0) {
+        uPortUartClose(gUartBHandle);
+        gUartBHandle = -1;
+    }
+#endif
     uShortRangeTestPrivateCleanup(&gHandles);
 }
 
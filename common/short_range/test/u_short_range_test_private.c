@@ -47,6 +47,7 @@
 
 #include "u_short_range_module_type.h"
 #include "u_short_range.h"
+#include "u_short_range_edm.h"
 #include "u_short_range_private.h"
 #include "u_short_range_edm_stream.h"
 #include "u_short_range_test_private.h"
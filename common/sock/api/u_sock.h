@@ -67,6 +67,118 @@ extern "C" {
 # define U_SOCK_CLOSE_TIMEOUT_SECONDS 60
 #endif
 
+#ifndef U_SOCK_CLOSE_POLL_INTERVAL_MS
+/** The interval at which uSockDeinit() checks whether the
+ * sockets it has asked the underlying socket layer to close
+ * have all been closed.
+ */
+# define U_SOCK_CLOSE_POLL_INTERVAL_MS 100
+#endif
+
+#ifndef U_SOCK_WRITE_COALESCE_BUFFER_SIZE_BYTES
+/** The size of the buffer in which small uSockWrite()s are
+ * coalesced on a TCP socket that has write coalescing switched
+ * on (see uSockWriteCoalesceSet()); once this many bytes are
+ * waiting they are sent.  Each socket that has write coalescing
+ * switched on will malloc() a buffer of this size.
+ */
+# define U_SOCK_WRITE_COALESCE_BUFFER_SIZE_BYTES 512
+#endif
+
+#ifndef U_SOCK_WRITE_COALESCE_TIMEOUT_MS
+/** The maximum time that data will sit in a write coalescing
+ * buffer before it is sent.
+ */
+# define U_SOCK_WRITE_COALESCE_TIMEOUT_MS 200
+#endif
+
+#ifndef U_SOCK_WRITE_QUEUE_SIZE_BYTES
+/** The default size of the write queue of a TCP socket that has
+ * its write queue switched on (see uSockWriteQueueSet()); this
+ * may be changed for a given socket with U_SOCK_OPT_SNDBUF.
+ */
+# define U_SOCK_WRITE_QUEUE_SIZE_BYTES 2048
+#endif
+
+#ifndef U_SOCK_WRITE_QUEUE_TOTAL_MAX_BYTES
+/** The maximum amount of memory that the write queues of all
+ * sockets together may occupy; switching a write queue on, or
+ * making one bigger with U_SOCK_OPT_SNDBUF, will fail with
+ * U_SOCK_ENOBUFS if this would be exceeded.
+ */
+# define U_SOCK_WRITE_QUEUE_TOTAL_MAX_BYTES 8192
+#endif
+
+#ifndef U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS
+/** The number of buffers in the pool shared by all sockets in
+ * push mode (see uSockRegisterCallbackDataPush()); when all of
+ * them are held by the application no more data is read from
+ * the underlying network layer.  Must be no more than 32.
+ */
+# define U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS 4
+#endif
+
+#ifndef U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES
+/** The size of each buffer in the push mode pool, which is the
+ * most data that will be passed to a push mode callback in one
+ * go.
+ */
+# define U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES 1024
+#endif
+
+#ifndef U_SOCK_STATS_ENABLE
+/** Set this to 0 to compile out the collection of per-socket
+ * statistics (see uSockStatsGet()), saving RAM and a little
+ * processing on each send/receive.
+ */
+# define U_SOCK_STATS_ENABLE 1
+#endif
+
+#ifndef U_SOCK_STATS_LATENCY_NUM_BINS
+/** The number of bins in the histogram of the time taken
+ * by send calls (see uSockStats_t).
+ */
+# define U_SOCK_STATS_LATENCY_NUM_BINS 8
+#endif
+
+#ifndef U_SOCK_STATS_LATENCY_BIN_0_MS
+/** The upper limit of the first bin in the histogram of the
+ * time taken by send calls, in milliseconds; the upper limit
+ * of each subsequent bin is double that of the one before it.
+ */
+# define U_SOCK_STATS_LATENCY_BIN_0_MS 10
+#endif
+
+#ifndef U_SOCK_DNS_CACHE_NUM_ENTRIES
+/** The number of host names that uSockGetHostByName() will
+ * remember the result of looking up; set this to 0 to switch
+ * DNS caching off.  When the cache is full the oldest entry
+ * is replaced.
+ */
+# define U_SOCK_DNS_CACHE_NUM_ENTRIES 4
+#endif
+
+#ifndef U_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES
+/** The maximum length of a host name that can be stored in the
+ * DNS cache, not including the null terminator; the results of
+ * looking up longer host names are not cached.
+ */
+# define U_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES 64
+#endif
+
+#ifndef U_SOCK_DNS_CACHE_TTL_SECONDS
+/** How long a successful host name look-up is remembered for.
+ */
+# define U_SOCK_DNS_CACHE_TTL_SECONDS 300
+#endif
+
+#ifndef U_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS
+/** How long a host name look-up that failed because the host
+ * could not be found is remembered for.
+ */
+# define U_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS 30
+#endif
+
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS: SOCKET OPTIONS FOR SOCKET LEVEL (-1)
  * -------------------------------------------------------------- */
@@ -130,6 +242,10 @@ extern "C" {
 
 /** Socket option: send buffer size. The value matches LWIP
  * which matches the BSD sockets API (see Stevens et al).
+ * This is handled locally as the size of the write queue of
+ * the socket (see uSockWriteQueueSet()), an int32_t, default
+ * U_SOCK_WRITE_QUEUE_SIZE_BYTES; it can only be changed while
+ * the write queue is empty.
  */
 #define U_SOCK_OPT_SNDBUF       0x1001
 
@@ -220,6 +336,30 @@ extern "C" {
  */
 #define U_SOCK_OPT_TCP_KEEPIDLE 0x0002
 
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS: SOCKET OPTIONS FOR SECURITY LEVEL
+ * -------------------------------------------------------------- */
+
+/** The level for options which configure TLS security that is
+ * carried out inside the module rather than on this MCU; there is
+ * no LWIP/BSD equivalent so the value is chosen not to clash with
+ * any of the other levels.
+ */
+#define U_SOCK_OPT_LEVEL_SEC     0x0ffe
+
+/** Security socket option: the security profile (0 to 4 for
+ * cellular) that the module should apply to this socket, or -1
+ * for no security.  The option value is an int32_t and it must
+ * be set after the socket has been created but BEFORE
+ * uSockConnect() is called.  The profile itself, the root CA,
+ * client certificate and client key it refers to etc., should
+ * have been set up beforehand with the uSecurityTlsXxx()
+ * functions of the common/security API; the TLS handshake and record layer are then run
+ * entirely inside the module and only plain-text data passes
+ * between this MCU and the module.
+ */
+#define U_SOCK_OPT_SEC_PROFILE   0x0001
+
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS: MISC
  * -------------------------------------------------------------- */
@@ -336,6 +476,45 @@ typedef struct {
     int32_t lingerSeconds;  //<! linger time in seconds.
 } uSockLinger_t;
 
+/** Statistics for a socket, or for all sockets, see
+ * uSockStatsGet() and uSockStatsTotalGet().  underlyingCalls
+ * counts the sends/receives requested of the underlying network
+ * layer, for cellular each being one or more AT transactions.
+ * Bin 0 of txLatencyHistogram counts the uSockWrite()/uSockSendTo()
+ * calls that took less than U_SOCK_STATS_LATENCY_BIN_0_MS, bin 1
+ * those that took less than twice that, etc., the last bin counting
+ * all the rest.
+ */
+typedef struct {
+    uint32_t txBytes;         /**< bytes sent. */
+    uint32_t txCalls;         /**< uSockWrite()/uSockSendTo() calls. */
+    uint32_t rxBytes;         /**< bytes received. */
+    uint32_t rxCalls;         /**< uSockRead()/uSockReceiveFrom() calls. */
+    uint32_t underlyingCalls; /**< calls to the underlying network layer. */
+    uint32_t partialWrites;   /**< underlying writes that sent less than asked. */
+    uint32_t wouldBlocks;     /**< U_SOCK_EWOULDBLOCK returns. */
+    uint32_t blockedMs;       /**< time blocked waiting to receive. */
+    uint32_t txLatencyHistogram[U_SOCK_STATS_LATENCY_NUM_BINS];
+} uSockStats_t;
+
+/** A datagram, for use with uSockSendToBatch() and
+ * uSockReceiveFromBatch().
+ */
+typedef struct {
+    uSockAddress_t *pAddress; /**< the remote address to send to
+                                   or to write the address of the
+                                   sender to; may be NULL. */
+    void *pData;              /**< the data to send or the buffer
+                                   to receive into; for a send
+                                   this is not modified. */
+    size_t dataSizeBytes;     /**< the number of bytes to send or
+                                   the number of bytes of storage
+                                   at pData. */
+    int32_t result;           /**< filled in with the number of
+                                   bytes sent/received or the
+                                   negated value of U_SOCK_Exxx. */
+} uSockDatagram_t;
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
  * -------------------------------------------------------------- */
@@ -355,7 +534,20 @@ typedef struct {
 int32_t uSockCreate(int32_t networkHandle, uSockType_t type,
                     uSockProtocol_t protocol);
 
-/** Make an outgoing connection on the given socket.
+/** Make an outgoing connection on the given socket.  If the
+ * socket is a non-blocking TCP socket (see uSockBlockingSet())
+ * and the underlying network layer supports it, this function
+ * will return straight away with errno set to U_SOCK_EINPROGRESS
+ * while the connection is made in the background; any callback
+ * registered with uSockRegisterCallbackConnected() will be
+ * called when the connection attempt has completed.  Meanwhile
+ * uSockRead()/uSockWrite() will fail with U_SOCK_EWOULDBLOCK and
+ * uSockConnect() with U_SOCK_EALREADY.  If the connection
+ * attempt fails the socket returns to its unconnected state and
+ * the reason may be read, once, with the socket option
+ * U_SOCK_OPT_ERROR.  Where the underlying network layer does not
+ * support it this function will block until the connection is
+ * made, even for a non-blocking socket.
  *
  * @param descriptor     the descriptor of the socket.
  * @param pRemoteAddress the address of the remote host to connect
@@ -404,7 +596,12 @@ void uSockCleanUp();
  * sockets to be shut down in an organised way, with all sockets
  * closed locally, it can be done by calling this function.
  * It is different from uSockCleanUp() in that all sockets,
- * whatever their state, are closed locally.
+ * whatever their state, are closed locally.  Closure of all
+ * of the sockets is requested at once and this function
+ * then waits for them all to close, or for
+ * U_SOCK_CLOSE_TIMEOUT_SECONDS to pass, so the time taken
+ * does not grow with the number of sockets.  No data, connected
+ * or closed callbacks are called once this function has begun.
  */
 void uSockDeinit();
 
@@ -522,6 +719,55 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
                          uSockAddress_t *pRemoteAddress,
                          void *pData, size_t dataSizeBytes);
 
+/** Send a batch of datagrams on a UDP socket.  This is the
+ * same as calling uSockSendTo() for each datagram but the
+ * underlying network layer can process the lot in one go; for
+ * cellular, for instance, the AT interface is locked only once
+ * and an IP address is only turned into a string when it differs
+ * from that of the previous datagram.  Sending stops at the first
+ * datagram that fails.  Not supported on Wi-Fi, where
+ * U_SOCK_ENOSYS is returned.
+ *
+ * @param descriptor     the descriptor of the socket.
+ * @param pDatagrams     an array of numDatagrams datagrams to
+ *                       send; where pAddress of a datagram is
+ *                       NULL the address from the uSockConnect()
+ *                       call is used.  The result field of each
+ *                       datagram that was attempted is filled in.
+ * @param numDatagrams   the number of entries in pDatagrams.
+ * @return               on success the number of datagrams sent,
+ *                       else negative error code (and errno will
+ *                       also be set to a value from u_sock_errno.h),
+ *                       which will be the case if the first
+ *                       datagram could not be sent.
+ */
+int32_t uSockSendToBatch(uSockDescriptor_t descriptor,
+                         uSockDatagram_t *pDatagrams,
+                         size_t numDatagrams);
+
+/** Receive a batch of datagrams on a UDP socket.  If the socket
+ * is blocking this waits, as uSockReceiveFrom() would, for the
+ * first datagram to arrive; it then fills in as many of the
+ * remaining entries of pDatagrams as there are datagrams already
+ * waiting, without blocking further.  As with uSockReceiveFrom(),
+ * if dataSizeBytes of an entry is too small to hold the datagram
+ * the remainder of that datagram is thrown away.  Not supported
+ * on Wi-Fi, where U_SOCK_ENOSYS is returned without waiting.
+ *
+ * @param descriptor     the descriptor of the socket.
+ * @param pDatagrams     an array of numDatagrams datagrams to
+ *                       receive into; the result field of each
+ *                       datagram that was attempted is filled in.
+ * @param numDatagrams   the number of entries in pDatagrams.
+ * @return               on success the number of datagrams
+ *                       received, else negative error code (and
+ *                       errno will also be set to a value from
+ *                       u_sock_errno.h).
+ */
+int32_t uSockReceiveFromBatch(uSockDescriptor_t descriptor,
+                              uSockDatagram_t *pDatagrams,
+                              size_t numDatagrams);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: STREAM (TCP)
  * -------------------------------------------------------------- */
@@ -566,6 +812,104 @@ int32_t uSockRead(uSockDescriptor_t descriptor,
 int32_t uSockShutdown(uSockDescriptor_t descriptor,
                       uSockShutdown_t how);
 
+/** Switch write coalescing on or off for a TCP socket; write
+ * coalescing is off by default.  When it is on, small
+ * uSockWrite()s are held in a buffer and sent in one go to the
+ * underlying network layer (e.g. in one AT command) once
+ * U_SOCK_WRITE_COALESCE_BUFFER_SIZE_BYTES have been written, when
+ * the oldest data has been waiting for U_SOCK_WRITE_COALESCE_TIMEOUT_MS,
+ * on a call to uSockWriteFlush(), uSockRead(), uSockShutdown() or
+ * uSockClose() or when U_SOCK_OPT_TCP_NODELAY is set to 1, which
+ * stops coalescing until it is set back to 0.  Note that, since
+ * uSockWrite() returns once data is buffered, an error in sending
+ * buffered data will be reported by a subsequent call.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @param onNotOff   true to switch write coalescing on, false to
+ *                   switch it off, in which case any buffered data
+ *                   is sent first.
+ * @return           zero on success else negative error code (and
+ *                   errno will also be set to a value from
+ *                   u_sock_errno.h).
+ */
+int32_t uSockWriteCoalesceSet(uSockDescriptor_t descriptor,
+                              bool onNotOff);
+
+/** Get whether write coalescing is on or off for a socket.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @return           true if write coalescing is on, else false.
+ */
+bool uSockWriteCoalesceGet(uSockDescriptor_t descriptor);
+
+/** Send any data that is being held in the write coalescing
+ * buffer of a socket.  If write coalescing is off this does
+ * nothing.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @return           zero on success else negative error code (and
+ *                   errno will also be set to a value from
+ *                   u_sock_errno.h).
+ */
+int32_t uSockWriteFlush(uSockDescriptor_t descriptor);
+
+/** Get the number of writes to the underlying network layer
+ * (e.g. AT commands) that write coalescing has saved on a socket,
+ * i.e. the number of uSockWrite() calls that were sent along with
+ * the data of another uSockWrite() call.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @return           the number of writes saved else negative error
+ *                   code (and errno will also be set to a value
+ *                   from u_sock_errno.h).
+ */
+int32_t uSockWriteCoalesceSavedGet(uSockDescriptor_t descriptor);
+
+/** Switch the write queue on or off for a TCP socket; the write
+ * queue is off by default.  When it is on, uSockWrite() copies
+ * the data into the write queue of the socket and returns
+ * straight away, never waiting on the underlying network layer;
+ * a task shared by all sockets then sends the data in the
+ * background.  If there is not room in the write queue for all
+ * of the data uSockWrite() queues what it can and returns the
+ * number of bytes queued, or fails with U_SOCK_EWOULDBLOCK if the
+ * write queue is full.  The size of the write queue is set with
+ * U_SOCK_OPT_SNDBUF and the total memory taken by the write queues
+ * of all sockets is limited to U_SOCK_WRITE_QUEUE_TOTAL_MAX_BYTES.
+ * Use uSockRegisterCallbackWriteQueue() to find out how sending
+ * went.  The write queue takes the place of write coalescing: the
+ * two cannot be on at the same time.  uSockShutdown() and
+ * uSockClose() send whatever is left in the write queue before
+ * doing their thing.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @param onNotOff   true to switch the write queue on, false to
+ *                   switch it off, in which case anything still
+ *                   in the write queue is sent first.
+ * @return           zero on success else negative error code (and
+ *                   errno will also be set to a value from
+ *                   u_sock_errno.h).
+ */
+int32_t uSockWriteQueueSet(uSockDescriptor_t descriptor,
+                           bool onNotOff);
+
+/** Get whether the write queue is on or off for a socket.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @return           true if the write queue is on, else false.
+ */
+bool uSockWriteQueueGet(uSockDescriptor_t descriptor);
+
+/** Get the number of bytes in the write queue of a socket that
+ * are yet to be sent.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @return           the number of bytes waiting to be sent else
+ *                   negative error code (and errno will also be
+ *                   set to a value from u_sock_errno.h).
+ */
+int32_t uSockWriteQueueLengthGet(uSockDescriptor_t descriptor);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: ASYNC
  * -------------------------------------------------------------- */
@@ -592,6 +936,50 @@ void uSockRegisterCallbackData(uSockDescriptor_t descriptor,
                                void (*pCallback) (void *),
                                void *pCallbackParameter);
 
+/** Switch a TCP socket into push mode: incoming data is read
+ * from the underlying network layer by this library as soon as
+ * it is signalled and pCallback is called with the descriptor,
+ * a pointer to a buffer containing the data, the number of bytes
+ * of data and pCallbackParameter.  The buffer comes from a pool
+ * of U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS buffers shared by all
+ * sockets and the application MUST give it back by calling
+ * uSockDataPushBufferRelease() when done with it; this may be
+ * done from the callback or later, from another task.  While
+ * all of the buffers are held by the application no more data
+ * is read, leaving it in the underlying network layer (and
+ * hence applying backpressure to the far end); reading resumes
+ * when a buffer is released.  Don't call uSockRead() on a socket
+ * in push mode.  The callback is run in a task shared by all
+ * sockets in push mode and the same restrictions apply as for
+ * uSockRegisterCallbackData().  All buffers should be released
+ * before uSockCleanUp() or uSockDeinit() is called.
+ *
+ * @param descriptor         the descriptor of the socket.
+ * @param pCallback          the function to call with the data,
+ *                           use NULL to switch push mode off again.
+ * @param pCallbackParameter parameter to be passed to the
+ *                           pCallback function as its last
+ *                           parameter when it is called; may
+ *                           be NULL.
+ * @return                   zero on success else negative error
+ *                           code (and errno will also be set to a
+ *                           value from u_sock_errno.h).
+ */
+int32_t uSockRegisterCallbackDataPush(uSockDescriptor_t descriptor,
+                                      void (*pCallback) (uSockDescriptor_t,
+                                                         char *,
+                                                         size_t,
+                                                         void *),
+                                      void *pCallbackParameter);
+
+/** Give back a buffer that was passed to a push mode callback
+ * (see uSockRegisterCallbackDataPush()) so that it can be used
+ * again.
+ *
+ * @param pBuffer the buffer, as passed to the push mode callback.
+ */
+void uSockDataPushBufferRelease(char *pBuffer);
+
 /** Register a callback which will be called when a socket is
  * closed, either locally or by the remote host.  The stack size
  * and priority of the task within which the callback is run
@@ -613,6 +1001,47 @@ void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
                                  void (*pCallback) (void *),
                                  void *pCallbackParameter);
 
+/** Register a callback which will be called when a connection
+ * attempt made by uSockConnect() on a non-blocking TCP socket
+ * has completed, successfully or otherwise; call uSockConnect()
+ * again to find out which (U_SOCK_EISCONN on success; a
+ * failure can be read with U_SOCK_OPT_ERROR).  The same
+ * restrictions apply as for uSockRegisterCallbackClosed().
+ *
+ * @param descriptor         the descriptor of the socket.
+ * @param pCallback          the function to call, use NULL
+ *                           to cancel a previously registered
+ *                           callback.
+ * @param pCallbackParameter parameter to be passed to the
+ *                           pCallback function when it is
+ *                           called; may be NULL.
+ */
+void uSockRegisterCallbackConnected(uSockDescriptor_t descriptor,
+                                    void (*pCallback) (void *),
+                                    void *pCallbackParameter);
+
+/** Register a callback which will be called by the write queue
+ * task (see uSockWriteQueueSet()) each time it has sent data
+ * from the write queue of a socket, with the number of bytes
+ * sent as the first parameter, or when sending has failed, with
+ * a negated value of errno from u_sock_errno.h as the first
+ * parameter; in the failure case anything else that was in the
+ * write queue has been thrown away.  The same restrictions apply
+ * as for uSockRegisterCallbackClosed().
+ *
+ * @param descriptor         the descriptor of the socket.
+ * @param pCallback          the function to call, use NULL
+ *                           to cancel a previously registered
+ *                           callback.
+ * @param pCallbackParameter parameter to be passed to the
+ *                           pCallback function as its second
+ *                           parameter when it is called; may
+ *                           be NULL.
+ */
+void uSockRegisterCallbackWriteQueue(uSockDescriptor_t descriptor,
+                                     void (*pCallback) (int32_t, void *),
+                                     void *pCallbackParameter);
+
 /* ----------------------------------------------------------------
  * FUNCTIONS: TCP INCOMING (TCP SERVER) ONLY
  * -------------------------------------------------------------- */
@@ -629,6 +1058,11 @@ int32_t uSockBind(uSockDescriptor_t descriptor,
 
 /** Set the given socket into listening mode for an incoming TCP
  * connection. The socket must have been bound to an address first.
+ * The arrival of an incoming connection is indicated to any
+ * callback registered with uSockRegisterCallbackData() on this
+ * socket.  Note that cellular networks do not generally allow
+ * incoming TCP connections unless a private APN or similar has
+ * been arranged with the network operator.
  *
  * @param descriptor the descriptor of the socket to listen on.
  * @param backlog    the number of pending connections that can
@@ -637,7 +1071,10 @@ int32_t uSockBind(uSockDescriptor_t descriptor,
  */
 int32_t uSockListen(uSockDescriptor_t descriptor, size_t backlog);
 
-/** Accept an incoming TCP connection on the given socket.
+/** Accept an incoming TCP connection on the given socket.  If
+ * the socket is blocking this will wait, for up to the receive
+ * timeout of the socket, for a connection to arrive, otherwise
+ * it will fail with U_SOCK_EWOULDBLOCK if there is none.
  *
  * @param descriptor      the descriptor of the socket with the queued
  *                        incoming connection.
@@ -705,7 +1142,13 @@ int32_t uSockGetLocalAddress(uSockDescriptor_t descriptor,
 /** Get the IP address of the given host name.  If the host name
  * is already an IP address then the IP address is returned
  * straight away without any external action, hence this also
- * implements "get host by address".
+ * implements "get host by address".  The result of a look-up,
+ * including failure to find the host, is cached for a time (see
+ * U_SOCK_DNS_CACHE_TTL_SECONDS and
+ * U_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS) and, if a look-up of
+ * the same host name is already in progress, this function
+ * will wait for the result of that look-up rather than
+ * sending another query.
  *
  * @param networkHandle  the handle of the underlying network to
  *                       use for host name look-up.
@@ -722,6 +1165,39 @@ int32_t uSockGetLocalAddress(uSockDescriptor_t descriptor,
 int32_t uSockGetHostByName(int32_t networkHandle, const char *pHostName,
                            uSockIpAddress_t *pHostIpAddress);
 
+/** Empty the cache of host names kept by uSockGetHostByName()
+ * (see U_SOCK_DNS_CACHE_NUM_ENTRIES), e.g. because the network
+ * has changed.
+ */
+void uSockDnsCacheClear();
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: STATISTICS
+ * -------------------------------------------------------------- */
+
+/** Get the statistics for a socket; only available if
+ * U_SOCK_STATS_ENABLE is non-zero.
+ *
+ * @param descriptor the descriptor of the socket.
+ * @param pStats     a place to put the statistics.
+ * @return           zero on success else negative error code
+ *                   (and errno will also be set to a value from
+ *                   u_sock_errno.h).
+ */
+int32_t uSockStatsGet(uSockDescriptor_t descriptor,
+                      uSockStats_t *pStats);
+
+/** Get the statistics summed across all sockets that have
+ * been created since the sockets layer was first used,
+ * including those that are now closed; only available if
+ * U_SOCK_STATS_ENABLE is non-zero.
+ *
+ * @param pStats a place to put the statistics.
+ * @return       zero on success else negative error code
+ *               (and errno will also be set to a value from
+ *               u_sock_errno.h).
+ */
+int32_t uSockStatsTotalGet(uSockStats_t *pStats);
 
 /* ----------------------------------------------------------------
  * FUNCTIONS: ADDRESS CONVERSION
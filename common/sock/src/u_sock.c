@@ -135,6 +135,22 @@
  * This function will only be called on a socket in state
  * U_SOCK_STATE_CREATED.
  *
+ * Connect to a server without blocking (optional):
+ *
+ * int32_t uXxxSockConnectAsync(int32_t networkHandle,
+ *                              int32_t sockHandle,
+ *                              const uSockAddress_t *pRemoteAddress,
+ *                              void (*pCallback) (int32_t,
+ *                                                 int32_t,
+ *                                                 int32_t));
+ *
+ * Called for non-blocking TCP sockets.  Should return zero
+ * once the connection attempt is started and later call
+ * pCallback with networkHandle, sockHandle and zero or a
+ * negated value of errno from the U_SOCK_Exxx list.  Should
+ * return -U_SOCK_ENOSYS if not supported, in which case
+ * uXxxSockConnect() will be called instead.
+ *
  * Deinitialise (optional):
  *
  * void uXxxSockDeinit();
@@ -174,6 +190,9 @@
  * (e.g. -U_SOCK_EINVAL).  All options are passed transparently
  * through except for U_SOCK_OPT_RCVTIMEO which is handled
  * here in the u_sock layer (since blocking is handled here).
+ * U_SOCK_OPT_TCP_NODELAY is passed through but is also handled
+ * here, since it switches off write coalescing, so it is not an
+ * error for the implementation to return -U_SOCK_ENOSYS for it.
  *
  * Get option (optional):
  *
@@ -226,6 +245,33 @@
  * length datagram has been received (where zero should be returned).
  * It is valid to use this call on a TCP socket.
  *
+ * Send-to a batch of datagrams (optional):
+ *
+ * int32_t uXxxSockSendToBatch(int32_t networkHandle,
+ *                             int32_t sockHandle,
+ *                             const uSockAddress_t *pRemoteAddressDefault,
+ *                             uSockDatagram_t *pDatagrams,
+ *                             size_t numDatagrams);
+ *
+ * Sends the datagrams in order, stopping at the first that fails,
+ * filling in the result field of each datagram attempted.
+ * pRemoteAddressDefault, which may be NULL, is used for datagrams
+ * where pAddress is NULL.  Returns the number of datagrams sent or,
+ * if none were sent, the negative errno of the first datagram.
+ *
+ * Receive-from a batch of datagrams (optional):
+ *
+ * int32_t uXxxSockReceiveFromBatch(int32_t networkHandle,
+ *                                  int32_t sockHandle,
+ *                                  uSockDatagram_t *pDatagrams,
+ *                                  size_t numDatagrams);
+ *
+ * Receives as many datagrams as are waiting, up to numDatagrams,
+ * filling in the result field of each datagram attempted, without
+ * blocking.  Returns the number of datagrams received or, if none
+ * were received, a negative errno (U_SOCK_EWOULDBLOCK if there was
+ * nothing to receive).
+ *
  * Write, i.e. byte-oriented or streamed, AKA TCP, data
  * transmission over a connected socket (optional):
  *
@@ -300,7 +346,11 @@
  *                        uSockAddress_t *pRemoteAddress);
  *
  * The return value is the sockHandle to be used with
- * the new connection from now on.
+ * the new connection from now on.  This function should
+ * not block: if no connection has yet arrived it should
+ * return -U_SOCK_EWOULDBLOCK, this layer will do any
+ * waiting.  The arrival of a connection should be
+ * indicated to the data callback of the listening socket.
  */
 
 #ifdef U_CFG_OVERRIDE
@@ -318,19 +368,19 @@
 #include "sys/time.h"  // struct timeval
 
 #include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
 
 #include "u_error_common.h"
 
 #include "u_port.h"
 #include "u_port_debug.h"
 #include "u_port_os.h"
+#include "u_port_event_queue.h"
 
 #include "u_sock_errno.h"
 #include "u_sock.h"
 #include "u_cell_sock.h"
-// Commented out until there is a wifi sockets
-// implementation
-//#include "u_wifi_sock.h"
+#include "u_wifi_sock.h"
 
 #include "u_network_handle.h"
 
@@ -349,6 +399,110 @@
 # define U_SOCK_NUM_STATIC_SOCKETS     7
 #endif
 
+#ifndef U_SOCK_WRITE_COALESCE_TASK_STACK_SIZE_BYTES
+/** The stack size of the task which sends data that has been
+ * sitting in a write coalescing buffer for longer than
+ * U_SOCK_WRITE_COALESCE_TIMEOUT_MS; this task calls down into
+ * the underlying cell/wifi socket layer.
+ */
+# define U_SOCK_WRITE_COALESCE_TASK_STACK_SIZE_BYTES 2048
+#endif
+
+#ifndef U_SOCK_WRITE_COALESCE_TASK_PRIORITY
+/** The priority of the task which sends data that has been
+ * sitting in a write coalescing buffer for too long; this
+ * must be lower than that of the AT client URC task.
+ */
+# define U_SOCK_WRITE_COALESCE_TASK_PRIORITY (U_CFG_OS_PRIORITY_MIN + 2)
+#endif
+
+#ifndef U_SOCK_WRITE_QUEUE_TASK_STACK_SIZE_BYTES
+/** The stack size of the task which sends the data in the
+ * write queues of sockets; this task calls down into the
+ * underlying cell/wifi socket layer.
+ */
+# define U_SOCK_WRITE_QUEUE_TASK_STACK_SIZE_BYTES 2048
+#endif
+
+#ifndef U_SOCK_WRITE_QUEUE_TASK_PRIORITY
+/** The priority of the task which sends the data in the write
+ * queues of sockets; this must be lower than that of the AT
+ * client URC task.
+ */
+# define U_SOCK_WRITE_QUEUE_TASK_PRIORITY (U_CFG_OS_PRIORITY_MIN + 2)
+#endif
+
+#ifndef U_SOCK_WRITE_QUEUE_CHUNK_SIZE_BYTES
+/** The largest amount of data that the write queue task will
+ * send from one socket in one go before moving on to the next
+ * socket; this much is malloc()ed while any write queue is on.
+ */
+# define U_SOCK_WRITE_QUEUE_CHUNK_SIZE_BYTES 1024
+#endif
+
+#ifndef U_SOCK_WRITE_QUEUE_RETRY_INTERVAL_MS
+/** How long the write queue task waits before trying again
+ * when the underlying network layer is not accepting data.
+ */
+# define U_SOCK_WRITE_QUEUE_RETRY_INTERVAL_MS 100
+#endif
+
+#ifndef U_SOCK_DATA_PUSH_TASK_STACK_SIZE_BYTES
+/** The stack size of the task which reads incoming data for
+ * sockets in push mode and calls the push mode callbacks; this
+ * task calls down into the underlying cell/wifi socket layer.
+ */
+# define U_SOCK_DATA_PUSH_TASK_STACK_SIZE_BYTES 2048
+#endif
+
+#ifndef U_SOCK_DATA_PUSH_TASK_PRIORITY
+/** The priority of the task which reads incoming data for
+ * sockets in push mode; this must be lower than that of the
+ * AT client URC task.
+ */
+# define U_SOCK_DATA_PUSH_TASK_PRIORITY (U_CFG_OS_PRIORITY_MIN + 2)
+#endif
+
+#if U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS > 32
+# error U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS must be no more than 32.
+#endif
+
+/** The event sent to the push mode task to ask it to look at
+ * every socket that ran out of buffers.
+ */
+#define U_SOCK_DATA_PUSH_RESUME -1
+
+#if U_SOCK_STATS_ENABLE
+/** Add to a statistic for a socket and to the total across
+ * all sockets.
+ */
+# define U_SOCK_STATS_ADD(pContainer, field, value) do {                     \
+                            (pContainer)->socket.stats.field += (value); \
+                            gStatsTotal.field += (value);                \
+                        } while (0)
+
+/** Get the start time for a latency statistic.
+ */
+# define U_SOCK_STATS_START_TIME_MS() uPortGetTickTimeMs()
+
+/** Add the time since startTimeMs to the send latency histogram.
+ */
+# define U_SOCK_STATS_TX_LATENCY(pContainer, startTimeMs) statsTxLatencyAdd(pContainer, \
+                                                                              startTimeMs)
+#else
+# define U_SOCK_STATS_ADD(pContainer, field, value) do {} while (0)
+# define U_SOCK_STATS_START_TIME_MS() 0
+# define U_SOCK_STATS_TX_LATENCY(pContainer, startTimeMs) (void) (startTimeMs)
+#endif
+
+#ifndef U_SOCK_DNS_CACHE_WAIT_INTERVAL_MS
+/** The interval at which uSockGetHostByName() checks whether
+ * a look-up of the same host name that is already in progress
+ * has completed.
+ */
+# define U_SOCK_DNS_CACHE_WAIT_INTERVAL_MS 100
+#endif
+
 /** Increment a socket descriptor.
  */
 #define U_SOCK_INC_DESCRIPTOR(d)  (d)++;         \
@@ -364,6 +518,9 @@
  */
 typedef enum {
     U_SOCK_STATE_CREATED,   /**< Freshly created, unsullied. */
+    U_SOCK_STATE_CONNECTING, /**< Non-blocking TCP connect in progress. */
+    U_SOCK_STATE_LISTENING, /**< TCP server, waiting for incoming
+                                 connections. */
     U_SOCK_STATE_CONNECTED, /**< TCP connected or UDP has an address. */
     U_SOCK_STATE_SHUTDOWN_FOR_READ,  /**< Block all reads. */
     U_SOCK_STATE_SHUTDOWN_FOR_WRITE, /**< Block all writes. */
@@ -392,11 +549,75 @@ typedef struct {
     int64_t receiveTimeoutMs;
     void (*pDataCallback) (void *);
     void *pDataCallbackParameter;
+    void (*pDataPushCallback) (uSockDescriptor_t, char *, size_t, void *);
+    void *pDataPushCallbackParameter;
     void (*pClosedCallback) (void *);
     void *pClosedCallbackParameter;
+    char *pWriteCoalesceBuffer; /**< Buffer for coalescing small
+                                     writes, NULL if write coalescing
+                                     is not switched on. */
+    size_t writeCoalesceLength; /**< Bytes in pWriteCoalesceBuffer. */
+    size_t writeCoalesceNumWrites; /**< The number of uSockWrite()
+                                        calls that have gone into
+                                        pWriteCoalesceBuffer. */
+    int64_t writeCoalesceStartTimeMs; /**< When the first byte went
+                                           into pWriteCoalesceBuffer. */
+    int32_t writeCoalesceSaved; /**< Number of underlying writes saved. */
+    int32_t writeCoalesceErrno; /**< The errno from a failed flush of
+                                     pWriteCoalesceBuffer that nobody
+                                     was waiting for, reported by the
+                                     next uSockWrite(). */
+    char *pWriteQueueBuffer; /**< Ring buffer of data waiting to be
+                                  sent by the write queue task, NULL
+                                  if the write queue is not switched
+                                  on. */
+    size_t writeQueueSize; /**< The size of pWriteQueueBuffer, set
+                                by U_SOCK_OPT_SNDBUF. */
+    size_t writeQueueRead; /**< Where the oldest byte is in
+                                pWriteQueueBuffer. */
+    size_t writeQueueLength; /**< Bytes in pWriteQueueBuffer. */
+    int64_t writeQueueServiceTimeMs; /**< When the write queue task
+                                          last sent from this socket. */
+    void (*pWriteQueueCallback) (int32_t, void *);
+    void *pWriteQueueCallbackParameter;
+    void (*pConnectedCallback) (void *);
+    void *pConnectedCallbackParameter;
+    int32_t connectErrno; /**< The outcome of a failed non-blocking
+                               connect, reported by U_SOCK_OPT_ERROR. */
+#if U_SOCK_STATS_ENABLE
+    uSockStats_t stats;
+#endif
+    bool noDelay; /**< Set by U_SOCK_OPT_TCP_NODELAY. */
+    bool dataPushPending; /**< The socket has been sent to the push
+                               mode task, protected by gMutexDataPush. */
+    bool dataPushStalled; /**< The push mode task ran out of
+                               buffers for this socket, protected
+                               by gMutexDataPush. */
     bool blocking; // At end to optimise structure packing
 } uSockSocket_t;
 
+/** The state of an entry in the DNS cache.
+ */
+typedef enum {
+    U_SOCK_DNS_CACHE_STATE_EMPTY,
+    U_SOCK_DNS_CACHE_STATE_LOOKING_UP, /**< A look-up is in progress,
+                                            the entry must not be
+                                            replaced. */
+    U_SOCK_DNS_CACHE_STATE_VALID
+} uSockDnsCacheState_t;
+
+/** An entry in the DNS cache.
+ */
+typedef struct {
+    int32_t networkHandle;
+    char hostName[U_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES + 1];
+    uSockIpAddress_t ipAddress;
+    int32_t errnoLocal; /**< U_SOCK_ENONE or U_SOCK_ENXIO
+                             (host not found). */
+    int64_t timeMs; /**< When the look-up completed. */
+    uSockDnsCacheState_t state;
+} uSockDnsCacheEntry_t;
+
 /** A socket container.
  */
 typedef struct uSockContainer_t {
@@ -435,6 +656,95 @@ static uSockDescriptor_t gNextDescriptor = 0;
  */
 static uSockContainer_t gStaticContainers[U_SOCK_NUM_STATIC_SOCKETS];
 
+/** Handle of the event queue that acts as a timer for write
+ * coalescing, opened when write coalescing is first switched on.
+ */
+static int32_t gWriteCoalesceEventQueueHandle = -1;
+
+/** Flag to indicate that the write coalescing timer is running.
+ */
+static bool gWriteCoalesceTimerRunning = false;
+
+/** Mutex held by the write queue task while it is sending and
+ * by anything that sends from or throws away the contents of a
+ * write queue; where both are required this must be locked
+ * BEFORE gMutexContainer.  uSockWrite() doesn't need it.
+ */
+static uPortMutexHandle_t gMutexWriteQueue = NULL;
+
+/** Handle of the event queue that runs the write queue task,
+ * opened when a write queue is first switched on.
+ */
+static int32_t gWriteQueueEventQueueHandle = -1;
+
+/** Flag to indicate that the write queue task is running.
+ */
+static bool gWriteQueueTaskRunning = false;
+
+/** Buffer into which the write queue task copies the data
+ * that it is sending, allocated with gWriteQueueEventQueueHandle.
+ */
+static char *gpWriteQueueChunk = NULL;
+
+/** The total amount of memory taken up by write queues.
+ */
+static size_t gWriteQueueTotalBytes = 0;
+
+/** Mutex to protect the push mode buffer pool and flags; where
+ * gMutexContainer is also required it must be locked BEFORE this
+ * one.  Nothing else may be locked while this is held so that
+ * uSockDataPushBufferRelease() can be called from anywhere.
+ */
+static uPortMutexHandle_t gMutexDataPush = NULL;
+
+/** Handle of the event queue that runs the push mode task,
+ * opened when a socket is first put into push mode.
+ */
+static int32_t gDataPushEventQueueHandle = -1;
+
+/** The push mode buffer pool, allocated with
+ * gDataPushEventQueueHandle.
+ */
+static char *gpDataPushPool = NULL;
+
+/** Bit-map of the buffers in gpDataPushPool that are in use.
+ */
+static uint32_t gDataPushPoolInUse = 0;
+
+/** The number of sockets that the push mode task has had to
+ * stop reading from because it ran out of buffers.
+ */
+static size_t gDataPushNumStalled = 0;
+
+/** Set when U_SOCK_DATA_PUSH_RESUME has been sent to the push
+ * mode task and not yet acted upon.
+ */
+static bool gDataPushResumePending = false;
+
+#if U_SOCK_STATS_ENABLE
+/** Statistics summed across all sockets.
+ */
+static uSockStats_t gStatsTotal = {0};
+#endif
+
+/** Mutex to protect the DNS cache; separate from gMutexContainer
+ * since a DNS look-up can take a long time.
+ */
+static uPortMutexHandle_t gMutexDnsCache = NULL;
+
+#if U_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+/** The DNS cache.
+ */
+static uSockDnsCacheEntry_t gDnsCache[U_SOCK_DNS_CACHE_NUM_ENTRIES];
+#endif
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: FORWARD DECLARATIONS
+ * -------------------------------------------------------------- */
+
+static void dataPushPost(uSockContainer_t *pContainer);
+static void dataPushUnstall(uSockSocket_t *pSocket);
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: MISC
  * -------------------------------------------------------------- */
@@ -455,6 +765,15 @@ static int32_t init()
     if ((errorCode == 0) && (gMutexCallbacks == NULL)) {
         errorCode = uPortMutexCreate(&gMutexCallbacks);
     }
+    if ((errorCode == 0) && (gMutexDnsCache == NULL)) {
+        errorCode = uPortMutexCreate(&gMutexDnsCache);
+    }
+    if ((errorCode == 0) && (gMutexWriteQueue == NULL)) {
+        errorCode = uPortMutexCreate(&gMutexWriteQueue);
+    }
+    if ((errorCode == 0) && (gMutexDataPush == NULL)) {
+        errorCode = uPortMutexCreate(&gMutexDataPush);
+    }
 
     if (errorCode == 0) {
         errnoLocal = U_SOCK_ENONE;
@@ -462,9 +781,9 @@ static int32_t init()
             // uXxxSockInit returns a negated value of errno
             // from the U_SOCK_Exxx list
             errnoLocal = uCellSockInit();
-            // TODO if (errnoLocal == U_SOCK_ENONE) {
-            //          errnoLocal = uWifiSockInit();
-            //      }
+            if (errnoLocal == U_SOCK_ENONE) {
+                errnoLocal = uWifiSockInit();
+            }
 
             if (errnoLocal == U_SOCK_ENONE) {
                 //  Link the static containers into the start of the container list
@@ -500,7 +819,11 @@ static void deinitButNotMutex()
         // to remain.
 
         uCellSockDeinit();
-        // TODO: call uWifiSockDeinit();
+        uWifiSockDeinit();
+
+        // Network handles may be re-used so
+        // what we've cached is no longer valid
+        uSockDnsCacheClear();
 
         gInitialised = false;
     }
@@ -572,6 +895,24 @@ static size_t numContainersInUse()
     return numInUse;
 }
 
+// Determine the number of sockets waiting for closure to
+// be completed by the underlying socket layer.
+// This does NOT lock the mutex, you need to do that.
+static size_t numContainersClosing()
+{
+    uSockContainer_t *pContainer = gpContainerListHead;
+    size_t numClosing = 0;
+
+    while (pContainer != NULL) {
+        if (pContainer->socket.state == U_SOCK_STATE_CLOSING) {
+            numClosing++;
+        }
+        pContainer = pContainer->pNext;
+    }
+
+    return numClosing;
+}
+
 // Create a socket in a container with the given descriptor.
 // This does NOT lock the mutex, you need to do that.
 static uSockContainer_t *pSockContainerCreate(uSockDescriptor_t descriptor,
@@ -587,6 +928,18 @@ static uSockContainer_t *pSockContainerCreate(uSockDescriptor_t descriptor,
     while ((*ppContainerThis != NULL) && (pContainer == NULL)) {
         if ((*ppContainerThis)->socket.state == U_SOCK_STATE_CLOSED) {
             pContainer = *ppContainerThis;
+            // A socket closed by the remote host may still
+            // have a write coalescing buffer or write queue
+            // hanging off it
+            free(pContainer->socket.pWriteCoalesceBuffer);
+            if (pContainer->socket.pWriteQueueBuffer != NULL) {
+                gWriteQueueTotalBytes -= pContainer->socket.writeQueueSize;
+                free(pContainer->socket.pWriteQueueBuffer);
+            }
+            // ...or be waiting for a push mode buffer
+            U_PORT_MUTEX_LOCK(gMutexDataPush);
+            dataPushUnstall(&(pContainer->socket));
+            U_PORT_MUTEX_UNLOCK(gMutexDataPush);
         }
         pContainerPrevious = *ppContainerThis;
         ppContainerThis = &((*ppContainerThis)->pNext);
@@ -618,8 +971,45 @@ static uSockContainer_t *pSockContainerCreate(uSockDescriptor_t descriptor,
         pContainer->socket.receiveTimeoutMs = U_SOCK_DEFAULT_RECEIVE_TIMEOUT_MS;
         pContainer->socket.pDataCallback = NULL;
         pContainer->socket.pDataCallbackParameter = NULL;
+        pContainer->socket.pDataPushCallback = NULL;
+        pContainer->socket.pDataPushCallbackParameter = NULL;
         pContainer->socket.pClosedCallback = NULL;
         pContainer->socket.pClosedCallbackParameter = NULL;
+        pContainer->socket.pConnectedCallback = NULL;
+        pContainer->socket.pConnectedCallbackParameter = NULL;
+        pContainer->socket.pWriteCoalesceBuffer = NULL;
+        pContainer->socket.pWriteQueueBuffer = NULL;
+        pContainer->socket.writeQueueSize = U_SOCK_WRITE_QUEUE_SIZE_BYTES;
+        pContainer->socket.pWriteQueueCallback = NULL;
+        pContainer->socket.pWriteQueueCallbackParameter = NULL;
+    }
+
+    return pContainer;
+}
+
+// Create a socket container using the next free descriptor,
+// returning NULL if there is no memory for it.
+// This does NOT lock the mutex, you need to do that.
+static uSockContainer_t *pSockContainerCreateNext(uSockType_t type,
+                                                  uSockProtocol_t protocol)
+{
+    uSockContainer_t *pContainer = NULL;
+    uSockDescriptor_t descriptor = gNextDescriptor;
+    bool found = false;
+
+    while (!found) {
+        // Try the descriptor value, making sure
+        // each time that it can't be found.
+        if (pContainerFindByDescriptor(descriptor) == NULL) {
+            gNextDescriptor = descriptor;
+            U_SOCK_INC_DESCRIPTOR(gNextDescriptor);
+            // Found a free descriptor, now try to
+            // create the socket in a container
+            pContainer = pSockContainerCreate(descriptor,
+                                              type, protocol);
+            found = true;
+        }
+        U_SOCK_INC_DESCRIPTOR(descriptor);
     }
 
     return pContainer;
@@ -679,21 +1069,69 @@ static void closedCallback(int32_t networkHandle,
                            int32_t sockHandle)
 {
     uSockContainer_t *pContainer;
+    void (*pCallback) (void *) = NULL;
+    void *pCallbackParameter = NULL;
 
     // Don't lock the container mutex here as this
     // needs to be callable while a send or receive is
-    // in progress and that already has the mutex
+    // in progress and that already has the mutex; the
+    // callbacks mutex is enough to stop uSockDeinit()
+    // freeing the container while we are using it
+    U_PORT_MUTEX_LOCK(gMutexCallbacks);
     pContainer = pContainerFindByNetworkLayer(networkHandle,
                                               sockHandle);
     if (pContainer != NULL) {
         // Mark the container as closed
         pContainer->socket.state = U_SOCK_STATE_CLOSED;
-        U_PORT_MUTEX_LOCK(gMutexCallbacks);
-        if (pContainer->socket.pClosedCallback != NULL) {
-            pContainer->socket.pClosedCallback(pContainer->socket.pClosedCallbackParameter);
-            pContainer->socket.pClosedCallback = NULL;
+        // Socket is now closed, can lose the callback
+        pCallback = pContainer->socket.pClosedCallback;
+        pCallbackParameter = pContainer->socket.pClosedCallbackParameter;
+        pContainer->socket.pClosedCallback = NULL;
+    }
+    U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+    // Call the user outside the mutex, with no
+    // reference to the container
+    if (pCallback != NULL) {
+        pCallback(pCallbackParameter);
+    }
+}
+
+// Callback for when a non-blocking connect at the
+// underlying cell/wifi socket layer has completed.
+static void connectedCallback(int32_t networkHandle,
+                              int32_t sockHandle,
+                              int32_t negErrno)
+{
+    uSockContainer_t *pContainer;
+    void (*pCallback) (void *) = NULL;
+    void *pCallbackParameter = NULL;
+
+    // Don't lock the container mutex here, for the
+    // same reason as closedCallback(); the callbacks
+    // mutex protects the container while we use it
+    U_PORT_MUTEX_LOCK(gMutexCallbacks);
+    pContainer = pContainerFindByNetworkLayer(networkHandle,
+                                              sockHandle);
+    if ((pContainer != NULL) &&
+        (pContainer->socket.state == U_SOCK_STATE_CONNECTING)) {
+        if (negErrno == 0) {
+            pContainer->socket.state = U_SOCK_STATE_CONNECTED;
+        } else {
+            // Back to where we started, with the
+            // reason kept for U_SOCK_OPT_ERROR
+            pContainer->socket.connectErrno = -negErrno;
+            pContainer->socket.state = U_SOCK_STATE_CREATED;
         }
-        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+        pCallback = pContainer->socket.pConnectedCallback;
+        pCallbackParameter = pContainer->socket.pConnectedCallbackParameter;
+    }
+    U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+    // Call the user outside the mutex, with no
+    // reference to the container
+    if (pCallback != NULL) {
+        pCallback(pCallbackParameter);
     }
 }
 
@@ -710,6 +1148,10 @@ static void dataCallback(int32_t networkHandle,
     pContainer = pContainerFindByNetworkLayer(networkHandle,
                                               sockHandle);
     if (pContainer != NULL) {
+        if (pContainer->socket.pDataPushCallback != NULL) {
+            // In push mode the push mode task reads the data
+            dataPushPost(pContainer);
+        }
         U_PORT_MUTEX_LOCK(gMutexCallbacks);
         if (pContainer->socket.pDataCallback != NULL) {
             pContainer->socket.pDataCallback(pContainer->socket.pDataCallbackParameter);
@@ -1035,12 +1477,31 @@ static void printSocketOption(const void *pOptionValue,
 #endif
 }
 
+#if U_SOCK_STATS_ENABLE
+// Add the time since startTimeMs to the send latency histogram
+// of a socket and to that of the total across all sockets.
+static void statsTxLatencyAdd(uSockContainer_t *pContainer,
+                              int64_t startTimeMs)
+{
+    int64_t durationMs = uPortGetTickTimeMs() - startTimeMs;
+    int64_t limitMs = U_SOCK_STATS_LATENCY_BIN_0_MS;
+    size_t bin = 0;
+
+    while ((bin < U_SOCK_STATS_LATENCY_NUM_BINS - 1) &&
+           (durationMs >= limitMs)) {
+        limitMs <<= 1;
+        bin++;
+    }
+    U_SOCK_STATS_ADD(pContainer, txLatencyHistogram[bin], 1);
+}
+#endif
+
 /* ----------------------------------------------------------------
  * STATIC FUNCTIONS: RECEIVING
  * -------------------------------------------------------------- */
 
 // Receive data on a socket, either UDP or TCP.
-static int32_t receive(const uSockContainer_t *pContainer,
+static int32_t receive(uSockContainer_t *pContainer,
                        uSockAddress_t *pRemoteAddress,
                        void *pData, size_t dataSizeBytes)
 {
@@ -1061,7 +1522,11 @@ static int32_t receive(const uSockContainer_t *pContainer,
                                                       pData,
                                                       dataSizeBytes);
             } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                // TODO
+                negErrnoOrSize = uWifiSockReceiveFrom(networkHandle,
+                                                      sockHandle,
+                                                      pRemoteAddress,
+                                                      pData,
+                                                      dataSizeBytes);
             }
         } else {
             // TCP style
@@ -1071,12 +1536,18 @@ static int32_t receive(const uSockContainer_t *pContainer,
                                                pData,
                                                dataSizeBytes);
             } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                // TODO
+                negErrnoOrSize = uWifiSockRead(networkHandle,
+                                               sockHandle,
+                                               pData,
+                                               dataSizeBytes);
             }
         }
+        U_SOCK_STATS_ADD(pContainer, underlyingCalls, 1);
         if (negErrnoOrSize < 0) {
             // Yield for the poll interval
             uPortTaskBlock(U_SOCK_RECEIVE_POLL_INTERVAL_MS);
+            U_SOCK_STATS_ADD(pContainer, blockedMs,
+                             U_SOCK_RECEIVE_POLL_INTERVAL_MS);
         }
     } while ((negErrnoOrSize < 0) &&
              (pContainer->socket.blocking) &&
@@ -1086,110 +1557,2095 @@ static int32_t receive(const uSockContainer_t *pContainer,
     return negErrnoOrSize;
 }
 
+// Receive a batch of datagrams using the underlying cell/wifi
+// socket layer, blocking until at least one has arrived if the
+// socket is blocking.
+static int32_t receiveBatch(uSockContainer_t *pContainer,
+                            uSockDatagram_t *pDatagrams,
+                            size_t numDatagrams)
+{
+    int32_t networkHandle = pContainer->socket.networkHandle;
+    int32_t sockHandle = pContainer->socket.sockHandle;
+    int32_t negErrnoOrNum = -U_SOCK_ENOSYS;
+    int64_t startTimeMs = uPortGetTickTimeMs();
+
+    // Run around the loop until at least one datagram turns
+    // up or we time out or just once if we're non-blocking.
+    do {
+        if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+            negErrnoOrNum = uCellSockReceiveFromBatch(networkHandle,
+                                                      sockHandle,
+                                                      pDatagrams,
+                                                      numDatagrams);
+        } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+            // Batch receive is not supported on Wi-Fi: the
+            // short range module has no multi-datagram read
+            negErrnoOrNum = -U_SOCK_ENOSYS;
+        }
+        U_SOCK_STATS_ADD(pContainer, underlyingCalls, 1);
+        if ((negErrnoOrNum < 0) && (negErrnoOrNum != -U_SOCK_ENOSYS)) {
+            // Yield for the poll interval
+            uPortTaskBlock(U_SOCK_RECEIVE_POLL_INTERVAL_MS);
+            U_SOCK_STATS_ADD(pContainer, blockedMs,
+                             U_SOCK_RECEIVE_POLL_INTERVAL_MS);
+        }
+        // No point in waiting for something that is not supported
+    } while ((negErrnoOrNum < 0) && (negErrnoOrNum != -U_SOCK_ENOSYS) &&
+             (pContainer->socket.blocking) &&
+             (uPortGetTickTimeMs() < startTimeMs +
+              pContainer->socket.receiveTimeoutMs));
+
+    return negErrnoOrNum;
+}
+
 /* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
+ * STATIC FUNCTIONS: SENDING
  * -------------------------------------------------------------- */
 
-// Create a socket.
-int32_t uSockCreate(int32_t networkHandle, uSockType_t type,
-                    uSockProtocol_t protocol)
+// Write data on a TCP socket using the underlying cell/wifi
+// socket layer.  uXxxSockWrite() returns the number of bytes
+// sent or a negated value of errno from the U_SOCK_Exxx list.
+static int32_t writeNetwork(int32_t networkHandle, int32_t sockHandle,
+                            const void *pData, size_t dataSizeBytes)
 {
-    int32_t descriptorOrError = (int32_t) U_ERROR_COMMON_SUCCESS;
-    int32_t errnoLocal;
-    uSockContainer_t *pContainer = NULL;
-    uSockDescriptor_t descriptor = gNextDescriptor;
-    int32_t sockHandle = -U_SOCK_ENOSYS;
+    int32_t negErrnoOrSize = -U_SOCK_ENOSYS;
 
-    errnoLocal = init();
-    if (errnoLocal == U_SOCK_ENONE) {
-        // Check parameters
-        errnoLocal = U_SOCK_ENODEV;
-        if (U_NETWORK_HANDLE_IS_VALID(networkHandle)) {
-            errnoLocal = U_SOCK_EPROTONOSUPPORT;
-            if (((type == U_SOCK_TYPE_STREAM) && (protocol == U_SOCK_PROTOCOL_TCP)) ||
-                ((type == U_SOCK_TYPE_DGRAM) && (protocol == U_SOCK_PROTOCOL_UDP))) {
-                errnoLocal = U_SOCK_ENONE;
+    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+        negErrnoOrSize = uCellSockWrite(networkHandle, sockHandle,
+                                        pData, dataSizeBytes);
+    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+        negErrnoOrSize = uWifiSockWrite(networkHandle, sockHandle,
+                                        pData, dataSizeBytes);
+    }
+
+    return negErrnoOrSize;
+}
+
+// As writeNetwork() but for a socket container, keeping
+// the statistics up to date.
+static int32_t writeUnderlying(uSockContainer_t *pContainer,
+                               const void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoOrSize;
+
+    negErrnoOrSize = writeNetwork(pContainer->socket.networkHandle,
+                                  pContainer->socket.sockHandle,
+                                  pData, dataSizeBytes);
+
+    U_SOCK_STATS_ADD(pContainer, underlyingCalls, 1);
+    if ((negErrnoOrSize >= 0) && (negErrnoOrSize < (int32_t) dataSizeBytes)) {
+        U_SOCK_STATS_ADD(pContainer, partialWrites, 1);
+    }
+
+    return negErrnoOrSize;
+}
+
+// Send whatever is in the write coalescing buffer of a socket.
+// Returns zero if the buffer has been emptied, else a negated
+// value of errno from the U_SOCK_Exxx list, in which case
+// whatever could not be sent remains in the buffer.
+// This does NOT lock the mutex, you need to do that.
+static int32_t writeCoalesceFlush(uSockContainer_t *pContainer)
+{
+    uSockSocket_t *pSocket = &(pContainer->socket);
+    int32_t negErrnoOrSize = U_SOCK_ENONE;
+
+    if (pSocket->writeCoalesceLength > 0) {
+        negErrnoOrSize = writeUnderlying(pContainer,
+                                         pSocket->pWriteCoalesceBuffer,
+                                         pSocket->writeCoalesceLength);
+        if (negErrnoOrSize >= 0) {
+            // All of the uSockWrite() calls that went into the
+            // buffer bar one have been saved an underlying write
+            if (pSocket->writeCoalesceNumWrites > 1) {
+                pSocket->writeCoalesceSaved += (int32_t) pSocket->writeCoalesceNumWrites - 1;
+            }
+            pSocket->writeCoalesceNumWrites = 0;
+            if (negErrnoOrSize < (int32_t) pSocket->writeCoalesceLength) {
+                // Keep what wasn't sent for next time
+                pSocket->writeCoalesceLength -= negErrnoOrSize;
+                memmove(pSocket->pWriteCoalesceBuffer,
+                        pSocket->pWriteCoalesceBuffer + negErrnoOrSize,
+                        pSocket->writeCoalesceLength);
+                pSocket->writeCoalesceNumWrites = 1;
+                negErrnoOrSize = -U_SOCK_EWOULDBLOCK;
+            } else {
+                pSocket->writeCoalesceLength = 0;
+                negErrnoOrSize = U_SOCK_ENONE;
             }
         }
     }
 
-    if (errnoLocal == U_SOCK_ENONE) {
+    return negErrnoOrSize;
+}
+
+// Flush the write coalescing buffer of a socket when there is no
+// caller to hand an error to: only if the underlying socket layer
+// would block is the data kept to be tried again, for any other
+// error it is thrown away and the errno kept for the next
+// uSockWrite().  Returns the same as writeCoalesceFlush().
+// This does NOT lock the mutex, you need to do that.
+static int32_t writeCoalesceFlushBackground(uSockContainer_t *pContainer)
+{
+    uSockSocket_t *pSocket = &(pContainer->socket);
+    int32_t negErrno = writeCoalesceFlush(pContainer);
+
+    if ((negErrno != U_SOCK_ENONE) && (negErrno != -U_SOCK_EWOULDBLOCK)) {
+        pSocket->writeCoalesceErrno = -negErrno;
+        pSocket->writeCoalesceLength = 0;
+        pSocket->writeCoalesceNumWrites = 0;
+    }
+
+    return negErrno;
+}
+
+// Free the write coalescing buffer of a socket, if there is one,
+// throwing away anything that is in it.
+// This does NOT lock the mutex, you need to do that.
+static void writeCoalesceFree(uSockContainer_t *pContainer)
+{
+    free(pContainer->socket.pWriteCoalesceBuffer);
+    pContainer->socket.pWriteCoalesceBuffer = NULL;
+    pContainer->socket.writeCoalesceLength = 0;
+    pContainer->socket.writeCoalesceNumWrites = 0;
+}
+
+// Event queue callback which acts as the write coalescing timer:
+// it sends anything that has been sitting in a write coalescing
+// buffer for U_SOCK_WRITE_COALESCE_TIMEOUT_MS and keeps going
+// until there is nothing left waiting.
+static void writeCoalesceTimerCallback(void *pParam, size_t paramLength)
+{
+    uSockContainer_t *pContainer;
+    int64_t nowMs;
+    int64_t waitMs;
+    int64_t thisWaitMs;
+
+    (void) pParam;
+    (void) paramLength;
+
+    do {
+        waitMs = -1;
 
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
-        errnoLocal = U_SOCK_ENOBUFS;
-        if (numContainersInUse() < U_SOCK_MAX_NUM_SOCKETS) {
-            // Find the next free descriptor
-            descriptorOrError = (int32_t) U_ERROR_COMMON_BSD_ERROR;
-            while (descriptorOrError < 0) {
-                // Try the descriptor value, making sure
-                // each time that it can't be found.
-                if (pContainerFindByDescriptor(descriptor) == NULL) {
-                    gNextDescriptor = descriptor;
-                    U_SOCK_INC_DESCRIPTOR(gNextDescriptor);
-                    // Found a free descriptor, now try to
-                    // create the socket in a container
-                    pContainer = pSockContainerCreate(descriptor,
-                                                      type, protocol);
-                    if (pContainer != NULL) {
-                        descriptorOrError = (int32_t) descriptor;
-                    } else {
-                        errnoLocal = U_SOCK_ENOMEM;
-                        uPortLog("U_SOCK: unable to allocate memory"
-                                 " for socket.\n");
-                        // Exit stage left
-                        break;
-                    }
+        nowMs = uPortGetTickTimeMs();
+        for (pContainer = gpContainerListHead; pContainer != NULL;
+             pContainer = pContainer->pNext) {
+            if ((pContainer->socket.state != U_SOCK_STATE_CLOSED) &&
+                (pContainer->socket.writeCoalesceLength > 0)) {
+                thisWaitMs = pContainer->socket.writeCoalesceStartTimeMs +
+                             U_SOCK_WRITE_COALESCE_TIMEOUT_MS - nowMs;
+                if ((thisWaitMs <= 0) &&
+                    (writeCoalesceFlushBackground(pContainer) == -U_SOCK_EWOULDBLOCK)) {
+                    // Couldn't send it all, try again later; any
+                    // other error has thrown the data away and will
+                    // be reported on the next uSockWrite()
+                    thisWaitMs = U_SOCK_WRITE_COALESCE_TIMEOUT_MS;
+                }
+                if ((thisWaitMs > 0) && ((waitMs < 0) || (thisWaitMs < waitMs))) {
+                    waitMs = thisWaitMs;
                 }
-                U_SOCK_INC_DESCRIPTOR(descriptor);
             }
+        }
+        if ((waitMs < 0) || (gWriteCoalesceEventQueueHandle < 0)) {
+            // Nothing left to wait for or being shut down
+            waitMs = -1;
+            gWriteCoalesceTimerRunning = false;
+        }
 
-            if ((descriptorOrError >= 0) && (pContainer != NULL)) {
-                errnoLocal = U_SOCK_ENOSYS;
-                if (pContainerFindByNetworkLayer(networkHandle, -1) == NULL) {
-                    // If this is the first time we have
-                    // encountered this network layer,
-                    // ask the underlying cell/wifi sockets
-                    // layer to initialise it
-                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                        errnoLocal = -uCellSockInitInstance(networkHandle);
-                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                        // TODO
-                    }
-                }
-                // Get the underlying cell/wifi socket layer to
-                // create the socket there. uXxxSockCreate() returns
-                // a socket handle or a negated value of errno from
-                // the U_SOCK_Exxx list
-                if (errnoLocal == 0) {
-                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                        sockHandle = uCellSockCreate(networkHandle,
-                                                     type, protocol);
-                        // Setting non-blocking so that
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+        if (waitMs > 0) {
+            uPortTaskBlock((int32_t) waitMs);
+        }
+    } while (waitMs > 0);
+}
+
+// Make sure that the write coalescing timer is running.
+// This does NOT lock the mutex, you need to do that.
+static void writeCoalesceTimerStart()
+{
+    if (!gWriteCoalesceTimerRunning &&
+        (gWriteCoalesceEventQueueHandle >= 0) &&
+        (uPortEventQueueSend(gWriteCoalesceEventQueueHandle,
+                             NULL, 0) == 0)) {
+        gWriteCoalesceTimerRunning = true;
+    }
+}
+
+// Shut down the write coalescing timer.  This must be called
+// WITHOUT the mutex locked since the timer may be waiting on it.
+static void writeCoalesceTimerClose()
+{
+    int32_t eventQueueHandle;
+
+    // Take the handle out of use under the mutex, then close
+    // the event queue outside it
+    U_PORT_MUTEX_LOCK(gMutexContainer);
+    eventQueueHandle = gWriteCoalesceEventQueueHandle;
+    gWriteCoalesceEventQueueHandle = -1;
+    gWriteCoalesceTimerRunning = false;
+    U_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+    if (eventQueueHandle >= 0) {
+        uPortEventQueueClose(eventQueueHandle);
+    }
+}
+
+// Write data on a TCP socket, coalescing it with the data from
+// previous calls if write coalescing is switched on.  Returns the
+// number of bytes written or a negated value of errno from the
+// U_SOCK_Exxx list.
+// This does NOT lock the mutex, you need to do that.
+static int32_t writeStream(uSockContainer_t *pContainer,
+                           const void *pData, size_t dataSizeBytes)
+{
+    uSockSocket_t *pSocket = &(pContainer->socket);
+    int32_t negErrnoOrSize = U_SOCK_ENONE;
+    bool coalesce = (pSocket->pWriteCoalesceBuffer != NULL) &&
+                    !pSocket->noDelay;
+
+    if (pSocket->writeCoalesceErrno != U_SOCK_ENONE) {
+        // A flush that nobody was waiting for has failed,
+        // this is the first chance to say so
+        negErrnoOrSize = -pSocket->writeCoalesceErrno;
+        pSocket->writeCoalesceErrno = U_SOCK_ENONE;
+    } else if (!coalesce ||
+        (pSocket->writeCoalesceLength + dataSizeBytes >
+         U_SOCK_WRITE_COALESCE_BUFFER_SIZE_BYTES)) {
+        // The new data won't fit in with what is already
+        // buffered, or coalescing has been switched off,
+        // so send anything that is buffered first to
+        // preserve ordering
+        negErrnoOrSize = writeCoalesceFlush(pContainer);
+    }
+
+    if (negErrnoOrSize == U_SOCK_ENONE) {
+        if (coalesce && (pSocket->writeCoalesceLength + dataSizeBytes <=
+                         U_SOCK_WRITE_COALESCE_BUFFER_SIZE_BYTES)) {
+            if (pSocket->writeCoalesceLength == 0) {
+                pSocket->writeCoalesceStartTimeMs = uPortGetTickTimeMs();
+                writeCoalesceTimerStart();
+            }
+            memcpy(pSocket->pWriteCoalesceBuffer + pSocket->writeCoalesceLength,
+                   pData, dataSizeBytes);
+            pSocket->writeCoalesceLength += dataSizeBytes;
+            pSocket->writeCoalesceNumWrites++;
+            negErrnoOrSize = (int32_t) dataSizeBytes;
+            if ((pSocket->writeCoalesceLength >= U_SOCK_WRITE_COALESCE_BUFFER_SIZE_BYTES) ||
+                (uPortGetTickTimeMs() - pSocket->writeCoalesceStartTimeMs >=
+                 U_SOCK_WRITE_COALESCE_TIMEOUT_MS)) {
+                // Reached the size or time threshold: send it now,
+                // any error will be reported on the next call
+                writeCoalesceFlushBackground(pContainer);
+            }
+        } else {
+            negErrnoOrSize = writeUnderlying(pContainer, pData,
+                                             dataSizeBytes);
+        }
+    }
+
+    return negErrnoOrSize;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: WRITE QUEUE
+ * -------------------------------------------------------------- */
+
+// Copy as much of the given data as will fit onto the end of
+// the write queue of a socket, returning the number of bytes
+// copied.
+// This does NOT lock the mutex, you need to do that.
+static size_t writeQueuePush(uSockSocket_t *pSocket,
+                             const char *pData, size_t dataSizeBytes)
+{
+    size_t writeIndex;
+    size_t x;
+
+    x = pSocket->writeQueueSize - pSocket->writeQueueLength;
+    if (dataSizeBytes > x) {
+        dataSizeBytes = x;
+    }
+    writeIndex = (pSocket->writeQueueRead + pSocket->writeQueueLength) %
+                 pSocket->writeQueueSize;
+    // Copy up to the end of the buffer and then wrap
+    x = pSocket->writeQueueSize - writeIndex;
+    if (x > dataSizeBytes) {
+        x = dataSizeBytes;
+    }
+    memcpy(pSocket->pWriteQueueBuffer + writeIndex, pData, x);
+    memcpy(pSocket->pWriteQueueBuffer, pData + x, dataSizeBytes - x);
+    pSocket->writeQueueLength += dataSizeBytes;
+
+    return dataSizeBytes;
+}
+
+// Copy up to dataSizeBytes from the front of the write queue
+// of a socket, without removing it, returning the number of
+// bytes copied.
+// This does NOT lock the mutex, you need to do that.
+static size_t writeQueuePeek(const uSockSocket_t *pSocket,
+                             char *pData, size_t dataSizeBytes)
+{
+    size_t x;
+
+    if (dataSizeBytes > pSocket->writeQueueLength) {
+        dataSizeBytes = pSocket->writeQueueLength;
+    }
+    x = pSocket->writeQueueSize - pSocket->writeQueueRead;
+    if (x > dataSizeBytes) {
+        x = dataSizeBytes;
+    }
+    memcpy(pData, pSocket->pWriteQueueBuffer + pSocket->writeQueueRead, x);
+    memcpy(pData + x, pSocket->pWriteQueueBuffer, dataSizeBytes - x);
+
+    return dataSizeBytes;
+}
+
+// Remove dataSizeBytes from the front of the write queue
+// of a socket.
+// This does NOT lock the mutex, you need to do that.
+static void writeQueuePop(uSockSocket_t *pSocket, size_t dataSizeBytes)
+{
+    if (dataSizeBytes > pSocket->writeQueueLength) {
+        dataSizeBytes = pSocket->writeQueueLength;
+    }
+    pSocket->writeQueueRead = (pSocket->writeQueueRead + dataSizeBytes) %
+                              pSocket->writeQueueSize;
+    pSocket->writeQueueLength -= dataSizeBytes;
+    if (pSocket->writeQueueLength == 0) {
+        pSocket->writeQueueRead = 0;
+    }
+}
+
+// Send everything in the write queue of a socket from this task.
+// Returns zero if the write queue has been emptied, else a negated
+// value of errno from the U_SOCK_Exxx list, in which case whatever
+// could not be sent remains in the write queue.
+// gMutexWriteQueue and gMutexContainer must BOTH be locked.
+static int32_t writeQueueDrain(uSockContainer_t *pContainer)
+{
+    uSockSocket_t *pSocket = &(pContainer->socket);
+    int32_t negErrnoOrSize = U_SOCK_ENONE;
+    size_t x;
+
+    while ((pSocket->writeQueueLength > 0) &&
+           (negErrnoOrSize == U_SOCK_ENONE)) {
+        // Send the contiguous part at the front
+        x = pSocket->writeQueueSize - pSocket->writeQueueRead;
+        if (x > pSocket->writeQueueLength) {
+            x = pSocket->writeQueueLength;
+        }
+        negErrnoOrSize = writeUnderlying(pContainer,
+                                         pSocket->pWriteQueueBuffer +
+                                         pSocket->writeQueueRead, x);
+        if (negErrnoOrSize > 0) {
+            writeQueuePop(pSocket, negErrnoOrSize);
+            negErrnoOrSize = U_SOCK_ENONE;
+        } else if (negErrnoOrSize == 0) {
+            negErrnoOrSize = -U_SOCK_EWOULDBLOCK;
+        }
+    }
+
+    return negErrnoOrSize;
+}
+
+// Free the write queue of a socket, if there is one, throwing
+// away anything that is in it.
+// This does NOT lock the mutex, you need to do that.
+static void writeQueueFree(uSockContainer_t *pContainer)
+{
+    if (pContainer->socket.pWriteQueueBuffer != NULL) {
+        gWriteQueueTotalBytes -= pContainer->socket.writeQueueSize;
+        free(pContainer->socket.pWriteQueueBuffer);
+        pContainer->socket.pWriteQueueBuffer = NULL;
+    }
+    pContainer->socket.writeQueueRead = 0;
+    pContainer->socket.writeQueueLength = 0;
+}
+
+// Set the size of the write queue of a socket, re-allocating
+// the write queue if it is switched on; returns a value from
+// the U_SOCK_Exxx list.
+// This does NOT lock the mutex, you need to do that.
+static int32_t writeQueueSizeSet(uSockContainer_t *pContainer,
+                                 size_t sizeBytes)
+{
+    int32_t errnoLocal = U_SOCK_ENONE;
+    uSockSocket_t *pSocket = &(pContainer->socket);
+    char *pBuffer;
+
+    if (pSocket->pWriteQueueBuffer != NULL) {
+        errnoLocal = U_SOCK_EBUSY;
+        if (pSocket->writeQueueLength == 0) {
+            errnoLocal = U_SOCK_ENOBUFS;
+            if (gWriteQueueTotalBytes - pSocket->writeQueueSize +
+                sizeBytes <= U_SOCK_WRITE_QUEUE_TOTAL_MAX_BYTES) {
+                pBuffer = (char *) malloc(sizeBytes);
+                if (pBuffer != NULL) {
+                    writeQueueFree(pContainer);
+                    pSocket->pWriteQueueBuffer = pBuffer;
+                    gWriteQueueTotalBytes += sizeBytes;
+                    errnoLocal = U_SOCK_ENONE;
+                }
+            }
+        }
+    }
+    if (errnoLocal == U_SOCK_ENONE) {
+        pSocket->writeQueueSize = sizeBytes;
+    }
+
+    return errnoLocal;
+}
+
+// Event queue callback which is the write queue task: it sends
+// data from the write queues of sockets, a chunk at a time,
+// serving the socket that has waited longest first, until there
+// is nothing left to send.  Neither gMutexContainer nor
+// gMutexCallbacks are held while sending so that uSockWrite()
+// is never held up.
+static void writeQueueTaskCallback(void *pParam, size_t paramLength)
+{
+    uSockContainer_t *pContainer;
+    uSockContainer_t *pServe;
+    uSockDescriptor_t descriptor = -1;
+    int32_t networkHandle = -1;
+    int32_t sockHandle = -1;
+    size_t sizeBytes;
+    int32_t negErrnoOrSize;
+    void (*pCallback) (int32_t, void *);
+    void *pCallbackParameter = NULL;
+    bool keepGoing = true;
+
+    (void) pParam;
+    (void) paramLength;
+
+    while (keepGoing) {
+        sizeBytes = 0;
+        negErrnoOrSize = U_SOCK_ENONE;
+        pCallback = NULL;
+
+        U_PORT_MUTEX_LOCK(gMutexWriteQueue);
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        pServe = NULL;
+        for (pContainer = gpContainerListHead; pContainer != NULL;
+             pContainer = pContainer->pNext) {
+            if ((pContainer->socket.writeQueueLength > 0) &&
+                ((pServe == NULL) ||
+                 (pContainer->socket.writeQueueServiceTimeMs <
+                  pServe->socket.writeQueueServiceTimeMs))) {
+                pServe = pContainer;
+            }
+        }
+        if ((pServe != NULL) && (gWriteQueueEventQueueHandle >= 0)) {
+            pServe->socket.writeQueueServiceTimeMs = uPortGetTickTimeMs();
+            if ((pServe->socket.state == U_SOCK_STATE_CONNECTED) ||
+                (pServe->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ)) {
+                // Take a copy of the front of the queue to send
+                // once the container mutex has been released
+                descriptor = pServe->descriptor;
+                networkHandle = pServe->socket.networkHandle;
+                sockHandle = pServe->socket.sockHandle;
+                sizeBytes = writeQueuePeek(&(pServe->socket), gpWriteQueueChunk,
+                                           U_SOCK_WRITE_QUEUE_CHUNK_SIZE_BYTES);
+            } else {
+                // The socket has gone, throw the data away
+                writeQueuePop(&(pServe->socket), pServe->socket.writeQueueLength);
+                negErrnoOrSize = -U_SOCK_ENOTCONN;
+                pCallback = pServe->socket.pWriteQueueCallback;
+                pCallbackParameter = pServe->socket.pWriteQueueCallbackParameter;
+            }
+        } else {
+            // Nothing left to send or being shut down
+            gWriteQueueTaskRunning = false;
+            keepGoing = false;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+        if (sizeBytes > 0) {
+            negErrnoOrSize = writeNetwork(networkHandle, sockHandle,
+                                          gpWriteQueueChunk, sizeBytes);
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+
+            // The socket may have been closed while we were sending
+            pContainer = pContainerFindByDescriptor(descriptor);
+            if ((pContainer != NULL) &&
+                (pContainer->socket.pWriteQueueBuffer != NULL)) {
+                U_SOCK_STATS_ADD(pContainer, underlyingCalls, 1);
+                if (negErrnoOrSize > 0) {
+                    if (negErrnoOrSize < (int32_t) sizeBytes) {
+                        U_SOCK_STATS_ADD(pContainer, partialWrites, 1);
+                    }
+                    writeQueuePop(&(pContainer->socket), negErrnoOrSize);
+                } else if ((negErrnoOrSize < 0) &&
+                           (negErrnoOrSize != -U_SOCK_EWOULDBLOCK)) {
+                    // Can't continue with a broken stream,
+                    // throw away the rest
+                    writeQueuePop(&(pContainer->socket),
+                                  pContainer->socket.writeQueueLength);
+                }
+                if ((negErrnoOrSize != 0) &&
+                    (negErrnoOrSize != -U_SOCK_EWOULDBLOCK)) {
+                    pCallback = pContainer->socket.pWriteQueueCallback;
+                    pCallbackParameter = pContainer->socket.pWriteQueueCallbackParameter;
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexWriteQueue);
+
+        if (pCallback != NULL) {
+            U_PORT_MUTEX_LOCK(gMutexCallbacks);
+            pCallback(negErrnoOrSize, pCallbackParameter);
+            U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+        }
+
+        if ((sizeBytes > 0) &&
+            ((negErrnoOrSize == 0) || (negErrnoOrSize == -U_SOCK_EWOULDBLOCK))) {
+            // The underlying network layer isn't taking
+            // data at the moment, give it a rest
+            uPortTaskBlock(U_SOCK_WRITE_QUEUE_RETRY_INTERVAL_MS);
+        }
+    }
+}
+
+// Make sure that the write queue task is running.
+// This does NOT lock the mutex, you need to do that.
+static void writeQueueTaskStart()
+{
+    if (!gWriteQueueTaskRunning &&
+        (gWriteQueueEventQueueHandle >= 0) &&
+        (uPortEventQueueSend(gWriteQueueEventQueueHandle,
+                             NULL, 0) == 0)) {
+        gWriteQueueTaskRunning = true;
+    }
+}
+
+// Shut down the write queue task.  This must be called
+// WITHOUT the mutexes locked since the task may be waiting
+// on them.
+static void writeQueueTaskClose()
+{
+    int32_t eventQueueHandle;
+    char *pChunk;
+
+    // Take the handle and the chunk out of use under the mutexes;
+    // the task holds gMutexWriteQueue while it sends from the
+    // chunk and stops serving sockets once the handle is -1
+    U_PORT_MUTEX_LOCK(gMutexWriteQueue);
+    U_PORT_MUTEX_LOCK(gMutexContainer);
+    eventQueueHandle = gWriteQueueEventQueueHandle;
+    gWriteQueueEventQueueHandle = -1;
+    gWriteQueueTaskRunning = false;
+    pChunk = gpWriteQueueChunk;
+    gpWriteQueueChunk = NULL;
+    U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    U_PORT_MUTEX_UNLOCK(gMutexWriteQueue);
+
+    // Close the event queue outside the mutexes since
+    // the task may be waiting on them
+    if (eventQueueHandle >= 0) {
+        uPortEventQueueClose(eventQueueHandle);
+    }
+    free(pChunk);
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: DATA PUSH
+ * -------------------------------------------------------------- */
+
+// Get a buffer from the push mode pool, NULL if there are none.
+// This does NOT lock gMutexDataPush, you need to do that.
+static char *pDataPushBufferAlloc()
+{
+    char *pBuffer = NULL;
+
+    for (size_t x = 0; (x < U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS) &&
+         (pBuffer == NULL) && (gpDataPushPool != NULL); x++) {
+        if ((gDataPushPoolInUse & (1UL << x)) == 0) {
+            gDataPushPoolInUse |= 1UL << x;
+            pBuffer = gpDataPushPool + (x * U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES);
+        }
+    }
+
+    return pBuffer;
+}
+
+// Give a buffer back to the push mode pool and, if there are
+// sockets waiting for one, ask the push mode task to resume.
+// Locks gMutexDataPush and nothing else.
+static void dataPushBufferFree(const char *pBuffer)
+{
+    int32_t event = U_SOCK_DATA_PUSH_RESUME;
+    bool resume = false;
+    size_t x;
+    int32_t eventQueueHandle = -1;
+
+    U_PORT_MUTEX_LOCK(gMutexDataPush);
+
+    if ((gpDataPushPool != NULL) && (pBuffer >= gpDataPushPool) &&
+        (pBuffer < gpDataPushPool + (U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS *
+                                     U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES))) {
+        x = (size_t) (pBuffer - gpDataPushPool) / U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES;
+        gDataPushPoolInUse &= ~(1UL << x);
+        if ((gDataPushNumStalled > 0) && !gDataPushResumePending &&
+            (gDataPushEventQueueHandle >= 0)) {
+            gDataPushResumePending = true;
+            eventQueueHandle = gDataPushEventQueueHandle;
+            resume = true;
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+
+    if (resume) {
+        uPortEventQueueSend(eventQueueHandle,
+                            &event, sizeof(event));
+    }
+}
+
+// Mark a socket as no longer waiting for a push mode buffer.
+// This does NOT lock gMutexDataPush, you need to do that.
+static void dataPushUnstall(uSockSocket_t *pSocket)
+{
+    if (pSocket->dataPushStalled) {
+        pSocket->dataPushStalled = false;
+        // Check needed as the count is zeroed by dataPushTaskClose()
+        if (gDataPushNumStalled > 0) {
+            gDataPushNumStalled--;
+        }
+    }
+}
+
+// Send a socket to the push mode task, if it has not already
+// been sent; there can only be one event per socket, plus
+// U_SOCK_DATA_PUSH_RESUME, in the queue and hence sending never
+// has to wait.  Doesn't need gMutexContainer.
+static void dataPushPost(uSockContainer_t *pContainer)
+{
+    uSockDescriptor_t descriptor = pContainer->descriptor;
+    int32_t eventQueueHandle = -1;
+
+    U_PORT_MUTEX_LOCK(gMutexDataPush);
+    if (!pContainer->socket.dataPushPending &&
+        (gDataPushEventQueueHandle >= 0)) {
+        pContainer->socket.dataPushPending = true;
+        eventQueueHandle = gDataPushEventQueueHandle;
+    }
+    U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+
+    if (eventQueueHandle >= 0) {
+        uPortEventQueueSend(eventQueueHandle,
+                            &descriptor, sizeof(descriptor));
+    }
+}
+
+// Read everything that is waiting on a socket in push mode and
+// pass it to the push mode callback, stopping if the pool runs
+// out of buffers.  Neither gMutexContainer nor gMutexDataPush
+// are held while reading.
+static void dataPushSocket(uSockDescriptor_t descriptor)
+{
+    uSockContainer_t *pContainer;
+    int32_t networkHandle = -1;
+    int32_t sockHandle = -1;
+    char *pBuffer;
+    int32_t negErrnoOrSize = 1;
+    void (*pCallback) (uSockDescriptor_t, char *, size_t, void *);
+    void *pCallbackParameter = NULL;
+
+    while (negErrnoOrSize > 0) {
+        pBuffer = NULL;
+        pCallback = NULL;
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            U_PORT_MUTEX_LOCK(gMutexDataPush);
+            pContainer->socket.dataPushPending = false;
+            pCallback = pContainer->socket.pDataPushCallback;
+            if (pCallback == NULL) {
+                // No longer in push mode
+                dataPushUnstall(&(pContainer->socket));
+            } else {
+                networkHandle = pContainer->socket.networkHandle;
+                sockHandle = pContainer->socket.sockHandle;
+                pCallbackParameter = pContainer->socket.pDataPushCallbackParameter;
+                pBuffer = pDataPushBufferAlloc();
+                if (pBuffer == NULL) {
+                    // Out of buffers: leave the data where it is
+                    // until the application gives one back
+                    if (!pContainer->socket.dataPushStalled) {
+                        pContainer->socket.dataPushStalled = true;
+                        gDataPushNumStalled++;
+                    }
+                } else {
+                    dataPushUnstall(&(pContainer->socket));
+                }
+            }
+            U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+        negErrnoOrSize = 0;
+        if (pBuffer != NULL) {
+            // uXxxSockRead() returns the number of bytes
+            // read or a negated value from the U_SOCK_Exxx list
+            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                negErrnoOrSize = uCellSockRead(networkHandle, sockHandle, pBuffer,
+                                               U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES);
+            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                negErrnoOrSize = uWifiSockRead(networkHandle, sockHandle, pBuffer,
+                                               U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES);
+            }
+            if (negErrnoOrSize > 0) {
+                U_PORT_MUTEX_LOCK(gMutexCallbacks);
+                //lint -e(613) Suppress possible use of NULL pointer,
+                // pCallback is non-NULL if pBuffer is non-NULL
+                pCallback(descriptor, pBuffer, negErrnoOrSize,
+                          pCallbackParameter);
+                U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+            } else {
+                dataPushBufferFree(pBuffer);
+            }
+        }
+    }
+}
+
+// Event queue callback which is the push mode task: it is sent
+// either the descriptor of a socket that has data waiting or
+// U_SOCK_DATA_PUSH_RESUME, in which case it tries again all of
+// the sockets that it had to stop reading from.
+static void dataPushTaskCallback(void *pParam, size_t paramLength)
+{
+    uSockDescriptor_t descriptor = *((uSockDescriptor_t *) pParam);
+    uSockContainer_t *pContainer;
+
+    (void) paramLength;
+
+    if (descriptor == U_SOCK_DATA_PUSH_RESUME) {
+        U_PORT_MUTEX_LOCK(gMutexDataPush);
+        gDataPushResumePending = false;
+        U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+        // Start from the first container each time since
+        // the list may change while we are reading
+        do {
+            descriptor = U_SOCK_DATA_PUSH_RESUME;
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+            U_PORT_MUTEX_LOCK(gMutexDataPush);
+
+            // Nothing to be done while the pool is still empty,
+            // we will be sent U_SOCK_DATA_PUSH_RESUME again
+            for (pContainer = gpContainerListHead;
+                 (pContainer != NULL) && (descriptor < 0) &&
+                 (gDataPushPoolInUse != (0xFFFFFFFFUL >> (32 - U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS)));
+                 pContainer = pContainer->pNext) {
+                if (pContainer->socket.dataPushStalled) {
+                    if (pContainer->socket.state == U_SOCK_STATE_CLOSED) {
+                        dataPushUnstall(&(pContainer->socket));
+                    } else {
+                        // dataPushSocket() will un-stall it
+                        descriptor = pContainer->descriptor;
+                    }
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+            if (descriptor >= 0) {
+                dataPushSocket(descriptor);
+            }
+        } while (descriptor >= 0);
+    } else {
+        dataPushSocket(descriptor);
+    }
+}
+
+// Shut down the push mode task and free the pool.  This must
+// be called WITHOUT the mutexes locked since the task may be
+// waiting on them.
+static void dataPushTaskClose()
+{
+    int32_t eventQueueHandle;
+
+    // Take the handle out of use under the mutex, then close
+    // the event queue outside it
+    U_PORT_MUTEX_LOCK(gMutexDataPush);
+    eventQueueHandle = gDataPushEventQueueHandle;
+    gDataPushEventQueueHandle = -1;
+    U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+
+    if (eventQueueHandle >= 0) {
+        uPortEventQueueClose(eventQueueHandle);
+        // The task has gone, the pool can be freed
+        U_PORT_MUTEX_LOCK(gMutexDataPush);
+        free(gpDataPushPool);
+        gpDataPushPool = NULL;
+        gDataPushPoolInUse = 0;
+        gDataPushNumStalled = 0;
+        gDataPushResumePending = false;
+        U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: DNS
+ * -------------------------------------------------------------- */
+
+// Do a host name look-up in the underlying network layer,
+// returning a value from the U_SOCK_Exxx list.
+static int32_t getHostByNameUnderlying(int32_t networkHandle,
+                                       const char *pHostName,
+                                       uSockIpAddress_t *pHostIpAddress)
+{
+    int32_t errnoLocal = U_SOCK_ENOSYS;
+
+    // uXxxSockGetHostByName() returns a negated
+    // value from the U_SOCK_Exxx list.
+    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+        errnoLocal = -uCellSockGetHostByName(networkHandle,
+                                             pHostName,
+                                             pHostIpAddress);
+    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+        errnoLocal = -uWifiSockGetHostByName(networkHandle,
+                                             pHostName,
+                                             pHostIpAddress);
+    }
+
+    return errnoLocal;
+}
+
+#if U_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+
+// Find the DNS cache entry for the given host name, NULL if
+// there isn't one.
+// This does NOT lock the mutex, you need to do that.
+static uSockDnsCacheEntry_t *pDnsCacheFind(int32_t networkHandle,
+                                           const char *pHostName)
+{
+    uSockDnsCacheEntry_t *pEntry = NULL;
+
+    for (size_t x = 0; (x < sizeof(gDnsCache) / sizeof(gDnsCache[0])) &&
+         (pEntry == NULL); x++) {
+        if ((gDnsCache[x].state != U_SOCK_DNS_CACHE_STATE_EMPTY) &&
+            (gDnsCache[x].networkHandle == networkHandle) &&
+            (strcmp(gDnsCache[x].hostName, pHostName) == 0)) {
+            pEntry = &(gDnsCache[x]);
+        }
+    }
+
+    return pEntry;
+}
+
+// Find a DNS cache entry that can be used for a new look-up:
+// an empty one or, failing that, the oldest valid one; NULL
+// if every entry has a look-up in progress.
+// This does NOT lock the mutex, you need to do that.
+static uSockDnsCacheEntry_t *pDnsCacheFindFree()
+{
+    uSockDnsCacheEntry_t *pEntry = NULL;
+
+    for (size_t x = 0; x < sizeof(gDnsCache) / sizeof(gDnsCache[0]); x++) {
+        if (gDnsCache[x].state == U_SOCK_DNS_CACHE_STATE_EMPTY) {
+            pEntry = &(gDnsCache[x]);
+            break;
+        } else if ((gDnsCache[x].state == U_SOCK_DNS_CACHE_STATE_VALID) &&
+                   ((pEntry == NULL) || (gDnsCache[x].timeMs < pEntry->timeMs))) {
+            pEntry = &(gDnsCache[x]);
+        }
+    }
+
+    return pEntry;
+}
+
+// Determine if a valid DNS cache entry has expired.
+static bool dnsCacheExpired(const uSockDnsCacheEntry_t *pEntry,
+                            int64_t nowMs)
+{
+    int64_t ttlMs = ((int64_t) U_SOCK_DNS_CACHE_TTL_SECONDS) * 1000;
+
+    if (pEntry->errnoLocal != U_SOCK_ENONE) {
+        ttlMs = ((int64_t) U_SOCK_DNS_CACHE_NEGATIVE_TTL_SECONDS) * 1000;
+    }
+
+    return (nowMs - pEntry->timeMs >= ttlMs);
+}
+
+// Do a host name look-up via the DNS cache, returning a value
+// from the U_SOCK_Exxx list.
+static int32_t dnsCacheGetHostByName(int32_t networkHandle,
+                                     const char *pHostName,
+                                     uSockIpAddress_t *pHostIpAddress)
+{
+    int32_t errnoLocal = U_SOCK_ENONE;
+    uSockDnsCacheEntry_t *pEntry = NULL;
+    bool done = false;
+    bool waiting;
+    bool waited = false;
+    bool lookingUp = false;
+
+    if (strlen(pHostName) <= U_SOCK_DNS_CACHE_HOST_NAME_MAX_LENGTH_BYTES) {
+        do {
+            waiting = false;
+
+            U_PORT_MUTEX_LOCK(gMutexDnsCache);
+
+            pEntry = pDnsCacheFind(networkHandle, pHostName);
+            if (pEntry != NULL) {
+                if (pEntry->state == U_SOCK_DNS_CACHE_STATE_LOOKING_UP) {
+                    // Someone else is looking this host name up,
+                    // wait for them
+                    waiting = true;
+                } else if (waited ||
+                           !dnsCacheExpired(pEntry, uPortGetTickTimeMs())) {
+                    // Use the cached answer; if we've waited for
+                    // another look-up then use its answer
+                    // whatever its age
+                    errnoLocal = pEntry->errnoLocal;
+                    if (errnoLocal == U_SOCK_ENONE) {
+                        memcpy(pHostIpAddress, &(pEntry->ipAddress),
+                               sizeof(*pHostIpAddress));
+                    }
+                    done = true;
+                } else {
+                    // Expired: refresh it ourselves
+                    pEntry->state = U_SOCK_DNS_CACHE_STATE_LOOKING_UP;
+                    lookingUp = true;
+                }
+            } else {
+                pEntry = pDnsCacheFindFree();
+                if (pEntry != NULL) {
+                    pEntry->networkHandle = networkHandle;
+                    strncpy(pEntry->hostName, pHostName,
+                            sizeof(pEntry->hostName));
+                    pEntry->state = U_SOCK_DNS_CACHE_STATE_LOOKING_UP;
+                    lookingUp = true;
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexDnsCache);
+
+            if (waiting) {
+                uPortTaskBlock(U_SOCK_DNS_CACHE_WAIT_INTERVAL_MS);
+                waited = true;
+            }
+        } while (waiting);
+    }
+
+    if (!done) {
+        errnoLocal = getHostByNameUnderlying(networkHandle, pHostName,
+                                             pHostIpAddress);
+        if (lookingUp) {
+
+            U_PORT_MUTEX_LOCK(gMutexDnsCache);
+
+            if ((errnoLocal == U_SOCK_ENONE) ||
+                (errnoLocal == U_SOCK_ENXIO)) {
+                // Only cache success or "host not found",
+                // anything else may be a local problem
+                pEntry->errnoLocal = errnoLocal;
+                if (errnoLocal == U_SOCK_ENONE) {
+                    memcpy(&(pEntry->ipAddress), pHostIpAddress,
+                           sizeof(pEntry->ipAddress));
+                }
+                pEntry->timeMs = uPortGetTickTimeMs();
+                pEntry->state = U_SOCK_DNS_CACHE_STATE_VALID;
+            } else {
+                pEntry->state = U_SOCK_DNS_CACHE_STATE_EMPTY;
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexDnsCache);
+        }
+    }
+
+    return errnoLocal;
+}
+
+#endif // #if U_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
+ * -------------------------------------------------------------- */
+
+// Create a socket.
+int32_t uSockCreate(int32_t networkHandle, uSockType_t type,
+                    uSockProtocol_t protocol)
+{
+    int32_t descriptorOrError = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t sockHandle = -U_SOCK_ENOSYS;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        // Check parameters
+        errnoLocal = U_SOCK_ENODEV;
+        if (U_NETWORK_HANDLE_IS_VALID(networkHandle)) {
+            errnoLocal = U_SOCK_EPROTONOSUPPORT;
+            if (((type == U_SOCK_TYPE_STREAM) && (protocol == U_SOCK_PROTOCOL_TCP)) ||
+                ((type == U_SOCK_TYPE_DGRAM) && (protocol == U_SOCK_PROTOCOL_UDP))) {
+                errnoLocal = U_SOCK_ENONE;
+            }
+        }
+    }
+
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        errnoLocal = U_SOCK_ENOBUFS;
+        if (numContainersInUse() < U_SOCK_MAX_NUM_SOCKETS) {
+            // Create a container with the next free descriptor
+            descriptorOrError = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+            pContainer = pSockContainerCreateNext(type, protocol);
+            if (pContainer != NULL) {
+                descriptorOrError = (int32_t) pContainer->descriptor;
+            } else {
+                errnoLocal = U_SOCK_ENOMEM;
+                uPortLog("U_SOCK: unable to allocate memory"
+                         " for socket.\n");
+            }
+
+            if ((descriptorOrError >= 0) && (pContainer != NULL)) {
+                errnoLocal = U_SOCK_ENOSYS;
+                if (pContainerFindByNetworkLayer(networkHandle, -1) == NULL) {
+                    // If this is the first time we have
+                    // encountered this network layer,
+                    // ask the underlying cell/wifi sockets
+                    // layer to initialise it
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        errnoLocal = -uCellSockInitInstance(networkHandle);
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        errnoLocal = -uWifiSockInitInstance(networkHandle);
+                    }
+                }
+                // Get the underlying cell/wifi socket layer to
+                // create the socket there. uXxxSockCreate() returns
+                // a socket handle or a negated value of errno from
+                // the U_SOCK_Exxx list
+                if (errnoLocal == 0) {
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        sockHandle = uCellSockCreate(networkHandle,
+                                                     type, protocol);
+                        // Setting non-blocking so that
                         // we do the blocking here instead.
                         // Since this has no return value
                         // we can do it at the same time
                         uCellSockBlockingSet(networkHandle,
                                              sockHandle, false);
                     } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                        // TODO
+                        sockHandle = uWifiSockCreate(networkHandle,
+                                                     type, protocol);
+                        uWifiSockBlockingSet(networkHandle,
+                                             sockHandle, false);
+                    }
+
+                    if (sockHandle >= 0) {
+                        // All is good, no need to set descriptorOrError
+                        // as it was already set above
+                        pContainer->socket.sockHandle = sockHandle;
+                        pContainer->socket.networkHandle = networkHandle;
+                        uPortLog("U_SOCK: socket created, descriptor %d,"
+                                 " network handle %d, socket handle %d.\n",
+                                 descriptorOrError, networkHandle, sockHandle);
+                    } else {
+                        // Set errno
+                        errnoLocal = -sockHandle;
+                        // Free the container once more
+                        containerFree(descriptorOrError);
+                        uPortLog("U_SOCK: underlying socket layer could not create"
+                                 " socket (errno %d).\n", errnoLocal);
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        descriptorOrError = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return descriptorOrError;
+}
+
+// Make an outgoing connection on the given socket.
+int32_t uSockConnect(uSockDescriptor_t descriptor,
+                     const uSockAddress_t *pRemoteAddress)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+    int32_t sockHandle;
+#if U_CFG_ENABLE_LOGGING
+    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+#endif
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = U_SOCK_EINVAL;
+        // Check that the remote IP address is sensible
+        if (pRemoteAddress != NULL) {
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+
+            // Find the container
+            pContainer = pContainerFindByDescriptor(descriptor);
+            errnoLocal = U_SOCK_EBADF;
+            if (pContainer != NULL) {
+                // A socket in any other state (e.g. one that is
+                // being closed) cannot be connected
+                errnoLocal = U_SOCK_EPERM;
+                if (pContainer->socket.state == U_SOCK_STATE_CONNECTING) {
+                    errnoLocal = U_SOCK_EALREADY;
+                } else if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
+                    errnoLocal = U_SOCK_EISCONN;
+                } else if (pContainer->socket.state == U_SOCK_STATE_CREATED) {
+                    // We have found the container and it is
+                    // in the right state, talk to the underlying
+                    // cell/wifi socket layer to make the connection
+                    // uXxxSockConnect() returns a negated value of errno
+                    // from the U_SOCK_Exxx list
+                    networkHandle = pContainer->socket.networkHandle;
+                    sockHandle = pContainer->socket.sockHandle;
+                    pContainer->socket.connectErrno = U_SOCK_ENONE;
+                    errnoLocal = U_SOCK_ENONE;
+                    errorCode = -U_SOCK_ENOSYS;
+                    uPortLog("U_SOCK: connecting socket to \"%.*s\"...\n",
+                             addressToString(pRemoteAddress, true,
+                                             buffer, sizeof(buffer)),
+                             buffer);
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        if (!pContainer->socket.blocking &&
+                            (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP)) {
+                            // For a non-blocking TCP socket ask for
+                            // the connection to be made in the
+                            // background; set the state first as
+                            // connectedCallback() may be called
+                            // before uCellSockConnectAsync() returns
+                            memcpy(&pContainer->socket.remoteAddress,
+                                   pRemoteAddress,
+                                   sizeof(pContainer->socket.remoteAddress));
+                            pContainer->socket.state = U_SOCK_STATE_CONNECTING;
+                            errorCode = uCellSockConnectAsync(networkHandle,
+                                                              sockHandle,
+                                                              pRemoteAddress,
+                                                              connectedCallback);
+                            if (errorCode == 0) {
+                                errorCode = -U_SOCK_EINPROGRESS;
+                            } else {
+                                pContainer->socket.state = U_SOCK_STATE_CREATED;
+                            }
+                        }
+                        if (errorCode == -U_SOCK_ENOSYS) {
+                            // Blocking, or the module can't do
+                            // it asynchronously: just connect
+                            errorCode = uCellSockConnect(networkHandle,
+                                                         sockHandle,
+                                                         pRemoteAddress);
+                        }
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        errorCode = uWifiSockConnect(networkHandle,
+                                                     sockHandle,
+                                                     pRemoteAddress);
+                    }
+
+                    if (errorCode == -U_SOCK_EINPROGRESS) {
+                        // Connection is being made, completion
+                        // will be signalled via connectedCallback()
+                        errnoLocal = U_SOCK_EINPROGRESS;
+                        uPortLog("U_SOCK: socket with descriptor %d, network"
+                                 " handle %d, socket handle %d, is"
+                                 " connecting.\n", descriptor, networkHandle,
+                                 sockHandle);
+                    } else if (errorCode == 0) {
+                        // All is good
+                        memcpy(&pContainer->socket.remoteAddress,
+                               pRemoteAddress,
+                               sizeof(pContainer->socket.remoteAddress));
+                        pContainer->socket.state = U_SOCK_STATE_CONNECTED;
+                        uPortLog("U_SOCK: socket with descriptor %d, network"
+                                 " handle %d, socket handle %d, is "
+                                 " connected to address \"%.*s\".\n",
+                                 descriptor, networkHandle, sockHandle,
+                                 addressToString(&pContainer->socket.remoteAddress,
+                                                 true, buffer,
+                                                 sizeof(buffer)),
+                                 buffer);
+                    } else {
+                        // Set errno
+                        errnoLocal = -errorCode;
+                        uPortLog("U_SOCK: underlying socket layer"
+                                 " returned errno %d when trying to"
+                                 " connect to address \"%.*s\" on socket"
+                                 " with descriptor %d, network handle"
+                                 " %d, socket handle %d.\n", errnoLocal,
+                                 addressToString(pRemoteAddress, true,
+                                                 buffer, sizeof(buffer)),
+                                 buffer, descriptor, networkHandle,
+                                 sockHandle);
+                    }
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        }
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Close a socket.
+int32_t uSockClose(uSockDescriptor_t descriptor)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+    int32_t sockHandle;
+    uSockState_t finalState = U_SOCK_STATE_CLOSED;
+    void (*pAsyncClosedCallback) (int32_t, int32_t) = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexWriteQueue);
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            // We have found the container, talk to the underlying
+            // cell/wifi socket layer to close the socket there.
+            // If the underlying socket layer waits while it gets
+            // the ack for the ack for the ack at TCP level then
+            // give it a callback to call when it is done and
+            // set finalState to U_SOCK_STATE_CLOSING to mark
+            // the socket as closing, not closed.
+            // uXxxSockClose() returns a negated value of errno
+            // from the U_SOCK_Exxx list
+            networkHandle = pContainer->socket.networkHandle;
+            sockHandle = pContainer->socket.sockHandle;
+            // Send anything left in the write coalescing
+            // buffer or write queue: nothing we can do about
+            // an error here
+            writeCoalesceFlush(pContainer);
+            writeCoalesceFree(pContainer);
+            writeQueueDrain(pContainer);
+            writeQueueFree(pContainer);
+            errnoLocal = U_SOCK_ENONE;
+            errorCode = -U_SOCK_ENOSYS;
+            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                // In the cellular case asynchronous TCP
+                // socket closure is used in some cases.
+                if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
+                    finalState = U_SOCK_STATE_CLOSING;
+                    pAsyncClosedCallback = closedCallback;
+                }
+                errorCode = uCellSockClose(networkHandle,
+                                           sockHandle,
+                                           pAsyncClosedCallback);
+            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                // Wifi socket closure is always synchronous
+                errorCode = uWifiSockClose(networkHandle,
+                                           sockHandle, NULL);
+            }
+            if (errorCode == 0) {
+                uPortLog("U_SOCK: socket with descriptor %d,"
+                         " network handle %d, socket handle %d,"
+                         " has been closed.\n",
+                         descriptor, networkHandle, sockHandle);
+                if (pContainer->socket.state != U_SOCK_STATE_CLOSED) {
+                    // Now mark the socket as closed (or closing).
+                    // Socket is only freed by a call to
+                    // uSockCleanUp() in order to ensure
+                    // thread-safeness
+                    // Do the check for closed state above first as it
+                    // is possible for the uXxxSockClose() function
+                    // to call the callback to close the socket
+                    // immediately, before it returns.
+                    if (finalState == U_SOCK_STATE_CLOSED) {
+                        // There was no hanging around, call the
+                        // callback directly
+                        closedCallback(networkHandle, sockHandle);
+                    } else {
+                        // Just set the state and the callback
+                        // will sort actual closing out later
+                        pContainer->socket.state = finalState;
+                    }
+                }
+            } else {
+                errnoLocal = -errorCode;
+                uPortLog("U_SOCK: underlying socket layer returned"
+                         " errno %d on closing descriptor %d,"
+                         " network handle %d, socket handle %d.\n",
+                         errnoLocal, descriptor, networkHandle,
+                         sockHandle);
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        U_PORT_MUTEX_UNLOCK(gMutexWriteQueue);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Free memory from any sockets that are no longer in use.
+void uSockCleanUp()
+{
+    uSockContainer_t *pContainer = gpContainerListHead;
+    uSockContainer_t *pTmp;
+    size_t numNonClosedSockets = 0;
+    int32_t networkHandle;
+
+    if (gInitialised) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Move through the list removing closed sockets
+        while (pContainer != NULL) {
+            if ((pContainer->socket.state == U_SOCK_STATE_CLOSED) ||
+                (pContainer->socket.state == U_SOCK_STATE_CLOSING)) {
+                writeCoalesceFree(pContainer);
+                writeQueueFree(pContainer);
+                if (!(pContainer->isStatic)) {
+                    // If this socket is not static, uncouple it
+                    // If there is a previous container, move its pNext
+                    if (pContainer->pPrevious != NULL) {
+                        pContainer->pPrevious->pNext = pContainer->pNext;
+                    } else {
+                        // If there is no previous container, must be
+                        // at the start of the list so move the head
+                        // pointer on instead
+                        gpContainerListHead = pContainer->pNext;
+                    }
+                    // If there is a next container, move its pPrevious
+                    if (pContainer->pNext != NULL) {
+                        pContainer->pNext->pPrevious = pContainer->pPrevious;
+                    }
+
+                    // Remember the next pointer and the
+                    // network handle
+                    pTmp = pContainer->pNext;
+                    networkHandle = pContainer->socket.networkHandle;
+
+                    // Free the memory
+                    free(pContainer);
+                    // Move to the next entry
+                    pContainer = pTmp;
+                } else {
+                    // Remember the network handle
+                    networkHandle = pContainer->socket.networkHandle;
+                    pContainer->socket.state = U_SOCK_STATE_CLOSED;
+                    // Move on
+                    pContainer = pContainer->pNext;
+                }
+
+                if (networkHandle >= 0) {
+                    // Call the clean-up function in the underlying
+                    // socket layer, where present
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        uCellSockCleanup(networkHandle);
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        uWifiSockCleanup(networkHandle);
+                    }
+                }
+            } else {
+                // Move on but count the number of non-closed sockets
+                numNonClosedSockets++;
+                pContainer = pContainer->pNext;
+            }
+        }
+
+        // If everything has been closed, we can deinit();
+        if (numNonClosedSockets == 0) {
+            deinitButNotMutex();
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+        if (numNonClosedSockets == 0) {
+            // Can only do these outside the mutex
+            writeCoalesceTimerClose();
+            writeQueueTaskClose();
+            dataPushTaskClose();
+        }
+    }
+}
+
+// Close all sockets and free resource.
+void uSockDeinit()
+{
+    uSockContainer_t *pContainer;
+    uSockContainer_t *pTmp;
+    int32_t networkHandle;
+    int32_t sockHandle;
+    int64_t startTimeMs;
+    size_t numClosing;
+
+    if (gInitialised) {
+
+        U_PORT_MUTEX_LOCK(gMutexWriteQueue);
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // No user callbacks are called once deinitialisation
+        // has begun
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        pContainer = gpContainerListHead;
+        while (pContainer != NULL) {
+            pContainer->socket.pDataCallback = NULL;
+            pContainer->socket.pConnectedCallback = NULL;
+            pContainer->socket.pClosedCallback = NULL;
+            pContainer = pContainer->pNext;
+        }
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+        // Ask the underlying socket layer to close all of the
+        // sockets first, asynchronously where it can, so that
+        // the closures proceed in parallel; errors are ignored
+        // 'cos there's nothing we can do, we're closin' dowwwn...
+        pContainer = gpContainerListHead;
+        while (pContainer != NULL) {
+            if ((pContainer->socket.state != U_SOCK_STATE_CLOSING) &&
+                (pContainer->socket.state != U_SOCK_STATE_CLOSED)) {
+                networkHandle = pContainer->socket.networkHandle;
+                sockHandle = pContainer->socket.sockHandle;
+                writeCoalesceFlush(pContainer);
+                writeQueueDrain(pContainer);
+                if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                    if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
+                        // Mark the socket as closing before asking for
+                        // closure since closedCallback() may be
+                        // called before uCellSockClose() returns
+                        pContainer->socket.state = U_SOCK_STATE_CLOSING;
+                        if (uCellSockClose(networkHandle, sockHandle,
+                                           closedCallback) != 0) {
+                            pContainer->socket.state = U_SOCK_STATE_CLOSED;
+                        }
+                    } else {
+                        uCellSockClose(networkHandle, sockHandle, NULL);
+                    }
+                } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                    uWifiSockClose(networkHandle, sockHandle, NULL);
+                }
+            }
+            pContainer = pContainer->pNext;
+        }
+
+        // Wait for the closures to complete without holding
+        // the mutexes, since the callback task that will call
+        // closedCallback() may be held up by something else
+        // that needs them
+        startTimeMs = uPortGetTickTimeMs();
+        numClosing = numContainersClosing();
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        U_PORT_MUTEX_UNLOCK(gMutexWriteQueue);
+        while ((numClosing > 0) &&
+               (uPortGetTickTimeMs() - startTimeMs <
+                U_SOCK_CLOSE_TIMEOUT_SECONDS * 1000)) {
+            uPortTaskBlock(U_SOCK_CLOSE_POLL_INTERVAL_MS);
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+            numClosing = numContainersClosing();
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        }
+        U_PORT_MUTEX_LOCK(gMutexWriteQueue);
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Now move through the list removing the sockets,
+        // holding the callbacks mutex so that a late
+        // closedCallback() can't be using a container
+        // as it is freed
+        U_PORT_MUTEX_LOCK(gMutexCallbacks);
+        pContainer = gpContainerListHead;
+        while (pContainer != NULL) {
+            writeCoalesceFree(pContainer);
+            writeQueueFree(pContainer);
+            if (!(pContainer->isStatic)) {
+                // If this socket is not static, uncouple it
+                // If there is a previous container, move its pNext
+                if (pContainer->pPrevious != NULL) {
+                    pContainer->pPrevious->pNext = pContainer->pNext;
+                } else {
+                    // If there is no previous container, must be
+                    // at the start of the list so move the head
+                    // pointer on instead
+                    gpContainerListHead = pContainer->pNext;
+                }
+                // If there is a next container, move its pPrevious
+                if (pContainer->pNext != NULL) {
+                    pContainer->pNext->pPrevious = pContainer->pPrevious;
+                }
+
+                // Remember the next pointer
+                pTmp = pContainer->pNext;
+
+                // Free the memory
+                free(pContainer);
+                // Move to the next entry
+                pContainer = pTmp;
+            } else {
+                pContainer->socket.state = U_SOCK_STATE_CLOSED;
+                // Move on
+                pContainer = pContainer->pNext;
+            }
+        }
+        U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+
+        // We can now deinit();
+        deinitButNotMutex();
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        U_PORT_MUTEX_UNLOCK(gMutexWriteQueue);
+
+        // Can only do these outside the mutex
+        writeCoalesceTimerClose();
+        writeQueueTaskClose();
+        dataPushTaskClose();
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CONFIGURE
+ * -------------------------------------------------------------- */
+
+// Set a socket to be blocking or non-blocking.
+void uSockBlockingSet(uSockDescriptor_t descriptor, bool isBlocking)
+{
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        pContainer = pContainerFindByDescriptor(descriptor);
+        errnoLocal = U_SOCK_EBADF;
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_ENONE;
+            pContainer->socket.blocking = isBlocking;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+    }
+}
+
+// Get whether a socket is blocking or not.
+bool uSockBlockingGet(uSockDescriptor_t descriptor)
+{
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    bool isBlocking = false;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_ENONE;
+            isBlocking = pContainer->socket.blocking;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+    }
+
+    return isBlocking;
+}
+
+// Set the options for the given socket.
+int32_t uSockOptionSet(uSockDescriptor_t descriptor,
+                       int32_t level, uint32_t option,
+                       const void *pOptionValue,
+                       size_t optionValueLength)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+    int32_t sockHandle;
+    bool noDelaySet;
+
+    uPortLog("U_SOCK: option set command %d:0x%04x called"
+             " on descriptor %d with value ", option, level,
+             descriptor);
+    printSocketOption(pOptionValue, optionValueLength);
+    uPortLog("\n");
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EINVAL;
+            // Check parameters
+            if ((optionValueLength == 0) ||
+                ((optionValueLength > 0) && (pOptionValue != NULL))) {
+                if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                    (option == U_SOCK_OPT_RCVTIMEO)) {
+                    // Receive timeout we set locally
+                    if ((pOptionValue != NULL) &&
+                        (optionValueLength == sizeof(struct timeval))) {
+                        // All good
+                        errnoLocal = U_SOCK_ENONE;
+                        pContainer->socket.receiveTimeoutMs =
+                            (((const struct timeval *) pOptionValue)->tv_usec / 1000) +
+                            (((int64_t) ((const struct timeval *) pOptionValue)->tv_sec) * 1000);
+                        uPortLog("U_SOCK: timeout for socket descriptor"
+                                 " %d set to %d ms.\n", descriptor,
+                                 (int32_t) pContainer->socket.receiveTimeoutMs);
+                    } else {
+                        uPortLog("U_SOCK: socket option %d:0x%04x"
+                                 " could not be set to value ",
+                                 option, level);
+                        printSocketOption(pOptionValue, optionValueLength);
+                        uPortLog("\n");
+                    }
+                } else if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                           (option == U_SOCK_OPT_SNDBUF)) {
+                    // Send buffer size is the size of the write
+                    // queue, which we have locally
+                    if ((pOptionValue != NULL) &&
+                        (optionValueLength == sizeof(int32_t)) &&
+                        (*((const int32_t *) pOptionValue) > 0)) {
+                        errnoLocal = writeQueueSizeSet(pContainer,
+                                                       *((const int32_t *) pOptionValue));
+                    }
+                    if (errnoLocal == U_SOCK_ENONE) {
+                        uPortLog("U_SOCK: write queue size for socket"
+                                 " descriptor %d set to %d byte(s).\n",
+                                 descriptor,
+                                 (int32_t) pContainer->socket.writeQueueSize);
+                    } else {
+                        uPortLog("U_SOCK: socket option %d:0x%04x"
+                                 " could not be set to value ",
+                                 option, level);
+                        printSocketOption(pOptionValue, optionValueLength);
+                        uPortLog("\n");
+                    }
+                } else {
+                    // Otherwise talk to the underlying socket
+                    // layer to set the socket option.
+                    // uXxxSockOptionSet() returns a negated value
+                    // of errno from the U_SOCK_Exxx list
+                    networkHandle = pContainer->socket.networkHandle;
+                    sockHandle = pContainer->socket.sockHandle;
+                    errnoLocal = U_SOCK_ENONE;
+                    noDelaySet = false;
+                    if ((level == U_SOCK_OPT_LEVEL_TCP) &&
+                        (option == U_SOCK_OPT_TCP_NODELAY) &&
+                        (pOptionValue != NULL) &&
+                        (optionValueLength >= sizeof(int32_t))) {
+                        // No delay means no write coalescing
+                        // either, so send anything buffered; this
+                        // is done here whatever the underlying
+                        // socket layer makes of the option
+                        noDelaySet = true;
+                        pContainer->socket.noDelay = (*((const int32_t *) pOptionValue) != 0);
+                        if (pContainer->socket.noDelay) {
+                            writeCoalesceFlush(pContainer);
+                        }
+                    }
+                    errorCode = -U_SOCK_ENOSYS;
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        errorCode = uCellSockOptionSet(networkHandle,
+                                                       sockHandle,
+                                                       level, option,
+                                                       pOptionValue,
+                                                       optionValueLength);
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        // Socket options are not supported on Wi-Fi,
+                        // leave errorCode as -U_SOCK_ENOSYS
+                    }
+
+                    if ((errorCode == 0) ||
+                        (noDelaySet && (errorCode == -U_SOCK_ENOSYS))) {
+                        // All good, the underlying socket layer
+                        // having nothing to do with no delay is
+                        // fine since it has been handled here
+                        errorCode = 0;
+                        uPortLog("U_SOCK: socket option %d:0x%04x"
+                                 " set to value ", option, level);
+                    } else {
+                        // Invalid argument
+                        errnoLocal = -errorCode;
+                        uPortLog("U_SOCK: errno %d when setting"
+                                 " socket option %d:0x%04x to value ",
+                                 errnoLocal, option, level);
+                    }
+                    printSocketOption(pOptionValue, optionValueLength);
+                    uPortLog("by network handle %d, socket"
+                             " handle %d.\n", networkHandle,
+                             sockHandle);
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Get the options for the given socket.
+int32_t uSockOptionGet(uSockDescriptor_t descriptor,
+                       int32_t level, uint32_t option,
+                       void *pOptionValue,
+                       size_t *pOptionValueLength)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+    int32_t sockHandle;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EINVAL;
+            // If there's an optionValue then there must be a length
+            if ((pOptionValue == NULL) ||
+                (pOptionValueLength != NULL)) {
+                if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                    (option == U_SOCK_OPT_ERROR) &&
+                    (pContainer->socket.connectErrno != U_SOCK_ENONE)) {
+                    // The outcome of a failed non-blocking connect
+                    // we have locally; reading it clears it
+                    if (pOptionValueLength != NULL) {
+                        if (pOptionValue != NULL) {
+                            if (*pOptionValueLength >= sizeof(int32_t)) {
+                                errnoLocal = U_SOCK_ENONE;
+                                *((int32_t *) pOptionValue) = pContainer->socket.connectErrno;
+                                *pOptionValueLength = sizeof(int32_t);
+                                pContainer->socket.connectErrno = U_SOCK_ENONE;
+                            }
+                        } else {
+                            errnoLocal = U_SOCK_ENONE;
+                            // Caller just wants to know the length required
+                            *pOptionValueLength = sizeof(int32_t);
+                        }
+                    }
+                } else if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                           (option == U_SOCK_OPT_RCVTIMEO)) {
+                    // Receive timeout we have locally
+                    if (pOptionValueLength != NULL) {
+                        if (pOptionValue != NULL) {
+                            if (*pOptionValueLength >= sizeof(struct timeval)) {
+                                errnoLocal = U_SOCK_ENONE;
+                                // Return the answer
+                                ((struct timeval *) pOptionValue)->tv_sec =
+                                    (int32_t) (pContainer->socket.receiveTimeoutMs / 1000);
+                                ((struct timeval *) pOptionValue)->tv_usec =
+                                    (pContainer->socket.receiveTimeoutMs % 1000) * 1000;
+                                *pOptionValueLength = sizeof(struct timeval);
+                                uPortLog("U_SOCK: timeout for socket descriptor"
+                                         " %d is %d ms.\n", descriptor,
+                                         (int32_t) pContainer->socket.receiveTimeoutMs);
+                            }
+                        } else {
+                            errnoLocal = U_SOCK_ENONE;
+                            // Caller just wants to know the length required
+                            *pOptionValueLength = sizeof(struct timeval);
+                        }
+                    }
+                } else if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
+                           (option == U_SOCK_OPT_SNDBUF)) {
+                    // Write queue size we have locally
+                    if (pOptionValueLength != NULL) {
+                        if (pOptionValue != NULL) {
+                            if (*pOptionValueLength >= sizeof(int32_t)) {
+                                errnoLocal = U_SOCK_ENONE;
+                                *((int32_t *) pOptionValue) = (int32_t) pContainer->socket.writeQueueSize;
+                                *pOptionValueLength = sizeof(int32_t);
+                            }
+                        } else {
+                            errnoLocal = U_SOCK_ENONE;
+                            // Caller just wants to know the length required
+                            *pOptionValueLength = sizeof(int32_t);
+                        }
+                    }
+                } else {
+                    // Otherwise talk to the underlying socket layer
+                    // to get the socket option.
+                    // uXxxSockOptionGet() returns a negated value of
+                    // errno from the U_SOCK_Exxx list.
+                    networkHandle = pContainer->socket.networkHandle;
+                    sockHandle = pContainer->socket.sockHandle;
+                    errnoLocal = U_SOCK_ENONE;
+                    errorCode = -U_SOCK_ENOSYS;
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        errorCode = uCellSockOptionGet(networkHandle,
+                                                       sockHandle,
+                                                       level, option,
+                                                       pOptionValue,
+                                                       pOptionValueLength);
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        // Socket options are not supported on Wi-Fi,
+                        // leave errorCode as -U_SOCK_ENOSYS
+                    }
+
+                    if (errorCode == 0) {
+                        // All good.
+                        if (pOptionValue != NULL) {
+                            uPortLog("U_SOCK: the value of option %d:0x%04x"
+                                     " for socket descriptor %d is ", option,
+                                     level, descriptor);
+                            printSocketOption(pOptionValue, *pOptionValueLength);
+                            uPortLog("according to network handle %d, socket"
+                                     " handle %d.\n", networkHandle, sockHandle);
+                        }
+                    } else {
+                        // Set errno
+                        errnoLocal = -errorCode;
+                        uPortLog("U_SOCK: getting the value of option"
+                                 " %d:0x%04x for socket descriptor %d from"
+                                 " network handle %d, socket handle %d,"
+                                 " returned errno %d.\n",
+                                 option, level, descriptor, networkHandle,
+                                 sockHandle, errnoLocal);
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: UDP ONLY
+ * -------------------------------------------------------------- */
+
+// Send a datagram to the given host.
+int32_t uSockSendTo(uSockDescriptor_t descriptor,
+                    const uSockAddress_t *pRemoteAddress,
+                    const void *pData, size_t dataSizeBytes)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+    int32_t sockHandle;
+    int64_t startTimeMs;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            // Check address and state
+            errnoLocal = U_SOCK_EDESTADDRREQ;
+            if (pRemoteAddress != NULL) {
+                errnoLocal = U_SOCK_ENONE;
+            } else {
+                // If there is no remote address and the socket was
+                // connected we must use the stored address
+                if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
+                    pRemoteAddress = &(pContainer->socket.remoteAddress);
+                    errnoLocal = U_SOCK_ENONE;
+                } else {
+                    if ((pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_WRITE) ||
+                        (pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        // Socket is shut down
+                        errnoLocal = U_SOCK_ESHUTDOWN;
+                    } else if (pContainer->socket.state == U_SOCK_STATE_CLOSING) {
+                        // I know connection isn't strictly relevant
+                        // to UDP transmission but I can't see anything
+                        // more appropriate to return
+                        errnoLocal = U_SOCK_ENOTCONN;
+                    } else {
+                        // Destination address required?
+                        errnoLocal = U_SOCK_EDESTADDRREQ;
+                    }
+                }
+            }
+            if ((errnoLocal == U_SOCK_ENONE) && (pRemoteAddress != NULL)) {
+                errnoLocal = U_SOCK_EPROTOTYPE;
+                // It is OK to send UDP packets on a TCP socket
+                if ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) ||
+                    (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP)) {
+                    errnoLocal = U_SOCK_EINVAL;
+                    if ((pData == NULL) && (dataSizeBytes > 0)) {
+                        // Invalid argument
+                    } else {
+                        errnoLocal = U_SOCK_ENONE;
+                        if ((pData != NULL) && (dataSizeBytes > 0)) {
+                            startTimeMs = U_SOCK_STATS_START_TIME_MS();
+                            // Talk to the underlying cell/wifi
+                            // socket layer to send the datagram.
+                            // uXxxSockSendTo() returns the number of
+                            // bytes sent or a negated value of errno
+                            // from the U_SOCK_Exxx list.
+                            networkHandle = pContainer->socket.networkHandle;
+                            sockHandle = pContainer->socket.sockHandle;
+                            errorCodeOrSize = -U_SOCK_ENOSYS;
+                            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                                errorCodeOrSize = uCellSockSendTo(networkHandle,
+                                                                  sockHandle,
+                                                                  pRemoteAddress,
+                                                                  pData,
+                                                                  dataSizeBytes);
+                            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                                errorCodeOrSize = uWifiSockSendTo(networkHandle,
+                                                                  sockHandle,
+                                                                  pRemoteAddress,
+                                                                  pData,
+                                                                  dataSizeBytes);
+                            }
+
+                            U_SOCK_STATS_ADD(pContainer, underlyingCalls, 1);
+                            U_SOCK_STATS_ADD(pContainer, txCalls, 1);
+                            U_SOCK_STATS_TX_LATENCY(pContainer, startTimeMs);
+                            if (errorCodeOrSize < 0) {
+                                // Set errno
+                                errnoLocal = -errorCodeOrSize;
+                                if (errnoLocal == U_SOCK_EWOULDBLOCK) {
+                                    U_SOCK_STATS_ADD(pContainer, wouldBlocks, 1);
+                                }
+                            } else {
+                                U_SOCK_STATS_ADD(pContainer, txBytes, errorCodeOrSize);
+                            }
+                        }
                     }
+                }
+            }
+        }
 
-                    if (sockHandle >= 0) {
-                        // All is good, no need to set descriptorOrError
-                        // as it was already set above
-                        pContainer->socket.sockHandle = sockHandle;
-                        pContainer->socket.networkHandle = networkHandle;
-                        uPortLog("U_SOCK: socket created, descriptor %d,"
-                                 " network handle %d, socket handle %d.\n",
-                                 descriptorOrError, networkHandle, sockHandle);
-                    } else {
-                        // Set errno
-                        errnoLocal = -sockHandle;
-                        // Free the container once more
-                        containerFree(descriptorOrError);
-                        uPortLog("U_SOCK: underlying socket layer could not create"
-                                 " socket (errno %d).\n", errnoLocal);
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCodeOrSize;
+}
+
+// Receive a single datagram from the given host.
+int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
+                         uSockAddress_t *pRemoteAddress,
+                         void *pData, size_t dataSizeBytes)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EPROTOTYPE;
+            // It is OK to receive UDP-style on a TCP socket
+            if ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) ||
+                (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP)) {
+                // I know connection isn't strictly relevant
+                // to UDP but I can't see anything more
+                // appropriate to return
+                errnoLocal = U_SOCK_ENOTCONN;
+                if (pContainer->socket.state != U_SOCK_STATE_CLOSING) {
+                    errnoLocal = U_SOCK_ESHUTDOWN;
+                    if ((pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_READ) &&
+                        (pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        errnoLocal = U_SOCK_EINVAL;
+                        if ((pData == NULL) && (dataSizeBytes > 0)) {
+                            // Invalid argument
+                        } else {
+                            errnoLocal = U_SOCK_ENONE;
+                            if ((pData != NULL) && (dataSizeBytes != 0)) {
+                                // Receive the datagram
+                                errorCodeOrSize = receive(pContainer,
+                                                          pRemoteAddress,
+                                                          pData,
+                                                          dataSizeBytes);
+                                U_SOCK_STATS_ADD(pContainer, rxCalls, 1);
+                                if (errorCodeOrSize < 0) {
+                                    // Set errno
+                                    errnoLocal = -errorCodeOrSize;
+                                    if (errnoLocal == U_SOCK_EWOULDBLOCK) {
+                                        U_SOCK_STATS_ADD(pContainer, wouldBlocks, 1);
+                                    }
+                                } else {
+                                    U_SOCK_STATS_ADD(pContainer, rxBytes, errorCodeOrSize);
+                                }
+                            }
+                        }
                     }
                 }
             }
@@ -1201,114 +3657,103 @@ int32_t uSockCreate(int32_t networkHandle, uSockType_t type,
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        descriptorOrError = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
 
-    return descriptorOrError;
+    return errorCodeOrSize;
 }
 
-// Make an outgoing connection on the given socket.
-int32_t uSockConnect(uSockDescriptor_t descriptor,
-                     const uSockAddress_t *pRemoteAddress)
+// Send a batch of datagrams.
+int32_t uSockSendToBatch(uSockDescriptor_t descriptor,
+                         uSockDatagram_t *pDatagrams,
+                         size_t numDatagrams)
 {
-    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errorCodeOrNum = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
+    const uSockAddress_t *pRemoteAddressDefault = NULL;
     int32_t networkHandle;
-    int32_t sockHandle;
-#if U_CFG_ENABLE_LOGGING
-    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
-#endif
+    int64_t startTimeMs;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
-        errnoLocal = U_SOCK_EINVAL;
-        // Check that the remote IP address is sensible
-        if (pRemoteAddress != NULL) {
 
-            U_PORT_MUTEX_LOCK(gMutexContainer);
+        U_PORT_MUTEX_LOCK(gMutexContainer);
 
-            // Find the container
-            pContainer = pContainerFindByDescriptor(descriptor);
-            errnoLocal = U_SOCK_EBADF;
-            if (pContainer != NULL) {
-                // TODO: is "operation not permitted" the right error?
-                errnoLocal = U_SOCK_EPERM;
-                if (pContainer->socket.state == U_SOCK_STATE_CREATED) {
-                    // We have found the container and it is
-                    // in the right state, talk to the underlying
-                    // cell/wifi socket layer to make the connection
-                    // uXxxSockConnect() returns a negated value of errno
-                    // from the U_SOCK_Exxx list
-                    networkHandle = pContainer->socket.networkHandle;
-                    sockHandle = pContainer->socket.sockHandle;
-                    errnoLocal = U_SOCK_ENONE;
-                    errorCode = -U_SOCK_ENOSYS;
-                    uPortLog("U_SOCK: connecting socket to \"%.*s\"...\n",
-                             addressToString(pRemoteAddress, true,
-                                             buffer, sizeof(buffer)),
-                             buffer);
-                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                        errorCode = uCellSockConnect(networkHandle,
-                                                     sockHandle,
-                                                     pRemoteAddress);
-                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                        // TODO
-                    }
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EPROTOTYPE;
+            if (pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) {
+                errnoLocal = U_SOCK_ESHUTDOWN;
+                if ((pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_WRITE) &&
+                    (pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                    errnoLocal = U_SOCK_EINVAL;
+                    if ((pDatagrams != NULL) || (numDatagrams == 0)) {
+                        errnoLocal = U_SOCK_ENONE;
+                        if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
+                            // Datagrams with no address go here
+                            pRemoteAddressDefault = &(pContainer->socket.remoteAddress);
+                        }
+                        if (numDatagrams > 0) {
+                            startTimeMs = U_SOCK_STATS_START_TIME_MS();
+                            networkHandle = pContainer->socket.networkHandle;
+                            errorCodeOrNum = -U_SOCK_ENOSYS;
+                            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                                errorCodeOrNum = uCellSockSendToBatch(networkHandle,
+                                                                      pContainer->socket.sockHandle,
+                                                                      pRemoteAddressDefault,
+                                                                      pDatagrams,
+                                                                      numDatagrams);
+                            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                                // Batch send is not supported on Wi-Fi:
+                                // the short range module has no
+                                // multi-datagram write
+                                errorCodeOrNum = -U_SOCK_ENOSYS;
+                            }
 
-                    if (errorCode == 0) {
-                        // All is good
-                        memcpy(&pContainer->socket.remoteAddress,
-                               pRemoteAddress,
-                               sizeof(pContainer->socket.remoteAddress));
-                        pContainer->socket.state = U_SOCK_STATE_CONNECTED;
-                        uPortLog("U_SOCK: socket with descriptor %d, network"
-                                 " handle %d, socket handle %d, is "
-                                 " connected to address \"%.*s\".\n",
-                                 descriptor, networkHandle, sockHandle,
-                                 addressToString(&pContainer->socket.remoteAddress,
-                                                 true, buffer,
-                                                 sizeof(buffer)),
-                                 buffer);
-                    } else {
-                        // Set errno
-                        errnoLocal = -errorCode;
-                        uPortLog("U_SOCK: underlying socket layer"
-                                 " returned errno %d when trying to"
-                                 " connect to address \"%.*s\" on socket"
-                                 " with descriptor %d, network handle"
-                                 " %d, socket handle %d.\n", errnoLocal,
-                                 addressToString(pRemoteAddress, true,
-                                                 buffer, sizeof(buffer)),
-                                 buffer, descriptor, networkHandle,
-                                 sockHandle);
+                            U_SOCK_STATS_ADD(pContainer, underlyingCalls, 1);
+                            U_SOCK_STATS_ADD(pContainer, txCalls, 1);
+                            U_SOCK_STATS_TX_LATENCY(pContainer, startTimeMs);
+                            if (errorCodeOrNum < 0) {
+                                // Set errno
+                                errnoLocal = -errorCodeOrNum;
+                                if (errnoLocal == U_SOCK_EWOULDBLOCK) {
+                                    U_SOCK_STATS_ADD(pContainer, wouldBlocks, 1);
+                                }
+                            } else {
+                                for (int32_t x = 0; x < errorCodeOrNum; x++) {
+                                    U_SOCK_STATS_ADD(pContainer, txBytes,
+                                                     pDatagrams[x].result);
+                                }
+                            }
+                        }
                     }
                 }
             }
-
-            U_PORT_MUTEX_UNLOCK(gMutexContainer);
         }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
     }
 
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+        errorCodeOrNum = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
 
-    return errorCode;
+    return errorCodeOrNum;
 }
 
-// Close a socket.
-int32_t uSockClose(uSockDescriptor_t descriptor)
+// Receive a batch of datagrams.
+int32_t uSockReceiveFromBatch(uSockDescriptor_t descriptor,
+                              uSockDatagram_t *pDatagrams,
+                              size_t numDatagrams)
 {
-    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errorCodeOrNum = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    int32_t networkHandle;
-    int32_t sockHandle;
-    uSockState_t finalState = U_SOCK_STATE_CLOSED;
-    void (*pAsyncClosedCallback) (int32_t, int32_t) = NULL;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -1319,63 +3764,132 @@ int32_t uSockClose(uSockDescriptor_t descriptor)
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            // We have found the container, talk to the underlying
-            // cell/wifi socket layer to close the socket there.
-            // If the underlying socket layer waits while it gets
-            // the ack for the ack for the ack at TCP level then
-            // give it a callback to call when it is done and
-            // set finalState to U_SOCK_STATE_CLOSING to mark
-            // the socket as closing, not closed.
-            // uXxxSockClose() returns a negated value of errno
-            // from the U_SOCK_Exxx list
-            networkHandle = pContainer->socket.networkHandle;
-            sockHandle = pContainer->socket.sockHandle;
-            errnoLocal = U_SOCK_ENONE;
-            errorCode = -U_SOCK_ENOSYS;
-            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                // In the cellular case asynchronous TCP
-                // socket closure is used in some cases.
-                if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
-                    finalState = U_SOCK_STATE_CLOSING;
-                    pAsyncClosedCallback = closedCallback;
+            errnoLocal = U_SOCK_EPROTOTYPE;
+            if (pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) {
+                errnoLocal = U_SOCK_ENOTCONN;
+                if (pContainer->socket.state != U_SOCK_STATE_CLOSING) {
+                    errnoLocal = U_SOCK_ESHUTDOWN;
+                    if ((pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_READ) &&
+                        (pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        errnoLocal = U_SOCK_EINVAL;
+                        if ((pDatagrams != NULL) || (numDatagrams == 0)) {
+                            errnoLocal = U_SOCK_ENONE;
+                            if (numDatagrams > 0) {
+                                errorCodeOrNum = receiveBatch(pContainer,
+                                                              pDatagrams,
+                                                              numDatagrams);
+                                U_SOCK_STATS_ADD(pContainer, rxCalls, 1);
+                                if (errorCodeOrNum < 0) {
+                                    // Set errno
+                                    errnoLocal = -errorCodeOrNum;
+                                    if (errnoLocal == U_SOCK_EWOULDBLOCK) {
+                                        U_SOCK_STATS_ADD(pContainer, wouldBlocks, 1);
+                                    }
+                                } else {
+                                    for (int32_t x = 0; x < errorCodeOrNum; x++) {
+                                        U_SOCK_STATS_ADD(pContainer, rxBytes,
+                                                         pDatagrams[x].result);
+                                    }
+                                }
+                            }
+                        }
+                    }
                 }
-                errorCode = uCellSockClose(networkHandle,
-                                           sockHandle,
-                                           pAsyncClosedCallback);
-            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                // TODO
             }
-            if (errorCode == 0) {
-                uPortLog("U_SOCK: socket with descriptor %d,"
-                         " network handle %d, socket handle %d,"
-                         " has been closed.\n",
-                         descriptor, networkHandle, sockHandle);
-                if (pContainer->socket.state != U_SOCK_STATE_CLOSED) {
-                    // Now mark the socket as closed (or closing).
-                    // Socket is only freed by a call to
-                    // uSockCleanUp() in order to ensure
-                    // thread-safeness
-                    // Do the check for closed state above first as it
-                    // is possible for the uXxxSockClose() function
-                    // to call the callback to close the socket
-                    // immediately, before it returns.
-                    if (finalState == U_SOCK_STATE_CLOSED) {
-                        // There was no hanging around, call the
-                        // callback directly
-                        closedCallback(networkHandle, sockHandle);
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCodeOrNum = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCodeOrNum;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: STREAM (TCP)
+ * -------------------------------------------------------------- */
+
+// Send data.
+int32_t uSockWrite(uSockDescriptor_t descriptor,
+                   const void *pData, size_t dataSizeBytes)
+{
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int64_t startTimeMs;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EPROTOTYPE;
+            if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
+                if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
+                    errnoLocal = U_SOCK_EINVAL;
+                    if (((pData == NULL) && (dataSizeBytes > 0)) ||
+                        (dataSizeBytes > INT_MAX)) {
+                        // Invalid argument
                     } else {
-                        // Just set the state and the callback
-                        // will sort actual closing out later
-                        pContainer->socket.state = finalState;
+                        errnoLocal = U_SOCK_ENONE;
+                        if ((pData != NULL) && (dataSizeBytes != 0)) {
+                            startTimeMs = U_SOCK_STATS_START_TIME_MS();
+                            if (pContainer->socket.pWriteQueueBuffer != NULL) {
+                                // Queue the data for the write queue
+                                // task to send
+                                errorCodeOrSize = (int32_t) writeQueuePush(&(pContainer->socket),
+                                                                           pData, dataSizeBytes);
+                                if (errorCodeOrSize > 0) {
+                                    writeQueueTaskStart();
+                                } else {
+                                    // Write queue is full
+                                    errorCodeOrSize = -U_SOCK_EWOULDBLOCK;
+                                }
+                            } else {
+                                // Send the data, or buffer it if
+                                // write coalescing is switched on
+                                errorCodeOrSize = writeStream(pContainer,
+                                                              pData,
+                                                              dataSizeBytes);
+                            }
+                            U_SOCK_STATS_ADD(pContainer, txCalls, 1);
+                            U_SOCK_STATS_TX_LATENCY(pContainer, startTimeMs);
+                            if (errorCodeOrSize < 0) {
+                                // Set errno
+                                errnoLocal = -errorCodeOrSize;
+                                if (errnoLocal == U_SOCK_EWOULDBLOCK) {
+                                    U_SOCK_STATS_ADD(pContainer, wouldBlocks, 1);
+                                }
+                            } else {
+                                U_SOCK_STATS_ADD(pContainer, txBytes, errorCodeOrSize);
+                            }
+                        }
+                    }
+                } else {
+                    if ((pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ) ||
+                        (pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        // Socket is shut down
+                        errnoLocal = U_SOCK_ESHUTDOWN;
+                    } else if (pContainer->socket.state == U_SOCK_STATE_CLOSING) {
+                        // Not connected mate
+                        errnoLocal = U_SOCK_ENOTCONN;
+                    } else if (pContainer->socket.state == U_SOCK_STATE_CONNECTING) {
+                        // Not connected yet, try again later
+                        errnoLocal = U_SOCK_EWOULDBLOCK;
+                    } else {
+                        // No route to host?
+                        errnoLocal = U_SOCK_EHOSTUNREACH;
                     }
                 }
-            } else {
-                errnoLocal = -errorCode;
-                uPortLog("U_SOCK: underlying socket layer returned"
-                         " errno %d on closing descriptor %d,"
-                         " network handle %d, socket handle %d.\n",
-                         errnoLocal, descriptor, networkHandle,
-                         sockHandle);
             }
         }
 
@@ -1385,160 +3899,155 @@ int32_t uSockClose(uSockDescriptor_t descriptor)
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
 
-    return errorCode;
+    return errorCodeOrSize;
 }
 
-// Free memory from any sockets that are no longer in use.
-void uSockCleanUp()
+// Receive data.
+int32_t uSockRead(uSockDescriptor_t descriptor,
+                  void *pData, size_t dataSizeBytes)
 {
-    uSockContainer_t *pContainer = gpContainerListHead;
-    uSockContainer_t *pTmp;
-    size_t numNonClosedSockets = 0;
-    int32_t networkHandle;
+    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
 
-    if (gInitialised) {
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
 
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
-        // Move through the list removing closed sockets
-        while (pContainer != NULL) {
-            if ((pContainer->socket.state == U_SOCK_STATE_CLOSED) ||
-                (pContainer->socket.state == U_SOCK_STATE_CLOSING)) {
-                if (!(pContainer->isStatic)) {
-                    // If this socket is not static, uncouple it
-                    // If there is a previous container, move its pNext
-                    if (pContainer->pPrevious != NULL) {
-                        pContainer->pPrevious->pNext = pContainer->pNext;
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EPROTOTYPE;
+            if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
+                if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
+                    errnoLocal = U_SOCK_EINVAL;
+                    if (((pData == NULL) && (dataSizeBytes > 0)) ||
+                        (dataSizeBytes > INT_MAX)) {
+                        // Invalid argument
                     } else {
-                        // If there is no previous container, must be
-                        // at the start of the list so move the head
-                        // pointer on instead
-                        gpContainerListHead = pContainer->pNext;
-                    }
-                    // If there is a next container, move its pPrevious
-                    if (pContainer->pNext != NULL) {
-                        pContainer->pNext->pPrevious = pContainer->pPrevious;
+                        errnoLocal = U_SOCK_ENONE;
+                        if ((pData != NULL) && (dataSizeBytes != 0)) {
+                            // The far end is unlikely to respond
+                            // to data we are sitting on, so send
+                            // anything in the write coalescing
+                            // buffer; any error will be reported
+                            // on the next uSockWrite()
+                            writeCoalesceFlush(pContainer);
+                            // Receive the datagram
+                            errorCodeOrSize = receive(pContainer,
+                                                      NULL, pData,
+                                                      dataSizeBytes);
+                            U_SOCK_STATS_ADD(pContainer, rxCalls, 1);
+                            if (errorCodeOrSize < 0) {
+                                // Set errno
+                                errnoLocal = -errorCodeOrSize;
+                                if (errnoLocal == U_SOCK_EWOULDBLOCK) {
+                                    U_SOCK_STATS_ADD(pContainer, wouldBlocks, 1);
+                                }
+                            } else {
+                                U_SOCK_STATS_ADD(pContainer, rxBytes, errorCodeOrSize);
+                            }
+                        }
                     }
-
-                    // Remember the next pointer and the
-                    // network handle
-                    pTmp = pContainer->pNext;
-                    networkHandle = pContainer->socket.networkHandle;
-
-                    // Free the memory
-                    free(pContainer);
-                    // Move to the next entry
-                    pContainer = pTmp;
                 } else {
-                    // Remember the network handle
-                    networkHandle = pContainer->socket.networkHandle;
-                    pContainer->socket.state = U_SOCK_STATE_CLOSED;
-                    // Move on
-                    pContainer = pContainer->pNext;
-                }
-
-                if (networkHandle >= 0) {
-                    // Call the clean-up function in the underlying
-                    // socket layer, where present
-                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                        uCellSockCleanup(networkHandle);
-                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                        // TODO
+                    if ((pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ) ||
+                        (pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
+                        // Socket is shut down
+                        errnoLocal = U_SOCK_ESHUTDOWN;
+                    } else if (pContainer->socket.state == U_SOCK_STATE_CLOSING) {
+                        // Not connected mate
+                        errnoLocal = U_SOCK_ENOTCONN;
+                    } else if (pContainer->socket.state == U_SOCK_STATE_CONNECTING) {
+                        // Not connected yet, try again later
+                        errnoLocal = U_SOCK_EWOULDBLOCK;
+                    } else {
+                        // No route to host?
+                        errnoLocal = U_SOCK_EHOSTUNREACH;
                     }
                 }
-            } else {
-                // Move on but count the number of non-closed sockets
-                numNonClosedSockets++;
-                pContainer = pContainer->pNext;
             }
         }
 
-        // If everything has been closed, we can deinit();
-        if (numNonClosedSockets == 0) {
-            deinitButNotMutex();
-        }
-
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
     }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCodeOrSize;
 }
 
-// Close all sockets and free resource.
-void uSockDeinit()
+// Prepare a TCP socket for being closed.
+// Note: this does not need to reference the underlying
+// cell/wifi socket layer other than to send anything
+// left in the write coalescing buffer.
+int32_t uSockShutdown(uSockDescriptor_t descriptor,
+                      uSockShutdown_t how)
 {
-    uSockContainer_t *pContainer = gpContainerListHead;
-    uSockContainer_t *pTmp;
-    int32_t networkHandle;
-    int32_t sockHandle;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
 
-    if (gInitialised) {
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
 
+        U_PORT_MUTEX_LOCK(gMutexWriteQueue);
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
-        // Move through the list closing and
-        // removing sockets
-        while (pContainer != NULL) {
-            if ((pContainer->socket.state != U_SOCK_STATE_CLOSING) &&
-                (pContainer->socket.state != U_SOCK_STATE_CLOSED)) {
-                // Talk to the underlying socket layer
-                // to close the socket: ignoring errors here
-                // 'cos there's nothing we can do,
-                // we're closin' dowwwn...
-                networkHandle = pContainer->socket.networkHandle;
-                sockHandle = pContainer->socket.sockHandle;
-                if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                    uCellSockClose(networkHandle, sockHandle, NULL);
-                } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                    // TODO
-                }
-            }
-
-            if (!(pContainer->isStatic)) {
-                // If this socket is not static, uncouple it
-                // If there is a previous container, move its pNext
-                if (pContainer->pPrevious != NULL) {
-                    pContainer->pPrevious->pNext = pContainer->pNext;
-                } else {
-                    // If there is no previous container, must be
-                    // at the start of the list so move the head
-                    // pointer on instead
-                    gpContainerListHead = pContainer->pNext;
-                }
-                // If there is a next container, move its pPrevious
-                if (pContainer->pNext != NULL) {
-                    pContainer->pNext->pPrevious = pContainer->pPrevious;
-                }
-
-                // Remember the next pointer
-                pTmp = pContainer->pNext;
-
-                // Free the memory
-                free(pContainer);
-                // Move to the next entry
-                pContainer = pTmp;
-            } else {
-                pContainer->socket.state = U_SOCK_STATE_CLOSED;
-                // Move on
-                pContainer = pContainer->pNext;
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            // Set the socket state
+            errnoLocal = U_SOCK_EINVAL;
+            switch (how) {
+                case U_SOCK_SHUTDOWN_READ:
+                    pContainer->socket.state = U_SOCK_STATE_SHUTDOWN_FOR_READ;
+                    errnoLocal = U_SOCK_ENONE;
+                    break;
+                case U_SOCK_SHUTDOWN_WRITE:
+                    writeCoalesceFlush(pContainer);
+                    writeQueueDrain(pContainer);
+                    pContainer->socket.state = U_SOCK_STATE_SHUTDOWN_FOR_WRITE;
+                    errnoLocal = U_SOCK_ENONE;
+                    break;
+                case U_SOCK_SHUTDOWN_READ_WRITE:
+                    writeCoalesceFlush(pContainer);
+                    writeQueueDrain(pContainer);
+                    pContainer->socket.state = U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE;
+                    errnoLocal = U_SOCK_ENONE;
+                    break;
+                default:
+                    break;
             }
         }
 
-        // We can now deinit();
-        deinitButNotMutex();
-
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        U_PORT_MUTEX_UNLOCK(gMutexWriteQueue);
     }
-}
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: CONFIGURE
- * -------------------------------------------------------------- */
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
 
-// Set a socket to be blocking or non-blocking.
-void uSockBlockingSet(uSockDescriptor_t descriptor, bool isBlocking)
+    return errorCode;
+}
+
+// Switch write coalescing on or off.
+int32_t uSockWriteCoalesceSet(uSockDescriptor_t descriptor,
+                              bool onNotOff)
 {
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
 
@@ -1548,11 +4057,44 @@ void uSockBlockingSet(uSockDescriptor_t descriptor, bool isBlocking)
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
         // Find the container
-        pContainer = pContainerFindByDescriptor(descriptor);
         errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            errnoLocal = U_SOCK_ENONE;
-            pContainer->socket.blocking = isBlocking;
+            errnoLocal = U_SOCK_EPROTOTYPE;
+            if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
+                errnoLocal = U_SOCK_ENONE;
+                if (onNotOff) {
+                    if (pContainer->socket.pWriteQueueBuffer != NULL) {
+                        // Can't coalesce into a write queue
+                        errnoLocal = U_SOCK_EBUSY;
+                    } else if (pContainer->socket.pWriteCoalesceBuffer == NULL) {
+                        errnoLocal = U_SOCK_ENOMEM;
+                        // The timer is shared between all sockets
+                        // and is set up on first use
+                        if (gWriteCoalesceEventQueueHandle < 0) {
+                            gWriteCoalesceEventQueueHandle = uPortEventQueueOpen(writeCoalesceTimerCallback,
+                                                                                 "sockCoalesce", 0,
+                                                                                 U_SOCK_WRITE_COALESCE_TASK_STACK_SIZE_BYTES,
+                                                                                 U_SOCK_WRITE_COALESCE_TASK_PRIORITY,
+                                                                                 1);
+                        }
+                        if (gWriteCoalesceEventQueueHandle >= 0) {
+                            pContainer->socket.pWriteCoalesceBuffer = (char *) malloc(U_SOCK_WRITE_COALESCE_BUFFER_SIZE_BYTES);
+                            if (pContainer->socket.pWriteCoalesceBuffer != NULL) {
+                                pContainer->socket.writeCoalesceLength = 0;
+                                pContainer->socket.writeCoalesceNumWrites = 0;
+                                errnoLocal = U_SOCK_ENONE;
+                            }
+                        }
+                    }
+                } else {
+                    // Only switch off once everything has been sent
+                    errnoLocal = -writeCoalesceFlush(pContainer);
+                    if (errnoLocal == U_SOCK_ENONE) {
+                        writeCoalesceFree(pContainer);
+                    }
+                }
+            }
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -1561,15 +4103,18 @@ void uSockBlockingSet(uSockDescriptor_t descriptor, bool isBlocking)
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
+
+    return errorCode;
 }
 
-// Get whether a socket is blocking or not.
-bool uSockBlockingGet(uSockDescriptor_t descriptor)
+// Get whether write coalescing is on or off.
+bool uSockWriteCoalesceGet(uSockDescriptor_t descriptor)
 {
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    bool isBlocking = false;
+    bool onNotOff = false;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -1581,7 +4126,7 @@ bool uSockBlockingGet(uSockDescriptor_t descriptor)
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
             errnoLocal = U_SOCK_ENONE;
-            isBlocking = pContainer->socket.blocking;
+            onNotOff = (pContainer->socket.pWriteCoalesceBuffer != NULL);
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -1592,26 +4137,15 @@ bool uSockBlockingGet(uSockDescriptor_t descriptor)
         errno = errnoLocal;
     }
 
-    return isBlocking;
+    return onNotOff;
 }
 
-// Set the options for the given socket.
-int32_t uSockOptionSet(uSockDescriptor_t descriptor,
-                       int32_t level, uint32_t option,
-                       const void *pOptionValue,
-                       size_t optionValueLength)
+// Send any data held in the write coalescing buffer.
+int32_t uSockWriteFlush(uSockDescriptor_t descriptor)
 {
     int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    int32_t networkHandle;
-    int32_t sockHandle;
-
-    uPortLog("U_SOCK: option set command %d:0x%04x called"
-             " on descriptor %d with value ", option, level,
-             descriptor);
-    printSocketOption(pOptionValue, optionValueLength);
-    uPortLog("\n");
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -1622,66 +4156,7 @@ int32_t uSockOptionSet(uSockDescriptor_t descriptor,
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            errnoLocal = U_SOCK_EINVAL;
-            // Check parameters
-            if ((optionValueLength == 0) ||
-                ((optionValueLength > 0) && (pOptionValue != NULL))) {
-                if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
-                    (option == U_SOCK_OPT_RCVTIMEO)) {
-                    // Receive timeout we set locally
-                    if ((pOptionValue != NULL) &&
-                        (optionValueLength == sizeof(struct timeval))) {
-                        // All good
-                        errnoLocal = U_SOCK_ENONE;
-                        pContainer->socket.receiveTimeoutMs =
-                            (((const struct timeval *) pOptionValue)->tv_usec / 1000) +
-                            (((int64_t) ((const struct timeval *) pOptionValue)->tv_sec) * 1000);
-                        uPortLog("U_SOCK: timeout for socket descriptor"
-                                 " %d set to %d ms.\n", descriptor,
-                                 (int32_t) pContainer->socket.receiveTimeoutMs);
-                    } else {
-                        uPortLog("U_SOCK: socket option %d:0x%04x"
-                                 " could not be set to value ",
-                                 option, level);
-                        printSocketOption(pOptionValue, optionValueLength);
-                        uPortLog("\n");
-                    }
-                } else {
-                    // Otherwise talk to the underlying socket
-                    // layer to set the socket option.
-                    // uXxxSockOptionSet() returns a negated value
-                    // of errno from the U_SOCK_Exxx list
-                    networkHandle = pContainer->socket.networkHandle;
-                    sockHandle = pContainer->socket.sockHandle;
-                    errnoLocal = U_SOCK_ENONE;
-                    errorCode = -U_SOCK_ENOSYS;
-                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                        errorCode = uCellSockOptionSet(networkHandle,
-                                                       sockHandle,
-                                                       level, option,
-                                                       pOptionValue,
-                                                       optionValueLength);
-                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                        // TODO
-                    }
-
-                    if (errorCode == 0) {
-                        // All good
-                        uPortLog("U_SOCK: socket option %d:0x%04x"
-                                 " set to value ", option, level);
-                    } else {
-                        // Invalid argument
-                        errnoLocal = -errorCode;
-                        uPortLog("U_SOCK: errno %d when setting"
-                                 " socket option %d:0x%04x to value ",
-                                 errnoLocal, option, level);
-                    }
-                    printSocketOption(pOptionValue, optionValueLength);
-                    uPortLog("by network handle %d, socket"
-                             " handle %d.\n", networkHandle,
-                             sockHandle);
-                }
-            }
+            errnoLocal = -writeCoalesceFlush(pContainer);
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -1696,17 +4171,12 @@ int32_t uSockOptionSet(uSockDescriptor_t descriptor,
     return errorCode;
 }
 
-// Get the options for the given socket.
-int32_t uSockOptionGet(uSockDescriptor_t descriptor,
-                       int32_t level, uint32_t option,
-                       void *pOptionValue,
-                       size_t *pOptionValueLength)
+// Get the number of underlying writes saved by write coalescing.
+int32_t uSockWriteCoalesceSavedGet(uSockDescriptor_t descriptor)
 {
-    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errorCodeOrCount = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    int32_t networkHandle;
-    int32_t sockHandle;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -1717,74 +4187,8 @@ int32_t uSockOptionGet(uSockDescriptor_t descriptor,
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            errnoLocal = U_SOCK_EINVAL;
-            // If there's an optionValue then there must be a length
-            if ((pOptionValue == NULL) ||
-                (pOptionValueLength != NULL)) {
-                if ((level == U_SOCK_OPT_LEVEL_SOCK) &&
-                    (option == U_SOCK_OPT_RCVTIMEO)) {
-                    // Receive timeout we have locally
-                    if (pOptionValueLength != NULL) {
-                        if (pOptionValue != NULL) {
-                            if (*pOptionValueLength >= sizeof(struct timeval)) {
-                                errnoLocal = U_SOCK_ENONE;
-                                // Return the answer
-                                ((struct timeval *) pOptionValue)->tv_sec =
-                                    (int32_t) (pContainer->socket.receiveTimeoutMs / 1000);
-                                ((struct timeval *) pOptionValue)->tv_usec =
-                                    (pContainer->socket.receiveTimeoutMs % 1000) * 1000;
-                                *pOptionValueLength = sizeof(struct timeval);
-                                uPortLog("U_SOCK: timeout for socket descriptor"
-                                         " %d is %d ms.\n", descriptor,
-                                         (int32_t) pContainer->socket.receiveTimeoutMs);
-                            }
-                        } else {
-                            errnoLocal = U_SOCK_ENONE;
-                            // Caller just wants to know the length required
-                            *pOptionValueLength = sizeof(struct timeval);
-                        }
-                    }
-                } else {
-                    // Otherwise talk to the underlying socket layer
-                    // to get the socket option.
-                    // uXxxSockOptionGet() returns a negated value of
-                    // errno from the U_SOCK_Exxx list.
-                    networkHandle = pContainer->socket.networkHandle;
-                    sockHandle = pContainer->socket.sockHandle;
-                    errnoLocal = U_SOCK_ENONE;
-                    errorCode = -U_SOCK_ENOSYS;
-                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                        errorCode = uCellSockOptionGet(networkHandle,
-                                                       sockHandle,
-                                                       level, option,
-                                                       pOptionValue,
-                                                       pOptionValueLength);
-                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                        // TODO
-                    }
-
-                    if (errorCode == 0) {
-                        // All good.
-                        if (pOptionValue != NULL) {
-                            uPortLog("U_SOCK: the value of option %d:0x%04x"
-                                     " for socket descriptor %d is ", option,
-                                     level, descriptor);
-                            printSocketOption(pOptionValue, *pOptionValueLength);
-                            uPortLog("according to network handle %d, socket"
-                                     " handle %d.\n", networkHandle, sockHandle);
-                        }
-                    } else {
-                        // Set errno
-                        errnoLocal = -errorCode;
-                        uPortLog("U_SOCK: getting the value of option"
-                                 " %d:0x%04x for socket descriptor %d from"
-                                 " network handle %d, socket handle %d,"
-                                 " returned errno %d.\n",
-                                 option, level, descriptor, networkHandle,
-                                 sockHandle, errnoLocal);
-                    }
-                }
-            }
+            errnoLocal = U_SOCK_ENONE;
+            errorCodeOrCount = pContainer->socket.writeCoalesceSaved;
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -1793,99 +4197,112 @@ int32_t uSockOptionGet(uSockDescriptor_t descriptor,
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+        errorCodeOrCount = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
 
-    return errorCode;
+    return errorCodeOrCount;
 }
 
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: UDP ONLY
- * -------------------------------------------------------------- */
-
-// Send a datagram to the given host.
-int32_t uSockSendTo(uSockDescriptor_t descriptor,
-                    const uSockAddress_t *pRemoteAddress,
-                    const void *pData, size_t dataSizeBytes)
+// Switch the write queue on or off.
+int32_t uSockWriteQueueSet(uSockDescriptor_t descriptor,
+                           bool onNotOff)
 {
-    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    int32_t networkHandle;
-    int32_t sockHandle;
+    uSockSocket_t *pSocket;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
 
+        U_PORT_MUTEX_LOCK(gMutexWriteQueue);
         U_PORT_MUTEX_LOCK(gMutexContainer);
 
         // Find the container
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            // Check address and state
-            errnoLocal = U_SOCK_EDESTADDRREQ;
-            if (pRemoteAddress != NULL) {
+            pSocket = &(pContainer->socket);
+            errnoLocal = U_SOCK_EPROTOTYPE;
+            if (pSocket->protocol == U_SOCK_PROTOCOL_TCP) {
                 errnoLocal = U_SOCK_ENONE;
-            } else {
-                // If there is no remote address and the socket was
-                // connected we must use the stored address
-                if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
-                    pRemoteAddress = &(pContainer->socket.remoteAddress);
-                    errnoLocal = U_SOCK_ENONE;
+                if (onNotOff) {
+                    if (pSocket->pWriteCoalesceBuffer != NULL) {
+                        // Can't have both
+                        errnoLocal = U_SOCK_EBUSY;
+                    } else if (pSocket->pWriteQueueBuffer == NULL) {
+                        errnoLocal = U_SOCK_ENOBUFS;
+                        if (gWriteQueueTotalBytes + pSocket->writeQueueSize <=
+                            U_SOCK_WRITE_QUEUE_TOTAL_MAX_BYTES) {
+                            errnoLocal = U_SOCK_ENOMEM;
+                            // The task is shared between all sockets
+                            // and is set up on first use
+                            if (gWriteQueueEventQueueHandle < 0) {
+                                gpWriteQueueChunk = (char *) malloc(U_SOCK_WRITE_QUEUE_CHUNK_SIZE_BYTES);
+                                if (gpWriteQueueChunk != NULL) {
+                                    gWriteQueueEventQueueHandle = uPortEventQueueOpen(writeQueueTaskCallback,
+                                                                                      "sockWriteQueue", 0,
+                                                                                      U_SOCK_WRITE_QUEUE_TASK_STACK_SIZE_BYTES,
+                                                                                      U_SOCK_WRITE_QUEUE_TASK_PRIORITY,
+                                                                                      1);
+                                    if (gWriteQueueEventQueueHandle < 0) {
+                                        free(gpWriteQueueChunk);
+                                        gpWriteQueueChunk = NULL;
+                                    }
+                                }
+                            }
+                            if (gWriteQueueEventQueueHandle >= 0) {
+                                pSocket->pWriteQueueBuffer = (char *) malloc(pSocket->writeQueueSize);
+                                if (pSocket->pWriteQueueBuffer != NULL) {
+                                    gWriteQueueTotalBytes += pSocket->writeQueueSize;
+                                    pSocket->writeQueueRead = 0;
+                                    pSocket->writeQueueLength = 0;
+                                    errnoLocal = U_SOCK_ENONE;
+                                }
+                            }
+                        }
+                    }
                 } else {
-                    if ((pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_WRITE) ||
-                        (pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                        // Socket is shut down
-                        errnoLocal = U_SOCK_ESHUTDOWN;
-                    } else if (pContainer->socket.state == U_SOCK_STATE_CLOSING) {
-                        // I know connection isn't strictly relevant
-                        // to UDP transmission but I can't see anything
-                        // more appropriate to return
-                        errnoLocal = U_SOCK_ENOTCONN;
-                    } else {
-                        // Destination address required?
-                        errnoLocal = U_SOCK_EDESTADDRREQ;
+                    // Only switch off once everything has been sent
+                    errnoLocal = -writeQueueDrain(pContainer);
+                    if (errnoLocal == U_SOCK_ENONE) {
+                        writeQueueFree(pContainer);
                     }
                 }
             }
-            if ((errnoLocal == U_SOCK_ENONE) && (pRemoteAddress != NULL)) {
-                errnoLocal = U_SOCK_EPROTOTYPE;
-                // It is OK to send UDP packets on a TCP socket
-                if ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) ||
-                    (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP)) {
-                    errnoLocal = U_SOCK_EINVAL;
-                    if ((pData == NULL) && (dataSizeBytes > 0)) {
-                        // Invalid argument
-                    } else {
-                        errnoLocal = U_SOCK_ENONE;
-                        if ((pData != NULL) && (dataSizeBytes > 0)) {
-                            // Talk to the underlying cell/wifi
-                            // socket layer to send the datagram.
-                            // uXxxSockSendTo() returns the number of
-                            // bytes sent or a negated value of errno
-                            // from the U_SOCK_Exxx list.
-                            networkHandle = pContainer->socket.networkHandle;
-                            sockHandle = pContainer->socket.sockHandle;
-                            errorCodeOrSize = -U_SOCK_ENOSYS;
-                            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                                errorCodeOrSize = uCellSockSendTo(networkHandle,
-                                                                  sockHandle,
-                                                                  pRemoteAddress,
-                                                                  pData,
-                                                                  dataSizeBytes);
-                            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                                // TODO
-                            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        U_PORT_MUTEX_UNLOCK(gMutexWriteQueue);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Get whether the write queue is on or off.
+bool uSockWriteQueueGet(uSockDescriptor_t descriptor)
+{
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    bool onNotOff = false;
 
-                            if (errorCodeOrSize < 0) {
-                                // Set errno
-                                errnoLocal = -errorCodeOrSize;
-                            }
-                        }
-                    }
-                }
-            }
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_ENONE;
+            onNotOff = (pContainer->socket.pWriteQueueBuffer != NULL);
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -1894,18 +4311,15 @@ int32_t uSockSendTo(uSockDescriptor_t descriptor,
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
 
-    return errorCodeOrSize;
+    return onNotOff;
 }
 
-// Receive a single datagram from the given host.
-int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
-                         uSockAddress_t *pRemoteAddress,
-                         void *pData, size_t dataSizeBytes)
+// Get the number of bytes waiting in the write queue.
+int32_t uSockWriteQueueLengthGet(uSockDescriptor_t descriptor)
 {
-    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errorCodeOrLength = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
 
@@ -1918,38 +4332,8 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            errnoLocal = U_SOCK_EPROTOTYPE;
-            // It is OK to receive UDP-style on a TCP socket
-            if ((pContainer->socket.protocol == U_SOCK_PROTOCOL_UDP) ||
-                (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP)) {
-                // I know connection isn't strictly relevant
-                // to UDP but I can't see anything more
-                // appropriate to return
-                errnoLocal = U_SOCK_ENOTCONN;
-                if (pContainer->socket.state != U_SOCK_STATE_CLOSING) {
-                    errnoLocal = U_SOCK_ESHUTDOWN;
-                    if ((pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_READ) &&
-                        (pContainer->socket.state != U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                        errnoLocal = U_SOCK_EINVAL;
-                        if ((pData == NULL) && (dataSizeBytes > 0)) {
-                            // Invalid argument
-                        } else {
-                            errnoLocal = U_SOCK_ENONE;
-                            if ((pData != NULL) && (dataSizeBytes != 0)) {
-                                // Receive the datagram
-                                errorCodeOrSize = receive(pContainer,
-                                                          pRemoteAddress,
-                                                          pData,
-                                                          dataSizeBytes);
-                                if (errorCodeOrSize < 0) {
-                                    // Set errno
-                                    errnoLocal = -errorCodeOrSize;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+            errnoLocal = U_SOCK_ENONE;
+            errorCodeOrLength = (int32_t) pContainer->socket.writeQueueLength;
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -1958,21 +4342,21 @@ int32_t uSockReceiveFrom(uSockDescriptor_t descriptor,
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+        errorCodeOrLength = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
 
-    return errorCodeOrSize;
+    return errorCodeOrLength;
 }
 
 /* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: STREAM (TCP)
+ * PUBLIC FUNCTIONS: ASYNC
  * -------------------------------------------------------------- */
 
-// Send data.
-int32_t uSockWrite(uSockDescriptor_t descriptor,
-                   const void *pData, size_t dataSizeBytes)
+// Register a callback for incoming data.
+void uSockRegisterCallbackData(uSockDescriptor_t descriptor,
+                               void (*pCallback) (void *),
+                               void *pCallbackParameter)
 {
-    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
     int32_t networkHandle;
@@ -1987,53 +4371,32 @@ int32_t uSockWrite(uSockDescriptor_t descriptor,
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            errnoLocal = U_SOCK_EPROTOTYPE;
-            if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
-                if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
-                    errnoLocal = U_SOCK_EINVAL;
-                    if (((pData == NULL) && (dataSizeBytes > 0)) ||
-                        (dataSizeBytes > INT_MAX)) {
-                        // Invalid argument
-                    } else {
-                        errnoLocal = U_SOCK_ENONE;
-                        if ((pData != NULL) && (dataSizeBytes != 0)) {
-                            // Talk to the underlying cell/wifi
-                            // socket layer to send the datagram.
-                            // uXxxSockWrite() returns the number
-                            // of bytes sent or a negated value of
-                            // errno from the U_SOCK_Exxx list.
-                            networkHandle = pContainer->socket.networkHandle;
-                            sockHandle = pContainer->socket.sockHandle;
-                            errorCodeOrSize = -U_SOCK_ENOSYS;
-                            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                                errorCodeOrSize = uCellSockWrite(networkHandle,
-                                                                 sockHandle,
-                                                                 pData,
-                                                                 dataSizeBytes);
-                            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                                // TODO
-                            }
 
-                            if (errorCodeOrSize < 0) {
-                                // Set errno
-                                errnoLocal = -errorCodeOrSize;
-                            }
-                        }
-                    }
-                } else {
-                    if ((pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ) ||
-                        (pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                        // Socket is shut down
-                        errnoLocal = U_SOCK_ESHUTDOWN;
-                    } else if (pContainer->socket.state == U_SOCK_STATE_CLOSING) {
-                        // Not connected mate
-                        errnoLocal = U_SOCK_ENOTCONN;
-                    } else {
-                        // No route to host?
-                        errnoLocal = U_SOCK_EHOSTUNREACH;
-                    }
-                }
+            U_PORT_MUTEX_LOCK(gMutexCallbacks);
+
+            // Talk to the underlying cell/wifi
+            // socket layer to set the callback.
+            networkHandle = pContainer->socket.networkHandle;
+            sockHandle = pContainer->socket.sockHandle;
+            errnoLocal = U_SOCK_ENOSYS;
+            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                uCellSockRegisterCallbackData(networkHandle,
+                                              sockHandle,
+                                              dataCallback);
+                errnoLocal = U_SOCK_ENONE;
+            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                uWifiSockRegisterCallbackData(networkHandle,
+                                              sockHandle,
+                                              dataCallback);
+                errnoLocal = U_SOCK_ENONE;
+            }
+
+            if (errnoLocal == U_SOCK_ENONE) {
+                pContainer->socket.pDataCallback = pCallback;
+                pContainer->socket.pDataCallbackParameter = pCallbackParameter;
             }
+
+            U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -2042,19 +4405,21 @@ int32_t uSockWrite(uSockDescriptor_t descriptor,
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
-
-    return errorCodeOrSize;
 }
 
-// Receive data.
-int32_t uSockRead(uSockDescriptor_t descriptor,
-                  void *pData, size_t dataSizeBytes)
+// Switch a socket into or out of push mode.
+int32_t uSockRegisterCallbackDataPush(uSockDescriptor_t descriptor,
+                                      void (*pCallback) (uSockDescriptor_t,
+                                                         char *,
+                                                         size_t,
+                                                         void *),
+                                      void *pCallbackParameter)
 {
-    int32_t errorCodeOrSize = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -2067,36 +4432,57 @@ int32_t uSockRead(uSockDescriptor_t descriptor,
         if (pContainer != NULL) {
             errnoLocal = U_SOCK_EPROTOTYPE;
             if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
-                if (pContainer->socket.state == U_SOCK_STATE_CONNECTED) {
-                    errnoLocal = U_SOCK_EINVAL;
-                    if (((pData == NULL) && (dataSizeBytes > 0)) ||
-                        (dataSizeBytes > INT_MAX)) {
-                        // Invalid argument
-                    } else {
-                        errnoLocal = U_SOCK_ENONE;
-                        if ((pData != NULL) && (dataSizeBytes != 0)) {
-                            // Receive the datagram
-                            errorCodeOrSize = receive(pContainer,
-                                                      NULL, pData,
-                                                      dataSizeBytes);
-                            if (errorCodeOrSize < 0) {
-                                // Set errno
-                                errnoLocal = -errorCodeOrSize;
-                            }
+                errnoLocal = U_SOCK_ENONE;
+                U_PORT_MUTEX_LOCK(gMutexDataPush);
+                if ((pCallback != NULL) && (gDataPushEventQueueHandle < 0)) {
+                    errnoLocal = U_SOCK_ENOMEM;
+                    // The task and the pool are shared between
+                    // all sockets and are set up on first use
+                    gpDataPushPool = (char *) malloc(U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS *
+                                                     U_SOCK_DATA_PUSH_BUFFER_SIZE_BYTES);
+                    if (gpDataPushPool != NULL) {
+                        gDataPushPoolInUse = 0;
+                        gDataPushEventQueueHandle = uPortEventQueueOpen(dataPushTaskCallback,
+                                                                        "sockDataPush",
+                                                                        sizeof(uSockDescriptor_t),
+                                                                        U_SOCK_DATA_PUSH_TASK_STACK_SIZE_BYTES,
+                                                                        U_SOCK_DATA_PUSH_TASK_PRIORITY,
+                                                                        U_SOCK_MAX_NUM_SOCKETS + 1);
+                        if (gDataPushEventQueueHandle >= 0) {
+                            errnoLocal = U_SOCK_ENONE;
+                        } else {
+                            free(gpDataPushPool);
+                            gpDataPushPool = NULL;
                         }
                     }
-                } else {
-                    if ((pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ) ||
-                        (pContainer->socket.state == U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE)) {
-                        // Socket is shut down
-                        errnoLocal = U_SOCK_ESHUTDOWN;
-                    } else if (pContainer->socket.state == U_SOCK_STATE_CLOSING) {
-                        // Not connected mate
-                        errnoLocal = U_SOCK_ENOTCONN;
-                    } else {
-                        // No route to host?
-                        errnoLocal = U_SOCK_EHOSTUNREACH;
-                    }
+                }
+                U_PORT_MUTEX_UNLOCK(gMutexDataPush);
+            }
+            if (errnoLocal == U_SOCK_ENONE) {
+                // Talk to the underlying cell/wifi
+                // socket layer to get told about data
+                networkHandle = pContainer->socket.networkHandle;
+                errnoLocal = U_SOCK_ENOSYS;
+                if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                    uCellSockRegisterCallbackData(networkHandle,
+                                                  pContainer->socket.sockHandle,
+                                                  dataCallback);
+                    errnoLocal = U_SOCK_ENONE;
+                } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                    uWifiSockRegisterCallbackData(networkHandle,
+                                                  pContainer->socket.sockHandle,
+                                                  dataCallback);
+                    errnoLocal = U_SOCK_ENONE;
+                }
+            }
+            if (errnoLocal == U_SOCK_ENONE) {
+                U_PORT_MUTEX_LOCK(gMutexCallbacks);
+                pContainer->socket.pDataPushCallback = pCallback;
+                pContainer->socket.pDataPushCallbackParameter = pCallbackParameter;
+                U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
+                if (pCallback != NULL) {
+                    // There may already be data waiting
+                    dataPushPost(pContainer);
                 }
             }
         }
@@ -2107,21 +4493,29 @@ int32_t uSockRead(uSockDescriptor_t descriptor,
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCodeOrSize = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
     }
 
-    return errorCodeOrSize;
+    return errorCode;
 }
 
-// Prepare a TCP socket for being closed.
-// Note: this does not need to reference the underlying
-// cell/wifi socket layer.
-int32_t uSockShutdown(uSockDescriptor_t descriptor,
-                      uSockShutdown_t how)
+// Give back a buffer passed to a push mode callback.
+void uSockDataPushBufferRelease(char *pBuffer)
+{
+    if ((pBuffer != NULL) && (gMutexDataPush != NULL)) {
+        dataPushBufferFree(pBuffer);
+    }
+}
+
+// Register a callback for remote socket closure.
+void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
+                                 void (*pCallback) (void *),
+                                 void *pCallbackParameter)
 {
-    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+    int32_t sockHandle;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -2132,24 +4526,32 @@ int32_t uSockShutdown(uSockDescriptor_t descriptor,
         errnoLocal = U_SOCK_EBADF;
         pContainer = pContainerFindByDescriptor(descriptor);
         if (pContainer != NULL) {
-            // Set the socket state
-            errnoLocal = U_SOCK_EINVAL;
-            switch (how) {
-                case U_SOCK_SHUTDOWN_READ:
-                    pContainer->socket.state = U_SOCK_STATE_SHUTDOWN_FOR_READ;
-                    errnoLocal = U_SOCK_ENONE;
-                    break;
-                case U_SOCK_SHUTDOWN_WRITE:
-                    pContainer->socket.state = U_SOCK_STATE_SHUTDOWN_FOR_WRITE;
-                    errnoLocal = U_SOCK_ENONE;
-                    break;
-                case U_SOCK_SHUTDOWN_READ_WRITE:
-                    pContainer->socket.state = U_SOCK_STATE_SHUTDOWN_FOR_READ_WRITE;
-                    errnoLocal = U_SOCK_ENONE;
-                    break;
-                default:
-                    break;
+
+            U_PORT_MUTEX_LOCK(gMutexCallbacks);
+
+            // Talk to the underlying cell/wifi
+            // socket layer to set the callback.
+            networkHandle = pContainer->socket.networkHandle;
+            sockHandle = pContainer->socket.sockHandle;
+            errnoLocal = U_SOCK_ENOSYS;
+            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                uCellSockRegisterCallbackClosed(networkHandle,
+                                                sockHandle,
+                                                closedCallback);
+                errnoLocal = U_SOCK_ENONE;
+            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                uWifiSockRegisterCallbackClosed(networkHandle,
+                                                sockHandle,
+                                                closedCallback);
+                errnoLocal = U_SOCK_ENONE;
             }
+
+            if (errnoLocal == U_SOCK_ENONE) {
+                pContainer->socket.pClosedCallback = pCallback;
+                pContainer->socket.pClosedCallbackParameter = pCallbackParameter;
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
         }
 
         U_PORT_MUTEX_UNLOCK(gMutexContainer);
@@ -2158,25 +4560,16 @@ int32_t uSockShutdown(uSockDescriptor_t descriptor,
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
         errno = errnoLocal;
-        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
-    }
-
-    return errorCode;
-}
-
-/* ----------------------------------------------------------------
- * PUBLIC FUNCTIONS: ASYNC
- * -------------------------------------------------------------- */
+    }
+}
 
-// Register a callback for incoming data.
-void uSockRegisterCallbackData(uSockDescriptor_t descriptor,
-                               void (*pCallback) (void *),
-                               void *pCallbackParameter)
+// Register a callback on completion of a non-blocking connect.
+void uSockRegisterCallbackConnected(uSockDescriptor_t descriptor,
+                                    void (*pCallback) (void *),
+                                    void *pCallbackParameter)
 {
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    int32_t networkHandle;
-    int32_t sockHandle;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -2190,24 +4583,12 @@ void uSockRegisterCallbackData(uSockDescriptor_t descriptor,
 
             U_PORT_MUTEX_LOCK(gMutexCallbacks);
 
-            // Talk to the underlying cell/wifi
-            // socket layer to set the callback.
-            networkHandle = pContainer->socket.networkHandle;
-            sockHandle = pContainer->socket.sockHandle;
-            errnoLocal = U_SOCK_ENOSYS;
-            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                uCellSockRegisterCallbackData(networkHandle,
-                                              sockHandle,
-                                              dataCallback);
-                errnoLocal = U_SOCK_ENONE;
-            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                // TODO
-            }
-
-            if (errnoLocal == U_SOCK_ENONE) {
-                pContainer->socket.pDataCallback = pCallback;
-                pContainer->socket.pDataCallbackParameter = pCallbackParameter;
-            }
+            // Nothing to tell the underlying socket layer
+            // here, connectedCallback() is passed to it
+            // by uSockConnect()
+            pContainer->socket.pConnectedCallback = pCallback;
+            pContainer->socket.pConnectedCallbackParameter = pCallbackParameter;
+            errnoLocal = U_SOCK_ENONE;
 
             U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
         }
@@ -2221,15 +4602,13 @@ void uSockRegisterCallbackData(uSockDescriptor_t descriptor,
     }
 }
 
-// Register a callback for remote socket closure.
-void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
-                                 void (*pCallback) (void *),
-                                 void *pCallbackParameter)
+// Register a callback for the outcome of sending from the write queue.
+void uSockRegisterCallbackWriteQueue(uSockDescriptor_t descriptor,
+                                     void (*pCallback) (int32_t, void *),
+                                     void *pCallbackParameter)
 {
     int32_t errnoLocal;
     uSockContainer_t *pContainer = NULL;
-    int32_t networkHandle;
-    int32_t sockHandle;
 
     errnoLocal = init();
     if (errnoLocal == U_SOCK_ENONE) {
@@ -2243,24 +4622,11 @@ void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
 
             U_PORT_MUTEX_LOCK(gMutexCallbacks);
 
-            // Talk to the underlying cell/wifi
-            // socket layer to set the callback.
-            networkHandle = pContainer->socket.networkHandle;
-            sockHandle = pContainer->socket.sockHandle;
-            errnoLocal = U_SOCK_ENOSYS;
-            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                uCellSockRegisterCallbackClosed(networkHandle,
-                                                sockHandle,
-                                                closedCallback);
-                errnoLocal = U_SOCK_ENONE;
-            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                // TODO
-            }
-
-            if (errnoLocal == U_SOCK_ENONE) {
-                pContainer->socket.pClosedCallback = pCallback;
-                pContainer->socket.pClosedCallbackParameter = pCallbackParameter;
-            }
+            // Nothing to tell the underlying socket layer,
+            // this is called by the write queue task
+            pContainer->socket.pWriteQueueCallback = pCallback;
+            pContainer->socket.pWriteQueueCallbackParameter = pCallbackParameter;
+            errnoLocal = U_SOCK_ENONE;
 
             U_PORT_MUTEX_UNLOCK(gMutexCallbacks);
         }
@@ -2283,32 +4649,218 @@ void uSockRegisterCallbackClosed(uSockDescriptor_t descriptor,
 int32_t uSockBind(uSockDescriptor_t descriptor,
                   const uSockAddress_t *pLocalAddress)
 {
-    // TODO
-    (void) descriptor;
-    (void) pLocalAddress;
-    errno = U_SOCK_ENOSYS;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = U_SOCK_EINVAL;
+        // Check parameters
+        if (pLocalAddress != NULL) {
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+
+            // Find the container
+            errnoLocal = U_SOCK_EBADF;
+            pContainer = pContainerFindByDescriptor(descriptor);
+            if (pContainer != NULL) {
+                errnoLocal = U_SOCK_EINVAL;
+                if (pContainer->socket.state == U_SOCK_STATE_CREATED) {
+                    // Talk to the underlying cell/wifi
+                    // socket layer to do the binding.
+                    // uXxxSockBind() returns a negated
+                    // value from the U_SOCK_Exxx list.
+                    networkHandle = pContainer->socket.networkHandle;
+                    errnoLocal = U_SOCK_ENOSYS;
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        errnoLocal = -uCellSockBind(networkHandle,
+                                                    pContainer->socket.sockHandle,
+                                                    pLocalAddress);
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        // Bind is not supported on Wi-Fi, leave
+                        // errnoLocal as U_SOCK_ENOSYS
+                    }
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        }
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
 }
 
 // Set listening mode.
 int32_t uSockListen(uSockDescriptor_t descriptor, size_t backlog)
 {
-    // TODO
-    (void) descriptor;
-    (void) backlog;
-    errno = U_SOCK_ENOSYS;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    int32_t networkHandle;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+
+        U_PORT_MUTEX_LOCK(gMutexContainer);
+
+        // Find the container
+        errnoLocal = U_SOCK_EBADF;
+        pContainer = pContainerFindByDescriptor(descriptor);
+        if (pContainer != NULL) {
+            errnoLocal = U_SOCK_EOPNOTSUPP;
+            if (pContainer->socket.protocol == U_SOCK_PROTOCOL_TCP) {
+                errnoLocal = U_SOCK_EINVAL;
+                if (pContainer->socket.state == U_SOCK_STATE_CREATED) {
+                    // Talk to the underlying cell/wifi
+                    // socket layer to start listening.
+                    // uXxxSockListen() returns a negated
+                    // value from the U_SOCK_Exxx list.
+                    networkHandle = pContainer->socket.networkHandle;
+                    errnoLocal = U_SOCK_ENOSYS;
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        errnoLocal = -uCellSockListen(networkHandle,
+                                                      pContainer->socket.sockHandle,
+                                                      backlog);
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        // Listen is not supported on Wi-Fi, leave
+                        // errnoLocal as U_SOCK_ENOSYS
+                    }
+                    if (errnoLocal == U_SOCK_ENONE) {
+                        pContainer->socket.state = U_SOCK_STATE_LISTENING;
+                        uPortLog("U_SOCK: socket with descriptor %d, network"
+                                 " handle %d, socket handle %d, is"
+                                 " listening.\n", descriptor, networkHandle,
+                                 pContainer->socket.sockHandle);
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexContainer);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
 }
 
 // Accept an incoming TCP connection on the given socket.
 int32_t uSockAccept(uSockDescriptor_t descriptor,
                     uSockAddress_t *pRemoteAddress)
 {
-    // TODO
-    (void) descriptor;
-    (void) pRemoteAddress;
-    errno = U_SOCK_ENOSYS;
-    return (int32_t) U_ERROR_COMMON_NOT_IMPLEMENTED;
+    int32_t descriptorOrError = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+    uSockContainer_t *pContainer = NULL;
+    uSockContainer_t *pContainerAccepted;
+    uSockAddress_t remoteAddress;
+    int32_t networkHandle;
+    int32_t sockHandle;
+    int64_t startTimeMs;
+    bool waiting;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        startTimeMs = uPortGetTickTimeMs();
+        do {
+            waiting = false;
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+
+            // Find the container
+            errnoLocal = U_SOCK_EBADF;
+            pContainer = pContainerFindByDescriptor(descriptor);
+            if (pContainer != NULL) {
+                errnoLocal = U_SOCK_EINVAL;
+                if (pContainer->socket.state == U_SOCK_STATE_LISTENING) {
+                    // Ask the underlying cell/wifi socket layer
+                    // for a connection that has already arrived;
+                    // uXxxSockAccept() returns the socket handle of
+                    // the connection or a negated value of errno
+                    // from the U_SOCK_Exxx list
+                    networkHandle = pContainer->socket.networkHandle;
+                    sockHandle = -U_SOCK_ENOSYS;
+                    if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                        sockHandle = uCellSockAccept(networkHandle,
+                                                     pContainer->socket.sockHandle,
+                                                     &remoteAddress);
+                    } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
+                        // Accept is not supported on Wi-Fi, leave
+                        // sockHandle as -U_SOCK_ENOSYS
+                    }
+                    if (sockHandle >= 0) {
+                        // Put the new connection into a container
+                        errnoLocal = U_SOCK_ENOBUFS;
+                        pContainerAccepted = NULL;
+                        if (numContainersInUse() < U_SOCK_MAX_NUM_SOCKETS) {
+                            errnoLocal = U_SOCK_ENOMEM;
+                            pContainerAccepted = pSockContainerCreateNext(U_SOCK_TYPE_STREAM,
+                                                                          U_SOCK_PROTOCOL_TCP);
+                        }
+                        if (pContainerAccepted != NULL) {
+                            pContainerAccepted->socket.networkHandle = networkHandle;
+                            pContainerAccepted->socket.sockHandle = sockHandle;
+                            memcpy(&(pContainerAccepted->socket.remoteAddress),
+                                   &remoteAddress,
+                                   sizeof(pContainerAccepted->socket.remoteAddress));
+                            pContainerAccepted->socket.state = U_SOCK_STATE_CONNECTED;
+                            descriptorOrError = (int32_t) pContainerAccepted->descriptor;
+                            if (pRemoteAddress != NULL) {
+                                memcpy(pRemoteAddress, &remoteAddress,
+                                       sizeof(*pRemoteAddress));
+                            }
+                            errnoLocal = U_SOCK_ENONE;
+                            uPortLog("U_SOCK: socket with descriptor %d"
+                                     " accepted a connection, new descriptor"
+                                     " %d, socket handle %d.\n", descriptor,
+                                     descriptorOrError, sockHandle);
+                        } else {
+                            // Nowhere to put it, have to drop it
+                            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
+                                uCellSockClose(networkHandle, sockHandle, NULL);
+                            }
+                        }
+                    } else {
+                        // Set errno
+                        errnoLocal = -sockHandle;
+                        if ((errnoLocal == U_SOCK_EWOULDBLOCK) &&
+                            pContainer->socket.blocking &&
+                            (uPortGetTickTimeMs() - startTimeMs <
+                             pContainer->socket.receiveTimeoutMs)) {
+                            // Nothing yet, wait without holding
+                            // the mutex
+                            waiting = true;
+                        }
+                    }
+                }
+            }
+
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+
+            if (waiting) {
+                uPortTaskBlock(U_SOCK_RECEIVE_POLL_INTERVAL_MS);
+            }
+        } while (waiting);
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        descriptorOrError = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return descriptorOrError;
 }
 
 // Select: wait for one of a set of sockets to become unblocked.
@@ -2318,7 +4870,8 @@ int32_t uSockSelect(int32_t maxDescriptor,
                     uSockDescriptorSet_t *pExceptDescriptorSet,
                     int32_t timeMs)
 {
-    // TODO
+    // Select is not supported on any bearer, cellular
+    // or Wi-Fi, at the moment
     (void) maxDescriptor;
     (void) pReadDescriptorSet;
     (void) pWriteDescriptoreSet;
@@ -2410,7 +4963,8 @@ int32_t uSockGetLocalAddress(uSockDescriptor_t descriptor,
                                                            sockHandle,
                                                            pLocalAddress);
                 } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                    // TODO
+                    // Getting the local address is not supported on
+                    // Wi-Fi, leave errnoLocal as U_SOCK_ENOSYS
                 }
             }
 
@@ -2440,25 +4994,124 @@ int32_t uSockGetHostByName(int32_t networkHandle,
         errnoLocal = U_SOCK_EINVAL;
         // Check parameters
         if ((pHostName != NULL) && (pHostIpAddress != NULL)) {
+            // Note: the container mutex is deliberately not
+            // locked here since a DNS look-up can take a long
+            // time; the DNS cache has its own mutex.
+#if U_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+            errnoLocal = dnsCacheGetHostByName(networkHandle,
+                                               pHostName,
+                                               pHostIpAddress);
+#else
+            errnoLocal = getHostByNameUnderlying(networkHandle,
+                                                 pHostName,
+                                                 pHostIpAddress);
+#endif
+        }
+    }
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Empty the DNS cache.
+void uSockDnsCacheClear()
+{
+#if U_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+    if (gMutexDnsCache != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutexDnsCache);
+
+        for (size_t x = 0; x < sizeof(gDnsCache) / sizeof(gDnsCache[0]); x++) {
+            // Leave alone any entries with a look-up in
+            // progress: whoever is doing the look-up is
+            // relying on them
+            if (gDnsCache[x].state == U_SOCK_DNS_CACHE_STATE_VALID) {
+                gDnsCache[x].state = U_SOCK_DNS_CACHE_STATE_EMPTY;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutexDnsCache);
+    }
+#endif
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: STATISTICS
+ * -------------------------------------------------------------- */
+
+// Get the statistics for a socket.
+int32_t uSockStatsGet(uSockDescriptor_t descriptor,
+                      uSockStats_t *pStats)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+#if U_SOCK_STATS_ENABLE
+    uSockContainer_t *pContainer = NULL;
+
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = U_SOCK_EINVAL;
+        // Check parameters
+        if (pStats != NULL) {
 
             U_PORT_MUTEX_LOCK(gMutexContainer);
 
-            // Talk to the underlying cell/wifi
-            // socket layer to do the DNS look-up.
-            // uXxxSockGetHostByName() returns a negated
-            // value from the U_SOCK_Exxx list.
-            errnoLocal = U_SOCK_ENOSYS;
-            if (U_NETWORK_HANDLE_IS_CELL(networkHandle)) {
-                errnoLocal = -uCellSockGetHostByName(networkHandle,
-                                                     pHostName,
-                                                     pHostIpAddress);
-            } else if (U_NETWORK_HANDLE_IS_WIFI(networkHandle)) {
-                // TODO
+            // Find the container
+            errnoLocal = U_SOCK_EBADF;
+            pContainer = pContainerFindByDescriptor(descriptor);
+            if (pContainer != NULL) {
+                memcpy(pStats, &(pContainer->socket.stats), sizeof(*pStats));
+                errnoLocal = U_SOCK_ENONE;
             }
 
             U_PORT_MUTEX_UNLOCK(gMutexContainer);
         }
     }
+#else
+    (void) descriptor;
+    (void) pStats;
+    errnoLocal = U_SOCK_ENOSYS;
+#endif
+
+    if (errnoLocal != U_SOCK_ENONE) {
+        // Write the errno
+        errno = errnoLocal;
+        errorCode = (int32_t) U_ERROR_COMMON_BSD_ERROR;
+    }
+
+    return errorCode;
+}
+
+// Get the statistics summed across all sockets.
+int32_t uSockStatsTotalGet(uSockStats_t *pStats)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+    int32_t errnoLocal;
+
+#if U_SOCK_STATS_ENABLE
+    errnoLocal = init();
+    if (errnoLocal == U_SOCK_ENONE) {
+        errnoLocal = U_SOCK_EINVAL;
+        // Check parameters
+        if (pStats != NULL) {
+
+            U_PORT_MUTEX_LOCK(gMutexContainer);
+
+            memcpy(pStats, &gStatsTotal, sizeof(*pStats));
+            errnoLocal = U_SOCK_ENONE;
+
+            U_PORT_MUTEX_UNLOCK(gMutexContainer);
+        }
+    }
+#else
+    (void) pStats;
+    errnoLocal = U_SOCK_ENOSYS;
+#endif
 
     if (errnoLocal != U_SOCK_ENONE) {
         // Write the errno
@@ -58,6 +58,8 @@
 #include "u_sock.h"
 #include "u_sock_test_shared_cfg.h"
 
+#include "u_wifi_sock.h" // For U_WIFI_SOCK_MAX_NUM_SOCKETS
+
 /* ----------------------------------------------------------------
  * COMPILE-TIME MACROS
  * -------------------------------------------------------------- */
@@ -102,6 +104,21 @@
 # define U_SOCK_TEST_MAX_UDP_PACKET_SIZE 500
 #endif
 
+#ifndef U_SOCK_TEST_BATCH_NUM_DATAGRAMS
+/** The number of datagrams to send and receive in one go
+ * when testing uSockSendToBatch() and uSockReceiveFromBatch().
+ */
+# define U_SOCK_TEST_BATCH_NUM_DATAGRAMS 8
+#endif
+
+#ifndef U_SOCK_TEST_BATCH_DATAGRAM_SIZE
+/** The size of each datagram when testing uSockSendToBatch()
+ * and uSockReceiveFromBatch(); gSendData is marked every 100
+ * bytes so this makes each datagram distinct.
+ */
+# define U_SOCK_TEST_BATCH_DATAGRAM_SIZE 100
+#endif
+
 #ifndef U_SOCK_TEST_MAX_TCP_READ_WRITE_SIZE
 /** The maximum TCP read/write size to use during testing.
  */
@@ -152,6 +169,28 @@
 # error U_SOCK_TEST_TIME_MARGIN_PLUS_MS cannot be larger than U_SOCK_RECEIVE_TIMEOUT_DEFAULT_MS
 #endif
 
+#ifndef U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS
+/** The number of TCP sockets to close at once in the
+ * sockDeinitParallelClose test.
+ */
+# define U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS 3
+#endif
+
+/** Determine if the given network type supports socket options,
+ * batch send/receive and TCP server operation (bind, listen,
+ * accept); Wi-Fi does not.
+ */
+#define U_SOCK_TEST_TYPE_HAS_SOCK_EXTENDED(type) (type == U_NETWORK_TYPE_CELL)
+
+/** The maximum number of sockets that the given network type
+ * can have open at one time: U_SOCK_MAX_NUM_SOCKETS may be
+ * overridden and Wi-Fi is limited by U_WIFI_SOCK_MAX_NUM_SOCKETS
+ * as well.
+ */
+#define U_SOCK_TEST_MAX_NUM_SOCKETS(type) (((type == U_NETWORK_TYPE_WIFI) &&                   \
+                                            (U_WIFI_SOCK_MAX_NUM_SOCKETS < U_SOCK_MAX_NUM_SOCKETS)) ? \
+                                           U_WIFI_SOCK_MAX_NUM_SOCKETS : U_SOCK_MAX_NUM_SOCKETS)
+
 /* ----------------------------------------------------------------
  * TYPES
  * -------------------------------------------------------------- */
@@ -186,6 +225,18 @@ typedef struct {
     int32_t eventQueueHandle;
 } uSockTestConfig_t;
 
+/** Struct to pass to dataPushCallback().
+ */
+typedef struct {
+    char *pReceive; /**< Where to copy the data to. */
+    size_t size; /**< The size of pReceive. */
+    volatile size_t offset; /**< How much data has been copied. */
+    char *volatile pHeld[U_SOCK_DATA_PUSH_POOL_NUM_BUFFERS]; /**< Buffers
+                                                                  yet to be
+                                                                  released. */
+    volatile size_t numCalls;
+} uSockTestDataPush_t;
+
 /* ----------------------------------------------------------------
  * VARIABLES
  * -------------------------------------------------------------- */
@@ -732,6 +783,85 @@ static void setBoolCallback(void *pParameter)
     }
 }
 
+// Open a TCP socket, register setBoolCallback() as its
+// closed callback with pClosed as the parameter, and
+// connect it.
+static uSockDescriptor_t openTcpSocket(int32_t networkHandle,
+                                       const uSockAddress_t *pRemoteAddress,
+                                       bool *pClosed)
+{
+    int32_t errorCode = -1;
+    uSockDescriptor_t descriptor;
+
+    *pClosed = false;
+    descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                             U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(descriptor >= 0);
+    U_PORT_TEST_ASSERT(errno == 0);
+    uSockRegisterCallbackClosed(descriptor, setBoolCallback, pClosed);
+    // Connections can fail so allow this a few goes
+    for (size_t x = 2; (x > 0) && (errorCode < 0); x--) {
+        errorCode = uSockConnect(descriptor, pRemoteAddress);
+        if (errorCode < 0) {
+            U_PORT_TEST_ASSERT(errno != 0);
+            errno = 0;
+        }
+    }
+    U_PORT_TEST_ASSERT(errorCode == 0);
+
+    return descriptor;
+}
+
+// Callback for the write queue: adds the number of bytes sent
+// to the int32_t pointed to by pParameter or, on error, sets it
+// to the negative error value.
+static void writeQueueCallback(int32_t negErrnoOrSize, void *pParameter)
+{
+    int32_t *pSum = (int32_t *) pParameter;
+
+    if (pSum != NULL) {
+        if ((negErrnoOrSize > 0) && (*pSum >= 0)) {
+            *pSum += negErrnoOrSize;
+        } else {
+            *pSum = negErrnoOrSize;
+        }
+    }
+}
+
+// Push mode callback: copies the data into the receive buffer
+// of the uSockTestDataPush_t pointed to by pParameter and keeps
+// hold of the buffer, leaving the test task to release it, so
+// that the pool empties and reading has to stop and resume.
+static void dataPushCallback(uSockDescriptor_t descriptor,
+                             char *pBuffer, size_t size,
+                             void *pParameter)
+{
+    uSockTestDataPush_t *pDataPush = (uSockTestDataPush_t *) pParameter;
+    bool held = false;
+
+    (void) descriptor;
+
+    if (pDataPush != NULL) {
+        pDataPush->numCalls++;
+        if (pDataPush->offset + size > pDataPush->size) {
+            size = pDataPush->size - pDataPush->offset;
+        }
+        memcpy(pDataPush->pReceive + pDataPush->offset, pBuffer, size);
+        pDataPush->offset += size;
+        for (size_t x = 0; (x < sizeof(pDataPush->pHeld) /
+                            sizeof(pDataPush->pHeld[0])) && !held; x++) {
+            if (pDataPush->pHeld[x] == NULL) {
+                pDataPush->pHeld[x] = pBuffer;
+                held = true;
+            }
+        }
+    }
+
+    if (!held) {
+        uSockDataPushBufferRelease(pBuffer);
+    }
+}
+
 // Callback to send to event queue triggered by
 // data arriving.
 //lint -e{818} Suppress could be const, need to follow
@@ -899,6 +1029,9 @@ U_PORT_TEST_FUNCTION("[sock]", "sockBasicUdp")
     bool dataCallbackCalled;
     size_t sizeBytes;
     bool success = false;
+#if U_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+    int64_t startTimeMs;
+#endif
     int32_t heapUsed;
     int32_t heapSockInitLoss = 0;
     int32_t heapXxxSockInitLoss = 0;
@@ -939,6 +1072,27 @@ U_PORT_TEST_FUNCTION("[sock]", "sockBasicUdp")
                                                   &(remoteAddress.ipAddress)) == 0);
             heapSockInitLoss -= uPortGetHeapFree();
 
+#if U_SOCK_DNS_CACHE_NUM_ENTRIES > 0
+            // Looking up the same host name again should be
+            // answered straight away from the DNS cache
+            startTimeMs = uPortGetTickTimeMs();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                                  &(address.ipAddress)) == 0);
+            startTimeMs = uPortGetTickTimeMs() - startTimeMs;
+            uPortLog("U_SOCK_TEST: second look-up took %d ms.\n",
+                     (int32_t) startTimeMs);
+            U_PORT_TEST_ASSERT(startTimeMs < 100);
+            U_PORT_TEST_ASSERT(memcmp(&(address.ipAddress),
+                                      &(remoteAddress.ipAddress),
+                                      sizeof(address.ipAddress)) == 0);
+            // Clear the cache: it should then still work
+            uSockDnsCacheClear();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                                  &(address.ipAddress)) == 0);
+#endif
+
             // Add the port number we will use
             remoteAddress.port = U_SOCK_TEST_ECHO_UDP_SERVER_PORT;
 
@@ -1305,10 +1459,8 @@ U_PORT_TEST_FUNCTION("[sock]", "sockBasicTcp")
     }
 }
 
-/** Test maximum number of sockets.
- * TODO: this test assumes that all underlying bearers
- * are able to support U_SOCK_MAX_NUM_SOCKETS
- * simultaneously, TBD if this is the case.
+/** Test maximum number of sockets, which depends on the
+ * bearer, see U_SOCK_TEST_MAX_NUM_SOCKETS().
  */
 U_PORT_TEST_FUNCTION("[sock]", "sockMaxNumSockets")
 {
@@ -1316,6 +1468,7 @@ U_PORT_TEST_FUNCTION("[sock]", "sockMaxNumSockets")
     int32_t networkHandle;
     uSockAddress_t remoteAddress;
     uSockDescriptor_t descriptor[U_SOCK_MAX_NUM_SOCKETS + 1];
+    size_t maxNumSockets;
     int32_t heapUsed;
     int32_t heapSockInitLoss = 0;
     int32_t heapXxxSockInitLoss = 0;
@@ -1335,6 +1488,7 @@ U_PORT_TEST_FUNCTION("[sock]", "sockMaxNumSockets")
             U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
             // Get the initial-ish heap
             heapUsed = uPortGetHeapFree();
+            maxNumSockets = U_SOCK_TEST_MAX_NUM_SOCKETS(gUNetworkTestCfg[x].type);
 
             uPortLog("U_SOCK_TEST: testing max num sockets on %s.\n",
                      gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
@@ -1356,9 +1510,8 @@ U_PORT_TEST_FUNCTION("[sock]", "sockMaxNumSockets")
             // Open as many sockets as we are allowed to simultaneously
             // and use each one of them
             uPortLog("U_SOCK_TEST: opening %d socket(s) at the same time.\n",
-                     (sizeof(descriptor) / sizeof(descriptor[0])) - 1);
-            for (size_t y = 0; y < (sizeof(descriptor) /
-                                    sizeof(descriptor[0])) - 1; y++) {
+                     maxNumSockets);
+            for (size_t y = 0; y < maxNumSockets; y++) {
                 uPortLog("U_SOCK_TEST: socket %d.\n", y + 1);
                 descriptor[y] = openSocketAndUseIt(networkHandle,
                                                    &remoteAddress,
@@ -1371,14 +1524,12 @@ U_PORT_TEST_FUNCTION("[sock]", "sockMaxNumSockets")
 
             // Now try to open one more and it should fail
             uPortLog("U_SOCK_TEST: opening one more, should fail.\n");
-            descriptor[(sizeof(descriptor) /
-                                            sizeof(descriptor[0])) - 1] = openSocketAndUseIt(networkHandle,
-                                                                         &remoteAddress,
-                                                                         U_SOCK_TYPE_DGRAM,
-                                                                         U_SOCK_PROTOCOL_UDP,
-                                                                         &heapXxxSockInitLoss);
-            U_PORT_TEST_ASSERT(descriptor[(sizeof(descriptor) /
-                                                               sizeof(descriptor[0])) - 1] < 0);
+            descriptor[maxNumSockets] = openSocketAndUseIt(networkHandle,
+                                                           &remoteAddress,
+                                                           U_SOCK_TYPE_DGRAM,
+                                                           U_SOCK_PROTOCOL_UDP,
+                                                           &heapXxxSockInitLoss);
+            U_PORT_TEST_ASSERT(descriptor[maxNumSockets] < 0);
             U_PORT_TEST_ASSERT(errno > 0);
             errno = 0;
 
@@ -1401,8 +1552,7 @@ U_PORT_TEST_FUNCTION("[sock]", "sockMaxNumSockets")
 
             // Now close the lot
             uPortLog("U_SOCK_TEST: closing them all.\n");
-            for (size_t y = 0; y < (sizeof(descriptor) /
-                                    sizeof(descriptor[0])) - 1; y++) {
+            for (size_t y = 0; y < maxNumSockets; y++) {
                 uPortLog("U_SOCK_TEST: closing socket %d.\n", y + 1);
                 errorCode = uSockClose(descriptor[y]);
                 U_PORT_TEST_ASSERT(errorCode == 0);
@@ -1475,7 +1625,8 @@ U_PORT_TEST_FUNCTION("[sock]", "sockOptionsSetGet")
     for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
         networkHandle = gUNetworkTestCfg[x].handle;
         if ((networkHandle >= 0) &&
-            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type) &&
+            U_SOCK_TEST_TYPE_HAS_SOCK_EXTENDED(gUNetworkTestCfg[x].type)) {
             // Get the initial-ish heap
             heapUsed = uPortGetHeapFree();
 
@@ -1994,6 +2145,153 @@ U_PORT_TEST_FUNCTION("[sock]", "sockUdpEchoNonPingPong")
     }
 }
 
+/** UDP echo test using the batch send and receive functions.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockUdpBatch")
+{
+    int32_t networkHandle;
+    uSockAddress_t remoteAddress;
+    uSockAddress_t receivedAddress[U_SOCK_TEST_BATCH_NUM_DATAGRAMS];
+    uSockDatagram_t datagrams[U_SOCK_TEST_BATCH_NUM_DATAGRAMS];
+    bool received[U_SOCK_TEST_BATCH_NUM_DATAGRAMS];
+    size_t numReceived = 0;
+    uSockDescriptor_t descriptor;
+    int32_t tries;
+    int32_t y;
+    char *pDataReceived;
+    int64_t startTimeMs;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    U_PORT_TEST_ASSERT(U_SOCK_TEST_BATCH_NUM_DATAGRAMS *
+                       U_SOCK_TEST_BATCH_DATAGRAM_SIZE <= sizeof(gSendData) - 1);
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type) &&
+            U_SOCK_TEST_TYPE_HAS_SOCK_EXTENDED(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: doing UDP batch test on %s.\n",
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+            // The first call to a sockets API needs to
+            // initialise the underlying sockets layer; take
+            // account of that initialisation heap cost here.
+            heapSockInitLoss = uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                                  &(remoteAddress.ipAddress)) == 0);
+            heapSockInitLoss -= uPortGetHeapFree();
+            remoteAddress.port = U_SOCK_TEST_ECHO_UDP_SERVER_PORT;
+
+            heapXxxSockInitLoss += uPortGetHeapFree();
+            descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_DGRAM,
+                                     U_SOCK_PROTOCOL_UDP);
+            heapXxxSockInitLoss -= uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(descriptor >= 0);
+
+            // Parameter checking
+            U_PORT_TEST_ASSERT(uSockSendToBatch(descriptor, NULL, 1) < 0);
+            U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+            errno = 0;
+            U_PORT_TEST_ASSERT(uSockReceiveFromBatch(descriptor, NULL, 1) < 0);
+            U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+            errno = 0;
+
+            pDataReceived = (char *) malloc(U_SOCK_TEST_BATCH_NUM_DATAGRAMS *
+                                            U_SOCK_TEST_BATCH_DATAGRAM_SIZE);
+            U_PORT_TEST_ASSERT(pDataReceived != NULL);
+            memset(received, 0, sizeof(received));
+
+            // UDP may lose things so send everything that has
+            // not yet come back again, a few times if necessary
+            for (tries = 0; (numReceived < U_SOCK_TEST_BATCH_NUM_DATAGRAMS) &&
+                 (tries < U_SOCK_TEST_UDP_RETRIES); tries++) {
+                y = 0;
+                for (size_t z = 0; z < U_SOCK_TEST_BATCH_NUM_DATAGRAMS; z++) {
+                    if (!received[z]) {
+                        datagrams[y].pAddress = &remoteAddress;
+                        datagrams[y].pData = (void *) (gSendData +
+                                                       (z * U_SOCK_TEST_BATCH_DATAGRAM_SIZE));
+                        datagrams[y].dataSizeBytes = U_SOCK_TEST_BATCH_DATAGRAM_SIZE;
+                        datagrams[y].result = -1;
+                        y++;
+                    }
+                }
+                startTimeMs = uPortGetTickTimeMs();
+                U_PORT_TEST_ASSERT(uSockSendToBatch(descriptor, datagrams, y) == y);
+                uPortLog("U_SOCK_TEST: sent %d datagram(s) in one batch in %d ms.\n",
+                         y, (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+                for (int32_t z = 0; z < y; z++) {
+                    U_PORT_TEST_ASSERT(datagrams[z].result == U_SOCK_TEST_BATCH_DATAGRAM_SIZE);
+                }
+
+                // Receive what comes back, in batches
+                startTimeMs = uPortGetTickTimeMs();
+                while ((numReceived < U_SOCK_TEST_BATCH_NUM_DATAGRAMS) &&
+                       (uPortGetTickTimeMs() - startTimeMs < 10000)) {
+                    for (size_t z = 0; z < U_SOCK_TEST_BATCH_NUM_DATAGRAMS; z++) {
+                        datagrams[z].pAddress = &(receivedAddress[z]);
+                        datagrams[z].pData = pDataReceived + (z * U_SOCK_TEST_BATCH_DATAGRAM_SIZE);
+                        datagrams[z].dataSizeBytes = U_SOCK_TEST_BATCH_DATAGRAM_SIZE;
+                    }
+                    y = uSockReceiveFromBatch(descriptor, datagrams,
+                                              U_SOCK_TEST_BATCH_NUM_DATAGRAMS);
+                    if (y > 0) {
+                        uPortLog("U_SOCK_TEST: received %d datagram(s) in one batch.\n", y);
+                        for (int32_t z = 0; z < y; z++) {
+                            addressAssert(&remoteAddress, &(receivedAddress[z]), true);
+                            // Work out which datagram this is
+                            for (size_t w = 0; w < U_SOCK_TEST_BATCH_NUM_DATAGRAMS; w++) {
+                                if (!received[w] &&
+                                    (datagrams[z].result == U_SOCK_TEST_BATCH_DATAGRAM_SIZE) &&
+                                    (memcmp(datagrams[z].pData,
+                                            gSendData + (w * U_SOCK_TEST_BATCH_DATAGRAM_SIZE),
+                                            U_SOCK_TEST_BATCH_DATAGRAM_SIZE) == 0)) {
+                                    received[w] = true;
+                                    numReceived++;
+                                }
+                            }
+                        }
+                    } else {
+                        errno = 0;
+                    }
+                }
+            }
+            uPortLog("U_SOCK_TEST: %d of %d datagram(s) received after %d"
+                     " tries.\n", numReceived, U_SOCK_TEST_BATCH_NUM_DATAGRAMS,
+                     tries);
+            U_PORT_TEST_ASSERT(numReceived == U_SOCK_TEST_BATCH_NUM_DATAGRAMS);
+            free(pDataReceived);
+
+            // Close the socket
+            U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+            uSockCleanUp();
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: during this part of the test %d"
+                     " byte(s) were lost to sockets initialisation;"
+                     " we have leaked %d byte(s).\n",
+                     heapSockInitLoss + heapXxxSockInitLoss,
+                     heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        }
+    }
+}
+
 /** UDP echo test that does asynchronous receive.
  */
 U_PORT_TEST_FUNCTION("[sock]", "sockAsyncUdpEchoMayFailDueToInternetDatagramLoss")
@@ -2482,6 +2780,1049 @@ U_PORT_TEST_FUNCTION("[sock]", "sockAsyncTcpEcho")
     }
 }
 
+/** Test write coalescing on a TCP socket.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockWriteCoalesce")
+{
+    int32_t errorCode;
+    int32_t networkHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor;
+    bool closedCallbackCalled;
+    size_t sizeBytes = 20;
+    size_t numWrites = 10;
+    size_t offset;
+    int32_t saved;
+    int32_t y;
+    char *pDataReceived;
+    int64_t startTimeMs;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: doing TCP write coalescing test on %s.\n",
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+
+            // Look up the address of the server we use for TCP echo
+            heapSockInitLoss = uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(remoteAddress.ipAddress)) == 0);
+            heapSockInitLoss -= uPortGetHeapFree();
+            remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+            // Create and connect a TCP socket
+            heapXxxSockInitLoss += uPortGetHeapFree();
+            descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+            heapXxxSockInitLoss -= uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(descriptor >= 0);
+            U_PORT_TEST_ASSERT(errno == 0);
+            closedCallbackCalled = false;
+            uSockRegisterCallbackClosed(descriptor, setBoolCallback,
+                                        &closedCallbackCalled);
+            errorCode = -1;
+            for (y = 2; (y > 0) && (errorCode < 0); y--) {
+                errorCode = uSockConnect(descriptor, &remoteAddress);
+                if (errorCode < 0) {
+                    U_PORT_TEST_ASSERT(errno != 0);
+                    errno = 0;
+                }
+            }
+            U_PORT_TEST_ASSERT(errorCode == 0);
+
+            // Write coalescing is off by default
+            U_PORT_TEST_ASSERT(!uSockWriteCoalesceGet(descriptor));
+            U_PORT_TEST_ASSERT(uSockWriteCoalesceSet(descriptor, true) == 0);
+            U_PORT_TEST_ASSERT(uSockWriteCoalesceGet(descriptor));
+            U_PORT_TEST_ASSERT(uSockWriteCoalesceSavedGet(descriptor) == 0);
+
+            // Lots of small writes followed by a flush
+            // should be sent in one go
+            uPortLog("U_SOCK_TEST: %d writes of %d byte(s) each...\n",
+                     numWrites, sizeBytes);
+            for (size_t z = 0; z < numWrites; z++) {
+                U_PORT_TEST_ASSERT(uSockWrite(descriptor,
+                                              gSendData + (z * sizeBytes),
+                                              sizeBytes) == sizeBytes);
+            }
+            U_PORT_TEST_ASSERT(uSockWriteFlush(descriptor) == 0);
+            saved = uSockWriteCoalesceSavedGet(descriptor);
+            uPortLog("U_SOCK_TEST: write coalescing saved %d write(s).\n",
+                     saved);
+            U_PORT_TEST_ASSERT(saved == (int32_t) numWrites - 1);
+
+            // With U_SOCK_OPT_TCP_NODELAY set nothing is held back
+            y = 1;
+            U_PORT_TEST_ASSERT(uSockOptionSet(descriptor,
+                                              U_SOCK_OPT_LEVEL_TCP,
+                                              U_SOCK_OPT_TCP_NODELAY,
+                                              (void *) &y, sizeof(y)) == 0);
+            offset = numWrites * sizeBytes;
+            for (size_t z = 0; z < 2; z++) {
+                U_PORT_TEST_ASSERT(uSockWrite(descriptor,
+                                              gSendData + offset,
+                                              sizeBytes) == sizeBytes);
+                offset += sizeBytes;
+            }
+            U_PORT_TEST_ASSERT(uSockWriteCoalesceSavedGet(descriptor) == saved);
+            y = 0;
+            U_PORT_TEST_ASSERT(uSockOptionSet(descriptor,
+                                              U_SOCK_OPT_LEVEL_TCP,
+                                              U_SOCK_OPT_TCP_NODELAY,
+                                              (void *) &y, sizeof(y)) == 0);
+
+            // Without a flush, data should be sent anyway
+            // once the time threshold is passed
+            for (size_t z = 0; z < 2; z++) {
+                U_PORT_TEST_ASSERT(uSockWrite(descriptor,
+                                              gSendData + offset,
+                                              sizeBytes) == sizeBytes);
+                offset += sizeBytes;
+            }
+            uPortTaskBlock((U_SOCK_WRITE_COALESCE_TIMEOUT_MS * 2) + 1000);
+            U_PORT_TEST_ASSERT(uSockWriteCoalesceSavedGet(descriptor) == saved + 1);
+            U_PORT_TEST_ASSERT(errno == 0);
+
+            // Get it all back again
+            sizeBytes = offset;
+            pDataReceived = (char *) malloc(sizeBytes +
+                                            (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            U_PORT_TEST_ASSERT(pDataReceived != NULL);
+            //lint -e(668) Suppress possible use of NULL pointer
+            // for pDataReceived
+            memset(pDataReceived, U_SOCK_TEST_FILL_CHARACTER,
+                   sizeBytes + (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            startTimeMs = uPortGetTickTimeMs();
+            offset = 0;
+            while ((offset < sizeBytes) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                y = uSockRead(descriptor,
+                              pDataReceived + offset +
+                              U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                              sizeBytes - offset);
+                if (y > 0) {
+                    offset += y;
+                }
+            }
+            errno = 0;
+            U_PORT_TEST_ASSERT(checkAgainstSentData(gSendData, sizeBytes,
+                                                    pDataReceived, offset));
+            free(pDataReceived);
+
+            // Switch write coalescing off again
+            U_PORT_TEST_ASSERT(uSockWriteCoalesceSet(descriptor, false) == 0);
+            U_PORT_TEST_ASSERT(!uSockWriteCoalesceGet(descriptor));
+
+            // Close the socket
+            U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+            uPortLog("U_SOCK_TEST: waiting up to %d second(s) for TCP"
+                     " socket to close...\n",
+                     U_SOCK_TEST_TCP_CLOSE_SECONDS);
+            for (y = 0; (y < U_SOCK_TEST_TCP_CLOSE_SECONDS) &&
+                 !closedCallbackCalled; y++) {
+                uPortTaskBlock(1000);
+            }
+            U_PORT_TEST_ASSERT(closedCallbackCalled);
+            uSockCleanUp();
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: during this part of the test %d"
+                     " byte(s) were lost to sockets initialisation;"
+                     " we have leaked %d byte(s).\n",
+                     heapSockInitLoss + heapXxxSockInitLoss,
+                     heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        }
+    }
+}
+
+#if U_SOCK_STATS_ENABLE
+/** Test the statistics of a TCP socket: every count is worked
+ * out from the calls made here, which are made with write
+ * coalescing off so that each write is passed straight down.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockStats")
+{
+    int32_t errorCode;
+    int32_t networkHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor;
+    bool closedCallbackCalled;
+    size_t sizeBytes = 50;
+    size_t numWrites = 5;
+    size_t offset;
+    uint32_t numReads;
+    int32_t y;
+    char *pDataReceived;
+    int64_t startTimeMs;
+    uSockStats_t stats;
+    uSockStats_t statsTotalBefore;
+    uSockStats_t statsTotal;
+    uint32_t histogramCount;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: doing TCP statistics test on %s.\n",
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+
+            // Look up the address of the server we use for TCP echo
+            heapSockInitLoss = uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(remoteAddress.ipAddress)) == 0);
+            heapSockInitLoss -= uPortGetHeapFree();
+            remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+            // Create and connect a TCP socket
+            heapXxxSockInitLoss += uPortGetHeapFree();
+            descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+            heapXxxSockInitLoss -= uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(descriptor >= 0);
+            U_PORT_TEST_ASSERT(errno == 0);
+            closedCallbackCalled = false;
+            uSockRegisterCallbackClosed(descriptor, setBoolCallback,
+                                        &closedCallbackCalled);
+            errorCode = -1;
+            for (y = 2; (y > 0) && (errorCode < 0); y--) {
+                errorCode = uSockConnect(descriptor, &remoteAddress);
+                if (errorCode < 0) {
+                    U_PORT_TEST_ASSERT(errno != 0);
+                    errno = 0;
+                }
+            }
+            U_PORT_TEST_ASSERT(errorCode == 0);
+            U_PORT_TEST_ASSERT(!uSockWriteCoalesceGet(descriptor));
+
+            // Nothing has been sent or received on a new socket
+            U_PORT_TEST_ASSERT(uSockStatsGet(descriptor, &stats) == 0);
+            U_PORT_TEST_ASSERT(stats.txBytes == 0);
+            U_PORT_TEST_ASSERT(stats.txCalls == 0);
+            U_PORT_TEST_ASSERT(stats.rxBytes == 0);
+            U_PORT_TEST_ASSERT(stats.rxCalls == 0);
+            U_PORT_TEST_ASSERT(uSockStatsTotalGet(&statsTotalBefore) == 0);
+
+            // Send the data in numWrites writes
+            for (size_t z = 0; z < numWrites; z++) {
+                U_PORT_TEST_ASSERT(uSockWrite(descriptor,
+                                              gSendData + (z * sizeBytes),
+                                              sizeBytes) == sizeBytes);
+            }
+
+            // Get it all back again, counting the reads
+            offset = numWrites * sizeBytes;
+            pDataReceived = (char *) malloc(offset +
+                                            (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            U_PORT_TEST_ASSERT(pDataReceived != NULL);
+            //lint -e(668) Suppress possible use of NULL pointer
+            // for pDataReceived
+            memset(pDataReceived, U_SOCK_TEST_FILL_CHARACTER,
+                   offset + (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            numReads = 0;
+            startTimeMs = uPortGetTickTimeMs();
+            offset = 0;
+            while ((offset < numWrites * sizeBytes) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                y = uSockRead(descriptor,
+                              pDataReceived + offset +
+                              U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                              (numWrites * sizeBytes) - offset);
+                numReads++;
+                if (y > 0) {
+                    offset += y;
+                }
+            }
+            errno = 0;
+            U_PORT_TEST_ASSERT(checkAgainstSentData(gSendData,
+                                                    numWrites * sizeBytes,
+                                                    pDataReceived, offset));
+            free(pDataReceived);
+
+            // Every call made should have been counted
+            U_PORT_TEST_ASSERT(uSockStatsGet(descriptor, &stats) == 0);
+            U_PORT_TEST_ASSERT(uSockStatsTotalGet(&statsTotal) == 0);
+            uPortLog("U_SOCK_TEST: stats: %u byte(s) sent in %u call(s),"
+                     " %u byte(s) received in %u call(s), %u"
+                     " underlying call(s).\n", stats.txBytes,
+                     stats.txCalls, stats.rxBytes, stats.rxCalls,
+                     stats.underlyingCalls);
+            U_PORT_TEST_ASSERT(stats.txBytes == numWrites * sizeBytes);
+            U_PORT_TEST_ASSERT(stats.txCalls == numWrites);
+            U_PORT_TEST_ASSERT(stats.rxBytes == numWrites * sizeBytes);
+            U_PORT_TEST_ASSERT(stats.rxCalls == numReads);
+            U_PORT_TEST_ASSERT(stats.wouldBlocks <= numReads);
+            // At least one underlying call per write and per read
+            U_PORT_TEST_ASSERT(stats.underlyingCalls >= numWrites + numReads);
+            // Each write lands in exactly one latency bin
+            histogramCount = 0;
+            for (size_t z = 0; z < U_SOCK_STATS_LATENCY_NUM_BINS; z++) {
+                histogramCount += stats.txLatencyHistogram[z];
+            }
+            U_PORT_TEST_ASSERT(histogramCount == numWrites);
+            // This is the only socket, so the totals should have
+            // moved by exactly the same amounts
+            U_PORT_TEST_ASSERT(statsTotal.txBytes - statsTotalBefore.txBytes ==
+                               stats.txBytes);
+            U_PORT_TEST_ASSERT(statsTotal.txCalls - statsTotalBefore.txCalls ==
+                               stats.txCalls);
+            U_PORT_TEST_ASSERT(statsTotal.rxBytes - statsTotalBefore.rxBytes ==
+                               stats.rxBytes);
+            U_PORT_TEST_ASSERT(statsTotal.rxCalls - statsTotalBefore.rxCalls ==
+                               stats.rxCalls);
+
+            // NULL is not allowed
+            U_PORT_TEST_ASSERT(uSockStatsGet(descriptor, NULL) < 0);
+            U_PORT_TEST_ASSERT(errno > 0);
+            errno = 0;
+
+            // Close the socket
+            U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+            uPortLog("U_SOCK_TEST: waiting up to %d second(s) for TCP"
+                     " socket to close...\n",
+                     U_SOCK_TEST_TCP_CLOSE_SECONDS);
+            for (y = 0; (y < U_SOCK_TEST_TCP_CLOSE_SECONDS) &&
+                 !closedCallbackCalled; y++) {
+                uPortTaskBlock(1000);
+            }
+            U_PORT_TEST_ASSERT(closedCallbackCalled);
+            uSockCleanUp();
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: during this part of the test %d"
+                     " byte(s) were lost to sockets initialisation;"
+                     " we have leaked %d byte(s).\n",
+                     heapSockInitLoss + heapXxxSockInitLoss,
+                     heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        }
+    }
+}
+#endif
+
+/** Test the write queue of a TCP socket.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockWriteQueue")
+{
+    int32_t errorCode;
+    int32_t networkHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor;
+    bool closedCallbackCalled;
+    volatile int32_t bytesSent;
+    size_t sizeBytes = 200;
+    size_t numWrites = 8;
+    size_t offset;
+    size_t length;
+    int32_t y;
+    char *pDataReceived;
+    int64_t startTimeMs;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: doing TCP write queue test on %s.\n",
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+
+            // Look up the address of the server we use for TCP echo
+            heapSockInitLoss = uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(remoteAddress.ipAddress)) == 0);
+            heapSockInitLoss -= uPortGetHeapFree();
+            remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+            // Create and connect a TCP socket
+            heapXxxSockInitLoss += uPortGetHeapFree();
+            descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+            heapXxxSockInitLoss -= uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(descriptor >= 0);
+            U_PORT_TEST_ASSERT(errno == 0);
+            closedCallbackCalled = false;
+            uSockRegisterCallbackClosed(descriptor, setBoolCallback,
+                                        &closedCallbackCalled);
+            errorCode = -1;
+            for (y = 2; (y > 0) && (errorCode < 0); y--) {
+                errorCode = uSockConnect(descriptor, &remoteAddress);
+                if (errorCode < 0) {
+                    U_PORT_TEST_ASSERT(errno != 0);
+                    errno = 0;
+                }
+            }
+            U_PORT_TEST_ASSERT(errorCode == 0);
+
+            // The write queue is off by default, with the default size
+            U_PORT_TEST_ASSERT(!uSockWriteQueueGet(descriptor));
+            length = sizeof(y);
+            U_PORT_TEST_ASSERT(uSockOptionGet(descriptor,
+                                              U_SOCK_OPT_LEVEL_SOCK,
+                                              U_SOCK_OPT_SNDBUF,
+                                              (void *) &y, &length) == 0);
+            U_PORT_TEST_ASSERT(length == sizeof(y));
+            U_PORT_TEST_ASSERT(y == U_SOCK_WRITE_QUEUE_SIZE_BYTES);
+
+            // Make it smaller than what we're going to send and
+            // switch it on
+            y = (int32_t) ((sizeBytes * numWrites) / 2);
+            U_PORT_TEST_ASSERT(uSockOptionSet(descriptor,
+                                              U_SOCK_OPT_LEVEL_SOCK,
+                                              U_SOCK_OPT_SNDBUF,
+                                              (void *) &y, sizeof(y)) == 0);
+            bytesSent = 0;
+            uSockRegisterCallbackWriteQueue(descriptor, writeQueueCallback,
+                                            (void *) &bytesSent);
+            U_PORT_TEST_ASSERT(uSockWriteQueueSet(descriptor, true) == 0);
+            U_PORT_TEST_ASSERT(uSockWriteQueueGet(descriptor));
+            // Can't have write coalescing at the same time
+            U_PORT_TEST_ASSERT(uSockWriteCoalesceSet(descriptor, true) < 0);
+            U_PORT_TEST_ASSERT(errno == U_SOCK_EBUSY);
+            errno = 0;
+
+            // Write it all, going around again for whatever
+            // didn't fit in the write queue
+            uPortLog("U_SOCK_TEST: %d writes of %d byte(s) each...\n",
+                     numWrites, sizeBytes);
+            offset = 0;
+            startTimeMs = uPortGetTickTimeMs();
+            while ((offset < sizeBytes * numWrites) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                length = sizeBytes;
+                if (offset % sizeBytes > 0) {
+                    length -= offset % sizeBytes;
+                }
+                y = uSockWrite(descriptor, gSendData + offset, length);
+                if (y > 0) {
+                    U_PORT_TEST_ASSERT(y <= (int32_t) length);
+                    offset += y;
+                } else {
+                    // Write queue is full, wait for it to empty
+                    U_PORT_TEST_ASSERT(errno == U_SOCK_EWOULDBLOCK);
+                    errno = 0;
+                    uPortTaskBlock(100);
+                }
+            }
+            U_PORT_TEST_ASSERT(offset == sizeBytes * numWrites);
+
+            // Wait for the write queue task to say it has all gone
+            startTimeMs = uPortGetTickTimeMs();
+            while ((bytesSent >= 0) && (bytesSent < (int32_t) offset) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                uPortTaskBlock(100);
+            }
+            uPortLog("U_SOCK_TEST: write queue callback says %d byte(s)"
+                     " sent.\n", bytesSent);
+            U_PORT_TEST_ASSERT(bytesSent == (int32_t) offset);
+            U_PORT_TEST_ASSERT(uSockWriteQueueLengthGet(descriptor) == 0);
+
+            // Get it all back again
+            sizeBytes = offset;
+            pDataReceived = (char *) malloc(sizeBytes +
+                                            (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            U_PORT_TEST_ASSERT(pDataReceived != NULL);
+            //lint -e(668) Suppress possible use of NULL pointer
+            // for pDataReceived
+            memset(pDataReceived, U_SOCK_TEST_FILL_CHARACTER,
+                   sizeBytes + (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            startTimeMs = uPortGetTickTimeMs();
+            offset = 0;
+            while ((offset < sizeBytes) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                y = uSockRead(descriptor,
+                              pDataReceived + offset +
+                              U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                              sizeBytes - offset);
+                if (y > 0) {
+                    offset += y;
+                }
+            }
+            errno = 0;
+            U_PORT_TEST_ASSERT(checkAgainstSentData(gSendData, sizeBytes,
+                                                    pDataReceived, offset));
+            free(pDataReceived);
+
+            // Switch the write queue off again
+            U_PORT_TEST_ASSERT(uSockWriteQueueSet(descriptor, false) == 0);
+            U_PORT_TEST_ASSERT(!uSockWriteQueueGet(descriptor));
+
+            // Close the socket
+            U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+            uPortLog("U_SOCK_TEST: waiting up to %d second(s) for TCP"
+                     " socket to close...\n",
+                     U_SOCK_TEST_TCP_CLOSE_SECONDS);
+            for (y = 0; (y < U_SOCK_TEST_TCP_CLOSE_SECONDS) &&
+                 !closedCallbackCalled; y++) {
+                uPortTaskBlock(1000);
+            }
+            U_PORT_TEST_ASSERT(closedCallbackCalled);
+            uSockCleanUp();
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: during this part of the test %d"
+                     " byte(s) were lost to sockets initialisation;"
+                     " we have leaked %d byte(s).\n",
+                     heapSockInitLoss + heapXxxSockInitLoss,
+                     heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        }
+    }
+}
+
+/** Test push mode on a TCP socket.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockDataPush")
+{
+    int32_t errorCode;
+    int32_t networkHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor;
+    bool closedCallbackCalled;
+    uSockTestDataPush_t dataPush;
+    size_t sizeBytes = sizeof(gSendData) - 1;
+    size_t offset;
+    char *pBuffer;
+    int32_t y;
+    int64_t startTimeMs;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: doing TCP push mode test on %s.\n",
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+
+            // Look up the address of the server we use for TCP echo
+            heapSockInitLoss = uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(remoteAddress.ipAddress)) == 0);
+            heapSockInitLoss -= uPortGetHeapFree();
+            remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+            // Create and connect a TCP socket
+            heapXxxSockInitLoss += uPortGetHeapFree();
+            descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+            heapXxxSockInitLoss -= uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(descriptor >= 0);
+            U_PORT_TEST_ASSERT(errno == 0);
+            closedCallbackCalled = false;
+            uSockRegisterCallbackClosed(descriptor, setBoolCallback,
+                                        &closedCallbackCalled);
+            errorCode = -1;
+            for (y = 2; (y > 0) && (errorCode < 0); y--) {
+                errorCode = uSockConnect(descriptor, &remoteAddress);
+                if (errorCode < 0) {
+                    U_PORT_TEST_ASSERT(errno != 0);
+                    errno = 0;
+                }
+            }
+            U_PORT_TEST_ASSERT(errorCode == 0);
+
+            // Switch on push mode
+            memset(&dataPush, 0, sizeof(dataPush));
+            dataPush.pReceive = (char *) malloc(sizeBytes);
+            U_PORT_TEST_ASSERT(dataPush.pReceive != NULL);
+            dataPush.size = sizeBytes;
+            U_PORT_TEST_ASSERT(uSockRegisterCallbackDataPush(descriptor,
+                                                             dataPushCallback,
+                                                             &dataPush) == 0);
+
+            // Send the lot
+            uPortLog("U_SOCK_TEST: sending %d byte(s).\n", sizeBytes);
+            offset = 0;
+            startTimeMs = uPortGetTickTimeMs();
+            while ((offset < sizeBytes) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                y = uSockWrite(descriptor, gSendData + offset,
+                               sizeBytes - offset);
+                if (y > 0) {
+                    offset += y;
+                } else {
+                    errno = 0;
+                    uPortTaskBlock(100);
+                }
+            }
+            U_PORT_TEST_ASSERT(offset == sizeBytes);
+
+            // Wait for it all to be pushed back to us, releasing
+            // the buffers held by the callback as we go
+            startTimeMs = uPortGetTickTimeMs();
+            while ((dataPush.offset < sizeBytes) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                for (size_t z = 0; z < sizeof(dataPush.pHeld) /
+                     sizeof(dataPush.pHeld[0]); z++) {
+                    pBuffer = dataPush.pHeld[z];
+                    if (pBuffer != NULL) {
+                        dataPush.pHeld[z] = NULL;
+                        uSockDataPushBufferRelease(pBuffer);
+                    }
+                }
+                uPortTaskBlock(100);
+            }
+            uPortLog("U_SOCK_TEST: %d byte(s) pushed to us in %d"
+                     " callback(s).\n", dataPush.offset,
+                     dataPush.numCalls);
+            U_PORT_TEST_ASSERT(checkAgainstSentData(gSendData, sizeBytes,
+                                                    dataPush.pReceive,
+                                                    dataPush.offset));
+            for (size_t z = 0; z < sizeof(dataPush.pHeld) /
+                 sizeof(dataPush.pHeld[0]); z++) {
+                if (dataPush.pHeld[z] != NULL) {
+                    uSockDataPushBufferRelease(dataPush.pHeld[z]);
+                    dataPush.pHeld[z] = NULL;
+                }
+            }
+
+            // Switch push mode off again
+            U_PORT_TEST_ASSERT(uSockRegisterCallbackDataPush(descriptor,
+                                                             NULL, NULL) == 0);
+            free(dataPush.pReceive);
+
+            // Close the socket
+            U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+            uPortLog("U_SOCK_TEST: waiting up to %d second(s) for TCP"
+                     " socket to close...\n",
+                     U_SOCK_TEST_TCP_CLOSE_SECONDS);
+            for (y = 0; (y < U_SOCK_TEST_TCP_CLOSE_SECONDS) &&
+                 !closedCallbackCalled; y++) {
+                uPortTaskBlock(1000);
+            }
+            U_PORT_TEST_ASSERT(closedCallbackCalled);
+            uSockCleanUp();
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: during this part of the test %d"
+                     " byte(s) were lost to sockets initialisation;"
+                     " we have leaked %d byte(s).\n",
+                     heapSockInitLoss + heapXxxSockInitLoss,
+                     heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        }
+    }
+}
+
+/** Non-blocking TCP connect.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockNonBlockingConnect")
+{
+    int32_t errorCode;
+    int32_t networkHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor;
+    bool closedCallbackCalled;
+    bool connectedCallbackCalled;
+    size_t sizeBytes = 20;
+    size_t offset;
+    int32_t y;
+    char *pDataReceived;
+    int64_t startTimeMs;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: doing non-blocking connect test on %s.\n",
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+
+            // Look up the address of the server we use for TCP echo
+            heapSockInitLoss = uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(remoteAddress.ipAddress)) == 0);
+            heapSockInitLoss -= uPortGetHeapFree();
+            remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+            // Create a non-blocking TCP socket
+            heapXxxSockInitLoss += uPortGetHeapFree();
+            descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+            heapXxxSockInitLoss -= uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(descriptor >= 0);
+            U_PORT_TEST_ASSERT(errno == 0);
+            uSockBlockingSet(descriptor, false);
+            closedCallbackCalled = false;
+            uSockRegisterCallbackClosed(descriptor, setBoolCallback,
+                                        &closedCallbackCalled);
+            connectedCallbackCalled = false;
+            uSockRegisterCallbackConnected(descriptor, setBoolCallback,
+                                           &connectedCallbackCalled);
+            U_PORT_TEST_ASSERT(errno == 0);
+
+            // Connect: this should either return straight
+            // away with U_SOCK_EINPROGRESS or, if the underlying
+            // layer can't connect asynchronously, connect there
+            // and then; allow for connection failures
+            errorCode = -1;
+            for (y = 2; (y > 0) && (errorCode < 0); y--) {
+                startTimeMs = uPortGetTickTimeMs();
+                errorCode = uSockConnect(descriptor, &remoteAddress);
+                uPortLog("U_SOCK_TEST: uSockConnect() returned %d, errno %d,"
+                         " after %d ms.\n", errorCode, errno,
+                         (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+                if ((errorCode < 0) && (errno == U_SOCK_EINPROGRESS)) {
+                    errno = 0;
+                    // Can't do anything with the socket yet
+                    U_PORT_TEST_ASSERT(uSockWrite(descriptor, gSendData,
+                                                  sizeBytes) < 0);
+                    U_PORT_TEST_ASSERT((errno == U_SOCK_EWOULDBLOCK) ||
+                                       connectedCallbackCalled);
+                    errno = 0;
+                    // Wait for the connection to complete
+                    while (!connectedCallbackCalled &&
+                           (uPortGetTickTimeMs() - startTimeMs < 60000)) {
+                        uPortTaskBlock(100);
+                    }
+                    U_PORT_TEST_ASSERT(connectedCallbackCalled);
+                    uPortLog("U_SOCK_TEST: connection completed after %d ms.\n",
+                             (int32_t) (uPortGetTickTimeMs() - startTimeMs));
+                    // Calling connect again tells us the outcome
+                    U_PORT_TEST_ASSERT(uSockConnect(descriptor, &remoteAddress) < 0);
+                    if (errno == U_SOCK_EISCONN) {
+                        errorCode = 0;
+                    }
+                    connectedCallbackCalled = false;
+                }
+                if (errorCode < 0) {
+                    U_PORT_TEST_ASSERT(errno != 0);
+                    errno = 0;
+                }
+            }
+            U_PORT_TEST_ASSERT(errorCode == 0);
+            errno = 0;
+
+            // Check that the socket works
+            U_PORT_TEST_ASSERT(uSockWrite(descriptor, gSendData,
+                                          sizeBytes) == sizeBytes);
+            pDataReceived = (char *) malloc(sizeBytes +
+                                            (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            U_PORT_TEST_ASSERT(pDataReceived != NULL);
+            //lint -e(668) Suppress possible use of NULL pointer
+            // for pDataReceived
+            memset(pDataReceived, U_SOCK_TEST_FILL_CHARACTER,
+                   sizeBytes + (U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES * 2));
+            startTimeMs = uPortGetTickTimeMs();
+            offset = 0;
+            while ((offset < sizeBytes) &&
+                   (uPortGetTickTimeMs() - startTimeMs < 20000)) {
+                y = uSockRead(descriptor,
+                              pDataReceived + offset +
+                              U_SOCK_TEST_GUARD_LENGTH_SIZE_BYTES,
+                              sizeBytes - offset);
+                if (y > 0) {
+                    offset += y;
+                }
+            }
+            errno = 0;
+            U_PORT_TEST_ASSERT(checkAgainstSentData(gSendData, sizeBytes,
+                                                    pDataReceived, offset));
+            free(pDataReceived);
+
+            // Close the socket
+            U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+            uPortLog("U_SOCK_TEST: waiting up to %d second(s) for TCP"
+                     " socket to close...\n",
+                     U_SOCK_TEST_TCP_CLOSE_SECONDS);
+            for (y = 0; (y < U_SOCK_TEST_TCP_CLOSE_SECONDS) &&
+                 !closedCallbackCalled; y++) {
+                uPortTaskBlock(1000);
+            }
+            U_PORT_TEST_ASSERT(closedCallbackCalled);
+            uSockCleanUp();
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: during this part of the test %d"
+                     " byte(s) were lost to sockets initialisation;"
+                     " we have leaked %d byte(s).\n",
+                     heapSockInitLoss + heapXxxSockInitLoss,
+                     heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        }
+    }
+}
+
+/** TCP server: since cellular networks do not generally allow
+ * incoming TCP connections this can only check that a socket can
+ * be made to listen and that accepting does the right thing when
+ * there is nothing there.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockTcpServer")
+{
+    int32_t networkHandle;
+    uSockAddress_t localAddress;
+    uSockDescriptor_t descriptor;
+    int32_t heapUsed;
+    int32_t heapSockInitLoss = 0;
+    int32_t heapXxxSockInitLoss = 0;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type) &&
+            U_SOCK_TEST_TYPE_HAS_SOCK_EXTENDED(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: doing TCP server test on %s.\n",
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+
+            // Create a TCP socket
+            heapSockInitLoss += uPortGetHeapFree();
+            descriptor = uSockCreate(networkHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+            heapSockInitLoss -= uPortGetHeapFree();
+            U_PORT_TEST_ASSERT(descriptor >= 0);
+            U_PORT_TEST_ASSERT(errno == 0);
+
+            // Can't accept on a socket that isn't listening
+            U_PORT_TEST_ASSERT(uSockAccept(descriptor, NULL) < 0);
+            U_PORT_TEST_ASSERT(errno == U_SOCK_EINVAL);
+            errno = 0;
+
+            // Bind and listen
+            memset(&localAddress, 0, sizeof(localAddress));
+            localAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+            U_PORT_TEST_ASSERT(uSockBind(descriptor, &localAddress) == 0);
+            U_PORT_TEST_ASSERT(uSockListen(descriptor, 1) == 0);
+            U_PORT_TEST_ASSERT(errno == 0);
+
+            // Can't connect a listening socket
+            U_PORT_TEST_ASSERT(uSockConnect(descriptor, &localAddress) < 0);
+            U_PORT_TEST_ASSERT(errno != 0);
+            errno = 0;
+
+            // Nothing is going to arrive
+            uSockBlockingSet(descriptor, false);
+            U_PORT_TEST_ASSERT(uSockAccept(descriptor, NULL) < 0);
+            U_PORT_TEST_ASSERT(errno == U_SOCK_EWOULDBLOCK);
+            errno = 0;
+
+            // Close the socket
+            U_PORT_TEST_ASSERT(uSockClose(descriptor) == 0);
+            uSockCleanUp();
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: during this part of the test %d"
+                     " byte(s) were lost to sockets initialisation;"
+                     " we have leaked %d byte(s).\n",
+                     heapSockInitLoss + heapXxxSockInitLoss,
+                     heapUsed - (heapSockInitLoss + heapXxxSockInitLoss));
+            U_PORT_TEST_ASSERT(heapUsed <= heapSockInitLoss + heapXxxSockInitLoss);
+        }
+    }
+}
+
+/** Test that uSockDeinit() closes a number of TCP sockets
+ * in parallel: the same number of sockets are first closed
+ * one after the other to find out how long each closure takes
+ * and then uSockDeinit() must take closer to the time of the
+ * slowest single closure than to the sum of them, which it
+ * can only do if the closures overlap.
+ */
+U_PORT_TEST_FUNCTION("[sock]", "sockDeinitParallelClose")
+{
+    int32_t networkHandle;
+    uSockAddress_t remoteAddress;
+    uSockDescriptor_t descriptor[U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS];
+    bool closedCallbackCalled[U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS];
+    int64_t startTimeMs;
+    int32_t closeMs;
+    int32_t blockedMs;
+    int32_t serialMs;
+    int32_t maxMs;
+    int32_t deinitMs;
+    int32_t heapUsed;
+
+    // Call clean up to release OS resources that may
+    // have been left hanging by a previous failed test
+    osCleanup();
+
+    // Do the standard preamble to make sure there is
+    // a network underneath us
+    stdPreamble();
+
+    // Repeat for all bearers
+    for (size_t x = 0; x < gUNetworkTestCfgSize; x++) {
+        networkHandle = gUNetworkTestCfg[x].handle;
+        if ((networkHandle >= 0) &&
+            U_NETWORK_TEST_TYPE_HAS_SOCK(gUNetworkTestCfg[x].type)) {
+            // Get the initial-ish heap: since uSockDeinit()
+            // frees everything there is no initialisation loss
+            heapUsed = uPortGetHeapFree();
+
+            uPortLog("U_SOCK_TEST: testing parallel close of %d TCP"
+                     " socket(s) on %s.\n",
+                     U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS,
+                     gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+
+            // Look up the address of the server we use for TCP echo
+            U_PORT_TEST_ASSERT(uSockGetHostByName(networkHandle,
+                                                  U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                                  &(remoteAddress.ipAddress)) == 0);
+            remoteAddress.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+            // First close the sockets one at a time, timing how
+            // long each closure takes to be completed and how
+            // long uSockClose() itself blocks for
+            serialMs = 0;
+            maxMs = 0;
+            blockedMs = 0;
+            for (size_t y = 0; y < U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS; y++) {
+                descriptor[y] = openTcpSocket(networkHandle, &remoteAddress,
+                                              &(closedCallbackCalled[y]));
+                startTimeMs = uPortGetTickTimeMs();
+                U_PORT_TEST_ASSERT(uSockClose(descriptor[y]) == 0);
+                blockedMs += (int32_t) (uPortGetTickTimeMs() - startTimeMs);
+                while (!closedCallbackCalled[y] &&
+                       (uPortGetTickTimeMs() - startTimeMs <
+                        U_SOCK_CLOSE_TIMEOUT_SECONDS * 1000)) {
+                    uPortTaskBlock(10);
+                }
+                U_PORT_TEST_ASSERT(closedCallbackCalled[y]);
+                closeMs = (int32_t) (uPortGetTickTimeMs() - startTimeMs);
+                serialMs += closeMs;
+                if (closeMs > maxMs) {
+                    maxMs = closeMs;
+                }
+            }
+            uSockCleanUp();
+            uPortLog("U_SOCK_TEST: closing one at a time took %d ms"
+                     " (longest %d ms, %d ms of it blocked in"
+                     " uSockClose()).\n", serialMs, maxMs, blockedMs);
+
+            // Now open them again and shut the lot down at once
+            for (size_t y = 0; y < U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS; y++) {
+                descriptor[y] = openTcpSocket(networkHandle, &remoteAddress,
+                                              &(closedCallbackCalled[y]));
+            }
+            startTimeMs = uPortGetTickTimeMs();
+            uSockDeinit();
+            deinitMs = (int32_t) (uPortGetTickTimeMs() - startTimeMs);
+            uPortLog("U_SOCK_TEST: uSockDeinit() took %d ms.\n", deinitMs);
+            for (size_t y = 0; y < U_SOCK_TEST_PARALLEL_CLOSE_NUM_SOCKETS; y++) {
+                // User callbacks are not called during uSockDeinit()
+                U_PORT_TEST_ASSERT(!closedCallbackCalled[y]);
+            }
+            if (blockedMs < serialMs / 2) {
+                // Serial closure would take about serialMs and
+                // parallel closure about maxMs: require the
+                // answer to be in the bottom half of that range,
+                // allowing for the granularity of the polling
+                // in uSockDeinit()
+                U_PORT_TEST_ASSERT(deinitMs < maxMs + ((serialMs - maxMs) / 2) +
+                                   U_SOCK_CLOSE_POLL_INTERVAL_MS);
+            } else {
+                // If uSockClose() is blocking for most of the
+                // closure time then the underlying layer is
+                // closing synchronously and the closures cannot
+                // overlap
+                uPortLog("U_SOCK_TEST: closure on %s is synchronous,"
+                         " not checking for overlap.\n",
+                         gpUNetworkTestTypeName[gUNetworkTestCfg[x].type]);
+            }
+
+            // Check for memory leaks
+            heapUsed -= uPortGetHeapFree();
+            uPortLog("U_SOCK_TEST: we have leaked %d byte(s).\n", heapUsed);
+            U_PORT_TEST_ASSERT(heapUsed <= 0);
+        }
+    }
+}
+
 /** Clean-up to be run at the end of this round of tests, just
  * in case there were test failures which would have resulted
  * in the deinitialisation being skipped.
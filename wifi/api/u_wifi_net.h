@@ -0,0 +1,100 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_WIFI_NET_H_
+#define _U_WIFI_NET_H_
+
+/* No #includes allowed here */
+
+/** @file
+ * @brief This header file defines the APIs that connect a wifi
+ * module to an access point as a station.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_WIFI_NET_CONNECT_TIMEOUT_SECONDS
+/** The time to wait for the network to come up, i.e. for the
+ * module to associate with the access point and get an IP
+ * address, after being asked to connect.
+ */
+# define U_WIFI_NET_CONNECT_TIMEOUT_SECONDS 20
+#endif
+
+/** The maximum length of an SSID, not including a terminator.
+ */
+#define U_WIFI_NET_SSID_MAX_LENGTH 32
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The authentication used when connecting to an access point;
+ * the values match those of the AT interface.
+ */
+typedef enum {
+    U_WIFI_NET_AUTH_OPEN = 1, /**< No authentication. */
+    U_WIFI_NET_AUTH_WPA_PSK = 2 /**< WPA/WPA2 with a passphrase. */
+} uWifiNetAuth_t;
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Connect to an access point as a station, using station
+ * configuration 0 of the module, and wait until the network is
+ * up, i.e. an IP address has been obtained, or
+ * U_WIFI_NET_CONNECT_TIMEOUT_SECONDS have passed.  Other short
+ * range calls may be made while waiting but only one connection
+ * attempt may be in progress at a time.
+ *
+ * @param wifiHandle      the handle of the wifi instance.
+ * @param pSsid           the null-terminated SSID of the access
+ *                        point, cannot be NULL.
+ * @param authentication  the authentication to use.
+ * @param pPassPhrase     the null-terminated passphrase, required
+ *                        for U_WIFI_NET_AUTH_WPA_PSK, ignored
+ *                        otherwise.
+ * @return                zero on success else negative error
+ *                        code; U_WIFI_ERROR_TEMPORARY_FAILURE
+ *                        if another connection attempt is
+ *                        in progress.
+ */
+int32_t uWifiNetStationConnect(int32_t wifiHandle, const char *pSsid,
+                               uWifiNetAuth_t authentication,
+                               const char *pPassPhrase);
+
+/** Disconnect from the access point.  Any open sockets
+ * should be closed first.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @return            zero on success else negative error code.
+ */
+int32_t uWifiNetStationDisconnect(int32_t wifiHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_WIFI_NET_H_
+
+// End of file
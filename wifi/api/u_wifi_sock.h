@@ -0,0 +1,356 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_WIFI_SOCK_H_
+#define _U_WIFI_SOCK_H_
+
+/* No #includes allowed here */
+
+/** @file
+ * @brief This header file defines the sockets APIs for wifi.
+ * These functions are NOT thread-safe and are NOT intended to be
+ * called directly.  Instead, please use the common/sock API which
+ * wraps the functions exposed here to handle error/state checking
+ * and re-entrancy.
+ * Each socket is a peer connection of the short range module,
+ * its data carried over an EDM channel; hence a UDP socket is
+ * bound to one remote address by the first uWifiSockSendTo() or
+ * uWifiSockConnect() and TCP server operation and socket options
+ * are not supported.
+ * Note that this socket implementation is always non-blocking,
+ * the common/sock API provides blocking behaviour.
+ * The functions in here are different to those in the rest of
+ * the wifi API in that they return a negated value from the
+ * errno values in u_sock_errno.h (e.g. -U_SOCK_ENOMEM) instead
+ * of a value from u_error_common.h.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The maximum size of a datagram, which must fit into a
+ * single EDM frame.
+ */
+#define U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES 1000
+
+/** The maximum number of sockets that can be open at one time,
+ * across all wifi instances.
+ */
+#define U_WIFI_SOCK_MAX_NUM_SOCKETS 7
+
+#ifndef U_WIFI_SOCK_BUFFER_SIZE_BYTES
+/** The size of the receive buffer of each socket, allocated
+ * when the socket is created.  Data arriving while the buffer
+ * is full is thrown away since the module cannot be told to
+ * hold on to it.
+ */
+# define U_WIFI_SOCK_BUFFER_SIZE_BYTES 2048
+#endif
+
+#ifndef U_WIFI_SOCK_CONNECT_TIMEOUT_SECONDS
+/** The amount of time allowed to connect a socket.
+ */
+# define U_WIFI_SOCK_CONNECT_TIMEOUT_SECONDS 30
+#endif
+
+#ifndef U_WIFI_SOCK_DNS_LOOKUP_TIME_SECONDS
+/** The amount of time allowed to perform a DNS look-up.
+ */
+# define U_WIFI_SOCK_DNS_LOOKUP_TIME_SECONDS 30
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: INIT/DEINIT
+ * -------------------------------------------------------------- */
+
+/** Initialise the wifi sockets layer.  Must be called before
+ * this sockets layer is used.  If this sockets layer is already
+ * initialised then success is returned without any action being
+ * taken.
+ *
+ * @return  zero on success else negated value of U_SOCK_Exxx
+ *          from u_sock_errno.h.
+ */
+int32_t uWifiSockInit();
+
+/** Initialise the wifi instance.  Must be called before
+ * any other calls are made on the given instance.  If the
+ * instance is already initialised then success is returned
+ * without any action being taken.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @return            zero on success else negated value of
+ *                    U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uWifiSockInitInstance(int32_t wifiHandle);
+
+/** Deinitialise the wifi sockets layer.  Should be called
+ * when the wifi sockets layer is finished with.  May be called
+ * multiple times with no ill effects. Does not close sockets,
+ * you must do that.
+ */
+void uWifiSockDeinit();
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
+ * -------------------------------------------------------------- */
+
+/** Create a socket.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @param type        the type of socket to create.
+ * @param protocol    the protocol that will run over the given
+ *                    socket.
+ * @return            the socket handle on success else
+ *                    negated value of U_SOCK_Exxx from
+ *                    u_sock_errno.h.
+ */
+int32_t uWifiSockCreate(int32_t wifiHandle,
+                        uSockType_t type,
+                        uSockProtocol_t protocol);
+
+/** Connect to a server, waiting until the peer connection
+ * has been made.
+ *
+ * @param wifiHandle     the handle of the wifi instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pRemoteAddress the address of the server to
+ *                       connect to, possibly established
+ *                       via a call to uWifiSockGetHostByName(),
+ *                       including port number.
+ * @return               zero on success else negated
+ *                       value of U_SOCK_Exxx from
+ *                       u_sock_errno.h.
+ */
+int32_t uWifiSockConnect(int32_t wifiHandle,
+                         int32_t sockHandle,
+                         const uSockAddress_t *pRemoteAddress);
+
+/** Close a socket.  This always blocks until the closure is
+ * complete; pCallback, if non-NULL, is called before this
+ * function returns, so that the caller can track completion in
+ * the same way as for other socket implementations.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @param sockHandle  the handle of the socket.
+ * @param pCallback   callback to be called when the socket
+ *                    is closed, with the first parameter
+ *                    the wifiHandle and the second parameter
+ *                    the sockHandle; may be NULL.
+ * @return            zero on success else negated
+ *                    value of U_SOCK_Exxx from
+ *                    u_sock_errno.h.
+ */
+int32_t uWifiSockClose(int32_t wifiHandle,
+                       int32_t sockHandle,
+                       void (*pCallback) (int32_t,
+                                          int32_t));
+
+/** Clean-up.  This function should be called when
+ * there is no socket activity, either locally or from
+ * the remote host, in order to free memory occupied
+ * by closed sockets.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ */
+void uWifiSockCleanup(int32_t wifiHandle);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: CONFIGURE
+ * -------------------------------------------------------------- */
+
+/** Set a socket to be blocking or non-blocking. This function
+ * is provided for compatibility purposes only: this socket
+ * implementation is always non-blocking.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @param sockHandle  the handle of the socket.
+ * @param isBlocking  true to set the socket to be
+ *                    blocking, else false.
+ */
+void uWifiSockBlockingSet(int32_t wifiHandle,
+                          int32_t sockHandle,
+                          bool isBlocking);
+
+/** Get whether a socket is blocking or not.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @param sockHandle  the handle of the socket.
+ * @return            true if the socket is blocking,
+ *                    else false.
+ */
+bool uWifiSockBlockingGet(int32_t wifiHandle,
+                          int32_t sockHandle);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: UDP ONLY
+ * -------------------------------------------------------------- */
+
+/** Send a datagram.  The maximum length of datagram
+ * that can be transmitted is U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES:
+ * if dataSizeBytes is longer than this nothing will be
+ * transmitted and an error will be returned.  If the socket
+ * is not yet connected it is connected to pRemoteAddress
+ * first; after that only the same address may be used.
+ *
+ * @param wifiHandle     the handle of the wifi instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pRemoteAddress the address of the server to
+ *                       send the datagram to, possibly
+ *                       established via a call to
+ *                       uWifiSockGetHostByName(),
+ *                       plus port number; may be NULL
+ *                       if the socket is connected.
+ * @param pData          the data to send, may be NULL, in which
+ *                       case this function does nothing.
+ * @param dataSizeBytes  the number of bytes of data to send;
+ *                       must be zero if pData is NULL.
+ * @return               the number of bytes sent on
+ *                       success else negated value
+ *                       of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uWifiSockSendTo(int32_t wifiHandle,
+                        int32_t sockHandle,
+                        const uSockAddress_t *pRemoteAddress,
+                        const void *pData, size_t dataSizeBytes);
+
+/** Receive a datagram.
+ *
+ * @param wifiHandle     the handle of the wifi instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pRemoteAddress a place to put the address of the remote
+ *                       host from which the datagram was received;
+ *                       may be NULL.
+ * @param pData          a buffer in which to store the arriving
+ *                       datagram.
+ * @param dataSizeBytes  the number of bytes of storage available
+ *                       at pData.  Each call receives a single
+ *                       datagram; if dataSizeBytes is less than
+ *                       its length the remainder will be thrown
+ *                       away.
+ * @return               the number of bytes received else negated
+ *                       value of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uWifiSockReceiveFrom(int32_t wifiHandle,
+                             int32_t sockHandle,
+                             uSockAddress_t *pRemoteAddress,
+                             void *pData, size_t dataSizeBytes);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: STREAM (TCP)
+ * -------------------------------------------------------------- */
+
+/** Send bytes over a connected socket.
+ *
+ * @param wifiHandle     the handle of the wifi instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pData          the data to send, may be NULL, in which
+ *                       case this function does nothing.
+ * @param dataSizeBytes  the number of bytes of data to send;
+ *                       must be zero if pData is NULL.
+ * @return               the number of bytes sent on
+ *                       success else negated value
+ *                       of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uWifiSockWrite(int32_t wifiHandle,
+                       int32_t sockHandle,
+                       const void *pData, size_t dataSizeBytes);
+
+/** Receive bytes on a connected socket.
+ *
+ * @param wifiHandle     the handle of the wifi instance.
+ * @param sockHandle     the handle of the socket.
+ * @param pData          a buffer in which to store the received
+ *                       bytes.
+ * @param dataSizeBytes  the number of bytes of storage available
+ *                       at pData.
+ * @return               the number of bytes received else negated
+ *                       value of U_SOCK_Exxx from u_sock_errno.h.
+ */
+int32_t uWifiSockRead(int32_t wifiHandle,
+                      int32_t sockHandle,
+                      void *pData, size_t dataSizeBytes);
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: ASYNC
+ * -------------------------------------------------------------- */
+
+/** Register a callback on data being received.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @param sockHandle  the handle of the socket.
+ * @param pCallback   the callback to be called, or
+ *                    NULL to cancel a previous callback.
+ *                    The first parameter passed to the
+ *                    callback will be wifiHandle, the
+ *                    second sockHandle.
+ */
+void uWifiSockRegisterCallbackData(int32_t wifiHandle,
+                                   int32_t sockHandle,
+                                   void (*pCallback) (int32_t,
+                                                      int32_t));
+
+/** Register a callback on a socket being closed by the
+ * remote host.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ * @param sockHandle  the handle of the socket.
+ * @param pCallback   the callback to be called, or
+ *                    NULL to cancel a previous callback.
+ *                    The first parameter passed to the
+ *                    callback will be wifiHandle, the
+ *                    second sockHandle.
+ */
+void uWifiSockRegisterCallbackClosed(int32_t wifiHandle,
+                                     int32_t sockHandle,
+                                     void (*pCallback) (int32_t,
+                                                        int32_t));
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS: ADDRESS RESOLUTION
+ * -------------------------------------------------------------- */
+
+/** Perform a DNS look-up.
+ *
+ * @param wifiHandle     the handle of the wifi instance.
+ * @param pHostName      the host name to look up, e.g.
+ *                       "google.com".
+ * @param pHostIpAddress a place to put the IP address
+ *                       of the host.
+ * @return               zero on success else negated
+ *                       value of U_SOCK_Exxx from
+ *                       u_sock_errno.h.
+ */
+int32_t uWifiSockGetHostByName(int32_t wifiHandle,
+                               const char *pHostName,
+                               uSockIpAddress_t *pHostIpAddress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_WIFI_SOCK_H_
+
+// End of file
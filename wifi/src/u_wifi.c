@@ -0,0 +1,188 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the "general" API for wifi.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_error_common.h"
+
+#include "u_port_os.h"
+
+#include "u_at_client.h"
+#include "u_short_range_module_type.h"
+#include "u_short_range.h"
+#include "u_short_range_edm.h"
+#include "u_short_range_private.h"
+
+#include "u_network_handle.h"
+
+#include "u_sock.h"
+
+#include "u_wifi_module_type.h"
+#include "u_wifi.h"
+#include "u_wifi_sock.h"
+#include "u_wifi_private.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC VARIABLES
+ * -------------------------------------------------------------- */
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+static uWifiModuleType_t shortRangeToWifiModule(uShortRangeModuleType_t module)
+{
+    uWifiModuleType_t wifiModule;
+
+    switch (module) {
+        case U_SHORT_RANGE_MODULE_TYPE_NINA_B1:
+        case U_SHORT_RANGE_MODULE_TYPE_ANNA_B1:
+        case U_SHORT_RANGE_MODULE_TYPE_NINA_B3:
+        case U_SHORT_RANGE_MODULE_TYPE_NINA_B4:
+        case U_SHORT_RANGE_MODULE_TYPE_NINA_B2:
+            wifiModule = U_WIFI_MODULE_TYPE_UNSUPPORTED;
+            break;
+        case U_SHORT_RANGE_MODULE_TYPE_NINA_W13:
+            wifiModule = U_WIFI_MODULE_TYPE_NINA_W13;
+            break;
+        case U_SHORT_RANGE_MODULE_TYPE_NINA_W15:
+            wifiModule = U_WIFI_MODULE_TYPE_NINA_W15;
+            break;
+        case U_SHORT_RANGE_MODULE_TYPE_ODIN_W2:
+            wifiModule = U_WIFI_MODULE_TYPE_ODIN_W2;
+            break;
+        case U_SHORT_RANGE_MODULE_TYPE_INVALID:
+        default:
+            wifiModule = U_WIFI_MODULE_TYPE_INVALID;
+            break;
+    }
+
+    return wifiModule;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Initialise the wifi driver.
+int32_t uWifiInit()
+{
+    return uShortRangeInit();
+}
+
+// Shut-down the wifi driver.
+void uWifiDeinit()
+{
+    // Nothing in the sockets layer may refer to the
+    // instances once they are gone
+    uWifiSockDeinit();
+    uShortRangeDeinit();
+}
+
+// Add a wifi instance.
+int32_t uWifiAdd(uWifiModuleType_t moduleType,
+                 uAtClientHandle_t atHandle)
+{
+    int32_t errorCodeOrHandle;
+    errorCodeOrHandle = uShortRangeLock();
+
+    if (errorCodeOrHandle == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        errorCodeOrHandle = uShortRangeAdd((uShortRangeModuleType_t) moduleType, atHandle);
+        if (errorCodeOrHandle >= 0) {
+            if (U_WIFI_PRIVATE_WIFI_HANDLE(errorCodeOrHandle) > (int32_t) U_NETWORK_HANDLE_WIFI_MAX) {
+                // Out of wifi handles
+                uShortRangeRemove(errorCodeOrHandle);
+                errorCodeOrHandle = (int32_t) U_ERROR_COMMON_NO_MEMORY;
+            } else {
+                errorCodeOrHandle = U_WIFI_PRIVATE_WIFI_HANDLE(errorCodeOrHandle);
+            }
+        }
+        uShortRangeUnlock();
+    }
+
+    return errorCodeOrHandle;
+}
+
+// Remove a wifi instance.
+void uWifiRemove(int32_t wifiHandle)
+{
+    int32_t errorCode;
+
+    uWifiSockPrivateRemoveInstance(wifiHandle);
+
+    errorCode = uShortRangeLock();
+    if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        uShortRangeRemove(U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(wifiHandle));
+        uShortRangeUnlock();
+    }
+}
+
+// Get the handle of the AT client.
+int32_t uWifiAtClientHandleGet(int32_t wifiHandle,
+                               uAtClientHandle_t *pAtHandle)
+{
+    int32_t errorCode;
+    errorCode = uShortRangeLock();
+
+    if (errorCode == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        errorCode = uShortRangeAtClientHandleGet(U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(wifiHandle),
+                                                 pAtHandle);
+        uShortRangeUnlock();
+    }
+
+    return errorCode;
+}
+
+// Detect the module.
+uWifiModuleType_t uWifiDetectModule(int32_t wifiHandle)
+{
+    uWifiModuleType_t wifiModule = U_WIFI_MODULE_TYPE_INVALID;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+        uShortRangeModuleType_t shortRangeModule;
+        shortRangeModule = uShortRangeDetectModule(U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(wifiHandle));
+        wifiModule = shortRangeToWifiModule(shortRangeModule);
+        uShortRangeUnlock();
+    }
+
+    return wifiModule;
+}
+
+// End of file
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the station API for wifi.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_debug.h"
+
+#include "u_at_client.h"
+#include "u_short_range_module_type.h"
+#include "u_short_range.h"
+#include "u_short_range_edm.h"
+#include "u_short_range_private.h"
+
+#include "u_network_handle.h"
+
+#include "u_wifi_module_type.h"
+#include "u_wifi.h"
+#include "u_wifi_net.h"
+#include "u_wifi_private.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** The station configuration of the module that is used.
+ */
+#define U_WIFI_NET_STATION_CONFIG_ID 0
+
+/** How often to check for the network coming up.
+ */
+#define U_WIFI_NET_CONNECT_POLL_INTERVAL_MS 100
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** What the URCs have said while connecting.
+ */
+typedef struct {
+    volatile bool linkUp;
+    volatile bool linkDown;
+    volatile bool networkUp;
+} uWifiNetStatus_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** True while a connection attempt is in progress; protected
+ * by the short range lock.  The wait for the network is done
+ * without the lock so only one attempt may be in progress,
+ * otherwise the URC handlers would clash.
+ */
+static bool gConnecting = false;
+
+/** The status of the connection attempt in progress, written by
+ * the URC handlers.  This is static, not on the stack of
+ * uWifiNetStationConnect(), since if the instance is removed
+ * during the attempt the handlers can't safely be removed from
+ * an AT client that may be gone, and if it is not gone they may
+ * still be called later.
+ */
+static uWifiNetStatus_t gConnectStatus = {false, false, false};
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// +UUWLE:<connection_id>,<bssid>,<channel>
+static void UUWLE_urc(uAtClientHandle_t atHandle, void *pParameter)
+{
+    uWifiNetStatus_t *pStatus = (uWifiNetStatus_t *) pParameter;
+
+    (void) uAtClientReadInt(atHandle); // Connection ID
+    pStatus->linkUp = true;
+}
+
+// +UUWLD:<connection_id>,<reason>
+static void UUWLD_urc(uAtClientHandle_t atHandle, void *pParameter)
+{
+    uWifiNetStatus_t *pStatus = (uWifiNetStatus_t *) pParameter;
+
+    (void) uAtClientReadInt(atHandle); // Connection ID
+    uPortLog("U_WIFI_NET: link down, reason %d.\n",
+             uAtClientReadInt(atHandle));
+    pStatus->linkDown = true;
+}
+
+// +UUNU:<interface_id>
+static void UUNU_urc(uAtClientHandle_t atHandle, void *pParameter)
+{
+    uWifiNetStatus_t *pStatus = (uWifiNetStatus_t *) pParameter;
+
+    (void) uAtClientReadInt(atHandle); // Interface ID
+    pStatus->networkUp = true;
+}
+
+// Write one station configuration parameter.
+static int32_t stationConfigSet(uAtClientHandle_t atHandle,
+                                int32_t parameter, int32_t intValue,
+                                const char *pStringValue)
+{
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UWSC=");
+    uAtClientWriteInt(atHandle, U_WIFI_NET_STATION_CONFIG_ID);
+    uAtClientWriteInt(atHandle, parameter);
+    if (pStringValue != NULL) {
+        uAtClientWriteString(atHandle, pStringValue, true);
+    } else {
+        uAtClientWriteInt(atHandle, intValue);
+    }
+    uAtClientCommandStopReadResponse(atHandle);
+    return uAtClientUnlock(atHandle);
+}
+
+// Activate or deactivate the station configuration.
+static int32_t stationConfigAction(uAtClientHandle_t atHandle,
+                                   int32_t action)
+{
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UWSCA=");
+    uAtClientWriteInt(atHandle, U_WIFI_NET_STATION_CONFIG_ID);
+    uAtClientWriteInt(atHandle, action);
+    uAtClientCommandStopReadResponse(atHandle);
+    return uAtClientUnlock(atHandle);
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Connect to an access point.
+int32_t uWifiNetStationConnect(int32_t wifiHandle, const char *pSsid,
+                               uWifiNetAuth_t authentication,
+                               const char *pPassPhrase)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+    uAtClientHandle_t atHandle = NULL;
+    bool activated = false;
+    int64_t startTimeMs;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+
+        pInstance = pUShortRangePrivateGetInstance(U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(wifiHandle));
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if ((pInstance != NULL) && (pSsid != NULL) &&
+            ((authentication == U_WIFI_NET_AUTH_OPEN) ||
+             ((authentication == U_WIFI_NET_AUTH_WPA_PSK) && (pPassPhrase != NULL)))) {
+            errorCode = (int32_t) U_WIFI_ERROR_TEMPORARY_FAILURE;
+            if (!gConnecting) {
+                atHandle = pInstance->atHandle;
+                uPortLog("U_WIFI_NET: connecting to \"%s\"...\n", pSsid);
+
+                // SSID, authentication and, if needed, passphrase
+                errorCode = stationConfigSet(atHandle, 2, 0, pSsid);
+                if (errorCode == 0) {
+                    errorCode = stationConfigSet(atHandle, 5, (int32_t) authentication, NULL);
+                }
+                if ((errorCode == 0) && (authentication == U_WIFI_NET_AUTH_WPA_PSK)) {
+                    errorCode = stationConfigSet(atHandle, 8, 0, pPassPhrase);
+                }
+
+                if (errorCode == 0) {
+                    gConnectStatus.linkUp = false;
+                    gConnectStatus.linkDown = false;
+                    gConnectStatus.networkUp = false;
+                    uAtClientSetUrcHandler(atHandle, "+UUWLE:", UUWLE_urc, &gConnectStatus);
+                    uAtClientSetUrcHandler(atHandle, "+UUWLD:", UUWLD_urc, &gConnectStatus);
+                    uAtClientSetUrcHandler(atHandle, "+UUNU:", UUNU_urc, &gConnectStatus);
+                    // Activate
+                    errorCode = stationConfigAction(atHandle, 3);
+                    if (errorCode == 0) {
+                        gConnecting = true;
+                        activated = true;
+                    } else {
+                        uAtClientRemoveUrcHandler(atHandle, "+UUWLE:");
+                        uAtClientRemoveUrcHandler(atHandle, "+UUWLD:");
+                        uAtClientRemoveUrcHandler(atHandle, "+UUNU:");
+                    }
+                }
+
+                if (errorCode < 0) {
+                    errorCode = (int32_t) U_WIFI_ERROR_AT;
+                }
+            }
+        }
+
+        uShortRangeUnlock();
+
+        if (activated) {
+            // Wait for the link and then the network to come up
+            // without holding the lock, which would otherwise
+            // stall every other short range call for up to
+            // U_WIFI_NET_CONNECT_TIMEOUT_SECONDS
+            startTimeMs = uPortGetTickTimeMs();
+            while (!gConnectStatus.networkUp && !gConnectStatus.linkDown &&
+                   (uPortGetTickTimeMs() < startTimeMs +
+                    (U_WIFI_NET_CONNECT_TIMEOUT_SECONDS * 1000))) {
+                uPortTaskBlock(U_WIFI_NET_CONNECT_POLL_INTERVAL_MS);
+            }
+
+            errorCode = (int32_t) U_WIFI_ERROR_NOT_CONNECTED;
+            if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+                // The instance may have been removed while the lock
+                // was released, in which case its AT client may be
+                // gone too and must not be touched; the URC handlers
+                // only ever write to gConnectStatus
+                pInstance = pUShortRangePrivateGetInstance(U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(wifiHandle));
+                if ((pInstance != NULL) && (pInstance->atHandle == atHandle)) {
+                    if (gConnectStatus.networkUp) {
+                        uPortLog("U_WIFI_NET: connected.\n");
+                        errorCode = (int32_t) U_ERROR_COMMON_SUCCESS;
+                    } else {
+                        uPortLog("U_WIFI_NET: %s.\n", gConnectStatus.linkUp ?
+                                 "no network after link up" : "unable to connect");
+                        (void) stationConfigAction(atHandle, 4);
+                    }
+                    uAtClientRemoveUrcHandler(atHandle, "+UUWLE:");
+                    uAtClientRemoveUrcHandler(atHandle, "+UUWLD:");
+                    uAtClientRemoveUrcHandler(atHandle, "+UUNU:");
+                }
+                gConnecting = false;
+
+                uShortRangeUnlock();
+            } else {
+                // Short range has been deinitialised underneath us
+                gConnecting = false;
+            }
+        }
+    }
+
+    return errorCode;
+}
+
+// Disconnect from the access point.
+int32_t uWifiNetStationDisconnect(int32_t wifiHandle)
+{
+    int32_t errorCode = (int32_t) U_ERROR_COMMON_NOT_INITIALISED;
+    uShortRangePrivateInstance_t *pInstance;
+
+    if (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS) {
+
+        pInstance = pUShortRangePrivateGetInstance(U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(wifiHandle));
+        errorCode = (int32_t) U_ERROR_COMMON_INVALID_PARAMETER;
+        if (pInstance != NULL) {
+            uPortLog("U_WIFI_NET: disconnecting.\n");
+            errorCode = stationConfigAction(pInstance->atHandle, 4);
+            if (errorCode < 0) {
+                errorCode = (int32_t) U_WIFI_ERROR_AT;
+            }
+        }
+
+        uShortRangeUnlock();
+    }
+
+    return errorCode;
+}
+
+// End of file
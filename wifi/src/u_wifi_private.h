@@ -0,0 +1,66 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _U_WIFI_PRIVATE_H_
+#define _U_WIFI_PRIVATE_H_
+
+/* No #includes allowed here */
+
+/** @file
+ * @brief This header file defines types, functions and inclusions
+ * that are common and private to the wifi API.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+/** Convert a wifi handle into the handle of the short range
+ * instance underneath it.
+ */
+#define U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(wifiHandle) ((wifiHandle) - \
+                                                       (int32_t) U_NETWORK_HANDLE_WIFI_MIN)
+
+/** Convert the handle of a short range instance into a wifi
+ * handle, in the wifi range of u_network_handle.h.
+ */
+#define U_WIFI_PRIVATE_WIFI_HANDLE(shortRangeHandle) ((shortRangeHandle) + \
+                                                      (int32_t) U_NETWORK_HANDLE_WIFI_MIN)
+
+/* ----------------------------------------------------------------
+ * FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Release everything the sockets API holds for a wifi instance,
+ * which is about to be removed: its sockets and the EDM stream
+ * callbacks that refer to it.
+ * Note: the short range lock must NOT be held when this is called.
+ *
+ * @param wifiHandle  the handle of the wifi instance.
+ */
+void uWifiSockPrivateRemoveInstance(int32_t wifiHandle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _U_WIFI_PRIVATE_H_
+
+// End of file
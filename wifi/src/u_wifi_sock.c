@@ -0,0 +1,1094 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Implementation of the sockets API for wifi.  Each socket
+ * is a peer connection of the short range module (AT+UDCP), the
+ * data of which is carried over an EDM channel: the EDM connect
+ * event that gives the channel is matched to the socket by
+ * protocol and remote address.  Received data is buffered per
+ * socket until it is read.
+ */
+
+#ifdef U_CFG_OVERRIDE
+# include "u_cfg_override.h" // For a customer's configuration override
+#endif
+
+#include "stdio.h"     // snprintf()
+#include "stdlib.h"    // malloc() and free()
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memcpy(), memset()
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_os.h"
+#include "u_port_debug.h"
+#include "u_cfg_os_platform_specific.h"
+
+#include "u_at_client.h"
+
+#include "u_sock_errno.h"
+#include "u_sock.h"
+
+#include "u_short_range_module_type.h"
+#include "u_short_range.h"
+#include "u_short_range_edm.h"
+#include "u_short_range_private.h"
+#include "u_short_range_edm_stream.h"
+
+#include "u_network_handle.h"
+
+#include "u_wifi_sock.h"
+#include "u_wifi_private.h"
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#if U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES + U_SHORT_RANGE_EDM_DATA_OVERHEAD > U_EDM_STREAM_TX_BUFFER_SIZE
+# error U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES must fit into a single EDM frame.
+#endif
+
+/** How often to check whether the EDM channel of a socket
+ * being connected has turned up.
+ */
+#define U_WIFI_SOCK_CONNECT_POLL_INTERVAL_MS 50
+
+/** The number of bytes used in the receive buffer to store
+ * the length of each datagram of a UDP socket.
+ */
+#define U_WIFI_SOCK_DATAGRAM_LENGTH_SIZE 2
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** A wifi instance that has sockets, one per EDM stream.
+ */
+typedef struct {
+    int32_t wifiHandle; // -1 if this entry is free
+    int32_t streamHandle;
+    uAtClientHandle_t atHandle;
+} uWifiSockInstance_t;
+
+/** A socket.
+ */
+typedef struct {
+    int32_t sockHandle; // -1 if this entry is free
+    uWifiSockInstance_t *pInstance;
+    uSockProtocol_t protocol;
+    int32_t peerHandle; // From AT+UDCP, -1 if not connected
+    int32_t edmChannel; // From the EDM connect event, -1 until then
+    bool connecting;    // Waiting for the EDM connect event
+    bool closedByRemote;
+    uSockAddress_t remoteAddress;
+    char *pRxBuffer; // For a UDP socket each datagram is preceded by its length
+    size_t rxIn;
+    size_t rxOut;
+    size_t rxCount;
+    void (*pDataCallback) (int32_t, int32_t);
+    void (*pClosedCallback) (int32_t, int32_t);
+} uWifiSockSocket_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Protects gInstance[] and gSocket[]; it is never held while
+ * talking to the module since the EDM events that the module
+ * sends back need it.
+ */
+static uPortMutexHandle_t gMutex = NULL;
+
+/** The instances, one per EDM stream.
+ */
+static uWifiSockInstance_t gInstance[U_EDM_STREAM_MAX_NUM_INSTANCES];
+
+/** The sockets, the socket handle being the index.
+ */
+static uWifiSockSocket_t gSocket[U_WIFI_SOCK_MAX_NUM_SOCKETS];
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: FINDING THINGS
+ * -------------------------------------------------------------- */
+
+// Find an instance by wifi handle, use -1 to get a free entry.
+// gMutex must be locked before calling this function.
+static uWifiSockInstance_t *pInstanceGet(int32_t wifiHandle)
+{
+    uWifiSockInstance_t *pInstance = NULL;
+
+    for (size_t x = 0; (x < sizeof(gInstance) / sizeof(gInstance[0])) &&
+         (pInstance == NULL); x++) {
+        if (gInstance[x].wifiHandle == wifiHandle) {
+            pInstance = &(gInstance[x]);
+        }
+    }
+
+    return pInstance;
+}
+
+// Find a socket by wifi handle and socket handle.
+// gMutex must be locked before calling this function.
+static uWifiSockSocket_t *pSocketGet(int32_t wifiHandle, int32_t sockHandle)
+{
+    uWifiSockSocket_t *pSocket = NULL;
+
+    if ((sockHandle >= 0) && (sockHandle < U_WIFI_SOCK_MAX_NUM_SOCKETS) &&
+        (gSocket[sockHandle].sockHandle >= 0) &&
+        (gSocket[sockHandle].pInstance->wifiHandle == wifiHandle)) {
+        pSocket = &(gSocket[sockHandle]);
+    }
+
+    return pSocket;
+}
+
+// Find the socket that an EDM channel belongs to.
+// gMutex must be locked before calling this function.
+static uWifiSockSocket_t *pSocketGetByChannel(const uWifiSockInstance_t *pInstance,
+                                              int32_t channel)
+{
+    uWifiSockSocket_t *pSocket = NULL;
+
+    for (size_t x = 0; (x < U_WIFI_SOCK_MAX_NUM_SOCKETS) && (pSocket == NULL); x++) {
+        if ((gSocket[x].sockHandle >= 0) && (gSocket[x].pInstance == pInstance) &&
+            (gSocket[x].edmChannel == channel)) {
+            pSocket = &(gSocket[x]);
+        }
+    }
+
+    return pSocket;
+}
+
+// Free a socket.
+// gMutex must be locked before calling this function.
+static void socketFree(uWifiSockSocket_t *pSocket)
+{
+    free(pSocket->pRxBuffer);
+    memset(pSocket, 0, sizeof(*pSocket));
+    pSocket->sockHandle = -1;
+    pSocket->peerHandle = -1;
+    pSocket->edmChannel = -1;
+}
+
+// Convert the remote address of an EDM connect event.
+static void remoteAddressGet(const uShortRangeEdmStreamIpConnection_t *pConnection,
+                             uSockAddress_t *pAddress)
+{
+    const uint8_t *pBytes = pConnection->remoteAddress;
+
+    memset(pAddress, 0, sizeof(*pAddress));
+    if (pConnection->ipv6) {
+        // The most significant word is the last one
+        pAddress->ipAddress.type = U_SOCK_ADDRESS_TYPE_V6;
+        for (size_t x = 0; x < 4; x++) {
+            pAddress->ipAddress.address.ipv6[3 - x] = (((uint32_t) pBytes[0]) << 24) |
+                                                      (((uint32_t) pBytes[1]) << 16) |
+                                                      (((uint32_t) pBytes[2]) << 8)  |
+                                                      pBytes[3];
+            pBytes += 4;
+        }
+    } else {
+        pAddress->ipAddress.type = U_SOCK_ADDRESS_TYPE_V4;
+        pAddress->ipAddress.address.ipv4 = (((uint32_t) pBytes[0]) << 24) |
+                                           (((uint32_t) pBytes[1]) << 16) |
+                                           (((uint32_t) pBytes[2]) << 8)  |
+                                           pBytes[3];
+    }
+    pAddress->port = (uint16_t) pConnection->remotePort;
+}
+
+// Compare two addresses, including port number.
+static bool addressIsEqual(const uSockAddress_t *pAddress1,
+                           const uSockAddress_t *pAddress2)
+{
+    bool isEqual = (pAddress1->ipAddress.type == pAddress2->ipAddress.type) &&
+                   (pAddress1->port == pAddress2->port);
+
+    if (isEqual) {
+        if (pAddress1->ipAddress.type == U_SOCK_ADDRESS_TYPE_V6) {
+            isEqual = (memcmp(pAddress1->ipAddress.address.ipv6,
+                              pAddress2->ipAddress.address.ipv6,
+                              sizeof(pAddress1->ipAddress.address.ipv6)) == 0);
+        } else {
+            isEqual = (pAddress1->ipAddress.address.ipv4 ==
+                       pAddress2->ipAddress.address.ipv4);
+        }
+    }
+
+    return isEqual;
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: RECEIVE BUFFER
+ * -------------------------------------------------------------- */
+
+// Copy data into the receive buffer of a socket, which must have
+// room for it.
+// gMutex must be locked before calling this function.
+static void rxBufferPut(uWifiSockSocket_t *pSocket, const char *pData,
+                        size_t length)
+{
+    size_t thisLength;
+
+    pSocket->rxCount += length;
+    while (length > 0) {
+        thisLength = U_WIFI_SOCK_BUFFER_SIZE_BYTES - pSocket->rxIn;
+        if (thisLength > length) {
+            thisLength = length;
+        }
+        memcpy(pSocket->pRxBuffer + pSocket->rxIn, pData, thisLength);
+        pSocket->rxIn = (pSocket->rxIn + thisLength) % U_WIFI_SOCK_BUFFER_SIZE_BYTES;
+        pData += thisLength;
+        length -= thisLength;
+    }
+}
+
+// Take data out of the receive buffer of a socket, pData may be
+// NULL to throw it away.
+// gMutex must be locked before calling this function.
+static void rxBufferGet(uWifiSockSocket_t *pSocket, char *pData,
+                        size_t length)
+{
+    size_t thisLength;
+
+    pSocket->rxCount -= length;
+    while (length > 0) {
+        thisLength = U_WIFI_SOCK_BUFFER_SIZE_BYTES - pSocket->rxOut;
+        if (thisLength > length) {
+            thisLength = length;
+        }
+        if (pData != NULL) {
+            memcpy(pData, pSocket->pRxBuffer + pSocket->rxOut, thisLength);
+            pData += thisLength;
+        }
+        pSocket->rxOut = (pSocket->rxOut + thisLength) % U_WIFI_SOCK_BUFFER_SIZE_BYTES;
+        length -= thisLength;
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: EDM CALLBACKS
+ * -------------------------------------------------------------- */
+
+// Called by the EDM stream when an IP connection is made or ends.
+//lint -e{818} suppress "could be declared as pointing to const":
+// need to follow function signature
+static void wifiEventCallback(int32_t streamHandle, uint32_t type,
+                              uint32_t channel,
+                              const uShortRangeEdmStreamIpConnection_t *pConnection,
+                              void *pParam)
+{
+    uWifiSockInstance_t *pInstance = (uWifiSockInstance_t *) pParam;
+    uWifiSockSocket_t *pSocket;
+    uSockAddress_t remoteAddress;
+    uSockProtocol_t protocol;
+    void (*pClosedCallback) (int32_t, int32_t) = NULL;
+    int32_t wifiHandle = -1;
+    int32_t sockHandle = -1;
+
+    (void) streamHandle;
+
+    U_PORT_MUTEX_LOCK(gMutex);
+
+    if (pInstance->wifiHandle >= 0) {
+        if ((type == 0) && (pConnection != NULL)) {
+            // Connected: give the channel to the socket
+            // waiting for a connection to this address
+            remoteAddressGet(pConnection, &remoteAddress);
+            protocol = (pConnection->protocol == 0) ? U_SOCK_PROTOCOL_TCP :
+                       U_SOCK_PROTOCOL_UDP;
+            for (size_t x = 0; x < U_WIFI_SOCK_MAX_NUM_SOCKETS; x++) {
+                pSocket = &(gSocket[x]);
+                if ((pSocket->sockHandle >= 0) && (pSocket->pInstance == pInstance) &&
+                    pSocket->connecting && (pSocket->edmChannel < 0) &&
+                    (pSocket->protocol == protocol) &&
+                    addressIsEqual(&(pSocket->remoteAddress), &remoteAddress)) {
+                    pSocket->edmChannel = (int32_t) channel;
+                    break;
+                }
+            }
+        } else {
+            // Disconnected
+            pSocket = pSocketGetByChannel(pInstance, (int32_t) channel);
+            if (pSocket != NULL) {
+                pSocket->closedByRemote = true;
+                pSocket->edmChannel = -1;
+                pClosedCallback = pSocket->pClosedCallback;
+                wifiHandle = pInstance->wifiHandle;
+                sockHandle = pSocket->sockHandle;
+            }
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gMutex);
+
+    if (pClosedCallback != NULL) {
+        pClosedCallback(wifiHandle, sockHandle);
+    }
+}
+
+// Called by the EDM stream when data arrives on an IP connection.
+static void dataCallback(int32_t streamHandle, int32_t channel,
+                         int32_t length, char *pData, void *pParam)
+{
+    uWifiSockInstance_t *pInstance = (uWifiSockInstance_t *) pParam;
+    uWifiSockSocket_t *pSocket;
+    void (*pDataCallback) (int32_t, int32_t) = NULL;
+    int32_t wifiHandle = -1;
+    int32_t sockHandle = -1;
+    size_t room;
+    size_t thisLength = (size_t) length;
+    char datagramLength[U_WIFI_SOCK_DATAGRAM_LENGTH_SIZE];
+
+    (void) streamHandle;
+
+    U_PORT_MUTEX_LOCK(gMutex);
+
+    pSocket = pSocketGetByChannel(pInstance, channel);
+    if ((pSocket != NULL) && (length > 0)) {
+        room = U_WIFI_SOCK_BUFFER_SIZE_BYTES - pSocket->rxCount;
+        if (pSocket->protocol == U_SOCK_PROTOCOL_UDP) {
+            // A datagram goes in whole or not at all
+            if (thisLength + sizeof(datagramLength) <= room) {
+                datagramLength[0] = (char) (thisLength >> 8);
+                datagramLength[1] = (char) thisLength;
+                rxBufferPut(pSocket, datagramLength, sizeof(datagramLength));
+            } else {
+                thisLength = 0;
+            }
+        } else if (thisLength > room) {
+            thisLength = room;
+        }
+        if (thisLength < (size_t) length) {
+            uPortLog("U_WIFI_SOCK: socket %d receive buffer full, %d byte(s)"
+                     " thrown away.\n", pSocket->sockHandle,
+                     length - (int32_t) thisLength);
+        }
+        if (thisLength > 0) {
+            rxBufferPut(pSocket, pData, thisLength);
+            pDataCallback = pSocket->pDataCallback;
+            wifiHandle = pInstance->wifiHandle;
+            sockHandle = pSocket->sockHandle;
+        }
+    }
+
+    U_PORT_MUTEX_UNLOCK(gMutex);
+
+    if (pDataCallback != NULL) {
+        pDataCallback(wifiHandle, sockHandle);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS: MISC
+ * -------------------------------------------------------------- */
+
+// Disconnect a peer.
+static int32_t peerDisconnect(uAtClientHandle_t atHandle, int32_t peerHandle)
+{
+    uAtClientLock(atHandle);
+    uAtClientCommandStart(atHandle, "AT+UDCPC=");
+    uAtClientWriteInt(atHandle, peerHandle);
+    uAtClientCommandStopReadResponse(atHandle);
+    return uAtClientUnlock(atHandle);
+}
+
+// Release an instance: free its sockets and remove the EDM stream
+// callbacks, which has to be done without gMutex since the
+// callbacks may be waiting on it.
+static void instanceRelease(uWifiSockInstance_t *pInstance)
+{
+    int32_t streamHandle;
+
+    U_PORT_MUTEX_LOCK(gMutex);
+
+    for (size_t x = 0; x < U_WIFI_SOCK_MAX_NUM_SOCKETS; x++) {
+        if ((gSocket[x].sockHandle >= 0) && (gSocket[x].pInstance == pInstance)) {
+            socketFree(&(gSocket[x]));
+        }
+    }
+    streamHandle = pInstance->streamHandle;
+    pInstance->wifiHandle = -1;
+    pInstance->streamHandle = -1;
+    pInstance->atHandle = NULL;
+
+    U_PORT_MUTEX_UNLOCK(gMutex);
+
+    uShortRangeEdmStreamWifiEventCallbackRemove(streamHandle);
+    uShortRangeEdmStreamDataEventCallbackSet(streamHandle,
+                                             U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                             NULL, NULL, 0, 0);
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: INIT/DEINIT
+ * -------------------------------------------------------------- */
+
+// Initialise the wifi sockets layer.
+int32_t uWifiSockInit()
+{
+    int32_t errnoLocal = U_SOCK_ENONE;
+
+    if (gMutex == NULL) {
+        errnoLocal = U_SOCK_ENOMEM;
+        if (uPortMutexCreate(&gMutex) == 0) {
+            for (size_t x = 0; x < sizeof(gInstance) / sizeof(gInstance[0]); x++) {
+                gInstance[x].wifiHandle = -1;
+                gInstance[x].streamHandle = -1;
+                gInstance[x].atHandle = NULL;
+            }
+            for (size_t x = 0; x < U_WIFI_SOCK_MAX_NUM_SOCKETS; x++) {
+                gSocket[x].pRxBuffer = NULL;
+                socketFree(&(gSocket[x]));
+            }
+            errnoLocal = U_SOCK_ENONE;
+        }
+    }
+
+    return -errnoLocal;
+}
+
+// Initialise the wifi sockets instance.
+int32_t uWifiSockInitInstance(int32_t wifiHandle)
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uShortRangePrivateInstance_t *pShortRangeInstance;
+    uWifiSockInstance_t *pInstance;
+    int32_t errorCode;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pInstance = pInstanceGet(wifiHandle);
+        if (pInstance != NULL) {
+            errnoLocal = U_SOCK_ENONE;
+        } else {
+            pInstance = pInstanceGet(-1);
+            errnoLocal = U_SOCK_ENOBUFS;
+            if ((pInstance != NULL) &&
+                (uShortRangeLock() == (int32_t) U_ERROR_COMMON_SUCCESS)) {
+                errnoLocal = U_SOCK_EINVAL;
+                pShortRangeInstance = pUShortRangePrivateGetInstance(U_WIFI_PRIVATE_SHORT_RANGE_HANDLE(
+                                                                         wifiHandle));
+                if ((pShortRangeInstance != NULL) &&
+                    (pShortRangeInstance->mode == U_SHORT_RANGE_MODE_EDM)) {
+                    pInstance->streamHandle = pShortRangeInstance->streamHandle;
+                    pInstance->atHandle = pShortRangeInstance->atHandle;
+                    errnoLocal = U_SOCK_ENONE;
+                }
+                uShortRangeUnlock();
+            }
+            if (errnoLocal == U_SOCK_ENONE) {
+                // Get told about IP connections and their data
+                errorCode = uShortRangeEdmStreamWifiEventCallbackSet(pInstance->streamHandle,
+                                                                     wifiEventCallback, pInstance,
+                                                                     U_AT_CLIENT_URC_TASK_STACK_SIZE_BYTES,
+                                                                     U_CFG_OS_PRIORITY_MAX - 5);
+                if (errorCode == 0) {
+                    errorCode = uShortRangeEdmStreamDataEventCallbackSet(pInstance->streamHandle,
+                                                                         U_SHORT_RANGE_CONNECTION_TYPE_WIFI,
+                                                                         dataCallback, pInstance,
+                                                                         U_AT_CLIENT_URC_TASK_STACK_SIZE_BYTES,
+                                                                         U_CFG_OS_PRIORITY_MAX - 5);
+                    if (errorCode != 0) {
+                        uShortRangeEdmStreamWifiEventCallbackRemove(pInstance->streamHandle);
+                    }
+                }
+                if (errorCode == 0) {
+                    pInstance->wifiHandle = wifiHandle;
+                } else {
+                    errnoLocal = U_SOCK_ENOMEM;
+                    pInstance->streamHandle = -1;
+                    pInstance->atHandle = NULL;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return -errnoLocal;
+}
+
+// Deinitialise the wifi sockets layer.
+void uWifiSockDeinit()
+{
+    if (gMutex != NULL) {
+        for (size_t x = 0; x < sizeof(gInstance) / sizeof(gInstance[0]); x++) {
+            if (gInstance[x].wifiHandle >= 0) {
+                instanceRelease(&(gInstance[x]));
+            }
+        }
+
+        U_PORT_MUTEX_LOCK(gMutex);
+        U_PORT_MUTEX_UNLOCK(gMutex);
+        uPortMutexDelete(gMutex);
+        gMutex = NULL;
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CREATE/OPEN/CLOSE/CLEAN-UP
+ * -------------------------------------------------------------- */
+
+// Create a socket.
+int32_t uWifiSockCreate(int32_t wifiHandle,
+                        uSockType_t type,
+                        uSockProtocol_t protocol)
+{
+    int32_t negErrnoLocal = -U_SOCK_EINVAL;
+    uWifiSockInstance_t *pInstance;
+    uWifiSockSocket_t *pSocket = NULL;
+
+    (void) type;
+
+    if ((gMutex != NULL) && ((protocol == U_SOCK_PROTOCOL_TCP) ||
+                             (protocol == U_SOCK_PROTOCOL_UDP))) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pInstance = pInstanceGet(wifiHandle);
+        if (pInstance != NULL) {
+            negErrnoLocal = -U_SOCK_ENOBUFS;
+            for (size_t x = 0; (x < U_WIFI_SOCK_MAX_NUM_SOCKETS) &&
+                 (pSocket == NULL); x++) {
+                if (gSocket[x].sockHandle < 0) {
+                    pSocket = &(gSocket[x]);
+                    negErrnoLocal = -U_SOCK_ENOMEM;
+                    pSocket->pRxBuffer = (char *) malloc(U_WIFI_SOCK_BUFFER_SIZE_BYTES);
+                    if (pSocket->pRxBuffer != NULL) {
+                        pSocket->pInstance = pInstance;
+                        pSocket->protocol = protocol;
+                        pSocket->sockHandle = (int32_t) x;
+                        negErrnoLocal = pSocket->sockHandle;
+                    }
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return negErrnoLocal;
+}
+
+// Connect to a server.
+int32_t uWifiSockConnect(int32_t wifiHandle,
+                         int32_t sockHandle,
+                         const uSockAddress_t *pRemoteAddress)
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uWifiSockSocket_t *pSocket;
+    uAtClientHandle_t atHandle = NULL;
+    char url[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES + 8];
+    int32_t peerHandle = -1;
+    int32_t edmChannel = -1;
+    int64_t startTimeMs;
+
+    if ((gMutex != NULL) && (pRemoteAddress != NULL)) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if (pSocket != NULL) {
+            errnoLocal = U_SOCK_EISCONN;
+            if ((pSocket->peerHandle < 0) && !pSocket->connecting) {
+                // The peer URL, e.g. "tcp://192.168.1.1:5000/"
+                errnoLocal = U_SOCK_EINVAL;
+                memcpy(url, (pSocket->protocol == U_SOCK_PROTOCOL_TCP) ? "tcp://" : "udp://", 6);
+                if (uSockAddressToString(pRemoteAddress, url + 6,
+                                         sizeof(url) - 7) > 0) {
+                    strncat(url, "/", sizeof(url) - strlen(url) - 1);
+                    memcpy(&(pSocket->remoteAddress), pRemoteAddress,
+                           sizeof(pSocket->remoteAddress));
+                    pSocket->connecting = true;
+                    pSocket->closedByRemote = false;
+                    atHandle = pSocket->pInstance->atHandle;
+                    errnoLocal = U_SOCK_ENONE;
+                }
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if (errnoLocal == U_SOCK_ENONE) {
+            uPortLog("U_WIFI_SOCK: connecting socket %d to \"%s\"...\n",
+                     sockHandle, url);
+            uAtClientLock(atHandle);
+            uAtClientTimeoutSet(atHandle,
+                                U_WIFI_SOCK_CONNECT_TIMEOUT_SECONDS * 1000);
+            uAtClientCommandStart(atHandle, "AT+UDCP=");
+            uAtClientWriteString(atHandle, url, true);
+            uAtClientCommandStop(atHandle);
+            uAtClientResponseStart(atHandle, "+UDCP:");
+            peerHandle = uAtClientReadInt(atHandle);
+            uAtClientResponseStop(atHandle);
+            if ((uAtClientUnlock(atHandle) != 0) || (peerHandle < 0)) {
+                peerHandle = -1;
+                errnoLocal = U_SOCK_ECONNREFUSED;
+            }
+
+            if (errnoLocal == U_SOCK_ENONE) {
+                // Wait for the EDM channel of the connection
+                errnoLocal = U_SOCK_ETIMEDOUT;
+                startTimeMs = uPortGetTickTimeMs();
+                while ((edmChannel < 0) && (errnoLocal == U_SOCK_ETIMEDOUT) &&
+                       (uPortGetTickTimeMs() < startTimeMs +
+                        (U_WIFI_SOCK_CONNECT_TIMEOUT_SECONDS * 1000))) {
+                    U_PORT_MUTEX_LOCK(gMutex);
+                    // The socket may have been closed while
+                    // the lock was released
+                    pSocket = pSocketGet(wifiHandle, sockHandle);
+                    if ((pSocket != NULL) && pSocket->connecting) {
+                        edmChannel = pSocket->edmChannel;
+                    } else {
+                        errnoLocal = U_SOCK_EBADF;
+                    }
+                    U_PORT_MUTEX_UNLOCK(gMutex);
+                    if ((edmChannel < 0) && (errnoLocal == U_SOCK_ETIMEDOUT)) {
+                        uPortTaskBlock(U_WIFI_SOCK_CONNECT_POLL_INTERVAL_MS);
+                    }
+                }
+                if (edmChannel >= 0) {
+                    errnoLocal = U_SOCK_ENONE;
+                }
+            }
+
+            U_PORT_MUTEX_LOCK(gMutex);
+            // Check again, the socket may have been closed
+            // while the lock was released
+            pSocket = pSocketGet(wifiHandle, sockHandle);
+            if ((pSocket != NULL) && pSocket->connecting) {
+                pSocket->connecting = false;
+                if (errnoLocal == U_SOCK_ENONE) {
+                    pSocket->peerHandle = peerHandle;
+                }
+            } else {
+                errnoLocal = U_SOCK_EBADF;
+            }
+            U_PORT_MUTEX_UNLOCK(gMutex);
+
+            if ((errnoLocal != U_SOCK_ENONE) && (peerHandle >= 0)) {
+                // Don't leave the peer open if it can't be used
+                (void) peerDisconnect(atHandle, peerHandle);
+                peerHandle = -1;
+            }
+
+            if (errnoLocal == U_SOCK_ENONE) {
+                uPortLog("U_WIFI_SOCK: socket %d connected, peer handle %d,"
+                         " EDM channel %d.\n", sockHandle, peerHandle,
+                         edmChannel);
+            } else {
+                uPortLog("U_WIFI_SOCK: unable to connect socket %d (%d).\n",
+                         sockHandle, errnoLocal);
+            }
+        }
+    }
+
+    return -errnoLocal;
+}
+
+// Close a socket.
+int32_t uWifiSockClose(int32_t wifiHandle,
+                       int32_t sockHandle,
+                       void (*pCallback) (int32_t,
+                                          int32_t))
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uWifiSockSocket_t *pSocket;
+    uAtClientHandle_t atHandle = NULL;
+    int32_t peerHandle = -1;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if (pSocket != NULL) {
+            errnoLocal = U_SOCK_ENONE;
+            if (!pSocket->closedByRemote) {
+                peerHandle = pSocket->peerHandle;
+            }
+            // The disconnect event that results from closing
+            // the peer must not be reported as a remote closure
+            pSocket->pDataCallback = NULL;
+            pSocket->pClosedCallback = NULL;
+            atHandle = pSocket->pInstance->atHandle;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if ((peerHandle >= 0) && (peerDisconnect(atHandle, peerHandle) != 0)) {
+            errnoLocal = U_SOCK_EIO;
+        }
+
+        if (errnoLocal == U_SOCK_ENONE) {
+            U_PORT_MUTEX_LOCK(gMutex);
+            pSocket = pSocketGet(wifiHandle, sockHandle);
+            if (pSocket != NULL) {
+                socketFree(pSocket);
+            }
+            U_PORT_MUTEX_UNLOCK(gMutex);
+            if (pCallback != NULL) {
+                pCallback(wifiHandle, sockHandle);
+            }
+        }
+    }
+
+    return -errnoLocal;
+}
+
+// Clean-up.
+void uWifiSockCleanup(int32_t wifiHandle)
+{
+    // Nothing to do, sockets are freed when they are closed
+    (void) wifiHandle;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: CONFIGURE
+ * -------------------------------------------------------------- */
+
+// Set a socket to be blocking or non-blocking.
+void uWifiSockBlockingSet(int32_t wifiHandle,
+                          int32_t sockHandle,
+                          bool isBlocking)
+{
+    (void) wifiHandle;
+    (void) sockHandle;
+    (void) isBlocking;
+    // Nothing to do: always non-blocking
+}
+
+// Get whether a socket is blocking or not.
+bool uWifiSockBlockingGet(int32_t wifiHandle,
+                          int32_t sockHandle)
+{
+    (void) wifiHandle;
+    (void) sockHandle;
+    // Always non-blocking.
+    return false;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: UDP ONLY
+ * -------------------------------------------------------------- */
+
+// Send a datagram.
+int32_t uWifiSockSendTo(int32_t wifiHandle,
+                        int32_t sockHandle,
+                        const uSockAddress_t *pRemoteAddress,
+                        const void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoOrSize = -U_SOCK_EINVAL;
+    uWifiSockSocket_t *pSocket;
+    bool connected = false;
+
+    if ((gMutex != NULL) && (dataSizeBytes <= U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES)) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if ((pSocket != NULL) && (pSocket->protocol == U_SOCK_PROTOCOL_UDP)) {
+            negErrnoOrSize = -U_SOCK_ENONE;
+            connected = (pSocket->peerHandle >= 0);
+            if (connected && (pRemoteAddress != NULL) &&
+                !addressIsEqual(pRemoteAddress, &(pSocket->remoteAddress))) {
+                // The peer is for one address only
+                negErrnoOrSize = -U_SOCK_EISCONN;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if ((negErrnoOrSize == -U_SOCK_ENONE) && !connected) {
+            negErrnoOrSize = -U_SOCK_EDESTADDRREQ;
+            if (pRemoteAddress != NULL) {
+                negErrnoOrSize = uWifiSockConnect(wifiHandle, sockHandle,
+                                                  pRemoteAddress);
+            }
+        }
+
+        if (negErrnoOrSize == -U_SOCK_ENONE) {
+            negErrnoOrSize = uWifiSockWrite(wifiHandle, sockHandle,
+                                            pData, dataSizeBytes);
+        }
+    }
+
+    return negErrnoOrSize;
+}
+
+// Receive a datagram.
+int32_t uWifiSockReceiveFrom(int32_t wifiHandle,
+                             int32_t sockHandle,
+                             uSockAddress_t *pRemoteAddress,
+                             void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoOrSize = -U_SOCK_EINVAL;
+    uWifiSockSocket_t *pSocket;
+    char datagramLength[U_WIFI_SOCK_DATAGRAM_LENGTH_SIZE];
+    size_t length;
+
+    if ((gMutex != NULL) && ((pData != NULL) || (dataSizeBytes == 0))) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if ((pSocket != NULL) && (pSocket->protocol == U_SOCK_PROTOCOL_UDP)) {
+            negErrnoOrSize = -U_SOCK_EWOULDBLOCK;
+            if (pSocket->rxCount > 0) {
+                rxBufferGet(pSocket, datagramLength, sizeof(datagramLength));
+                length = (((size_t) (uint8_t) datagramLength[0]) << 8) |
+                         (uint8_t) datagramLength[1];
+                if (length > dataSizeBytes) {
+                    // Throw away what doesn't fit
+                    rxBufferGet(pSocket, (char *) pData, dataSizeBytes);
+                    rxBufferGet(pSocket, NULL, length - dataSizeBytes);
+                    length = dataSizeBytes;
+                } else {
+                    rxBufferGet(pSocket, (char *) pData, length);
+                }
+                if (pRemoteAddress != NULL) {
+                    memcpy(pRemoteAddress, &(pSocket->remoteAddress),
+                           sizeof(*pRemoteAddress));
+                }
+                negErrnoOrSize = (int32_t) length;
+            } else if (pSocket->closedByRemote) {
+                negErrnoOrSize = -U_SOCK_ENOTCONN;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return negErrnoOrSize;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: STREAM (TCP)
+ * -------------------------------------------------------------- */
+
+// Send bytes over a connected socket.
+int32_t uWifiSockWrite(int32_t wifiHandle,
+                       int32_t sockHandle,
+                       const void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoOrSize = -U_SOCK_EINVAL;
+    uWifiSockSocket_t *pSocket;
+    int32_t streamHandle = -1;
+    int32_t edmChannel = -1;
+
+    if ((gMutex != NULL) && ((pData != NULL) || (dataSizeBytes == 0))) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if (pSocket != NULL) {
+            negErrnoOrSize = -U_SOCK_ENOTCONN;
+            if ((pSocket->edmChannel >= 0) && !pSocket->closedByRemote) {
+                streamHandle = pSocket->pInstance->streamHandle;
+                edmChannel = pSocket->edmChannel;
+                negErrnoOrSize = -U_SOCK_ENONE;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if ((negErrnoOrSize == -U_SOCK_ENONE) && (dataSizeBytes > 0)) {
+            negErrnoOrSize = uShortRangeEdmStreamWrite(streamHandle, edmChannel,
+                                                       pData, dataSizeBytes);
+            if (negErrnoOrSize < 0) {
+                negErrnoOrSize = -U_SOCK_EIO;
+            }
+        }
+    }
+
+    return negErrnoOrSize;
+}
+
+// Receive bytes on a connected socket.
+int32_t uWifiSockRead(int32_t wifiHandle,
+                      int32_t sockHandle,
+                      void *pData, size_t dataSizeBytes)
+{
+    int32_t negErrnoOrSize = -U_SOCK_EINVAL;
+    uWifiSockSocket_t *pSocket;
+    size_t length;
+
+    if ((gMutex != NULL) && (pData != NULL)) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if ((pSocket != NULL) && (pSocket->protocol == U_SOCK_PROTOCOL_TCP)) {
+            negErrnoOrSize = -U_SOCK_EWOULDBLOCK;
+            if (pSocket->rxCount > 0) {
+                length = pSocket->rxCount;
+                if (length > dataSizeBytes) {
+                    length = dataSizeBytes;
+                }
+                rxBufferGet(pSocket, (char *) pData, length);
+                negErrnoOrSize = (int32_t) length;
+            } else if (pSocket->closedByRemote) {
+                negErrnoOrSize = -U_SOCK_ENOTCONN;
+            }
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+
+    return negErrnoOrSize;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: ASYNC
+ * -------------------------------------------------------------- */
+
+// Register a callback on data being received.
+void uWifiSockRegisterCallbackData(int32_t wifiHandle,
+                                   int32_t sockHandle,
+                                   void (*pCallback) (int32_t,
+                                                      int32_t))
+{
+    uWifiSockSocket_t *pSocket;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if (pSocket != NULL) {
+            pSocket->pDataCallback = pCallback;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+}
+
+// Register a callback on a socket being closed.
+void uWifiSockRegisterCallbackClosed(int32_t wifiHandle,
+                                     int32_t sockHandle,
+                                     void (*pCallback) (int32_t,
+                                                        int32_t))
+{
+    uWifiSockSocket_t *pSocket;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        pSocket = pSocketGet(wifiHandle, sockHandle);
+        if (pSocket != NULL) {
+            pSocket->pClosedCallback = pCallback;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+    }
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: ADDRESS RESOLUTION
+ * -------------------------------------------------------------- */
+
+// Perform a DNS look-up.
+int32_t uWifiSockGetHostByName(int32_t wifiHandle,
+                               const char *pHostName,
+                               uSockIpAddress_t *pHostIpAddress)
+{
+    int32_t errnoLocal = U_SOCK_EINVAL;
+    uAtClientHandle_t atHandle = NULL;
+    int32_t bytesRead;
+    char buffer[U_SOCK_ADDRESS_STRING_MAX_LENGTH_BYTES];
+    uSockAddress_t address;
+
+    if ((gMutex != NULL) && (pHostName != NULL)) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+
+        if (pInstanceGet(wifiHandle) != NULL) {
+            atHandle = pInstanceGet(wifiHandle)->atHandle;
+        }
+
+        U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if (atHandle != NULL) {
+            uPortLog("U_WIFI_SOCK: looking up IP address of \"%s\".\n",
+                     pHostName);
+            errnoLocal = U_SOCK_ENXIO;
+            uAtClientLock(atHandle);
+            uAtClientTimeoutSet(atHandle,
+                                U_WIFI_SOCK_DNS_LOOKUP_TIME_SECONDS * 1000);
+            uAtClientCommandStart(atHandle, "AT+UDNSRN=");
+            uAtClientWriteInt(atHandle, 0);
+            uAtClientWriteString(atHandle, pHostName, true);
+            uAtClientCommandStop(atHandle);
+            uAtClientResponseStart(atHandle, "+UDNSRN:");
+            bytesRead = uAtClientReadString(atHandle, buffer,
+                                            sizeof(buffer), false);
+            uAtClientResponseStop(atHandle);
+            if ((uAtClientUnlock(atHandle) == 0) && (bytesRead > 0)) {
+                uPortLog("U_WIFI_SOCK: found it at \"%.*s\".\n",
+                         bytesRead, buffer);
+                errnoLocal = U_SOCK_ENONE;
+                if (pHostIpAddress != NULL) {
+                    errnoLocal = U_SOCK_ENXIO;
+                    if (uSockStringToAddress(buffer, &address) == 0) {
+                        errnoLocal = U_SOCK_ENONE;
+                        memcpy(pHostIpAddress, &(address.ipAddress),
+                               sizeof(*pHostIpAddress));
+                    }
+                }
+            } else {
+                uPortLog("U_WIFI_SOCK: host not found.\n");
+            }
+        }
+    }
+
+    return -errnoLocal;
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS: PRIVATE TO WIFI
+ * -------------------------------------------------------------- */
+
+void uWifiSockPrivateRemoveInstance(int32_t wifiHandle)
+{
+    uWifiSockInstance_t *pInstance = NULL;
+
+    if (gMutex != NULL) {
+
+        U_PORT_MUTEX_LOCK(gMutex);
+        pInstance = pInstanceGet(wifiHandle);
+        U_PORT_MUTEX_UNLOCK(gMutex);
+
+        if ((pInstance != NULL) && (wifiHandle >= 0)) {
+            instanceRelease(pInstance);
+        }
+    }
+}
+
+// End of file
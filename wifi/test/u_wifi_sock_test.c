@@ -0,0 +1,448 @@
+/*
+ * Copyright 2020 u-blox Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Only #includes of u_* and the C standard library are allowed here,
+ * no platform stuff and no OS stuff.  Anything required from
+ * the platform/OS must be brought in through u_port* to maintain
+ * portability.
+ */
+
+/** @file
+ * @brief Tests for the wifi sockets API: these should pass on all
+ * platforms that have a short range module connected to them which
+ * can reach an access point.  They are only compiled if
+ * U_CFG_TEST_SHORT_RANGE_MODULE_TYPE and U_CFG_TEST_WIFI_SSID are
+ * defined.
+ */
+
+#if defined(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE) && defined(U_CFG_TEST_WIFI_SSID)
+
+# ifdef U_CFG_OVERRIDE
+#  include "u_cfg_override.h" // For a customer's configuration override
+# endif
+
+#include "stdlib.h"    // malloc(), free()
+#include "stddef.h"    // NULL, size_t etc.
+#include "stdint.h"    // int32_t etc.
+#include "stdbool.h"
+#include "string.h"    // memset(), memcmp()
+
+#include "u_cfg_sw.h"
+#include "u_cfg_os_platform_specific.h"
+#include "u_cfg_app_platform_specific.h"
+#include "u_cfg_test_platform_specific.h"
+
+#include "u_error_common.h"
+
+#include "u_port.h"
+#include "u_port_debug.h"
+#include "u_port_os.h"
+#include "u_port_uart.h"
+
+#include "u_at_client.h"
+
+#include "u_short_range_module_type.h"
+#include "u_short_range.h"
+#include "u_short_range_edm_stream.h"
+
+#include "u_sock_errno.h"
+#include "u_sock.h"
+
+#include "u_wifi_module_type.h"
+#include "u_wifi.h"
+#include "u_wifi_net.h"
+#include "u_wifi_sock.h"
+
+#include "u_sock_test_shared_cfg.h"   // For some of the test macros
+
+/* ----------------------------------------------------------------
+ * COMPILE-TIME MACROS
+ * -------------------------------------------------------------- */
+
+#ifndef U_WIFI_SOCK_TEST_RECEIVE_TIMEOUT_SECONDS
+/** How long to wait for echoed data to come back.
+ */
+# define U_WIFI_SOCK_TEST_RECEIVE_TIMEOUT_SECONDS 10
+#endif
+
+/* ----------------------------------------------------------------
+ * TYPES
+ * -------------------------------------------------------------- */
+
+/** The handles of everything underneath a wifi instance.
+ */
+typedef struct {
+    int32_t uartHandle;
+    int32_t edmStreamHandle;
+    uAtClientHandle_t atClientHandle;
+    int32_t wifiHandle;
+} uWifiSockTestHandles_t;
+
+/* ----------------------------------------------------------------
+ * VARIABLES
+ * -------------------------------------------------------------- */
+
+/** Generic handles.
+ */
+static uWifiSockTestHandles_t gHandles = {-1, -1, NULL, -1};
+
+/** UDP socket handle.
+ */
+static int32_t gSockHandleUdp = -1;
+
+/** TCP socket handle.
+ */
+static int32_t gSockHandleTcp = -1;
+
+/** Flag to indicate that the UDP data
+ * callback has been called.
+ */
+static volatile bool gDataCallbackCalledUdp = false;
+
+/** Flag to indicate that the TCP data
+ * callback has been called.
+ */
+static volatile bool gDataCallbackCalledTcp = false;
+
+/** Flag to indicate that a closed callback
+ * has been called.
+ */
+static volatile bool gClosedCallbackCalled = false;
+
+/** Data to send over the sockets.
+ */
+static const char gAllChars[] = "the quick brown fox jumps over the lazy dog "
+                                "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789 "
+                                "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f"
+                                "\x10\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f"
+                                "\x80\x81\x82\x83\x84\x85\x86\x87\x88\x89\x8a\x8b\x8c\x8d\x8e\x8f"
+                                "\xf0\xf1\xf2\xf3\xf4\xf5\xf6\xf7\xf8\xf9\xfa\xfb\xfc\xfd\xfe\xff";
+
+/* ----------------------------------------------------------------
+ * STATIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+// Callback for data being received on the UDP socket.
+static void dataCallbackUdp(int32_t wifiHandle, int32_t sockHandle)
+{
+    if ((wifiHandle == gHandles.wifiHandle) && (sockHandle == gSockHandleUdp)) {
+        gDataCallbackCalledUdp = true;
+    }
+}
+
+// Callback for data being received on the TCP socket.
+static void dataCallbackTcp(int32_t wifiHandle, int32_t sockHandle)
+{
+    if ((wifiHandle == gHandles.wifiHandle) && (sockHandle == gSockHandleTcp)) {
+        gDataCallbackCalledTcp = true;
+    }
+}
+
+// Callback for a socket being closed by the remote host.
+static void closedCallback(int32_t wifiHandle, int32_t sockHandle)
+{
+    (void) wifiHandle;
+    (void) sockHandle;
+    gClosedCallbackCalled = true;
+}
+
+// Open the UART, EDM stream and AT client for a wifi instance,
+// add the instance and connect it to the access point.
+static int32_t preamble(uWifiSockTestHandles_t *pHandles)
+{
+    int32_t errorCode;
+
+    U_PORT_TEST_ASSERT(uPortInit() == 0);
+    U_PORT_TEST_ASSERT(uShortRangeEdmStreamInit() == 0);
+    U_PORT_TEST_ASSERT(uAtClientInit() == 0);
+    U_PORT_TEST_ASSERT(uWifiInit() == 0);
+
+    pHandles->uartHandle = uPortUartOpen(U_CFG_APP_SHORT_RANGE_UART,
+                                         U_WIFI_UART_BAUD_RATE, NULL,
+                                         U_WIFI_UART_BUFFER_LENGTH_BYTES,
+                                         U_CFG_APP_PIN_SHORT_RANGE_TXD,
+                                         U_CFG_APP_PIN_SHORT_RANGE_RXD,
+                                         U_CFG_APP_PIN_SHORT_RANGE_CTS,
+                                         U_CFG_APP_PIN_SHORT_RANGE_RTS);
+    U_PORT_TEST_ASSERT(pHandles->uartHandle >= 0);
+
+    pHandles->edmStreamHandle = uShortRangeEdmStreamOpen(pHandles->uartHandle);
+    U_PORT_TEST_ASSERT(pHandles->edmStreamHandle >= 0);
+
+    pHandles->atClientHandle = uAtClientAdd(pHandles->edmStreamHandle,
+                                            U_AT_CLIENT_STREAM_TYPE_EDM,
+                                            NULL, U_WIFI_AT_BUFFER_LENGTH_BYTES);
+    U_PORT_TEST_ASSERT(pHandles->atClientHandle != NULL);
+    uShortRangeEdmStreamSetAtHandle(pHandles->edmStreamHandle,
+                                    pHandles->atClientHandle);
+
+    pHandles->wifiHandle = uWifiAdd((uWifiModuleType_t) U_CFG_TEST_SHORT_RANGE_MODULE_TYPE,
+                                    pHandles->atClientHandle);
+    U_PORT_TEST_ASSERT(pHandles->wifiHandle >= 0);
+    U_PORT_TEST_ASSERT(uWifiDetectModule(pHandles->wifiHandle) ==
+                       (uWifiModuleType_t) U_CFG_TEST_SHORT_RANGE_MODULE_TYPE);
+
+    uPortLog("U_WIFI_SOCK_TEST: connecting to \"%s\"...\n",
+             U_PORT_STRINGIFY_QUOTED(U_CFG_TEST_WIFI_SSID));
+    errorCode = uWifiNetStationConnect(pHandles->wifiHandle,
+                                       U_PORT_STRINGIFY_QUOTED(U_CFG_TEST_WIFI_SSID),
+#ifdef U_CFG_TEST_WIFI_PASSPHRASE
+                                       U_WIFI_NET_AUTH_WPA_PSK,
+                                       U_PORT_STRINGIFY_QUOTED(U_CFG_TEST_WIFI_PASSPHRASE));
+#else
+                                       U_WIFI_NET_AUTH_OPEN, NULL);
+#endif
+
+    return errorCode;
+}
+
+// Undo preamble(); safe to call on a partially completed preamble.
+static void postamble(uWifiSockTestHandles_t *pHandles)
+{
+    if (pHandles->wifiHandle >= 0) {
+        uWifiNetStationDisconnect(pHandles->wifiHandle);
+        uWifiRemove(pHandles->wifiHandle);
+        pHandles->wifiHandle = -1;
+    }
+    uWifiDeinit();
+    if (pHandles->atClientHandle != NULL) {
+        uAtClientRemove(pHandles->atClientHandle);
+        pHandles->atClientHandle = NULL;
+    }
+    uAtClientDeinit();
+    if (pHandles->edmStreamHandle >= 0) {
+        uShortRangeEdmStreamClose(pHandles->edmStreamHandle);
+        pHandles->edmStreamHandle = -1;
+    }
+    uShortRangeEdmStreamDeinit();
+    if (pHandles->uartHandle >= 0) {
+        uPortUartClose(pHandles->uartHandle);
+        pHandles->uartHandle = -1;
+    }
+    uPortDeinit();
+}
+
+/* ----------------------------------------------------------------
+ * PUBLIC FUNCTIONS
+ * -------------------------------------------------------------- */
+
+/** Connect to the access point, then connect a UDP and a TCP
+ * socket to the echo servers and check that what is sent
+ * comes back.
+ */
+U_PORT_TEST_FUNCTION("[wifiSock]", "wifiSockBasic")
+{
+    int32_t wifiHandle;
+    uSockAddress_t echoServerAddressUdp;
+    uSockAddress_t echoServerAddressTcp;
+    uSockAddress_t address;
+    char *pBuffer;
+    int32_t y;
+    size_t count;
+    int64_t startTimeMs;
+    int32_t heapUsed;
+
+    // In case a previous test failed
+    uWifiSockDeinit();
+    postamble(&gHandles);
+
+    // Obtain the initial heap size
+    heapUsed = uPortGetHeapFree();
+
+    memset(&echoServerAddressUdp, 0, sizeof(echoServerAddressUdp));
+    memset(&echoServerAddressTcp, 0, sizeof(echoServerAddressTcp));
+    memset(&address, 0, sizeof(address));
+
+    // Malloc a buffer to receive things into
+    pBuffer = (char *) malloc(U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES);
+    U_PORT_TEST_ASSERT(pBuffer != NULL);
+
+    // Bring up the instance and connect to the access point
+    U_PORT_TEST_ASSERT(preamble(&gHandles) == 0);
+    wifiHandle = gHandles.wifiHandle;
+
+    // Init wifi sockets
+    U_PORT_TEST_ASSERT(uWifiSockInit() == 0);
+    U_PORT_TEST_ASSERT(uWifiSockInitInstance(wifiHandle) == 0);
+
+    // Look up the addresses of the echo servers
+    U_PORT_TEST_ASSERT(uWifiSockGetHostByName(wifiHandle,
+                                              U_SOCK_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+                                              &(echoServerAddressUdp.ipAddress)) == 0);
+    echoServerAddressUdp.port = U_SOCK_TEST_ECHO_UDP_SERVER_PORT;
+    U_PORT_TEST_ASSERT(uWifiSockGetHostByName(wifiHandle,
+                                              U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+                                              &(echoServerAddressTcp.ipAddress)) == 0);
+    echoServerAddressTcp.port = U_SOCK_TEST_ECHO_TCP_SERVER_PORT;
+
+    // Create the sockets and add callbacks
+    gSockHandleUdp = uWifiSockCreate(wifiHandle, U_SOCK_TYPE_DGRAM,
+                                     U_SOCK_PROTOCOL_UDP);
+    U_PORT_TEST_ASSERT(gSockHandleUdp >= 0);
+    gSockHandleTcp = uWifiSockCreate(wifiHandle, U_SOCK_TYPE_STREAM,
+                                     U_SOCK_PROTOCOL_TCP);
+    U_PORT_TEST_ASSERT(gSockHandleTcp >= 0);
+    uWifiSockRegisterCallbackData(wifiHandle, gSockHandleUdp,
+                                  dataCallbackUdp);
+    uWifiSockRegisterCallbackData(wifiHandle, gSockHandleTcp,
+                                  dataCallbackTcp);
+    uWifiSockRegisterCallbackClosed(wifiHandle, gSockHandleUdp,
+                                    closedCallback);
+    uWifiSockRegisterCallbackClosed(wifiHandle, gSockHandleTcp,
+                                    closedCallback);
+
+    // Send and wait for the UDP echo data, trying a few
+    // times to reduce the chance of internet loss getting
+    // in the way; the first send connects the socket
+    uPortLog("U_WIFI_SOCK_TEST: sending %d byte(s) to %s:%d...\n",
+             sizeof(gAllChars), U_SOCK_TEST_ECHO_UDP_SERVER_DOMAIN_NAME,
+             U_SOCK_TEST_ECHO_UDP_SERVER_PORT);
+    y = 0;
+    for (size_t x = 0; (x < U_SOCK_TEST_UDP_RETRIES) &&
+         (y != sizeof(gAllChars)); x++) {
+        y = uWifiSockSendTo(wifiHandle, gSockHandleUdp,
+                            &echoServerAddressUdp,
+                            gAllChars, sizeof(gAllChars));
+        if (y == sizeof(gAllChars)) {
+            y = -U_SOCK_EWOULDBLOCK;
+            startTimeMs = uPortGetTickTimeMs();
+            while ((y == -U_SOCK_EWOULDBLOCK) &&
+                   (uPortGetTickTimeMs() < startTimeMs +
+                    (U_WIFI_SOCK_TEST_RECEIVE_TIMEOUT_SECONDS * 1000))) {
+                y = uWifiSockReceiveFrom(wifiHandle, gSockHandleUdp,
+                                         &address, pBuffer,
+                                         U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES);
+                if (y == -U_SOCK_EWOULDBLOCK) {
+                    uPortTaskBlock(100);
+                }
+            }
+            if (y != sizeof(gAllChars)) {
+                uPortLog("U_WIFI_SOCK_TEST: failed to receive UDP echo"
+                         " on try %d.\n", x + 1);
+            }
+        } else {
+            uPortLog("U_WIFI_SOCK_TEST: failed to send UDP data on"
+                     " try %d (%d).\n", x + 1, y);
+        }
+    }
+    uPortLog("U_WIFI_SOCK_TEST: %d byte(s) echoed over UDP.\n", y);
+    U_PORT_TEST_ASSERT(y == sizeof(gAllChars));
+    U_PORT_TEST_ASSERT(gDataCallbackCalledUdp);
+    U_PORT_TEST_ASSERT(memcmp(pBuffer, gAllChars, sizeof(gAllChars)) == 0);
+    U_PORT_TEST_ASSERT(memcmp(&(address.ipAddress),
+                              &(echoServerAddressUdp.ipAddress),
+                              sizeof(address.ipAddress)) == 0);
+    U_PORT_TEST_ASSERT(address.port == echoServerAddressUdp.port);
+
+    // Connect the TCP socket, a second connect should fail
+    U_PORT_TEST_ASSERT(uWifiSockConnect(wifiHandle, gSockHandleTcp,
+                                        &echoServerAddressTcp) == 0);
+    U_PORT_TEST_ASSERT(uWifiSockConnect(wifiHandle, gSockHandleTcp,
+                                        &echoServerAddressTcp) == -U_SOCK_EISCONN);
+
+    // Send the TCP data and read back the echo, which
+    // may arrive in pieces
+    uPortLog("U_WIFI_SOCK_TEST: sending %d byte(s) to %s:%d...\n",
+             sizeof(gAllChars), U_SOCK_TEST_ECHO_TCP_SERVER_DOMAIN_NAME,
+             U_SOCK_TEST_ECHO_TCP_SERVER_PORT);
+    U_PORT_TEST_ASSERT(uWifiSockWrite(wifiHandle, gSockHandleTcp,
+                                      gAllChars, sizeof(gAllChars)) == sizeof(gAllChars));
+    memset(pBuffer, 0, U_WIFI_SOCK_MAX_SEGMENT_SIZE_BYTES);
+    count = 0;
+    startTimeMs = uPortGetTickTimeMs();
+    while ((count < sizeof(gAllChars)) &&
+           (uPortGetTickTimeMs() < startTimeMs +
+            (U_WIFI_SOCK_TEST_RECEIVE_TIMEOUT_SECONDS * 1000))) {
+        y = uWifiSockRead(wifiHandle, gSockHandleTcp, pBuffer + count,
+                          sizeof(gAllChars) - count);
+        if (y > 0) {
+            count += y;
+        } else {
+            U_PORT_TEST_ASSERT(y == -U_SOCK_EWOULDBLOCK);
+            uPortTaskBlock(100);
+        }
+    }
+    uPortLog("U_WIFI_SOCK_TEST: %d byte(s) echoed over TCP.\n", count);
+    U_PORT_TEST_ASSERT(count == sizeof(gAllChars));
+    U_PORT_TEST_ASSERT(gDataCallbackCalledTcp);
+    U_PORT_TEST_ASSERT(memcmp(pBuffer, gAllChars, sizeof(gAllChars)) == 0);
+
+    // Close the sockets: a local close is not reported
+    // through the closed callback
+    U_PORT_TEST_ASSERT(uWifiSockClose(wifiHandle, gSockHandleUdp, NULL) == 0);
+    gSockHandleUdp = -1;
+    U_PORT_TEST_ASSERT(uWifiSockClose(wifiHandle, gSockHandleTcp, NULL) == 0);
+    gSockHandleTcp = -1;
+    U_PORT_TEST_ASSERT(!gClosedCallbackCalled);
+
+    uWifiSockDeinit();
+    postamble(&gHandles);
+    free(pBuffer);
+
+#ifndef __XTENSA__
+    // Check for memory leaks
+    // TODO: this if'ed out for ESP32 (xtensa compiler) at
+    // the moment as there is an issue with ESP32 hanging
+    // on to memory in the UART drivers that can't easily be
+    // accounted for.
+    heapUsed -= uPortGetHeapFree();
+    uPortLog("U_WIFI_SOCK_TEST: we have leaked %d byte(s).\n", heapUsed);
+    // heapUsed < 0 for the Zephyr case where the heap can look
+    // like it increases (negative leak)
+    U_PORT_TEST_ASSERT(heapUsed <= 0);
+#else
+    (void) heapUsed;
+#endif
+}
+
+/** Clean-up to be run at the end of this round of tests, just
+ * in case there were test failures which would have resulted
+ * in the deinitialisation being skipped.
+ */
+U_PORT_TEST_FUNCTION("[wifiSock]", "wifiSockCleanUp")
+{
+    int32_t x;
+
+    if (gHandles.wifiHandle >= 0) {
+        if (gSockHandleUdp >= 0) {
+            uWifiSockClose(gHandles.wifiHandle, gSockHandleUdp, NULL);
+        }
+        if (gSockHandleTcp >= 0) {
+            uWifiSockClose(gHandles.wifiHandle, gSockHandleTcp, NULL);
+        }
+    }
+    gSockHandleUdp = -1;
+    gSockHandleTcp = -1;
+    uWifiSockDeinit();
+
+    x = uPortTaskStackMinFree(NULL);
+    uPortLog("U_WIFI_SOCK_TEST: main task stack had a minimum of %d"
+             " byte(s) free at the end of these tests.\n", x);
+    U_PORT_TEST_ASSERT(x >= U_CFG_TEST_OS_MAIN_TASK_MIN_FREE_STACK_BYTES);
+
+    postamble(&gHandles);
+
+    x = uPortGetHeapMinFree();
+    if (x >= 0) {
+        uPortLog("U_WIFI_SOCK_TEST: heap had a minimum of %d"
+                 " byte(s) free at the end of these tests.\n", x);
+        U_PORT_TEST_ASSERT(x >= U_CFG_TEST_HEAP_MIN_FREE_BYTES);
+    }
+}
+
+#endif // defined(U_CFG_TEST_SHORT_RANGE_MODULE_TYPE) && defined(U_CFG_TEST_WIFI_SSID)
+
+// End of file